@@ -0,0 +1,1924 @@
+//
+// fc2sim.c
+//
+// Simulated Point Grey cameras behind the subset of the FlyCapture2
+// C API that idlpgr uses.  Built as a stand-in for libflycapture-c
+// so that the DLM and native benchmarks can run end to end on a
+// machine without cameras.
+//
+// Each simulated camera runs a thread that exposes frames at the
+// camera's frame rate and delivers them into a ring of driver
+// buffers, or to a callback.  Frames carry embedded image
+// information, time stamps derived from a simulated cycle timer,
+// and a frame counter that reveals frames lost in transit.
+//
+// The cameras are described by environment variables, read when
+// the first context is created:
+//
+//   FC2SIM_CAMERAS    number of cameras (1)
+//   FC2SIM_WIDTH      sensor width [pixels] (1280)
+//   FC2SIM_HEIGHT     sensor height [pixels] (1024)
+//   FC2SIM_FORMAT     MONO8, MONO12, MONO16, RAW8, RAW12, RAW16
+//                     or RGB8 (MONO8).  RAW and RGB formats
+//                     describe a color camera.
+//   FC2SIM_RATE       highest frame rate [frames/s] (30)
+//   FC2SIM_JITTER     rms jitter of the frame period [s] (0)
+//   FC2SIM_DROP       probability that a frame is lost (0)
+//   FC2SIM_INCOMPLETE probability that a frame arrives with
+//                     missing data (0)
+//   FC2SIM_CORRUPT    probability that a frame fails the driver's
+//                     consistency check (0)
+//   FC2SIM_INTERFACE  USB3 or GIGE (USB3)
+//   FC2SIM_MTU        largest GigE packet that arrives intact
+//                     [bytes] (9000)
+//   FC2SIM_SEED       seed of the random number generator (1)
+//
+// The frame rate is the lowest of the FRAME_RATE property, the rate
+// allowed by the shutter, and the rate that the packet size allows:
+// one Format7 packet per 125 us bus cycle for USB3, and a 1 Gb/s
+// link shared with packet overhead and inter-packet delay for GigE.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "C/FlyCapture2_C.h"
+
+#define FC2SIM_GUID        0x53494D00  // identifies simulated cameras
+#define FC2SIM_SERIAL      10000000
+#define FC2SIM_NBUFFERS    10          // default driver buffers
+#define FC2SIM_NREGISTERS  64
+#define FC2SIM_NSTROBES    4
+#define FC2SIM_SOFTWARE    7           // software trigger source
+#define FC2SIM_CYCLE_RATE  24576000ULL // cycle timer ticks per second
+#define FC2SIM_BUS_CYCLE   8000.       // bus cycles per second
+#define FC2SIM_GIGE_RATE   125e6       // GigE link [bytes/s]
+#define FC2SIM_GIGE_HEADER 90          // bytes of overhead per packet
+#define FC2SIM_PACKET_UNIT 4
+#define FC2SIM_USB_PACKET  49152       // largest USB3 Format7 packet
+#define FC2SIM_GIGE_PACKET 9000        // largest GigE packet
+#define FC2SIM_ALIGN       4096
+
+enum {
+  FC2SIM_FREE,                 // available to the camera
+  FC2SIM_FILLING,              // being written by the camera
+  FC2SIM_READY,                // holds a frame that was not retrieved
+  FC2SIM_LOCKED                // being read, or held by an fc2Image
+};
+
+typedef struct fc2sim_options {
+  unsigned int ncameras;
+  unsigned int width;
+  unsigned int height;
+  fc2PixelFormat format;
+  double rate;
+  double jitter;
+  double drop;
+  double incomplete;
+  double corrupt;
+  fc2InterfaceType interface;
+  unsigned int mtu;
+  uint64_t seed;
+} fc2sim_options;
+
+static fc2sim_options options;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static unsigned long long origin; // [ns] time at which the cycle timer started
+
+typedef struct fc2sim_context fc2sim_context;
+
+//
+// Private state of an fc2Image.  The state travels with the
+// fc2Image's contents when they are copied, so images can be
+// exchanged by assignment.
+//
+typedef struct fc2sim_image {
+  unsigned char *data;
+  size_t capacity;
+  int external;                // data was provided by fc2SetImageData
+  fc2TimeStamp timestamp;
+  fc2sim_context *context;     // context whose user buffer is held
+  unsigned int slot;
+} fc2sim_image;
+
+typedef struct fc2sim_slot {
+  unsigned char *data;
+  int state;
+  unsigned long long sequence;
+  unsigned int received;       // bytes that arrived
+  fc2Error error;
+  fc2TimeStamp timestamp;
+  fc2sim_image *holder;        // image that holds a user buffer
+} fc2sim_slot;
+
+struct fc2sim_context {
+  int camera;                  // index of the camera, or -1
+  pthread_mutex_t lock;
+  pthread_cond_t ready;        // a frame is ready, or capture stopped
+  pthread_cond_t triggered;    // a software trigger fired
+  fc2Config config;
+  fc2Format7ImageSettings settings;
+  unsigned int packetsize;
+  fc2GigEStreamChannel channel;
+  fc2PropertyInfo info[FC2_UNSPECIFIED_PROPERTY_TYPE];
+  fc2Property property[FC2_UNSPECIFIED_PROPERTY_TYPE];
+  fc2TriggerMode triggermode;
+  fc2StrobeControl strobe[FC2SIM_NSTROBES];
+  fc2EmbeddedImageInfo embedded;
+  unsigned int nregisters;
+  unsigned int address[FC2SIM_NREGISTERS];
+  unsigned int value[FC2SIM_NREGISTERS];
+
+  // capture
+  int capturing;
+  int running;                 // cleared to stop the camera thread
+  pthread_t thread;
+  fc2ImageEventCallback callback;
+  void *callbackdata;
+  unsigned char *userbuffers;
+  unsigned int usersize;
+  unsigned int nuserbuffers;
+  unsigned char *buffers;      // driver buffers, unless user buffers are set
+  fc2sim_slot *slot;
+  unsigned int nslots;
+  unsigned int rows, cols, stride;
+  fc2PixelFormat format;
+  size_t framesize;
+  unsigned char *pattern;      // framesize + FC2SIM_ALIGN bytes of scene
+  unsigned long long sequence; // frames exposed
+  unsigned long long start;    // [ns] first exposure
+  unsigned int triggers;       // software triggers not yet served
+  uint64_t random;
+
+  fc2sim_context *next;
+};
+
+static pthread_mutex_t contextslock = PTHREAD_MUTEX_INITIALIZER;
+static fc2sim_context *contexts = NULL;
+
+//
+// Time
+//
+static unsigned long long fc2sim_Now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void fc2sim_SleepUntil(unsigned long long deadline)
+{
+  struct timespec ts;
+
+  ts.tv_sec = deadline / 1000000000ULL;
+  ts.tv_nsec = deadline % 1000000000ULL;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
+
+//
+// Time stamp of the monotonic time t [ns]: host time, and the
+// cycle time of the simulated bus, which starts with the library.
+//
+static fc2TimeStamp fc2sim_TimeStamp(unsigned long long t)
+{
+  fc2TimeStamp ts;
+  struct timespec host;
+  unsigned long long ticks, now;
+
+  memset(&ts, 0, sizeof(fc2TimeStamp));
+
+  now = fc2sim_Now();
+  clock_gettime(CLOCK_REALTIME, &host);
+  host.tv_sec -= (now - t) / 1000000000ULL;
+  host.tv_nsec -= (now - t) % 1000000000ULL;
+  if (host.tv_nsec < 0) {
+    host.tv_sec--;
+    host.tv_nsec += 1000000000L;
+  }
+  ts.seconds = host.tv_sec;
+  ts.microSeconds = host.tv_nsec / 1000;
+
+  ticks = (t - origin) / 1000ULL * FC2SIM_CYCLE_RATE / 1000000ULL;
+  ts.cycleSeconds = (ticks / FC2SIM_CYCLE_RATE) % 128;
+  ts.cycleCount = (ticks % FC2SIM_CYCLE_RATE) / 3072;
+  ts.cycleOffset = ticks % 3072;
+
+  return ts;
+}
+
+//
+// Random numbers: xorshift64*
+//
+static double fc2sim_Uniform(uint64_t *state)
+{
+  uint64_t x = *state;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return (double) ((x * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.;
+}
+
+static double fc2sim_Gaussian(uint64_t *state)
+{
+  double u = fc2sim_Uniform(state);
+
+  return sqrt(-2. * log(u > 0. ? u : 1e-300)) *
+    cos(2. * M_PI * fc2sim_Uniform(state));
+}
+
+//
+// Options
+//
+static double fc2sim_Option(const char *name, double value)
+{
+  const char *s = getenv(name);
+
+  return (s && *s) ? atof(s) : value;
+}
+
+static fc2PixelFormat fc2sim_ParseFormat(const char *s)
+{
+  static const struct {
+    const char *name;
+    fc2PixelFormat format;
+  } formats[] = {
+    { "MONO8",  FC2_PIXEL_FORMAT_MONO8 },
+    { "MONO12", FC2_PIXEL_FORMAT_MONO12 },
+    { "MONO16", FC2_PIXEL_FORMAT_MONO16 },
+    { "RAW8",   FC2_PIXEL_FORMAT_RAW8 },
+    { "RAW12",  FC2_PIXEL_FORMAT_RAW12 },
+    { "RAW16",  FC2_PIXEL_FORMAT_RAW16 },
+    { "RGB8",   FC2_PIXEL_FORMAT_RGB8 },
+  };
+  size_t n;
+
+  for (n = 0; s && n < sizeof(formats)/sizeof(formats[0]); n++)
+    if (!strcasecmp(s, formats[n].name))
+      return formats[n].format;
+  return FC2_PIXEL_FORMAT_MONO8;
+}
+
+static void fc2sim_Initialize(void)
+{
+  const char *s;
+
+  options.ncameras = (unsigned int) fc2sim_Option("FC2SIM_CAMERAS", 1);
+  options.width = (unsigned int) fc2sim_Option("FC2SIM_WIDTH", 1280);
+  options.height = (unsigned int) fc2sim_Option("FC2SIM_HEIGHT", 1024);
+  options.format = fc2sim_ParseFormat(getenv("FC2SIM_FORMAT"));
+  options.rate = fc2sim_Option("FC2SIM_RATE", 30.);
+  options.jitter = fc2sim_Option("FC2SIM_JITTER", 0.);
+  options.drop = fc2sim_Option("FC2SIM_DROP", 0.);
+  options.incomplete = fc2sim_Option("FC2SIM_INCOMPLETE", 0.);
+  options.corrupt = fc2sim_Option("FC2SIM_CORRUPT", 0.);
+  s = getenv("FC2SIM_INTERFACE");
+  options.interface = (s && !strcasecmp(s, "GIGE")) ?
+    FC2_INTERFACE_GIGE : FC2_INTERFACE_USB_3;
+  options.mtu = (unsigned int) fc2sim_Option("FC2SIM_MTU", 9000);
+  options.seed = (uint64_t) fc2sim_Option("FC2SIM_SEED", 1);
+
+  // sizes are kept to multiples of the Format7 steps
+  options.width = (options.width < 16) ? 16 : options.width & ~15U;
+  options.height = (options.height < 4) ? 4 : options.height & ~3U;
+  if (options.rate <= 0.)
+    options.rate = 30.;
+  if (!options.seed)
+    options.seed = 1;
+
+  origin = fc2sim_Now();
+}
+
+static int fc2sim_IsColor(fc2PixelFormat format)
+{
+  return (format == FC2_PIXEL_FORMAT_RAW8 ||
+	  format == FC2_PIXEL_FORMAT_RAW12 ||
+	  format == FC2_PIXEL_FORMAT_RAW16 ||
+	  format == FC2_PIXEL_FORMAT_RGB8);
+}
+
+static unsigned int fc2sim_PixelFormats(void)
+{
+  if (fc2sim_IsColor(options.format))
+    return FC2_PIXEL_FORMAT_RAW8 | FC2_PIXEL_FORMAT_RAW12 |
+      FC2_PIXEL_FORMAT_RAW16 | FC2_PIXEL_FORMAT_RGB8 | FC2_PIXEL_FORMAT_MONO8;
+  return FC2_PIXEL_FORMAT_MONO8 | FC2_PIXEL_FORMAT_MONO12 |
+    FC2_PIXEL_FORMAT_MONO16;
+}
+
+//
+// Bytes per row of an image
+//
+static unsigned int fc2sim_Stride(unsigned int cols, fc2PixelFormat format)
+{
+  switch (format) {
+  case FC2_PIXEL_FORMAT_MONO12:
+  case FC2_PIXEL_FORMAT_RAW12:
+    return (cols * 3 + 1) / 2;
+  case FC2_PIXEL_FORMAT_MONO16:
+  case FC2_PIXEL_FORMAT_RAW16:
+    return 2 * cols;
+  case FC2_PIXEL_FORMAT_RGB8:
+    return 3 * cols;
+  default:
+    return cols;
+  }
+}
+
+//
+// Contexts
+//
+static fc2sim_context *fc2sim_Context(fc2Context context)
+{
+  pthread_once(&once, fc2sim_Initialize);
+  return (fc2sim_context *) context;
+}
+
+static fc2sim_context *fc2sim_Camera(fc2Context context, fc2Error *error)
+{
+  fc2sim_context *c = fc2sim_Context(context);
+
+  *error = !c ? FC2_ERROR_INVALID_PARAMETER :
+    (c->camera < 0) ? FC2_ERROR_NOT_CONNECTED : FC2_ERROR_OK;
+  return *error ? NULL : c;
+}
+
+static void fc2sim_Property(fc2sim_context *c, fc2PropertyType type,
+			    int abs, unsigned int min, unsigned int max,
+			    float absmin, float absmax, float value,
+			    const char *units, const char *abbr)
+{
+  fc2PropertyInfo *info = &c->info[type];
+  fc2Property *property = &c->property[type];
+
+  info->type = type;
+  info->present = TRUE;
+  info->manualSupported = TRUE;
+  info->onOffSupported = TRUE;
+  info->absValSupported = abs;
+  info->readOutSupported = TRUE;
+  info->min = min;
+  info->max = max;
+  info->absMin = absmin;
+  info->absMax = absmax;
+  snprintf(info->pUnits, MAX_STRING_LENGTH, "%s", units);
+  snprintf(info->pUnitAbbr, MAX_STRING_LENGTH, "%s", abbr);
+
+  property->type = type;
+  property->present = TRUE;
+  property->absControl = abs;
+  property->onOff = TRUE;
+  property->absValue = value;
+  property->valueA = (absmax > absmin) ?
+    min + (unsigned int) ((value - absmin) / (absmax - absmin) * (max - min)) :
+    (unsigned int) value;
+}
+
+static void fc2sim_Reset(fc2sim_context *c)
+{
+  int color = fc2sim_IsColor(options.format);
+  fc2EmbeddedImageInfoProperty *item;
+  int n;
+
+  memset(c->info, 0, sizeof(c->info));
+  memset(c->property, 0, sizeof(c->property));
+  for (n = 0; n < FC2_UNSPECIFIED_PROPERTY_TYPE; n++)
+    c->info[n].type = c->property[n].type = (fc2PropertyType) n;
+
+  fc2sim_Property(c, FC2_BRIGHTNESS, 1, 0, 255, 0., 6.24, 0.,
+		  "percent", "%");
+  fc2sim_Property(c, FC2_AUTO_EXPOSURE, 1, 1, 1023, -7.585, 2.414, 0.,
+		  "EV", "EV");
+  fc2sim_Property(c, FC2_SHARPNESS, 0, 0, 4095, 0., 0., 1024.,
+		  "", "");
+  if (color) {
+    fc2sim_Property(c, FC2_WHITE_BALANCE, 0, 0, 1023, 0., 0., 512.,
+		    "", "");
+    c->property[FC2_WHITE_BALANCE].valueB = 512;
+    fc2sim_Property(c, FC2_HUE, 1, 0, 4095, -180., 180., 0.,
+		    "degrees", "deg");
+    fc2sim_Property(c, FC2_SATURATION, 1, 0, 4095, 0., 399.9, 100.,
+		    "percent", "%");
+  }
+  fc2sim_Property(c, FC2_GAMMA, 1, 512, 4095, 0.5, 3.999, 1.,
+		  "", "");
+  fc2sim_Property(c, FC2_SHUTTER, 1, 1, 4095, 0.01, 1000. / options.rate,
+		  10. < 1000. / options.rate ? 10. : 1000. / options.rate,
+		  "ms", "ms");
+  fc2sim_Property(c, FC2_GAIN, 1, 0, 1023, 0., 23.98, 0.,
+		  "dB", "dB");
+  fc2sim_Property(c, FC2_TRIGGER_MODE, 0, 0, 0, 0., 0., 0.,
+		  "", "");
+  fc2sim_Property(c, FC2_TRIGGER_DELAY, 1, 0, 4095, 0., 0.01, 0.,
+		  "s", "s");
+  c->property[FC2_TRIGGER_DELAY].onOff = FALSE;
+  fc2sim_Property(c, FC2_FRAME_RATE, 1, 1, 4095, 1., options.rate,
+		  options.rate, "fps", "fps");
+  fc2sim_Property(c, FC2_TEMPERATURE, 1, 0, 4095, -273.15, 136.35, 40.,
+		  "Celsius", "C");
+  c->info[FC2_TEMPERATURE].manualSupported = FALSE;
+
+  memset(&c->triggermode, 0, sizeof(fc2TriggerMode));
+  c->triggermode.source = 0;
+  for (n = 0; n < FC2SIM_NSTROBES; n++) {
+    memset(&c->strobe[n], 0, sizeof(fc2StrobeControl));
+    c->strobe[n].source = n;
+  }
+
+  memset(&c->embedded, 0, sizeof(fc2EmbeddedImageInfo));
+  for (item = &c->embedded.timestamp; item <= &c->embedded.ROIPosition; item++)
+    item->available = TRUE;
+
+  memset(&c->settings, 0, sizeof(fc2Format7ImageSettings));
+  c->settings.mode = FC2_MODE_0;
+  c->settings.width = options.width;
+  c->settings.height = options.height;
+  c->settings.pixelFormat = options.format;
+  c->packetsize = (options.interface == FC2_INTERFACE_GIGE) ?
+    1400 : FC2SIM_USB_PACKET;
+
+  memset(&c->channel, 0, sizeof(fc2GigEStreamChannel));
+  c->channel.packetSize = 1400;
+  c->channel.doNotFragment = TRUE;
+
+  c->nregisters = 0;
+}
+
+fc2Error fc2CreateContext(fc2Context *pContext)
+{
+  fc2sim_context *c;
+
+  pthread_once(&once, fc2sim_Initialize);
+  if (!pContext)
+    return FC2_ERROR_INVALID_PARAMETER;
+
+  c = (fc2sim_context *) calloc(1, sizeof(fc2sim_context));
+  if (!c)
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  c->camera = -1;
+  pthread_mutex_init(&c->lock, NULL);
+  pthread_cond_init(&c->ready, NULL);
+  pthread_cond_init(&c->triggered, NULL);
+  c->config.numBuffers = FC2SIM_NBUFFERS;
+  c->config.grabTimeout = FC2_TIMEOUT_INFINITE;
+  c->config.grabMode = FC2_DROP_FRAMES;
+  fc2sim_Reset(c);
+
+  pthread_mutex_lock(&contextslock);
+  c->next = contexts;
+  contexts = c;
+  pthread_mutex_unlock(&contextslock);
+
+  *pContext = (fc2Context) c;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2CreateGigEContext(fc2Context *pContext)
+{
+  return fc2CreateContext(pContext);
+}
+
+fc2Error fc2DestroyContext(fc2Context context)
+{
+  fc2sim_context *c = fc2sim_Context(context), **p;
+
+  if (!c)
+    return FC2_ERROR_INVALID_PARAMETER;
+  fc2StopCapture(context);
+
+  pthread_mutex_lock(&contextslock);
+  for (p = &contexts; *p; p = &(*p)->next)
+    if (*p == c) {
+      *p = c->next;
+      break;
+    }
+  pthread_mutex_unlock(&contextslock);
+
+  pthread_mutex_destroy(&c->lock);
+  pthread_cond_destroy(&c->ready);
+  pthread_cond_destroy(&c->triggered);
+  free(c);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetNumOfCameras(fc2Context context, unsigned int *pNumCameras)
+{
+  if (!fc2sim_Context(context) || !pNumCameras)
+    return FC2_ERROR_INVALID_PARAMETER;
+  *pNumCameras = options.ncameras;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetCameraFromIndex(fc2Context context, unsigned int index,
+			       fc2PGRGuid *pGuid)
+{
+  if (!fc2sim_Context(context) || !pGuid)
+    return FC2_ERROR_INVALID_PARAMETER;
+  if (index >= options.ncameras)
+    return FC2_ERROR_NOT_FOUND;
+  memset(pGuid, 0, sizeof(fc2PGRGuid));
+  pGuid->value[0] = FC2SIM_GUID;
+  pGuid->value[1] = index;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2Connect(fc2Context context, fc2PGRGuid *guid)
+{
+  fc2sim_context *c = fc2sim_Context(context);
+
+  if (!c || !guid)
+    return FC2_ERROR_INVALID_PARAMETER;
+  if (guid->value[0] != FC2SIM_GUID || guid->value[1] >= options.ncameras)
+    return FC2_ERROR_NOT_FOUND;
+
+  fc2StopCapture(context);
+  pthread_mutex_lock(&c->lock);
+  c->camera = (int) guid->value[1];
+  c->random = options.seed + 0x9E3779B97F4A7C15ULL * (c->camera + 1);
+  fc2sim_Reset(c);
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2Disconnect(fc2Context context)
+{
+  fc2sim_context *c = fc2sim_Context(context);
+
+  if (!c)
+    return FC2_ERROR_INVALID_PARAMETER;
+  fc2StopCapture(context);
+  c->camera = -1;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetCameraInfo(fc2Context context, fc2CameraInfo *pCameraInfo)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+  int gige = (options.interface == FC2_INTERFACE_GIGE);
+
+  if (error)
+    return error;
+  if (!pCameraInfo)
+    return FC2_ERROR_INVALID_PARAMETER;
+
+  memset(pCameraInfo, 0, sizeof(fc2CameraInfo));
+  pCameraInfo->serialNumber = FC2SIM_SERIAL + c->camera;
+  pCameraInfo->interfaceType = options.interface;
+  pCameraInfo->driverType = gige ? FC2_DRIVER_GIGE_NONE : FC2_DRIVER_USB_NONE;
+  pCameraInfo->isColorCamera = fc2sim_IsColor(options.format);
+  snprintf(pCameraInfo->modelName, MAX_STRING_LENGTH,
+	   "Simulated %s camera", gige ? "GigE" : "USB3");
+  snprintf(pCameraInfo->vendorName, MAX_STRING_LENGTH, "fc2sim");
+  snprintf(pCameraInfo->sensorInfo, MAX_STRING_LENGTH, "Simulated sensor");
+  snprintf(pCameraInfo->sensorResolution, MAX_STRING_LENGTH, "%ux%u",
+	   options.width, options.height);
+  snprintf(pCameraInfo->driverName, MAX_STRING_LENGTH, "fc2sim");
+  snprintf(pCameraInfo->firmwareVersion, MAX_STRING_LENGTH, "2.9.3");
+  snprintf(pCameraInfo->firmwareBuildTime, MAX_STRING_LENGTH, "%s", __DATE__);
+  pCameraInfo->bayerTileFormat = pCameraInfo->isColorCamera ?
+    FC2_BT_RGGB : FC2_BT_NONE;
+  pCameraInfo->nodeNumber = (unsigned short) c->camera;
+  if (gige) {
+    pCameraInfo->gigEMajorVersion = 1;
+    pCameraInfo->gigEMinorVersion = 2;
+    pCameraInfo->macAddress.octets[5] = (unsigned char) c->camera;
+    pCameraInfo->ipAddress.octets[0] = 169;
+    pCameraInfo->ipAddress.octets[1] = 254;
+    pCameraInfo->ipAddress.octets[3] = (unsigned char) (c->camera + 1);
+  }
+  return FC2_ERROR_OK;
+}
+
+//
+// Configuration
+//
+fc2Error fc2GetConfiguration(fc2Context context, fc2Config *config)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  *config = c->config;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetConfiguration(fc2Context context, fc2Config *config)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (config->grabMode != FC2_DROP_FRAMES &&
+      config->grabMode != FC2_BUFFER_FRAMES)
+    return FC2_ERROR_INVALID_PARAMETER;
+  pthread_mutex_lock(&c->lock);
+  // the number of buffers takes effect when capture next starts
+  c->config = *config;
+  if (!c->config.numBuffers)
+    c->config.numBuffers = FC2SIM_NBUFFERS;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+//
+// Properties
+//
+fc2Error fc2GetPropertyInfo(fc2Context context, fc2PropertyInfo *propInfo)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (!propInfo || propInfo->type >= FC2_UNSPECIFIED_PROPERTY_TYPE)
+    return FC2_ERROR_INVALID_PARAMETER;
+  pthread_mutex_lock(&c->lock);
+  *propInfo = c->info[propInfo->type];
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetProperty(fc2Context context, fc2Property *prop)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (!prop || prop->type >= FC2_UNSPECIFIED_PROPERTY_TYPE)
+    return FC2_ERROR_INVALID_PARAMETER;
+  pthread_mutex_lock(&c->lock);
+  *prop = c->property[prop->type];
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+//
+// Set a property, keeping the absolute and integer values consistent.
+// Called with the context locked.
+//
+static fc2Error fc2sim_SetProperty(fc2sim_context *c, const fc2Property *prop)
+{
+  const fc2PropertyInfo *info;
+  fc2Property *property;
+  double value, span, absspan;
+
+  if (prop->type >= FC2_UNSPECIFIED_PROPERTY_TYPE)
+    return FC2_ERROR_INVALID_PARAMETER;
+  info = &c->info[prop->type];
+  property = &c->property[prop->type];
+  if (!info->present)
+    return FC2_ERROR_PROPERTY_NOT_PRESENT;
+  if (!info->manualSupported)
+    return FC2_ERROR_PROPERTY_FAILED;
+
+  span = (double) info->max - info->min;
+  absspan = (double) info->absMax - info->absMin;
+  property->onOff = prop->onOff;
+  property->onePush = prop->onePush;
+  property->autoManualMode = prop->autoManualMode;
+  property->absControl = prop->absControl && info->absValSupported;
+  if (property->absControl) {
+    value = prop->absValue;
+    value = (value < info->absMin) ? info->absMin :
+      (value > info->absMax) ? info->absMax : value;
+    property->absValue = (float) value;
+    property->valueA = info->min +
+      (unsigned int) (absspan > 0. ? (value - info->absMin) / absspan * span : 0.);
+  } else {
+    property->valueA = (prop->valueA < info->min) ? info->min :
+      (prop->valueA > info->max) ? info->max : prop->valueA;
+    property->valueB = (prop->valueB > info->max) ? info->max : prop->valueB;
+    if (info->absValSupported && span > 0.)
+      property->absValue = (float) (info->absMin +
+				    (property->valueA - info->min) / span * absspan);
+  }
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetProperty(fc2Context context, fc2Property *prop)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (!prop)
+    return FC2_ERROR_INVALID_PARAMETER;
+  pthread_mutex_lock(&c->lock);
+  error = fc2sim_SetProperty(c, prop);
+  pthread_mutex_unlock(&c->lock);
+  return error;
+}
+
+//
+// Registers are remembered but have no effect.
+//
+fc2Error fc2ReadRegister(fc2Context context, unsigned int address,
+			 unsigned int *pValue)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+  unsigned int n;
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  *pValue = 0;
+  for (n = 0; n < c->nregisters; n++)
+    if (c->address[n] == address)
+      *pValue = c->value[n];
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2WriteRegister(fc2Context context, unsigned int address,
+			  unsigned int value)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+  unsigned int n;
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  for (n = 0; n < c->nregisters && c->address[n] != address; n++)
+    ;
+  if (n == FC2SIM_NREGISTERS)
+    error = FC2_ERROR_WRITE_REGISTER_FAILED;
+  else {
+    c->address[n] = address;
+    c->value[n] = value;
+    if (n == c->nregisters)
+      c->nregisters++;
+  }
+  pthread_mutex_unlock(&c->lock);
+  return error;
+}
+
+//
+// Embedded image information
+//
+fc2Error fc2GetEmbeddedImageInfo(fc2Context context,
+				 fc2EmbeddedImageInfo *pInfo)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  *pInfo = c->embedded;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetEmbeddedImageInfo(fc2Context context,
+				 fc2EmbeddedImageInfo *pInfo)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+  fc2EmbeddedImageInfoProperty *item, *setting;
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  for (item = &c->embedded.timestamp, setting = &pInfo->timestamp;
+       item <= &c->embedded.ROIPosition; item++, setting++)
+    item->onOff = item->available && setting->onOff;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+//
+// Format7
+//
+// Simulated cameras are always in a Format7 mode.
+//
+fc2Error fc2GetVideoModeAndFrameRate(fc2Context context,
+				     fc2VideoMode *videoMode,
+				     fc2FrameRate *frameRate)
+{
+  fc2Error error;
+
+  fc2sim_Camera(context, &error);
+  if (error)
+    return error;
+  *videoMode = FC2_VIDEOMODE_FORMAT7;
+  *frameRate = FC2_FRAMERATE_FORMAT7;
+  return FC2_ERROR_OK;
+}
+
+static int fc2sim_Binning(fc2Mode mode)
+{
+  return (mode == FC2_MODE_1) ? 2 : 1;
+}
+
+static unsigned int fc2sim_MaxPacket(void)
+{
+  return (options.interface == FC2_INTERFACE_GIGE) ?
+    FC2SIM_GIGE_PACKET : FC2SIM_USB_PACKET;
+}
+
+fc2Error fc2GetFormat7Info(fc2Context context, fc2Format7Info *info,
+			   BOOL *pSupported)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+  fc2Mode mode;
+  int binning;
+
+  if (error)
+    return error;
+  mode = info->mode;
+  memset(info, 0, sizeof(fc2Format7Info));
+  info->mode = mode;
+  *pSupported = (mode == FC2_MODE_0 || mode == FC2_MODE_1);
+  if (!*pSupported)
+    return FC2_ERROR_OK;
+
+  binning = fc2sim_Binning(mode);
+  info->maxWidth = options.width / binning;
+  info->maxHeight = options.height / binning;
+  info->offsetHStepSize = 8;
+  info->offsetVStepSize = 2;
+  info->imageHStepSize = 8;
+  info->imageVStepSize = 2;
+  info->pixelFormatBitField = fc2sim_PixelFormats();
+  pthread_mutex_lock(&c->lock);
+  info->packetSize = c->packetsize;
+  pthread_mutex_unlock(&c->lock);
+  info->minPacketSize = FC2SIM_PACKET_UNIT;
+  info->maxPacketSize = fc2sim_MaxPacket();
+  info->percentage = 100.f * info->packetSize / info->maxPacketSize;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2ValidateFormat7Settings(fc2Context context,
+				    fc2Format7ImageSettings *imageSettings,
+				    BOOL *settingsAreValid,
+				    fc2Format7PacketInfo *packetInfo)
+{
+  fc2Error error;
+  fc2Format7ImageSettings *s = imageSettings;
+  unsigned int maxwidth, maxheight;
+  int binning;
+
+  fc2sim_Camera(context, &error);
+  if (error)
+    return error;
+
+  *settingsAreValid = FALSE;
+  if (s->mode != FC2_MODE_0 && s->mode != FC2_MODE_1)
+    return FC2_ERROR_INVALID_MODE;
+  binning = fc2sim_Binning(s->mode);
+  maxwidth = options.width / binning;
+  maxheight = options.height / binning;
+  *settingsAreValid =
+    s->width > 0 && s->height > 0 &&
+    s->offsetX % 8 == 0 && s->offsetY % 2 == 0 &&
+    s->width % 8 == 0 && s->height % 2 == 0 &&
+    s->offsetX + s->width <= maxwidth &&
+    s->offsetY + s->height <= maxheight &&
+    (s->pixelFormat & fc2sim_PixelFormats()) == (unsigned int) s->pixelFormat &&
+    __builtin_popcount((unsigned int) s->pixelFormat) == 1;
+
+  if (packetInfo) {
+    memset(packetInfo, 0, sizeof(fc2Format7PacketInfo));
+    packetInfo->unitBytesPerPacket = FC2SIM_PACKET_UNIT;
+    packetInfo->maxBytesPerPacket = fc2sim_MaxPacket();
+    packetInfo->recommendedBytesPerPacket =
+      (options.interface == FC2_INTERFACE_GIGE) ? 1400 : FC2SIM_USB_PACKET;
+  }
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetFormat7Configuration(fc2Context context,
+				    fc2Format7ImageSettings *imageSettings,
+				    unsigned int *packetSize,
+				    float *percentage)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  *imageSettings = c->settings;
+  *packetSize = c->packetsize;
+  *percentage = 100.f * c->packetsize / fc2sim_MaxPacket();
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetFormat7ConfigurationPacket(fc2Context context,
+					  fc2Format7ImageSettings *imageSettings,
+					  unsigned int packetSize)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+  BOOL valid;
+
+  if (error)
+    return error;
+  if (c->capturing)
+    return FC2_ERROR_ISOCH_ALREADY_STARTED;
+  error = fc2ValidateFormat7Settings(context, imageSettings, &valid, NULL);
+  if (error)
+    return error;
+  if (!valid)
+    return FC2_ERROR_INVALID_SETTINGS;
+  if (packetSize < FC2SIM_PACKET_UNIT || packetSize > fc2sim_MaxPacket() ||
+      packetSize % FC2SIM_PACKET_UNIT)
+    return FC2_ERROR_INVALID_PACKET_SIZE;
+
+  pthread_mutex_lock(&c->lock);
+  c->settings = *imageSettings;
+  c->packetsize = packetSize;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetGigEStreamChannelInfo(fc2Context context, unsigned int channel,
+				     fc2GigEStreamChannel *pChannel)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (options.interface != FC2_INTERFACE_GIGE)
+    return FC2_ERROR_NOT_SUPPORTED;
+  if (channel != 0)
+    return FC2_ERROR_INVALID_PARAMETER;
+  pthread_mutex_lock(&c->lock);
+  *pChannel = c->channel;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetGigEStreamChannelInfo(fc2Context context, unsigned int channel,
+				     fc2GigEStreamChannel *pChannel)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (options.interface != FC2_INTERFACE_GIGE)
+    return FC2_ERROR_NOT_SUPPORTED;
+  if (channel != 0 || pChannel->packetSize < 576 ||
+      pChannel->packetSize > FC2SIM_GIGE_PACKET)
+    return FC2_ERROR_INVALID_PARAMETER;
+  pthread_mutex_lock(&c->lock);
+  c->channel = *pChannel;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+//
+// Triggers and strobes
+//
+fc2Error fc2GetTriggerModeInfo(fc2Context context,
+			       fc2TriggerModeInfo *triggerModeInfo)
+{
+  fc2Error error;
+
+  fc2sim_Camera(context, &error);
+  if (error)
+    return error;
+  memset(triggerModeInfo, 0, sizeof(fc2TriggerModeInfo));
+  triggerModeInfo->present = TRUE;
+  triggerModeInfo->readOutSupported = TRUE;
+  triggerModeInfo->onOffSupported = TRUE;
+  triggerModeInfo->polaritySupported = TRUE;
+  triggerModeInfo->valueReadable = TRUE;
+  triggerModeInfo->sourceMask = 0x0F | (1U << FC2SIM_SOFTWARE);
+  triggerModeInfo->softwareTriggerSupported = TRUE;
+  triggerModeInfo->modeMask = (1U << 0) | (1U << 1) | (1U << 14) | (1U << 15);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetTriggerMode(fc2Context context, fc2TriggerMode *triggerMode)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  *triggerMode = c->triggermode;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetTriggerMode(fc2Context context, fc2TriggerMode *triggerMode)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (triggerMode->source > 3 && triggerMode->source != FC2SIM_SOFTWARE)
+    return FC2_ERROR_TRIGGER_FAILED;
+  pthread_mutex_lock(&c->lock);
+  c->triggermode = *triggerMode;
+  c->triggers = 0;
+  pthread_cond_broadcast(&c->triggered);
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+//
+// Apply fn to every connected context
+//
+static fc2Error fc2sim_Broadcast(fc2Context context,
+				 fc2Error (*fn)(fc2Context, void *),
+				 void *arg)
+{
+  fc2Error error, first = FC2_ERROR_OK;
+  fc2sim_context *c;
+
+  fc2sim_Camera(context, &error);
+  if (error)
+    return error;
+  pthread_mutex_lock(&contextslock);
+  for (c = contexts; c; c = c->next)
+    if (c->camera >= 0 && (error = fn((fc2Context) c, arg)) && !first)
+      first = error;
+  pthread_mutex_unlock(&contextslock);
+  return first;
+}
+
+static fc2Error fc2sim_SetTriggerMode(fc2Context context, void *arg)
+{
+  return fc2SetTriggerMode(context, (fc2TriggerMode *) arg);
+}
+
+fc2Error fc2SetTriggerModeBroadcast(fc2Context context,
+				    fc2TriggerMode *triggerMode)
+{
+  return fc2sim_Broadcast(context, fc2sim_SetTriggerMode, triggerMode);
+}
+
+fc2Error fc2FireSoftwareTrigger(fc2Context context)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  pthread_mutex_lock(&c->lock);
+  if (c->triggermode.onOff && c->triggermode.source == FC2SIM_SOFTWARE) {
+    c->triggers++;
+    pthread_cond_signal(&c->triggered);
+  }
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+static fc2Error fc2sim_FireSoftwareTrigger(fc2Context context, void *arg)
+{
+  return fc2FireSoftwareTrigger(context);
+}
+
+fc2Error fc2FireSoftwareTriggerBroadcast(fc2Context context)
+{
+  return fc2sim_Broadcast(context, fc2sim_FireSoftwareTrigger, NULL);
+}
+
+fc2Error fc2GetTriggerDelay(fc2Context context, fc2TriggerDelay *triggerDelay)
+{
+  triggerDelay->type = FC2_TRIGGER_DELAY;
+  return fc2GetProperty(context, triggerDelay);
+}
+
+fc2Error fc2SetTriggerDelay(fc2Context context, fc2TriggerDelay *triggerDelay)
+{
+  triggerDelay->type = FC2_TRIGGER_DELAY;
+  return fc2SetProperty(context, triggerDelay);
+}
+
+static fc2Error fc2sim_SetTriggerDelay(fc2Context context, void *arg)
+{
+  return fc2SetTriggerDelay(context, (fc2TriggerDelay *) arg);
+}
+
+fc2Error fc2SetTriggerDelayBroadcast(fc2Context context,
+				     fc2TriggerDelay *triggerDelay)
+{
+  return fc2sim_Broadcast(context, fc2sim_SetTriggerDelay, triggerDelay);
+}
+
+fc2Error fc2GetStrobeInfo(fc2Context context, fc2StrobeInfo *strobeInfo)
+{
+  fc2Error error;
+  unsigned int source = strobeInfo->source;
+
+  fc2sim_Camera(context, &error);
+  if (error)
+    return error;
+  if (source >= FC2SIM_NSTROBES)
+    return FC2_ERROR_STROBE_FAILED;
+  memset(strobeInfo, 0, sizeof(fc2StrobeInfo));
+  strobeInfo->source = source;
+  strobeInfo->present = TRUE;
+  strobeInfo->readOutSupported = TRUE;
+  strobeInfo->onOffSupported = TRUE;
+  strobeInfo->polaritySupported = TRUE;
+  strobeInfo->minValue = 0.f;
+  strobeInfo->maxValue = 1000.f / (float) options.rate;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2GetStrobe(fc2Context context, fc2StrobeControl *strobeControl)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (strobeControl->source >= FC2SIM_NSTROBES)
+    return FC2_ERROR_STROBE_FAILED;
+  pthread_mutex_lock(&c->lock);
+  *strobeControl = c->strobe[strobeControl->source];
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetStrobe(fc2Context context, fc2StrobeControl *strobeControl)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (strobeControl->source >= FC2SIM_NSTROBES ||
+      strobeControl->delay < 0.f || strobeControl->duration < 0.f)
+    return FC2_ERROR_STROBE_FAILED;
+  pthread_mutex_lock(&c->lock);
+  c->strobe[strobeControl->source] = *strobeControl;
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+static fc2Error fc2sim_SetStrobe(fc2Context context, void *arg)
+{
+  return fc2SetStrobe(context, (fc2StrobeControl *) arg);
+}
+
+fc2Error fc2SetStrobeBroadcast(fc2Context context,
+			       fc2StrobeControl *strobeControl)
+{
+  return fc2sim_Broadcast(context, fc2sim_SetStrobe, strobeControl);
+}
+
+fc2Error fc2GetCycleTime(fc2Context context, fc2TimeStamp *pTimeStamp)
+{
+  fc2Error error;
+
+  fc2sim_Camera(context, &error);
+  if (error)
+    return error;
+  *pTimeStamp = fc2sim_TimeStamp(fc2sim_Now());
+  return FC2_ERROR_OK;
+}
+
+//
+// Images
+//
+static fc2sim_image *fc2sim_Image(fc2Image *image)
+{
+  return (fc2sim_image *) image->imageImpl;
+}
+
+fc2Error fc2CreateImage(fc2Image *pImage)
+{
+  if (!pImage)
+    return FC2_ERROR_INVALID_PARAMETER;
+  memset(pImage, 0, sizeof(fc2Image));
+  pImage->imageImpl = calloc(1, sizeof(fc2sim_image));
+  return pImage->imageImpl ?
+    FC2_ERROR_OK : FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+}
+
+//
+// Return the user buffer held by image to the camera
+//
+static void fc2sim_Release(fc2sim_image *image)
+{
+  fc2sim_context *c = image->context;
+
+  if (!c)
+    return;
+  pthread_mutex_lock(&c->lock);
+  if (image->context && image->slot < c->nslots &&
+      c->slot[image->slot].holder == image) {
+    c->slot[image->slot].holder = NULL;
+    c->slot[image->slot].state = FC2SIM_FREE;
+  }
+  image->context = NULL;
+  pthread_mutex_unlock(&c->lock);
+}
+
+fc2Error fc2DestroyImage(fc2Image *image)
+{
+  fc2sim_image *impl;
+
+  if (!image || !(impl = fc2sim_Image(image)))
+    return FC2_ERROR_INVALID_PARAMETER;
+  fc2sim_Release(impl);
+  if (!impl->external)
+    free(impl->data);
+  free(impl);
+  memset(image, 0, sizeof(fc2Image));
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetImageData(fc2Image *pImage, const unsigned char *pData,
+			 unsigned int dataSize)
+{
+  fc2sim_image *impl;
+
+  if (!pImage || !(impl = fc2sim_Image(pImage)))
+    return FC2_ERROR_INVALID_PARAMETER;
+  fc2sim_Release(impl);
+  if (!impl->external)
+    free(impl->data);
+  impl->data = (unsigned char *) pData;
+  impl->capacity = pData ? dataSize : 0;
+  impl->external = (pData != NULL);
+  pImage->pData = impl->data;
+  pImage->dataSize = dataSize;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetImageDimensions(fc2Image *pImage, unsigned int rows,
+			       unsigned int cols, unsigned int stride,
+			       fc2PixelFormat pixelFormat,
+			       fc2BayerTileFormat bayerFormat)
+{
+  if (!pImage)
+    return FC2_ERROR_INVALID_PARAMETER;
+  pImage->rows = rows;
+  pImage->cols = cols;
+  pImage->stride = stride;
+  pImage->format = pixelFormat;
+  pImage->bayerFormat = bayerFormat;
+  return FC2_ERROR_OK;
+}
+
+fc2TimeStamp fc2GetImageTimeStamp(fc2Image *pImage)
+{
+  fc2TimeStamp ts;
+  fc2sim_image *impl = pImage ? fc2sim_Image(pImage) : NULL;
+
+  if (impl)
+    return impl->timestamp;
+  memset(&ts, 0, sizeof(fc2TimeStamp));
+  return ts;
+}
+
+//
+// Make room for size bytes in an image that owns its data
+//
+static fc2Error fc2sim_Reserve(fc2Image *image, size_t size)
+{
+  fc2sim_image *impl = fc2sim_Image(image);
+  void *data;
+
+  fc2sim_Release(impl);
+  if (impl->capacity >= size)
+    return FC2_ERROR_OK;
+  if (impl->external)
+    return FC2_ERROR_BUFFER_TOO_SMALL;
+  if (posix_memalign(&data, FC2SIM_ALIGN, size))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  free(impl->data);
+  impl->data = (unsigned char *) data;
+  impl->capacity = size;
+  return FC2_ERROR_OK;
+}
+
+//
+// Conversions between unpacked and 12-bit packed formats, and copies
+//
+fc2Error fc2ConvertImageTo(fc2PixelFormat format, fc2Image *pImageIn,
+			   fc2Image *pImageOut)
+{
+  fc2sim_image *impl;
+  unsigned int row, col, stride;
+  const unsigned char *src;
+  unsigned short *dest;
+  fc2Error error;
+
+  if (!pImageIn || !pImageOut || !(impl = fc2sim_Image(pImageOut)) ||
+      !pImageIn->pData)
+    return FC2_ERROR_INVALID_PARAMETER;
+
+  if (format == pImageIn->format) {
+    stride = pImageIn->stride;
+    if ((error = fc2sim_Reserve(pImageOut, (size_t) pImageIn->rows * stride)))
+      return error;
+    memcpy(impl->data, pImageIn->pData, (size_t) pImageIn->rows * stride);
+  } else if ((pImageIn->format == FC2_PIXEL_FORMAT_MONO12 &&
+	      format == FC2_PIXEL_FORMAT_MONO16) ||
+	     (pImageIn->format == FC2_PIXEL_FORMAT_RAW12 &&
+	      format == FC2_PIXEL_FORMAT_RAW16)) {
+    stride = 2 * pImageIn->cols;
+    if ((error = fc2sim_Reserve(pImageOut, (size_t) pImageIn->rows * stride)))
+      return error;
+    for (row = 0; row < pImageIn->rows; row++) {
+      src = pImageIn->pData + (size_t) row * pImageIn->stride;
+      dest = (unsigned short *) (impl->data + (size_t) row * stride);
+      for (col = 0; col + 1 < pImageIn->cols; col += 2, src += 3) {
+	dest[col]   = (unsigned short) ((src[0] << 4) | (src[1] & 0x0F));
+	dest[col+1] = (unsigned short) ((src[2] << 4) | (src[1] >> 4));
+      }
+      if (col < pImageIn->cols)
+	dest[col] = (unsigned short) ((src[0] << 4) | (src[1] & 0x0F));
+    }
+  } else
+    return FC2_ERROR_NOT_IMPLEMENTED;
+
+  pImageOut->rows = pImageIn->rows;
+  pImageOut->cols = pImageIn->cols;
+  pImageOut->stride = stride;
+  pImageOut->pData = impl->data;
+  pImageOut->dataSize = pImageOut->receivedDataSize =
+    pImageIn->rows * stride;
+  pImageOut->format = format;
+  pImageOut->bayerFormat = pImageIn->bayerFormat;
+  impl->timestamp = fc2GetImageTimeStamp(pImageIn);
+  return FC2_ERROR_OK;
+}
+
+//
+// Capture
+//
+
+//
+// Period [ns] between frames allowed by the camera's settings.
+// Called with the context locked.
+//
+static double fc2sim_Period(fc2sim_context *c)
+{
+  double rate, limit, packet;
+
+  rate = c->property[FC2_FRAME_RATE].absValue;
+  limit = 1e3 / c->property[FC2_SHUTTER].absValue;
+  if (limit < rate)
+    rate = limit;
+  if (options.interface == FC2_INTERFACE_GIGE) {
+    packet = c->channel.packetSize;
+    limit = FC2SIM_GIGE_RATE * packet /
+      (packet + FC2SIM_GIGE_HEADER + c->channel.interPacketDelay) /
+      c->framesize;
+  } else
+    limit = c->packetsize * FC2SIM_BUS_CYCLE / c->framesize;
+  if (limit < rate)
+    rate = limit;
+  return 1e9 / rate;
+}
+
+static void fc2sim_PutWord(unsigned char *p, uint32_t word)
+{
+  p[0] = (unsigned char) (word >> 24);
+  p[1] = (unsigned char) (word >> 16);
+  p[2] = (unsigned char) (word >> 8);
+  p[3] = (unsigned char) word;
+}
+
+//
+// Embedded image information of the frame exposed at ts.
+// Called with the context locked, because it reads the camera's
+// settings.
+//
+static void fc2sim_Expose(fc2sim_context *c,
+			  fc2TimeStamp ts, unsigned long long sequence,
+			  size_t *nembedded, uint32_t *embedded)
+{
+  const fc2EmbeddedImageInfoProperty *item = &c->embedded.timestamp;
+  uint32_t word[10];
+  size_t n, k;
+
+  word[0] = ((ts.cycleSeconds & 0x7F) << 25) |
+    ((ts.cycleCount & 0x1FFF) << 12) | (ts.cycleOffset & 0xFFF);
+  word[1] = c->property[FC2_GAIN].valueA;
+  word[2] = c->property[FC2_SHUTTER].valueA;
+  word[3] = c->property[FC2_BRIGHTNESS].valueA;
+  word[4] = c->property[FC2_AUTO_EXPOSURE].valueA;
+  word[5] = (c->property[FC2_WHITE_BALANCE].valueA << 12) |
+    c->property[FC2_WHITE_BALANCE].valueB;
+  word[6] = (uint32_t) sequence;
+  word[7] = 0;
+  for (n = 0; n < FC2SIM_NSTROBES; n++)
+    if (c->strobe[n].onOff)
+      word[7] |= 1U << n;
+  word[8] = c->triggermode.onOff ? (1U << c->triggermode.source) & 0xF : 0;
+  word[9] = (c->settings.offsetX << 16) | c->settings.offsetY;
+
+  for (n = 0, k = 0; n < 10; n++)
+    if (item[n].onOff)
+      embedded[k++] = word[n];
+  *nembedded = k;
+}
+
+//
+// Write a frame into data.  The scene drifts by one byte per frame
+// so that consecutive frames differ.  Embedded image information
+// replaces the first pixels.
+//
+static void fc2sim_Fill(fc2sim_context *c, unsigned char *data,
+			unsigned long long sequence,
+			size_t nembedded, const uint32_t *embedded)
+{
+  size_t n;
+
+  memcpy(data, c->pattern + sequence % FC2SIM_ALIGN, c->framesize);
+  for (n = 0; n < nembedded && 4 * (n + 1) <= c->framesize; n++)
+    fc2sim_PutWord(data + 4 * n, embedded[n]);
+}
+
+//
+// Choose a slot for a new frame, or return -1 if the frame must be
+// dropped.  In DROP_FRAMES mode the oldest unread frame is overwritten.
+// Called with the context locked.
+//
+static int fc2sim_SlotToFill(fc2sim_context *c)
+{
+  unsigned int n;
+  int oldest = -1;
+
+  for (n = 0; n < c->nslots; n++)
+    if (c->slot[n].state == FC2SIM_FREE)
+      return (int) n;
+  if (c->config.grabMode != FC2_DROP_FRAMES)
+    return -1;
+  for (n = 0; n < c->nslots; n++)
+    if (c->slot[n].state == FC2SIM_READY &&
+	(oldest < 0 || c->slot[n].sequence < c->slot[oldest].sequence))
+      oldest = (int) n;
+  return oldest;
+}
+
+static void *fc2sim_Camera_Thread(void *arg)
+{
+  fc2sim_context *c = (fc2sim_context *) arg;
+  unsigned long long deadline, exposure, delivery;
+  unsigned long long sequence;
+  double period, jitter, u;
+  unsigned int received;
+  fc2Error error;
+  fc2TimeStamp ts;
+  fc2sim_image impl;
+  fc2Image image;
+  uint32_t embedded[10];
+  size_t nembedded;
+  int n, software;
+
+  deadline = c->start;
+  pthread_mutex_lock(&c->lock);
+  while (c->running) {
+    software = c->triggermode.onOff &&
+      c->triggermode.source == FC2SIM_SOFTWARE;
+    if (software) {
+      // software triggers start exposure after the trigger delay
+      while (c->running && !c->triggers && c->triggermode.onOff &&
+	     c->triggermode.source == FC2SIM_SOFTWARE)
+	pthread_cond_wait(&c->triggered, &c->lock);
+      if (!c->running)
+	break;
+      if (!c->triggers)
+	continue;
+      c->triggers--;
+      exposure = fc2sim_Now();
+      if (c->property[FC2_TRIGGER_DELAY].onOff)
+	exposure += (unsigned long long)
+	  (1e9 * c->property[FC2_TRIGGER_DELAY].absValue);
+      deadline = exposure;
+    } else {
+      // free-running frames, or external triggers at the frame rate
+      period = fc2sim_Period(c);
+      jitter = options.jitter * 1e9 * fc2sim_Gaussian(&c->random);
+      if (jitter < -0.9 * period)
+	jitter = -0.9 * period;
+      deadline += (unsigned long long) (period + jitter);
+      exposure = deadline;
+    }
+    delivery = exposure +
+      (unsigned long long) (1e6 * c->property[FC2_SHUTTER].absValue);
+    sequence = ++c->sequence;
+    pthread_mutex_unlock(&c->lock);
+
+    fc2sim_SleepUntil(delivery);
+    if (!software && fc2sim_Now() > delivery + 1000000000ULL)
+      deadline = fc2sim_Now(); // fell far behind: do not catch up
+
+    pthread_mutex_lock(&c->lock);
+    if (!c->running)
+      break;
+
+    u = fc2sim_Uniform(&c->random);
+    if (u < options.drop)
+      continue;
+    u -= options.drop;
+    error = FC2_ERROR_OK;
+    received = (unsigned int) c->framesize;
+    if (u < options.corrupt)
+      error = FC2_ERROR_IMAGE_CONSISTENCY_ERROR;
+    else if (u - options.corrupt < options.incomplete ||
+	     (options.interface == FC2_INTERFACE_GIGE &&
+	      c->channel.packetSize > options.mtu))
+      received = (unsigned int) (c->framesize *
+				 (0.5 + 0.5 * fc2sim_Uniform(&c->random)));
+    ts = fc2sim_TimeStamp(exposure);
+    fc2sim_Expose(c, ts, sequence, &nembedded, embedded);
+
+    if (c->callback) {
+      // callbacks receive every frame in the camera's own buffer
+      pthread_mutex_unlock(&c->lock);
+      fc2sim_Fill(c, c->buffers, sequence, nembedded, embedded);
+      if (!error) {
+	memset(&impl, 0, sizeof(fc2sim_image));
+	impl.timestamp = ts;
+	memset(&image, 0, sizeof(fc2Image));
+	fc2SetImageDimensions(&image, c->rows, c->cols, c->stride, c->format,
+			      fc2sim_IsColor(c->format) ? FC2_BT_RGGB : FC2_BT_NONE);
+	image.pData = c->buffers;
+	image.dataSize = (unsigned int) c->framesize;
+	image.receivedDataSize = received;
+	image.imageImpl = &impl;
+	c->callback(&image, c->callbackdata);
+      }
+      pthread_mutex_lock(&c->lock);
+      continue;
+    }
+
+    if ((n = fc2sim_SlotToFill(c)) < 0)
+      continue;
+    c->slot[n].state = FC2SIM_FILLING;
+    pthread_mutex_unlock(&c->lock);
+    fc2sim_Fill(c, c->slot[n].data, sequence, nembedded, embedded);
+    pthread_mutex_lock(&c->lock);
+    c->slot[n].state = FC2SIM_READY;
+    c->slot[n].sequence = sequence;
+    c->slot[n].received = received;
+    c->slot[n].error = error;
+    c->slot[n].timestamp = ts;
+    pthread_cond_broadcast(&c->ready);
+  }
+  pthread_mutex_unlock(&c->lock);
+
+  return NULL;
+}
+
+static void fc2sim_FreeBuffers(fc2sim_context *c)
+{
+  unsigned int n;
+
+  // images that still hold user buffers keep their pixels
+  for (n = 0; n < c->nslots; n++)
+    if (c->slot[n].holder)
+      c->slot[n].holder->context = NULL;
+  free(c->slot);
+  free(c->buffers);
+  free(c->pattern);
+  c->slot = NULL;
+  c->nslots = 0;
+  c->buffers = NULL;
+  c->pattern = NULL;
+}
+
+//
+// Allocate the driver buffers and the scene for the current
+// Format7 settings, and start the camera thread.
+//
+static fc2Error fc2sim_Start(fc2sim_context *c,
+			     fc2ImageEventCallback callback,
+			     void *callbackdata,
+			     unsigned long long start)
+{
+  size_t n, size;
+  void *data;
+  uint64_t random;
+
+  if (c->capturing)
+    return FC2_ERROR_ISOCH_ALREADY_STARTED;
+
+  c->rows = c->settings.height;
+  c->cols = c->settings.width;
+  c->format = c->settings.pixelFormat;
+  c->stride = fc2sim_Stride(c->cols, c->format);
+  c->framesize = (size_t) c->rows * c->stride;
+
+  if (callback)
+    c->nslots = 1;
+  else if (c->userbuffers) {
+    if (c->usersize < c->framesize)
+      return FC2_ERROR_BUFFER_TOO_SMALL;
+    c->nslots = c->nuserbuffers;
+  } else
+    c->nslots = c->config.numBuffers ? c->config.numBuffers : FC2SIM_NBUFFERS;
+
+  size = (c->framesize + FC2SIM_ALIGN - 1) & ~((size_t) FC2SIM_ALIGN - 1);
+  c->slot = (fc2sim_slot *) calloc(c->nslots, sizeof(fc2sim_slot));
+  c->pattern = (unsigned char *) malloc(c->framesize + FC2SIM_ALIGN);
+  c->buffers = NULL;
+  if (!c->userbuffers || callback) {
+    if (posix_memalign(&data, FC2SIM_ALIGN, size * c->nslots))
+      data = NULL;
+    c->buffers = (unsigned char *) data;
+  }
+  if (!c->slot || !c->pattern || (!c->buffers && (!c->userbuffers || callback))) {
+    fc2sim_FreeBuffers(c);
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  for (n = 0; n < c->nslots; n++) {
+    c->slot[n].data = c->buffers ? c->buffers + n * size :
+      c->userbuffers + n * c->usersize;
+    c->slot[n].state = FC2SIM_FREE;
+    // touch the buffers now rather than in the frame path
+    memset(c->slot[n].data, 0, c->framesize);
+  }
+
+  // speckle: random pixels
+  random = c->random;
+  for (n = 0; n < c->framesize + FC2SIM_ALIGN; n++)
+    c->pattern[n] = (unsigned char) (256. * fc2sim_Uniform(&random));
+
+  c->callback = callback;
+  c->callbackdata = callbackdata;
+  c->triggers = 0;
+  c->start = start;
+  c->running = 1;
+  if (pthread_create(&c->thread, NULL, fc2sim_Camera_Thread, c)) {
+    c->running = 0;
+    fc2sim_FreeBuffers(c);
+    return FC2_ERROR_ISOCH_START_FAILED;
+  }
+  c->capturing = 1;
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2StartCapture(fc2Context context)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  return fc2sim_Start(c, NULL, NULL, fc2sim_Now());
+}
+
+fc2Error fc2StartCaptureCallback(fc2Context context,
+				 fc2ImageEventCallback pCallbackFn,
+				 void *pCallbackData)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (!pCallbackFn)
+    return FC2_ERROR_INVALID_PARAMETER;
+  return fc2sim_Start(c, pCallbackFn, pCallbackData, fc2sim_Now());
+}
+
+//
+// Synchronized cameras share the time of their first exposure
+//
+fc2Error fc2StartSyncCaptureCallback(unsigned int numCameras,
+				     fc2Context *pContexts,
+				     fc2ImageEventCallback *pCallbackFns,
+				     void **pCallbackDataArray)
+{
+  fc2Error error;
+  fc2sim_context *c;
+  unsigned long long start = fc2sim_Now();
+  unsigned int n;
+
+  for (n = 0; n < numCameras; n++) {
+    c = fc2sim_Camera(pContexts[n], &error);
+    if (!error)
+      error = fc2sim_Start(c,
+			   pCallbackFns ? pCallbackFns[n] : NULL,
+			   pCallbackDataArray ? pCallbackDataArray[n] : NULL,
+			   start);
+    if (error) {
+      while (n-- > 0)
+	fc2StopCapture(pContexts[n]);
+      return error;
+    }
+  }
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2StartSyncCapture(unsigned int numCameras, fc2Context *pContexts)
+{
+  return fc2StartSyncCaptureCallback(numCameras, pContexts, NULL, NULL);
+}
+
+fc2Error fc2StopCapture(fc2Context context)
+{
+  fc2sim_context *c = fc2sim_Context(context);
+
+  if (!c)
+    return FC2_ERROR_INVALID_PARAMETER;
+  if (!c->capturing)
+    return FC2_ERROR_ISOCH_NOT_STARTED;
+
+  pthread_mutex_lock(&c->lock);
+  c->running = 0;
+  pthread_cond_broadcast(&c->triggered);
+  pthread_cond_broadcast(&c->ready);
+  pthread_mutex_unlock(&c->lock);
+  pthread_join(c->thread, NULL);
+
+  pthread_mutex_lock(&c->lock);
+  c->capturing = 0;
+  c->callback = NULL;
+  fc2sim_FreeBuffers(c);
+  pthread_mutex_unlock(&c->lock);
+  return FC2_ERROR_OK;
+}
+
+fc2Error fc2SetUserBuffers(fc2Context context,
+			   unsigned char *const ppMemBuffers,
+			   int size, int nNumBuffers)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+
+  if (error)
+    return error;
+  if (c->capturing)
+    return FC2_ERROR_ISOCH_ALREADY_STARTED;
+  if (ppMemBuffers && (size <= 0 || nNumBuffers <= 0))
+    return FC2_ERROR_INVALID_PARAMETER;
+  c->userbuffers = ppMemBuffers;
+  c->usersize = ppMemBuffers ? (unsigned int) size : 0;
+  c->nuserbuffers = ppMemBuffers ? (unsigned int) nNumBuffers : 0;
+  return FC2_ERROR_OK;
+}
+
+//
+// Wait for the next frame.  In BUFFER_FRAMES mode frames are
+// retrieved in order; in DROP_FRAMES mode the newest frame is
+// retrieved and older frames are discarded.  Frames in user
+// buffers are not copied: the image refers to the buffer, which
+// the camera does not reuse until the image receives another
+// frame or is destroyed.
+//
+fc2Error fc2RetrieveBuffer(fc2Context context, fc2Image *pImage)
+{
+  fc2Error error;
+  fc2sim_context *c = fc2sim_Camera(context, &error);
+  fc2sim_image *impl;
+  fc2sim_slot *slot;
+  struct timespec deadline;
+  unsigned int n;
+  int chosen, timeout, status = 0;
+
+  if (error)
+    return error;
+  if (!pImage || !(impl = fc2sim_Image(pImage)))
+    return FC2_ERROR_INVALID_PARAMETER;
+  if (!c->capturing)
+    return FC2_ERROR_ISOCH_NOT_STARTED;
+  if (c->callback)
+    return FC2_ERROR_FAILED;
+
+  pthread_mutex_lock(&c->lock);
+  timeout = c->config.grabTimeout;
+  if (timeout >= 0) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (timeout % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+  for (;;) {
+    chosen = -1;
+    for (n = 0; n < c->nslots; n++)
+      if (c->slot[n].state == FC2SIM_READY &&
+	  (chosen < 0 ||
+	   ((c->config.grabMode == FC2_DROP_FRAMES) ?
+	    c->slot[n].sequence > c->slot[chosen].sequence :
+	    c->slot[n].sequence < c->slot[chosen].sequence)))
+	chosen = (int) n;
+    if (chosen >= 0 || !c->running || status == ETIMEDOUT)
+      break;
+    status = (timeout >= 0) ?
+      pthread_cond_timedwait(&c->ready, &c->lock, &deadline) :
+      pthread_cond_wait(&c->ready, &c->lock);
+  }
+  if (chosen < 0) {
+    pthread_mutex_unlock(&c->lock);
+    return c->running ? FC2_ERROR_TIMEOUT : FC2_ERROR_ISOCH_NOT_STARTED;
+  }
+  if (c->config.grabMode == FC2_DROP_FRAMES)
+    for (n = 0; n < c->nslots; n++)
+      if (c->slot[n].state == FC2SIM_READY && (int) n != chosen)
+	c->slot[n].state = FC2SIM_FREE;
+  slot = &c->slot[chosen];
+  slot->state = FC2SIM_LOCKED;
+  pthread_mutex_unlock(&c->lock);
+
+  if (slot->error) {
+    error = slot->error;
+    pthread_mutex_lock(&c->lock);
+    slot->state = FC2SIM_FREE;
+    pthread_mutex_unlock(&c->lock);
+    return error;
+  }
+
+  if (c->userbuffers) {
+    fc2sim_Release(impl);
+    if (!impl->external)
+      free(impl->data);
+    impl->data = NULL;
+    impl->capacity = 0;
+    impl->external = 0;
+    pthread_mutex_lock(&c->lock);
+    slot->holder = impl;
+    impl->context = c;
+    impl->slot = (unsigned int) chosen;
+    pthread_mutex_unlock(&c->lock);
+    pImage->pData = slot->data;
+  } else {
+    error = fc2sim_Reserve(pImage, c->framesize);
+    if (!error)
+      memcpy(impl->data, slot->data, c->framesize);
+    pthread_mutex_lock(&c->lock);
+    slot->state = FC2SIM_FREE;
+    pthread_mutex_unlock(&c->lock);
+    if (error)
+      return error;
+    pImage->pData = impl->data;
+  }
+
+  pImage->rows = c->rows;
+  pImage->cols = c->cols;
+  pImage->stride = c->stride;
+  pImage->dataSize = (unsigned int) c->framesize;
+  pImage->receivedDataSize = slot->received;
+  pImage->format = c->format;
+  pImage->bayerFormat = fc2sim_IsColor(c->format) ? FC2_BT_RGGB : FC2_BT_NONE;
+  impl->timestamp = slot->timestamp;
+  return FC2_ERROR_OK;
+}
+
+//
+// Errors
+//
+const char *fc2ErrorToDescription(fc2Error error)
+{
+  static const char *descriptions[] = {
+    "Ok.", "Failed.", "Not implemented.", "Failed bus master connection.",
+    "Not connected.", "Initialization failed.", "Not initialized.",
+    "Invalid parameter.", "Invalid settings.", "Invalid bus manager.",
+    "Memory allocation failed.", "Low level failure.", "Not found.",
+    "GUID failure.", "Invalid packet size.", "Invalid mode.",
+    "Not in Format7.", "Not supported.", "Timeout.", "Bus master failed.",
+    "Invalid generation.", "LUT failed.", "IIDC failed.", "Strobe failed.",
+    "Trigger failed.", "Property failed.", "Property not present.",
+    "Register failed.", "Read register failed.", "Write register failed.",
+    "Isochronous failed.", "Isochronous already started.",
+    "Isochronous not started.", "Isochronous start failed.",
+    "Isochronous retrieve buffer failed.", "Isochronous stop failed.",
+    "Isochronous sync failed.", "Isochronous bandwidth exceeded.",
+    "Image conversion failed.", "Image library failure.",
+    "Buffer too small.", "Image consistency error.",
+    "Incompatible driver."
+  };
+
+  if (error >= FC2_ERROR_OK &&
+      (size_t) error < sizeof(descriptions)/sizeof(descriptions[0]))
+    return descriptions[error];
+  return "Undefined error.";
+}
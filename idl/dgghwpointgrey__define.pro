@@ -31,11 +31,101 @@
 ;    [ GS] TRIGGER_DELAY
 ;    [ GS] FRAME_RATE
 ;    [ GS] TEMPERATURE
+;        Camera properties requested in one call to GetProperty or
+;        SetProperty are transferred together in a single batch.
 ;
 ;    [ G ] GRAYSCALE: If set, camera provides grayscale images
+;    [ G ] IMAGEINFO: structure describing geometry and pixel format
+;        of the most recent image
 ;    [ G ] CAMERAINFO: structure of camera information
+;    [ G ] CONTEXT: handle to the FlyCapture2 context
 ;    [ GS] POWER: If set, camera is powered.
 ;    [ GS] HFLIP: If set, flip image horizontally
+;    [IG ] GRABBER: If set, frames are retrieved by a background
+;        thread into a ring of buffers.  Setting GRABBER to a
+;        number greater than 1 sets the number of buffers.
+;    [IG ] USERBUFFERS: If set, the camera writes frames directly
+;        into buffers that are returned by Read() without copying.
+;        Setting USERBUFFERS to a number greater than 2 sets the
+;        number of buffers.  Each image returned by Read() holds
+;        a buffer until the variable is reassigned or deleted.
+;    [IGS] DEMOSAIC: Interpolate raw Bayer images from color cameras
+;        into RGB images [3, w, h] with a native kernel:
+;        0: no interpolation (default), 1: nearest neighbor,
+;        2: bilinear, 3: edge sensing.
+;    [IG ] LIVE: If set, the camera delivers frames to a callback
+;        that keeps only the most recent frame, and Read() returns
+;        that frame immediately.  Suited to live display, where
+;        latency matters more than completeness.
+;    [IGS] NUMBUFFERS: number of frames buffered by the driver.
+;    [IGS] GRABMODE: 0: drop frames that are not retrieved in time,
+;        keeping the newest (lowest latency).  1: buffer every frame
+;        until it is retrieved (lossless while buffers last).
+;    [IGS] GRABTIMEOUT: time limit for retrieving a frame [ms].
+;        -1: wait indefinitely.  When a retrieval times out, Read()
+;        returns the previous frame and sets TIMEDOUT.
+;    [ G ] TIMEDOUT: 1 if the most recent Read() timed out.
+;    [I  ] LOSSLESS: If set, buffer frames (GRABMODE = 1) in a deep
+;        queue of NUMBUFFERS frames (default 64).
+;    [IGS] ROI: region of interest [x, y, width, height] in pixels
+;        of the current Format7 mode.  Offsets and sizes are rounded
+;        down to the steps that the camera supports.  Reading a
+;        smaller region raises the highest frame rate.
+;    [IGS] MODE: Format7 mode.  Modes other than 0 typically bin
+;        pixels.  Changing the mode without specifying ROI selects
+;        the full sensor in the new mode.
+;    [IGS] PIXELFORMAT: fc2PixelFormat of the images,
+;        e.g. '80000000'XUL for MONO8.
+;    [IGS] PACKETSIZE: bytes per packet.  Default: the size
+;        recommended by the camera for the region of interest.
+;    [ G ] FORMAT7INFO: fc2Format7Info structure describing the
+;        current Format7 mode.
+;        Setting ROI, MODE, PIXELFORMAT or PACKETSIZE stops capture,
+;        reconfigures the camera, resizes the image buffer and
+;        restarts capture.
+;    [ GS] TRIGGERMODE: fc2TriggerMode structure describing how
+;        frames are triggered.
+;    [IGS] SOFTWARETRIGGER: If set, frames are exposed only when
+;        triggered by Trigger or TriggerBurst.
+;    [ G ] TRIGGERMODEINFO: fc2TriggerModeInfo structure describing
+;        the trigger modes, sources and polarities that the camera
+;        supports.
+;    [IGS] TRIGGERDELAY: delay from the trigger to the start of
+;        exposure [s].
+;    [ GS] STROBE: fc2StrobeControl structure describing the strobe
+;        output selected by STROBESOURCE.  Strobe DELAY and DURATION
+;        are in milliseconds.  DURATION = 0 strobes for the exposure.
+;    [IGS] STROBESOURCE: GPIO pin of the strobe output described
+;        by STROBE and STROBEINFO.  Default: 1.
+;    [ G ] STROBEINFO: fc2StrobeInfo structure describing the
+;        capabilities of the strobe output selected by STROBESOURCE.
+;    [IGS] MEASURELATENCY: If set, measure the time from the start
+;        of exposure of each frame to its delivery using the camera's
+;        embedded time stamp.  Measurements accumulate in the LATENCY
+;        histogram of Stats().
+;    [ G ] LATENCY: time from the start of exposure to delivery of
+;        the most recent frame [s], or -1 if it was not measured.
+;    [IGS] NORMALIZE: Estimate the background of every frame that
+;        is acquired, and return frames from Read() normalized by it
+;        as (I - DARK)/(B - DARK), as FLOAT arrays.  Monochrome and
+;        raw images only.
+;        0: no normalization (default), 1: B is the running mean,
+;        2: B is the running median, which ignores transient
+;        features such as particles passing through the field of view.
+;    [IGS] BACKGROUNDWEIGHT: weight of each new frame in the
+;        background, so that the estimate follows roughly the last
+;        1/BACKGROUNDWEIGHT frames.  0: average all frames.
+;        Default: 0.01.  Setting it restarts the estimate.
+;    [ GS] DARK: dark frame [w, h] or scalar dark level subtracted
+;        before normalization.  Default: 0.
+;    [ G ] BACKGROUND: current background estimate B [w, h],
+;        as selected by NORMALIZE.
+;    [I  ] TUNE: If set, tune the packet size at initialization.
+;    [IG ] METADATA: If set at initialization, the camera embeds its
+;        time stamp, frame counter, shutter, gain and GPIO pin state
+;        in the first pixels of each frame.  Returns an idlpgrMetadata
+;        structure describing the most recent frame acquired by Read(),
+;        including a monotonic camera time stamp TIME in seconds.
 ;
 ; METHODS:
 ;    GetProperty, property = property, ...
@@ -62,7 +152,85 @@
 ;    Reset
 ;        Reset camera to factory default settings
 ;
-;    Read(): acquire next image from camera and return the data
+;    Read(error = error): acquire next image from camera and
+;        return the data.
+;        ERROR: optional output: status of the acquisition.
+;            0: success.  18: timed out.  41: image consistency
+;            error.  -2: frame arrived with missing data.
+;            Other values are FlyCapture2 error codes.
+;            If present, bad frames do not raise errors: Read()
+;            returns the previous frame, so that long acquisitions
+;            can skip bad frames and continue.  Stats() counts
+;            each class of error.
+;
+;    ReadBurst(n, timestamps = timestamps, metadata = metadata)
+;        Acquire n consecutive images and return them as an array
+;        whose last dimension is the frame index.
+;        TIMESTAMPS: optional output: time stamp of each frame [s]
+;        METADATA: optional output: idlpgrMetadata for each frame
+;
+;    Integrate(n, /average, /float, variance = variance)
+;        Acquire n consecutive images and return their sum,
+;        accumulated natively so that only the result is transferred
+;        to IDL.  Monochrome and raw images only.
+;        The sum is ULONG unless AVERAGE or FLOAT is set.
+;        AVERAGE: If set, return the mean of the images as FLOAT.
+;        FLOAT: If set, accumulate in FLOAT, which is required for
+;            more than 65537 16-bit images.
+;        VARIANCE: optional output: variance of each pixel over
+;            the n images.
+;
+;    Record, filename, nbuffers = nbuffers, /direct
+;        Record frames to filename in the background at the
+;        camera's native rate.  Frames cannot be read while
+;        recording.
+;        NBUFFERS: number of frames that may wait to be written.
+;        DIRECT: If set, bypass the page cache when writing.
+;
+;    StopRecording
+;        Finish writing the recording and resume normal capture.
+;
+;    RecordingStatus()
+;        Structure reporting the progress of the recording:
+;        number of frames captured, written and dropped.
+;
+;    Format7, roi = roi, mode = mode, pixelformat = pixelformat,
+;             packetsize = packetsize
+;        Reconfigure the Format7 mode, region of interest, pixel
+;        format and packet size together.  Settings are validated
+;        before capture is stopped.
+;
+;    Trigger, /broadcast
+;        Fire a software trigger.
+;        BROADCAST: If set, trigger every camera on the bus.
+;
+;    TriggerBurst(n, interval, fired = fired, latency = latency,
+;                 timestamps = timestamps, metadata = metadata, /broadcast)
+;        Fire n software triggers separated by interval seconds
+;        with native timing and return the n frames that they
+;        expose, as for ReadBurst.  Requires SOFTWARETRIGGER.
+;        FIRED: optional output: time at which each trigger fired [s]
+;        LATENCY: optional output: time from each trigger to the
+;            delivery of its frame [s]
+;        BROADCAST: If set, trigger every camera on the bus.
+;
+;    Tune(results = results)
+;        Find and apply the packet size (and, for GigE cameras,
+;        the inter-packet delay) that sustains the highest frame
+;        rate without incomplete frames.  Returns an idlpgrTuning
+;        structure describing the chosen setting.
+;        RESULTS: optional output: idlpgrTuning for every setting tried.
+;
+;    Stats(/reset)
+;        Structure of acquisition statistics: frames retrieved,
+;        delivered and dropped, depth of the grabber's queue, and
+;        retrievals that failed by timing out (TIMEOUTS), by failing
+;        consistency checks (INCONSISTENT) or otherwise (ERRORS),
+;        frames delivered with missing data (INCOMPLETE), and
+;        histograms of the time spent retrieving, waiting for,
+;        converting and copying frames, of their latency and of
+;        the time spent updating the background.
+;        RESET: If set, reset the statistics after reading them.
 ;
 ; MODIFICATION HISTORY:
 ; 07/21/2013 Written by David G. Grier, New York University
@@ -70,6 +238,26 @@
 ; 03/17/2015 DGG Rudimentary support for grayscale.
 ; 03/28/2015 DGG Implemented Reset method.
 ; 05/26/2015 DGG Updated image retrieval code to minimize pointer creation.
+; 10/16/2026 DGG Optional background grabber.
+; 10/16/2026 DGG Optional zero-copy user buffers.
+; 10/16/2026 DGG Implemented ReadBurst method.
+; 10/16/2026 DGG Optional live mode returns the newest frame.
+; 10/16/2026 DGG Images are typed according to pixel format.
+; 10/16/2026 DGG Native demosaicing of Bayer images.
+; 10/16/2026 DGG Batched property access with cached property information.
+; 10/16/2026 DGG Added CONTEXT property for synchronized capture groups.
+; 10/16/2026 DGG Implemented Record, StopRecording and RecordingStatus.
+; 10/16/2026 DGG Optional embedded image metadata.
+; 10/16/2026 DGG Implemented Stats method.
+; 10/16/2026 DGG Capture configuration and retrieval timeouts.
+; 10/16/2026 DGG Format7 region of interest, binning and pixel format.
+; 10/16/2026 DGG Implemented Tune method.
+; 10/16/2026 DGG Image buffer is sized and aligned for the camera.
+; 10/16/2026 DGG Software triggers.
+; 10/16/2026 DGG Trigger delay, strobes and latency measurement.
+; 10/16/2026 DGG Read can report errors instead of raising them.
+; 10/16/2026 DGG Background normalization.
+; 10/16/2026 DGG Implemented Integrate method.
 ;
 ; Copyright (c) 2013-2015 David G. Grier
 ;-
@@ -80,11 +268,17 @@
 ;
 ; Return next video frame from camera
 ;
-function DGGhwPointGrey::Read
+function DGGhwPointGrey::Read, error = error
 
   COMPILE_OPT IDL2, HIDDEN
 
-  self.DGGhwPointGrey::Read
+  if (self.userbuffers gt 0) && ~arg_present(error) then $
+     return, idlpgr_AcquireImage(self.context, normalize = self.normalize)
+
+  if arg_present(error) then $
+     self.DGGhwPointGrey::Read, error = error $
+  else $
+     self.DGGhwPointGrey::Read
   return, *self._data
 end
 
@@ -94,12 +288,335 @@ end
 ;
 ; Read next video frame from camera into data
 ;
-pro DGGhwPointGrey::Read
+pro DGGhwPointGrey::Read, error = error
 
   COMPILE_OPT IDL2, HIDDEN
 
-  idlpgr_RetrieveBuffer, self.context, self.image
-  idlpgr_GetImage, self.image, *self._data
+  checked = arg_present(error)
+  error = 0L
+
+  if self.userbuffers gt 0 then begin
+     if checked then begin
+        data = idlpgr_AcquireImage(self.context, error = error, $
+                                   normalize = self.normalize)
+        self.timedout = (error eq 18)
+        if error eq 0 then $
+           *self._data = temporary(data)
+     endif else $
+        *self._data = idlpgr_AcquireImage(self.context, $
+                                          normalize = self.normalize)
+     return
+  endif
+
+  if self.live then begin
+     if self.metadata then begin
+        data = idlpgr_LatestFrame(self.context, metadata = metadata, $
+                                  normalize = self.normalize)
+        if isa(metadata, /struct) then $
+           *self._metadata = metadata
+     endif else $
+        data = idlpgr_LatestFrame(self.context, normalize = self.normalize)
+     if n_elements(data) gt 1 then $
+        *self._data = temporary(data)
+     return
+  endif
+
+  ;; bad frames are skipped without raising errors
+  if checked then begin
+     if self.metadata then $
+        idlpgr_RetrieveBuffer, self.context, self.image, $
+                               metadata = metadata, error = error $
+     else $
+        idlpgr_RetrieveBuffer, self.context, self.image, error = error
+     self.timedout = (error eq 18)
+     if error ne 0 then $
+        return
+     if self.metadata then $
+        *self._metadata = metadata
+     if self.normalize gt 0 then $
+        *self._data = idlpgr_NormalizeImage(self.image, $
+                                            median = (self.normalize eq 2)) $
+     else if self.demosaic gt 0 then $
+        *self._data = idlpgr_Demosaic(self.image, method = self.demosaic) $
+     else $
+        idlpgr_GetImage, self.image, *self._data, error = error
+     return
+  endif
+
+  if self.metadata then begin
+     idlpgr_RetrieveBuffer, self.context, self.image, $
+                            metadata = metadata, timedout = timedout
+     if ~timedout then $
+        *self._metadata = metadata
+  endif else $
+     idlpgr_RetrieveBuffer, self.context, self.image, timedout = timedout
+  self.timedout = timedout
+  if timedout then $
+     return
+  if self.normalize gt 0 then $
+     *self._data = idlpgr_NormalizeImage(self.image, $
+                                         median = (self.normalize eq 2)) $
+  else if self.demosaic gt 0 then $
+     *self._data = idlpgr_Demosaic(self.image, method = self.demosaic) $
+  else $
+     idlpgr_GetImage, self.image, *self._data
+end
+
+;;;;;
+;
+; DGGhwPointGrey::ReadBurst()
+;
+; Return n consecutive video frames from camera
+;
+function DGGhwPointGrey::ReadBurst, n, timestamps = timestamps, $
+                                    metadata = metadata
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if arg_present(metadata) then $
+     return, idlpgr_ReadFrames(self.context, self.image, n, $
+                               timestamps = timestamps, metadata = metadata)
+
+  return, idlpgr_ReadFrames(self.context, self.image, n, timestamps = timestamps)
+end
+
+;;;;;
+;
+; DGGhwPointGrey::Integrate()
+;
+; Return the sum or average of n consecutive video frames
+;
+function DGGhwPointGrey::Integrate, n, average = average, float = float, $
+                                    variance = variance
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if arg_present(variance) then $
+     return, idlpgr_AccumulateFrames(self.context, self.image, n, $
+                                     average = keyword_set(average), $
+                                     float = keyword_set(float), $
+                                     variance = variance)
+  return, idlpgr_AccumulateFrames(self.context, self.image, n, $
+                                  average = keyword_set(average), $
+                                  float = keyword_set(float))
+end
+
+;;;;;
+;
+; DGGhwPointGrey::Record
+;
+; Record frames to a file in the background
+;
+pro DGGhwPointGrey::Record, filename, $
+                            nbuffers = nbuffers, $
+                            direct = direct
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if ~isa(filename, 'string') then $
+     message, 'Usage: camera.record, filename'
+
+  ;; the recorder retrieves frames in place of the grabber or callback
+  self.stopcapture
+  idlpgr_StartCapture, self.context
+  if isa(nbuffers, /number, /scalar) then $
+     idlpgr_StartRecording, self.context, filename, $
+                            nbuffers = nbuffers, direct = keyword_set(direct) $
+  else $
+     idlpgr_StartRecording, self.context, filename, direct = keyword_set(direct)
+end
+
+;;;;;
+;
+; DGGhwPointGrey::StopRecording
+;
+pro DGGhwPointGrey::StopRecording
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  idlpgr_StopRecording, self.context
+  self.startcapture
+end
+
+;;;;;
+;
+; DGGhwPointGrey::RecordingStatus()
+;
+function DGGhwPointGrey::RecordingStatus
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  return, idlpgr_RecordingStatus(self.context)
+end
+
+;;;;;
+;
+; DGGhwPointGrey::Configure
+;
+; Set the capture configuration.  Changing the number of buffers
+; or the grab mode restarts capture.
+;
+pro DGGhwPointGrey::Configure, numbuffers = numbuffers, $
+                               grabmode = grabmode, $
+                               grabtimeout = grabtimeout
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  restart = 0B
+  if isa(numbuffers, /number, /scalar) then begin
+     config = {numbuffers: long(numbuffers)}
+     restart = 1B
+  endif
+  if isa(grabmode, /number, /scalar) then begin
+     config = isa(config) ? $
+              create_struct(config, 'grabmode', long(grabmode)) : $
+              {grabmode: long(grabmode)}
+     restart = 1B
+  endif
+  if isa(grabtimeout, /number, /scalar) then $
+     config = isa(config) ? $
+              create_struct(config, 'grabtimeout', long(grabtimeout)) : $
+              {grabtimeout: long(grabtimeout)}
+  if ~isa(config) then $
+     return
+
+  if restart then $
+     self.stopcapture
+  idlpgr_SetConfiguration, self.context, _extra = config
+  if restart then $
+     self.startcapture
+end
+
+;;;;;
+;
+; DGGhwPointGrey::Format7
+;
+; Set the Format7 mode, region of interest, pixel format and
+; packet size, and resize the image buffer to match.
+;
+pro DGGhwPointGrey::Format7, roi = roi, $
+                             mode = mode, $
+                             pixelformat = pixelformat, $
+                             packetsize = packetsize
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  settings = idlpgr_GetFormat7Configuration(self.context)
+  if isa(mode, /number, /scalar) && (long(mode) ne settings.mode) then begin
+     settings.mode = long(mode)
+     if ~isa(roi, /number) then $
+        roi = [0, 0, 0, 0]
+  endif
+  info = idlpgr_GetFormat7Info(self.context, settings.mode, supported = supported)
+  if ~supported then $
+     message, 'Format7 mode ' + strtrim(settings.mode, 2) + $
+              ' is not supported by this camera'
+
+  if isa(roi, /number) && (n_elements(roi) eq 4) then begin
+     hstep = info.imagehstepsize > 1UL
+     vstep = info.imagevstepsize > 1UL
+     width = (roi[2] gt 0) ? ulong(roi[2]) : info.maxwidth
+     height = (roi[3] gt 0) ? ulong(roi[3]) : info.maxheight
+     width = hstep > (hstep * (width / hstep)) < info.maxwidth
+     height = vstep > (vstep * (height / vstep)) < info.maxheight
+     hstep = info.offsethstepsize > 1UL
+     vstep = info.offsetvstepsize > 1UL
+     settings.offsetx = (hstep * (ulong(0 > roi[0]) / hstep)) < $
+                        (info.maxwidth - width)
+     settings.offsety = (vstep * (ulong(0 > roi[1]) / vstep)) < $
+                        (info.maxheight - height)
+     settings.width = width
+     settings.height = height
+  endif
+
+  if isa(pixelformat, /number, /scalar) then begin
+     if (info.pixelformatbitfield and ulong(pixelformat)) eq 0 then $
+        message, 'Pixel format is not supported in this mode'
+     settings.pixelformat = ulong(pixelformat)
+  endif
+
+  if ~idlpgr_ValidateFormat7Settings(self.context, settings, $
+                                     packetinfo = packetinfo) then $
+     message, 'Format7 settings are not valid for this camera'
+  if isa(packetsize, /number, /scalar) then $
+     bytes = long(packetsize) > 1L < long(packetinfo.maxbytesperpacket) $
+  else $
+     bytes = long(packetinfo.recommendedbytesperpacket)
+
+  self.stopcapture
+  idlpgr_SetFormat7Configuration, self.context, settings, packetsize = bytes
+  ;; the validated settings size the image buffer
+  if ptr_valid(self._data) then $
+     *self._data = idlpgr_AllocateFormat7Image(settings)
+  self.startcapture
+end
+
+;;;;;
+;
+; DGGhwPointGrey::Trigger
+;
+; Fire a software trigger
+;
+pro DGGhwPointGrey::Trigger, broadcast = broadcast
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  idlpgr_FireSoftwareTrigger, self.context, broadcast = keyword_set(broadcast)
+end
+
+;;;;;
+;
+; DGGhwPointGrey::TriggerBurst()
+;
+; Return n frames exposed by software triggers at regular intervals
+;
+function DGGhwPointGrey::TriggerBurst, n, interval, $
+                                       fired = fired, $
+                                       latency = latency, $
+                                       timestamps = timestamps, $
+                                       metadata = metadata, $
+                                       broadcast = broadcast
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if arg_present(metadata) then $
+     return, idlpgr_TriggerAndRead(self.context, self.image, n, interval, $
+                                   broadcast = keyword_set(broadcast), $
+                                   fired = fired, latency = latency, $
+                                   timestamps = timestamps, $
+                                   metadata = metadata)
+
+  return, idlpgr_TriggerAndRead(self.context, self.image, n, interval, $
+                                broadcast = keyword_set(broadcast), $
+                                fired = fired, latency = latency, $
+                                timestamps = timestamps)
+end
+
+;;;;;
+;
+; DGGhwPointGrey::Tune()
+;
+; Tune the packet size for the highest sustainable frame rate
+;
+function DGGhwPointGrey::Tune, results = results
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  self.stopcapture
+  tuning = idlpgr_TunePacketSize(self.context, results = results)
+  self.startcapture
+  return, tuning
+end
+
+;;;;;
+;
+; DGGhwPointGrey::Stats()
+;
+function DGGhwPointGrey::Stats, reset = reset
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  return, idlpgr_Stats(self.context, reset = keyword_set(reset))
 end
 
 ;;;;;
@@ -110,7 +627,14 @@ pro DGGhwPointGrey::StartCapture
 
   COMPILE_OPT IDL2, HIDDEN
 
+  if self.live then begin
+     idlpgr_StartCaptureCallback, self.context
+     return
+  endif
+
   idlpgr_StartCapture, self.context
+  if self.grabber gt 0 then $
+     idlpgr_StartGrabber, self.context, self.grabber
 end
 
 ;;;;;
@@ -153,6 +677,43 @@ function DGGhwPointGrey::PropertyInfo, property
   return, idlpgr_GetPropertyInfo(self.context, self.properties[property])
 end
 
+;;;;;
+;
+; DGGhwPointGrey::PropertyNames()
+;
+; Select the names of camera properties that are present on this
+; camera from a list of keywords.  Returns the property IDs and
+; cached property information for the selected names.
+;
+function DGGhwPointGrey::PropertyNames, keywords, ids, info
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  names = list()
+  foreach name, strlowcase(keywords) do $
+     if self.properties.haskey(name) then names.add, name
+  if names.isempty() then $
+     return, []
+
+  names = names.toarray()
+  ids = lonarr(n_elements(names))
+  foreach name, names, i do $
+     ids[i] = self.properties[name]
+  info = idlpgr_GetPropertyInfo(self.context, ids)
+
+  present = where(info.present, npresent, $
+                  complement = missing, ncomplement = nmissing)
+  if nmissing gt 0 then $
+     message, strjoin(names[missing], ', ') + $
+              ' not valid for this camera. Skipping', /inf
+  if npresent eq 0 then $
+     return, []
+
+  ids = ids[present]
+  info = info[present]
+  return, names[present]
+end
+
 ;;;;;
 ;
 ; DGGhwPoingGrey::ControlProperty
@@ -199,43 +760,125 @@ end
 ; DGGhwPointGrey::SetProperty
 ;
 pro DGGhwPointGrey::SetProperty, hflip = hflip, $
+                                 demosaic = demosaic, $
+                                 numbuffers = numbuffers, $
+                                 grabmode = grabmode, $
+                                 grabtimeout = grabtimeout, $
+                                 roi = roi, $
+                                 mode = mode, $
+                                 pixelformat = pixelformat, $
+                                 packetsize = packetsize, $
+                                 triggermode = triggermode, $
+                                 softwaretrigger = softwaretrigger, $
+                                 triggerdelay = triggerdelay, $
+                                 strobe = strobe, $
+                                 strobesource = strobesource, $
+                                 measurelatency = measurelatency, $
+                                 normalize = normalize, $
+                                 backgroundweight = backgroundweight, $
+                                 dark = dark, $
                                  _ref_extra = propertylist
 
   COMPILE_OPT IDL2, HIDDEN
   
   if isa(propertylist) then begin
-     foreach name, strlowcase(propertylist) do begin
-        if self.properties.haskey(name) then begin
-           propertyid = self.properties[name]
-           info = idlpgr_GetPropertyInfo(self.context,  propertyid)
-           if ~info.present then begin
-              message, name + ' is not a valid property for this camera. Skipping', /inf
-              continue
-           endif
-           prop = idlpgr_GetProperty(self.context, propertyid)
-           if info.absValSupported then begin
-              prop.abscontrol = 1L
+     names = self.PropertyNames(propertylist, ids, info)
+     count = n_elements(names)
+     if (count gt 1) && (max(names eq 'frame_rate') eq 1) then begin
+        ;; shutter limits depend on frame rate, so set frame rate first
+        self.DGGhwPointGrey::SetProperty, $
+           frame_rate = scope_varfetch('frame_rate', /ref_extra)
+        names = self.PropertyNames(names[where(names ne 'frame_rate')], $
+                                   ids, info)
+        count = n_elements(names)
+     endif
+     if count gt 0 then begin
+        props = idlpgr_GetProperties(self.context, ids)
+        foreach name, names, i do begin
+           if info[i].absValSupported then begin
+              props[i].abscontrol = 1L
               value = float(scope_varfetch(name, /ref_extra))
-              value >= info.absmin
-              value <= info.absmax
-              prop.absvalue = value
+              props[i].absvalue = info[i].absmin > value < info[i].absmax
            endif else begin
-              prop.abscontrol = 0L
+              props[i].abscontrol = 0L
               value = long(scope_varfetch(name, /ref_extra))
-              value >= info.min
-              value <= info.max
-              prop.valueA = value
+              props[i].valueA = info[i].min > value < info[i].max
            endelse
-           prop.automanualmode = 0L
-           idlpgr_SetProperty, self.context, prop
-        endif
-     endforeach
+        endforeach
+        props.automanualmode = 0L
+        idlpgr_SetProperties, self.context, props
+     endif
   endif
 
   if isa(hflip, /number, /scalar) then begin
      value = '80000000'XUL + (hflip ne 0)
      self.writeregister, '1054'XUL, value
   endif
+
+  if isa(demosaic, /number, /scalar) then $
+     self.demosaic = self.grayscale ? 0L : (0L > long(demosaic) < 3L)
+
+  self.DGGhwPointGrey::Configure, numbuffers = numbuffers, $
+                                  grabmode = grabmode, $
+                                  grabtimeout = grabtimeout
+
+  if isa(roi) || isa(mode) || isa(pixelformat) || isa(packetsize) then $
+     self.DGGhwPointGrey::Format7, roi = roi, mode = mode, $
+                                   pixelformat = pixelformat, $
+                                   packetsize = packetsize
+
+  if isa(triggermode, 'fc2TriggerMode') then $
+     idlpgr_SetTriggerMode, self.context, triggermode
+
+  if isa(softwaretrigger, /number, /scalar) then begin
+     if keyword_set(softwaretrigger) then $
+        idlpgr_SetTriggerMode, self.context, onoff = 1, source = 7, mode = 0 $
+     else $
+        idlpgr_SetTriggerMode, self.context, onoff = 0
+  endif
+
+  if isa(triggerdelay, /number, /scalar) then $
+     idlpgr_SetTriggerDelay, self.context, triggerdelay
+
+  if isa(strobesource, /number, /scalar) then $
+     self.strobesource = long(strobesource)
+
+  if isa(strobe, 'fc2StrobeControl') then $
+     idlpgr_SetStrobe, self.context, strobe
+
+  ;; embedded image information is configured while capture is stopped
+  if isa(measurelatency, /number, /scalar) then begin
+     self.measurelatency = keyword_set(measurelatency)
+     self.stopcapture
+     idlpgr_MeasureLatency, self.context, self.measurelatency
+     self.startcapture
+  endif
+
+  if isa(dark, /number) then begin
+     *self._dark = dark
+     if self.normalize gt 0 then $
+        idlpgr_SetDark, self.context, dark
+  endif
+
+  if isa(backgroundweight, /number, /scalar) then begin
+     self.backgroundweight = 0. > float(backgroundweight) < 1.
+     if self.normalize gt 0 then $
+        idlpgr_StartBackground, self.context, weight = self.backgroundweight
+  endif
+
+  if isa(normalize, /number, /scalar) then begin
+     value = 0L > long(normalize) < 2L
+     if (value gt 0) && (self.normalize eq 0) then begin
+        idlpgr_StartBackground, self.context, weight = self.backgroundweight
+        idlpgr_SetDark, self.context, *self._dark
+     endif
+     if (value eq 0) && (self.normalize gt 0) then begin
+        idlpgr_StopBackground, self.context
+        ;; restore the buffer for raw images
+        *self._data = idlpgr_AllocateImage(self.image)
+     endif
+     self.normalize = value
+  endif
 end
 
 ;;;;;
@@ -245,26 +888,51 @@ end
 pro DGGhwPointGrey::GetProperty, properties = properties, $
                                  grayscale  = grayscale,  $
                                  camerainfo = camerainfo, $
+                                 context    = context,    $
                                  hflip      = hflip,      $
+                                 grabber    = grabber,    $
+                                 userbuffers = userbuffers, $
+                                 live       = live,       $
+                                 imageinfo  = imageinfo,  $
+                                 demosaic   = demosaic,   $
+                                 metadata   = metadata,   $
+                                 numbuffers = numbuffers, $
+                                 grabmode   = grabmode,   $
+                                 grabtimeout = grabtimeout, $
+                                 timedout   = timedout,   $
+                                 roi        = roi,        $
+                                 mode       = mode,       $
+                                 pixelformat = pixelformat, $
+                                 packetsize = packetsize, $
+                                 format7info = format7info, $
+                                 triggermode = triggermode, $
+                                 softwaretrigger = softwaretrigger, $
+                                 triggermodeinfo = triggermodeinfo, $
+                                 triggerdelay = triggerdelay, $
+                                 strobe     = strobe,     $
+                                 strobesource = strobesource, $
+                                 strobeinfo = strobeinfo, $
+                                 measurelatency = measurelatency, $
+                                 latency    = latency,    $
+                                 normalize  = normalize,  $
+                                 backgroundweight = backgroundweight, $
+                                 dark       = dark,       $
+                                 background = background, $
                                  _ref_extra = propertylist
 
   COMPILE_OPT IDL2, HIDDEN
 
   if isa(propertylist) then begin
-     foreach name, strlowcase(propertylist) do begin
-        if self.properties.haskey(name) then begin
-           propertyid = self.properties[name]
-           info = idlpgr_GetPropertyInfo(self.context, propertyid)
-           if info.present then begin
-              prop = idlpgr_GetProperty(self.context, propertyid)
-              (scope_varfetch(name, /ref_extra)) = (info.absValSupported) ? $
-                                                   prop.absvalue : prop.valueA
-           endif else begin
-              message, name + ' is not a valid property for this camera.', /inf
-              (scope_varfetch(name, /ref_extra)) = 0
-           endelse
-        endif
-     endforeach
+     foreach name, strlowcase(propertylist) do $
+        if self.properties.haskey(name) then $
+           (scope_varfetch(name, /ref_extra)) = 0
+     names = self.PropertyNames(propertylist, ids, info)
+     if n_elements(names) gt 0 then begin
+        props = idlpgr_GetProperties(self.context, ids)
+        foreach name, names, i do $
+           (scope_varfetch(name, /ref_extra)) = $
+              (info[i].absValSupported) ? props[i].absvalue : props[i].valueA
+     endif
   endif
 
   if arg_present(properties) then $
@@ -276,8 +944,92 @@ pro DGGhwPointGrey::GetProperty, properties = properties, $
   if arg_present(camerainfo) then $
      camerainfo = idlpgr_GetCameraInfo(self.context)
 
+  if arg_present(context) then $
+     context = self.context
+
   if arg_present(hflip) then $
      hflip = (self.readregister('1054'XUL) and 1)
+
+  if arg_present(grabber) then $
+     grabber = self.grabber
+
+  if arg_present(userbuffers) then $
+     userbuffers = self.userbuffers
+
+  if arg_present(live) then $
+     live = self.live
+
+  if arg_present(imageinfo) then $
+     imageinfo = idlpgr_GetImageInfo(self.image)
+
+  if arg_present(demosaic) then $
+     demosaic = self.demosaic
+
+  if arg_present(metadata) then $
+     metadata = self.metadata ? *self._metadata : 0
+
+  if arg_present(numbuffers) || arg_present(grabmode) || $
+     arg_present(grabtimeout) then begin
+     config = idlpgr_GetConfiguration(self.context)
+     numbuffers = config.numbuffers
+     grabmode = config.grabmode
+     grabtimeout = config.grabtimeout
+  endif
+
+  if arg_present(timedout) then $
+     timedout = self.timedout
+
+  if arg_present(roi) || arg_present(mode) || arg_present(pixelformat) || $
+     arg_present(packetsize) || arg_present(format7info) then begin
+     settings = idlpgr_GetFormat7Configuration(self.context, $
+                                               packetsize = packetsize)
+     roi = [settings.offsetx, settings.offsety, $
+            settings.width, settings.height]
+     mode = settings.mode
+     pixelformat = settings.pixelformat
+     if arg_present(format7info) then $
+        format7info = idlpgr_GetFormat7Info(self.context, settings.mode)
+  endif
+
+  if arg_present(triggermode) || arg_present(softwaretrigger) then begin
+     triggermode = idlpgr_GetTriggerMode(self.context)
+     softwaretrigger = triggermode.onoff && (triggermode.source eq 7)
+  endif
+
+  if arg_present(triggermodeinfo) then $
+     triggermodeinfo = idlpgr_GetTriggerModeInfo(self.context)
+
+  if arg_present(triggerdelay) then $
+     triggerdelay = (idlpgr_GetTriggerDelay(self.context)).absvalue
+
+  if arg_present(strobesource) then $
+     strobesource = self.strobesource
+
+  if arg_present(strobe) then $
+     strobe = idlpgr_GetStrobe(self.context, self.strobesource)
+
+  if arg_present(strobeinfo) then $
+     strobeinfo = idlpgr_GetStrobeInfo(self.context, self.strobesource)
+
+  if arg_present(measurelatency) then $
+     measurelatency = self.measurelatency
+
+  if arg_present(latency) then $
+     latency = idlpgr_Latency(self.context)
+
+  if arg_present(normalize) then $
+     normalize = self.normalize
+
+  if arg_present(backgroundweight) then $
+     backgroundweight = self.backgroundweight
+
+  if arg_present(dark) then $
+     dark = *self._dark
+
+  if arg_present(background) then $
+     background = (self.normalize gt 0) ? $
+                  idlpgr_GetBackground(self.context, $
+                                       median = (self.normalize eq 2)) : 0
 end
 
 ;;;;;
@@ -306,7 +1058,27 @@ end
 ;
 ; DGGhwPointGrey::Init()
 ;
-function DGGhwPointGrey::Init, camera = _camera
+function DGGhwPointGrey::Init, camera = _camera, $
+                               grabber = grabber, $
+                               userbuffers = userbuffers, $
+                               live = live, $
+                               demosaic = demosaic, $
+                               metadata = metadata, $
+                               numbuffers = numbuffers, $
+                               grabmode = grabmode, $
+                               grabtimeout = grabtimeout, $
+                               lossless = lossless, $
+                               roi = roi, $
+                               mode = mode, $
+                               pixelformat = pixelformat, $
+                               packetsize = packetsize, $
+                               tune = tune, $
+                               softwaretrigger = softwaretrigger, $
+                               triggerdelay = triggerdelay, $
+                               strobesource = strobesource, $
+                               measurelatency = measurelatency, $
+                               normalize = normalize, $
+                               backgroundweight = backgroundweight
 
   COMPILE_OPT IDL2, HIDDEN
 
@@ -318,10 +1090,20 @@ function DGGhwPointGrey::Init, camera = _camera
 
   camera = isa(_camera, /number, /scalar) ? long(_camera) : 0L
 
+  if keyword_set(grabber) then $
+     self.grabber = (grabber gt 1) ? long(grabber) : 10L
+
   self.context = idlpgr_CreateContext()
   camera = idlpgr_GetCameraFromIndex(self.context, camera)
   idlpgr_Connect, self.context, camera
+  if keyword_set(lossless) then begin
+     if ~isa(grabmode, /number, /scalar) then grabmode = 1L
+     if ~isa(numbuffers, /number, /scalar) then numbuffers = 64L
+  endif
   self.startcapture
+  self.DGGhwPointGrey::Configure, numbuffers = numbuffers, $
+                                  grabmode = grabmode, $
+                                  grabtimeout = grabtimeout
 
   properties = ['brightness',    $
                 'auto_exposure', $
@@ -346,12 +1128,64 @@ function DGGhwPointGrey::Init, camera = _camera
 
   info = idlpgr_GetCameraInfo(self.context)
   self.grayscale = ~info.iscolorcamera
+  if isa(demosaic, /number, /scalar) then $
+     self.DGGhwPointGrey::SetProperty, demosaic = demosaic
+
+  self.strobesource = isa(strobesource, /number, /scalar) ? $
+                      long(strobesource) : 1L
 
-  self.image =  idlpgr_CreateImage()
+  self._metadata = ptr_new(0)
+  if keyword_set(metadata) then begin
+     self.stopcapture
+     idlpgr_SetEmbeddedImageInfo, self.context
+     self.metadata = 1L
+     self.startcapture
+  endif
+
+  if isa(roi) || isa(mode) || isa(pixelformat) || isa(packetsize) then $
+     self.DGGhwPointGrey::Format7, roi = roi, mode = mode, $
+                                   pixelformat = pixelformat, $
+                                   packetsize = packetsize
+
+  if keyword_set(tune) then $
+     void = self.DGGhwPointGrey::Tune()
+
+  if isa(triggerdelay, /number, /scalar) then $
+     self.DGGhwPointGrey::SetProperty, triggerdelay = triggerdelay
+
+  if keyword_set(measurelatency) then $
+     self.DGGhwPointGrey::SetProperty, measurelatency = 1
+
+  self.image =  idlpgr_CreateImage(self.context)
   idlpgr_RetrieveBuffer, self.context, self.image
   data = idlpgr_AllocateImage(self.image)
+
+  if keyword_set(userbuffers) then begin
+     self.userbuffers = (userbuffers gt 2) ? long(userbuffers) : 16L
+     self.stopcapture
+     imageinfo = idlpgr_GetImageInfo(self.image)
+     idlpgr_SetUserBuffers, self.context, imageinfo.datasize, self.userbuffers
+     self.startcapture
+  endif
+
+  if keyword_set(live) then begin
+     self.stopcapture
+     self.live = 1L
+     self.startcapture
+  endif
+
   self._data = ptr_new(data, /no_copy)
 
+  self._dark = ptr_new(0.)
+  self.backgroundweight = isa(backgroundweight, /number, /scalar) ? $
+                          (0. > float(backgroundweight) < 1.) : 0.01
+  if isa(normalize, /number, /scalar) then $
+     self.DGGhwPointGrey::SetProperty, normalize = normalize
+
+  ;; frames are triggered only after the first has been read
+  if keyword_set(softwaretrigger) then $
+     self.DGGhwPointGrey::SetProperty, softwaretrigger = 1
+
   return, 1B
 end
 
@@ -368,6 +1202,7 @@ pro DGGhwPointGrey::Cleanup
   self.stopcapture
   idlpgr_DestroyContext, self.context
   idlpgr_DestroyImage, self.image
+  ptr_free, self._metadata, self._dark
 end
 
 ;;;;;
@@ -385,6 +1220,18 @@ pro DGGhwPointGrey__define
             image: 0ULL, $
             _data: ptr_new(), $
             grayscale: 1L, $
+            grabber: 0L, $
+            userbuffers: 0L, $
+            live: 0L, $
+            demosaic: 0L, $
+            metadata: 0L, $
+            _metadata: ptr_new(), $
+            timedout: 0L, $
+            strobesource: 1L, $
+            measurelatency: 0L, $
+            normalize: 0L, $
+            backgroundweight: 0.01, $
+            _dark: ptr_new(), $
             properties: obj_new() $
            }
 end
@@ -0,0 +1,163 @@
+;+
+; NAME:
+;    DGGhwPointGreyGroup
+;
+; PURPOSE:
+;    Object interface for synchronized capture from several
+;    PointGrey video cameras
+;
+; CATEGORY:
+;    Hardware automation, Video processing
+;
+; CALLING SEQUENCE:
+;    a = DGGhwPointGreyGroup(cameras)
+;
+; INPUTS:
+;    cameras: array of DGGhwPointGrey objects.  All of the cameras
+;        must deliver images of the same size and format.
+;
+; KEYWORD PARAMETERS:
+;    CALLBACK: If set, frames are delivered to callbacks that keep
+;        only the most recent frame from each camera.  Otherwise,
+;        a thread for each camera retrieves frames into a ring of
+;        buffers.
+;    NBUFFERS: number of buffers in each camera's ring.  Default: 10
+;    TOLERANCE: largest difference between time stamps of frames
+;        in one set [s].  Default: half of the frame period.
+;
+; PROPERTIES:
+;    [IG ] CAMERAS: array of DGGhwPointGrey objects
+;    [ G ] DROPPED: number of frames discarded because they had
+;        no partner from every other camera.
+;
+; METHODS:
+;    Read(timestamps = timestamps)
+;        Return the next set of synchronized frames as an array
+;        whose last dimension is the camera index.
+;        TIMESTAMPS: optional output: time stamp of each frame [s]
+;
+; NOTES:
+;    Capture on each camera is suspended while the group exists,
+;    and resumes when the group is destroyed.
+;
+; MODIFICATION HISTORY:
+; 10/16/2026 Written by David G. Grier, New York University
+;
+; Copyright (c) 2026 David G. Grier
+;-
+
+;;;;;
+;
+; DGGhwPointGreyGroup::Read()
+;
+; Return next set of synchronized frames
+;
+function DGGhwPointGreyGroup::Read, timestamps = timestamps
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  data = idlpgr_ReadSyncFrames(self.group, timestamps = timestamps, $
+                               dropped = dropped)
+  self.dropped = dropped
+  return, data
+end
+
+;;;;;
+;
+; DGGhwPointGreyGroup::GetProperty
+;
+pro DGGhwPointGreyGroup::GetProperty, cameras = cameras, $
+                                      dropped = dropped
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if arg_present(cameras) then $
+     cameras = *self.cameras
+
+  if arg_present(dropped) then $
+     dropped = self.dropped
+end
+
+;;;;;
+;
+; DGGhwPointGreyGroup::Init()
+;
+function DGGhwPointGreyGroup::Init, cameras, $
+                                    callback = callback, $
+                                    nbuffers = nbuffers, $
+                                    tolerance = tolerance
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if n_params() ne 1 then $
+     return, 0B
+
+  if ~isa(cameras, 'DGGhwPointGrey') then begin
+     message, 'cameras must be DGGhwPointGrey objects', /inf
+     return, 0B
+  endif
+
+  contexts = ulon64arr(n_elements(cameras))
+  foreach camera, cameras, n do begin
+     camera.DGGhwPointGrey::GetProperty, context = context
+     contexts[n] = context
+     camera.stopcapture
+  endforeach
+
+  catch, error
+  if (error ne 0L) then begin
+     catch, /cancel
+     message, !ERROR_STATE.MSG, /inf
+     foreach camera, cameras do camera.startcapture
+     return, 0B
+  endif
+
+  extra = {callback: keyword_set(callback)}
+  if isa(nbuffers, /number, /scalar) then $
+     extra = create_struct(extra, 'nbuffers', long(nbuffers))
+  if isa(tolerance, /number, /scalar) then $
+     extra = create_struct(extra, 'tolerance', double(tolerance))
+  self.group = idlpgr_StartSyncCapture(contexts, _extra = extra)
+  catch, /cancel
+
+  self.cameras = ptr_new(cameras)
+
+  return, 1B
+end
+
+;;;;;
+;
+; DGGhwPointGreyGroup::Cleanup
+;
+pro DGGhwPointGreyGroup::Cleanup
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if self.group ne 0 then $
+     idlpgr_StopSyncCapture, self.group
+
+  if ptr_valid(self.cameras) then begin
+     foreach camera, *self.cameras do $
+        if obj_valid(camera) then camera.startcapture
+     ptr_free, self.cameras
+  endif
+end
+
+;;;;;
+;
+; DGGhwPointGreyGroup__define
+;
+; Define an object that captures synchronized frames
+; from several PointGrey cameras
+;
+pro DGGhwPointGreyGroup__define
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  struct = {DGGhwPointGreyGroup, $
+            inherits IDL_Object, $
+            group: 0ULL, $
+            cameras: ptr_new(), $
+            dropped: 0ULL $
+           }
+end
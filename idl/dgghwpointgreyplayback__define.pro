@@ -0,0 +1,236 @@
+;+
+; NAME:
+;    DGGhwPointGreyPlayback
+;
+; PURPOSE:
+;    Object interface for recorded PointGrey video with the same
+;    Read() method as DGGhwPointGrey, so that analysis code can
+;    run unchanged on live or recorded data.
+;
+; CATEGORY:
+;    Video processing
+;
+; CALLING SEQUENCE:
+;    a = DGGhwPointGreyPlayback(filename)
+;
+; INPUTS:
+;    filename: name of a recording made with DGGhwPointGrey::Record,
+;        or of a raw dump of frames.
+;
+; KEYWORD PARAMETERS:
+;    DIMENSIONS: dimensions of each frame of a raw dump, as
+;        returned by DGGhwPointGrey::Read().  Setting DIMENSIONS
+;        opens the file as a raw dump: a fixed header followed by
+;        contiguous frames.
+;    HEADER: size of the header of a raw dump [bytes].  Default: 0
+;    TYPE: IDL type code of the frames of a raw dump.
+;        Default: 1 (BYTE)
+;    LOOP: If set, Read() returns to the first frame after the last.
+;
+; PROPERTIES:
+;    [IG ] FILENAME: name of the file
+;    [ G ] NFRAMES: number of frames in the recording
+;    [ GS] FRAME: index of the frame returned by the next Read()
+;    [ G ] TIMESTAMP: time stamp of the frame returned by the
+;        most recent Read() [s].  0 for raw dumps.
+;    [ G ] INFO: structure describing the recording
+;    [IGS] LOOP
+;
+; METHODS:
+;    Read(): return the next frame
+;
+;    ReadBurst(n, timestamps = timestamps)
+;        Return n consecutive frames as an array whose last
+;        dimension is the frame index.
+;        TIMESTAMPS: optional output: time stamp of each frame [s]
+;
+;    ReadFrame(n): return frame n without changing FRAME
+;
+; NOTES:
+;    Frames are returned as views of the memory-mapped file
+;    whenever possible, so reading does not copy data.  Changes
+;    to the returned arrays are not written to the file.
+;
+; MODIFICATION HISTORY:
+; 10/16/2026 Written by David G. Grier, New York University
+;
+; Copyright (c) 2026 David G. Grier
+;-
+
+;;;;;
+;
+; DGGhwPointGreyPlayback::Read()
+;
+; Return next video frame from the recording
+;
+function DGGhwPointGreyPlayback::Read
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if self.frame ge self.nframes then begin
+     if ~self.loop then $
+        message, 'no more frames in ' + self.filename
+     self.frame = 0ULL
+  endif
+
+  data = idlpgr_ReadRecording(self.recording, self.frame, $
+                              timestamp = timestamp)
+  self.timestamp = timestamp
+  self.frame++
+  return, data
+end
+
+;;;;;
+;
+; DGGhwPointGreyPlayback::ReadBurst()
+;
+; Return n consecutive video frames from the recording
+;
+function DGGhwPointGreyPlayback::ReadBurst, n, timestamps = timestamps
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if self.frame + n gt self.nframes then $
+     message, 'not enough frames in ' + self.filename
+
+  data = idlpgr_ReadRecording(self.recording, self.frame, count = n, $
+                              timestamp = timestamps)
+  self.timestamp = timestamps[-1]
+  self.frame += n
+  return, data
+end
+
+;;;;;
+;
+; DGGhwPointGreyPlayback::ReadFrame()
+;
+; Return the specified frame
+;
+function DGGhwPointGreyPlayback::ReadFrame, n
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  return, idlpgr_ReadRecording(self.recording, n)
+end
+
+;;;;;
+;
+; DGGhwPointGreyPlayback::SetProperty
+;
+pro DGGhwPointGreyPlayback::SetProperty, frame = frame, $
+                                         loop = loop
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if isa(frame, /number, /scalar) then $
+     self.frame = 0ULL > ulong64(frame) < self.nframes
+
+  if isa(loop, /number, /scalar) then $
+     self.loop = keyword_set(loop)
+end
+
+;;;;;
+;
+; DGGhwPointGreyPlayback::GetProperty
+;
+pro DGGhwPointGreyPlayback::GetProperty, filename = filename, $
+                                         nframes = nframes, $
+                                         frame = frame, $
+                                         timestamp = timestamp, $
+                                         info = info, $
+                                         loop = loop
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if arg_present(filename) then $
+     filename = self.filename
+
+  if arg_present(nframes) then $
+     nframes = self.nframes
+
+  if arg_present(frame) then $
+     frame = self.frame
+
+  if arg_present(timestamp) then $
+     timestamp = self.timestamp
+
+  if arg_present(info) then $
+     info = idlpgr_RecordingInfo(self.recording)
+
+  if arg_present(loop) then $
+     loop = self.loop
+end
+
+;;;;;
+;
+; DGGhwPointGreyPlayback::Init()
+;
+function DGGhwPointGreyPlayback::Init, filename, $
+                                       dimensions = dimensions, $
+                                       header = header, $
+                                       type = type, $
+                                       loop = loop
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if ~isa(filename, 'string') then $
+     return, 0B
+
+  catch, error
+  if (error ne 0L) then begin
+     catch, /cancel
+     message, !ERROR_STATE.MSG, /inf
+     return, 0B
+  endif
+
+  if isa(dimensions, /number, /array) then begin
+     header = isa(header, /number, /scalar) ? long(header) : 0L
+     type = isa(type, /number, /scalar) ? long(type) : 1L
+     self.recording = idlpgr_OpenRecording(filename, /sequential, $
+                                           dimensions = dimensions, $
+                                           header = header, $
+                                           type = type)
+  endif else $
+     self.recording = idlpgr_OpenRecording(filename, /sequential)
+  catch, /cancel
+
+  info = idlpgr_RecordingInfo(self.recording)
+  self.nframes = info.nframes
+  self.filename = filename
+  self.loop = keyword_set(loop)
+
+  return, 1B
+end
+
+;;;;;
+;
+; DGGhwPointGreyPlayback::Cleanup
+;
+pro DGGhwPointGreyPlayback::Cleanup
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  if self.recording ne 0 then $
+     idlpgr_CloseRecording, self.recording
+end
+
+;;;;;
+;
+; DGGhwPointGreyPlayback__define
+;
+; Define an object that plays back recorded video
+;
+pro DGGhwPointGreyPlayback__define
+
+  COMPILE_OPT IDL2, HIDDEN
+
+  struct = {DGGhwPointGreyPlayback, $
+            inherits IDL_Object, $
+            recording: 0ULL, $
+            filename: '', $
+            nframes: 0ULL, $
+            frame: 0ULL, $
+            timestamp: 0D, $
+            loop: 0L $
+           }
+end
@@ -0,0 +1,378 @@
+//
+// benchcapture.c
+//
+// Benchmark of the idlpgr acquisition path without IDL.
+// Frames are acquired and transferred through the C interface
+// of idlpgr_api.h, and so through the same background grabber
+// and kernels as in the DLM, for each combination of frame size
+// and pixel format.  The results are written to standard output
+// as JSON, together with the instruction set of the kernels that
+// the library chose for each stage.
+//
+// For each run the benchmark reports the sustained frame rate,
+// the data rate from the camera and into the destination array,
+// frames lost in the ring or in transit (from the embedded frame
+// counter), failed retrievals by class, and percentiles of the
+// time spent in each stage:
+//
+//   retrieve  fc2RetrieveBuffer in the grabber thread
+//   wait      reader waiting for the next frame in the ring
+//   convert   unpacking into the destination array
+//   copy      copying into the destination array
+//   read      idlpgr_DeviceRead, measured for every frame
+//
+// All but the last are estimated from the library's logarithmic
+// histograms.
+//
+// Usage: benchcapture [-n nframes] [-w nwarmup] [-b nslots]
+//                     [-c camera] [-s WxH[,WxH...]]
+//                     [-f FORMAT[,FORMAT...]]
+//
+// FORMAT is one of MONO8, MONO12, MONO16, RAW8, RAW12, RAW16
+// and RGB8.  Sizes larger than the sensor are reduced to fit.
+// Combinations that the camera does not support are reported
+// with the reason they were skipped.  Linked against fc2sim,
+// the benchmark runs without a camera.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Report the selected kernels.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <time.h>
+
+#include "C/FlyCapture2_C.h"
+#include "idlpgr_api.h"
+
+#define NBUFFERS  10
+#define TIMEOUT   5000       // [ms] longest wait for a frame
+
+static const struct {
+  const char *name;
+  fc2PixelFormat format;
+  unsigned int bits;           // per pixel, from the camera
+} formats[] = {
+  { "MONO8",  FC2_PIXEL_FORMAT_MONO8,  8 },
+  { "MONO12", FC2_PIXEL_FORMAT_MONO12, 12 },
+  { "MONO16", FC2_PIXEL_FORMAT_MONO16, 16 },
+  { "RAW8",   FC2_PIXEL_FORMAT_RAW8,   8 },
+  { "RAW12",  FC2_PIXEL_FORMAT_RAW12,  12 },
+  { "RAW16",  FC2_PIXEL_FORMAT_RAW16,  16 },
+  { "RGB8",   FC2_PIXEL_FORMAT_RGB8,   24 },
+};
+
+#define NFORMATS (sizeof(formats)/sizeof(formats[0]))
+
+static const struct {
+  const char *name;
+  int stage;
+} stages[] = {
+  { "retrieve", IDLPGR_API_RETRIEVE },
+  { "wait",     IDLPGR_API_WAIT },
+  { "convert",  IDLPGR_API_CONVERT },
+  { "copy",     IDLPGR_API_COPY },
+};
+
+#define NSTAGES (sizeof(stages)/sizeof(stages[0]))
+
+static unsigned long long now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1000000000ULL * ts.tv_sec + ts.tv_nsec;
+}
+
+static int compare(const void *a, const void *b)
+{
+  unsigned long long x = *(const unsigned long long *) a;
+  unsigned long long y = *(const unsigned long long *) b;
+
+  return (x > y) - (x < y);
+}
+
+static double percentile(const unsigned long long *sorted, size_t n, double p)
+{
+  size_t k;
+
+  if (!n)
+    return 0.;
+  k = (size_t) (p * n);
+  return (double) sorted[k < n ? k : n - 1];
+}
+
+//
+// Report percentiles [us] of n intervals [ns], sorting them in place
+//
+static void report_samples(const char *name, unsigned long long *t, size_t n)
+{
+  double total = 0.;
+  size_t k;
+
+  qsort(t, n, sizeof(unsigned long long), compare);
+  for (k = 0; k < n; k++)
+    total += t[k];
+  printf("        \"%s\": {\"mean_us\": %.3f, \"p50_us\": %.3f, "
+	 "\"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}\n",
+	 name, n ? 1e-3 * total / n : 0.,
+	 1e-3 * percentile(t, n, 0.50), 1e-3 * percentile(t, n, 0.90),
+	 1e-3 * percentile(t, n, 0.99), n ? 1e-3 * t[n-1] : 0.);
+}
+
+static void report_timing(const char *name, const idlpgr_timing *t)
+{
+  printf("        \"%s\": {\"count\": %llu, \"mean_us\": %.3f, "
+	 "\"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, "
+	 "\"estimated\": true},\n",
+	 name, t->count, 1e6 * t->mean, 1e6 * t->p50, 1e6 * t->p99,
+	 1e6 * t->max);
+}
+
+static void report_skipped(unsigned int width, unsigned int height,
+			   const char *format, const char *reason,
+			   int *first)
+{
+  printf("%s    {\"width\": %u, \"height\": %u, \"format\": \"%s\", "
+	 "\"skipped\": \"%s\"}", *first ? "" : ",\n",
+	 width, height, format, reason);
+  *first = 0;
+}
+
+//
+// Configure the camera for one run.  Returns NULL on success,
+// or the reason that the combination was skipped.
+//
+static const char *configure(fc2Context context,
+			     fc2Format7ImageSettings *settings,
+			     unsigned int *packetsize)
+{
+  fc2Format7Info info;
+  fc2Format7PacketInfo packetinfo;
+  BOOL supported, valid;
+
+  memset(&info, 0, sizeof(fc2Format7Info));
+  info.mode = FC2_MODE_0;
+  if (fc2GetFormat7Info(context, &info, &supported) || !supported)
+    return "Format7 mode 0 not supported";
+  if (!(info.pixelFormatBitField & settings->pixelFormat))
+    return "pixel format not supported";
+
+  if (settings->width > info.maxWidth)
+    settings->width = info.maxWidth;
+  if (settings->height > info.maxHeight)
+    settings->height = info.maxHeight;
+  if (info.imageHStepSize)
+    settings->width -= settings->width % info.imageHStepSize;
+  if (info.imageVStepSize)
+    settings->height -= settings->height % info.imageVStepSize;
+  settings->mode = FC2_MODE_0;
+  settings->offsetX = settings->offsetY = 0;
+
+  if (fc2ValidateFormat7Settings(context, settings, &valid, &packetinfo) ||
+      !valid)
+    return "settings not valid";
+  *packetsize = packetinfo.recommendedBytesPerPacket;
+  if (fc2SetFormat7ConfigurationPacket(context, settings, *packetsize))
+    return "settings not accepted";
+
+  return NULL;
+}
+
+static int run(idlpgr_device *device, fc2Format7ImageSettings *settings,
+	       const char *formatname, unsigned int bits, unsigned int nframes,
+	       unsigned int nwarmup, unsigned int nslots, int *first)
+{
+  fc2Context context = (fc2Context) idlpgr_DeviceContext(device);
+  fc2EmbeddedImageInfo embedded;
+  idlpgr_devicestats stats;
+  idlpgr_frameinfo info;
+  const char *reason;
+  unsigned int packetsize = 0, n, delivered = 0, k;
+  unsigned long long *t, start, elapsed;
+  unsigned char *dest = NULL;
+  size_t framesize, destsize = 0;
+  int error;
+
+  if ((reason = configure(context, settings, &packetsize))) {
+    report_skipped(settings->width, settings->height, formatname, reason,
+		   first);
+    return 0;
+  }
+  framesize = (size_t) settings->width * settings->height * bits / 8;
+
+  // the frame counter reveals frames lost before the grabber
+  if (!fc2GetEmbeddedImageInfo(context, &embedded)) {
+    embedded.frameCounter.onOff = embedded.frameCounter.available;
+    fc2SetEmbeddedImageInfo(context, &embedded);
+  }
+
+  memset(&info, 0, sizeof(idlpgr_frameinfo));
+  info.structsize = sizeof(idlpgr_frameinfo);
+  memset(&stats, 0, sizeof(idlpgr_devicestats));
+  stats.structsize = sizeof(idlpgr_devicestats);
+  t = (unsigned long long *) calloc(nframes ? nframes : 1,
+				    sizeof(unsigned long long));
+
+  if ((error = idlpgr_DeviceStart(device, nslots))) {
+    report_skipped(settings->width, settings->height, formatname,
+		   idlpgr_ErrorString(error), first);
+    free(t);
+    return 1;
+  }
+
+  for (n = 0; n < nwarmup + nframes; n++) {
+    if (n == nwarmup)
+      idlpgr_DeviceResetStats(device);
+    start = now();
+    error = idlpgr_DeviceRead(device, dest, destsize, &info, 0);
+    if (error == FC2_ERROR_BUFFER_TOO_SMALL) {
+      free(dest);
+      destsize = info.size;
+      if (!(dest = (unsigned char *) malloc(destsize))) {
+	error = FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+	break;
+      }
+      error = idlpgr_DeviceRead(device, dest, destsize, &info, 0);
+    }
+    if (error && error != IDLPGR_ERROR_INCOMPLETE)
+      break;
+    error = 0;
+    if (n >= nwarmup)
+      t[delivered++] = now() - start;
+  }
+
+  idlpgr_DeviceStats(device, &stats);
+  idlpgr_DeviceStop(device);
+  elapsed = (unsigned long long) (1e9 * stats.elapsed);
+  if (!elapsed)
+    elapsed = 1;
+
+  printf("%s    {\"width\": %u, \"height\": %u, \"format\": \"%s\",\n"
+	 "      \"packetsize\": %u, \"framebytes\": %zu, \"outputbytes\": %zu,\n"
+	 "      \"frames\": %u, \"elapsed_s\": %.6f, \"fps\": %.3f,\n"
+	 "      \"input_MBps\": %.3f, \"output_MBps\": %.3f,\n"
+	 "      \"dropped\": %llu, \"overflows\": %llu, \"gaps\": %llu,\n"
+	 "      \"timeouts\": %llu, \"inconsistent\": %llu, "
+	 "\"incomplete\": %llu, \"errors\": %llu,\n"
+	 "      \"error\": %d,\n"
+	 "      \"stages\": {\n",
+	 *first ? "" : ",\n",
+	 settings->width, settings->height, formatname,
+	 packetsize, framesize, destsize,
+	 delivered, 1e-9 * elapsed, 1e9 * delivered / elapsed,
+	 1e3 * delivered * framesize / elapsed,
+	 1e3 * delivered * destsize / elapsed,
+	 stats.overflows + stats.gaps, stats.overflows, stats.gaps,
+	 stats.timeouts, stats.inconsistent, stats.incomplete, stats.errors,
+	 error);
+  for (k = 0; k < NSTAGES; k++)
+    report_timing(stages[k].name, &stats.stage[stages[k].stage]);
+  report_samples("read", t, delivered);
+  printf("      }\n    }");
+  *first = 0;
+
+  fprintf(stderr, "%5ux%-5u %-7s %9.1f fps %9.1f MB/s %6llu dropped\n",
+	  settings->width, settings->height, formatname,
+	  1e9 * delivered / elapsed, 1e3 * delivered * framesize / elapsed,
+	  stats.overflows + stats.gaps);
+
+  free(dest);
+  free(t);
+
+  return error != 0;
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-n nframes] [-w nwarmup] [-b nslots] "
+	  "[-c camera] [-s WxH[,WxH...]] [-f FORMAT[,FORMAT...]]\n", name);
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *sizes = "640x480,1280x1024,2048x2048";
+  const char *formatlist = "MONO8,MONO12,MONO16";
+  unsigned int nframes = 200, nwarmup = 10, nslots = NBUFFERS, index = 0;
+  unsigned int width, height, n;
+  char *list, *size, *names, *name, *s1, *s2;
+  idlpgr_device *device;
+  fc2CameraInfo info;
+  idlpgr_kernels kernels;
+  fc2Format7ImageSettings settings;
+  int opt, first = 1, status = 0;
+
+  while ((opt = getopt(argc, argv, "n:w:b:c:s:f:")) != -1) {
+    switch (opt) {
+    case 'n': nframes = (unsigned int) atoi(optarg); break;
+    case 'w': nwarmup = (unsigned int) atoi(optarg); break;
+    case 'b': nslots = (unsigned int) atoi(optarg); break;
+    case 'c': index = (unsigned int) atoi(optarg); break;
+    case 's': sizes = optarg; break;
+    case 'f': formatlist = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (nslots < 1)
+    usage(argv[0]);
+
+  if (idlpgr_DeviceOpen(index, &device)) {
+    fprintf(stderr, "%s: could not connect to camera %u\n", argv[0], index);
+    return 1;
+  }
+  if (fc2GetCameraInfo((fc2Context) idlpgr_DeviceContext(device), &info))
+    memset(&info, 0, sizeof(fc2CameraInfo));
+  memset(&kernels, 0, sizeof(idlpgr_kernels));
+  kernels.structsize = sizeof(idlpgr_kernels);
+  idlpgr_Kernels(&kernels);
+
+  printf("{\n  \"camera\": {\"model\": \"%s\", \"serial\": %u, "
+	 "\"interface\": %d},\n"
+	 "  \"api\": %d, \"nframes\": %u, \"nslots\": %u,\n"
+	 "  \"kernels\": {\"unpack\": \"%s\", \"demosaic\": \"%s\", "
+	 "\"background\": \"%s\", \"accumulate\": \"%s\"},\n"
+	 "  \"runs\": [\n",
+	 info.modelName, info.serialNumber, (int) info.interfaceType,
+	 idlpgr_APIVersion(), nframes, nslots,
+	 kernels.unpack, kernels.demosaic, kernels.background,
+	 kernels.accumulate);
+
+  list = strdup(sizes);
+  for (size = strtok_r(list, ",", &s1); size; size = strtok_r(NULL, ",", &s1)) {
+    if (sscanf(size, "%ux%u", &width, &height) != 2) {
+      fprintf(stderr, "%s: bad size %s\n", argv[0], size);
+      continue;
+    }
+    names = strdup(formatlist);
+    for (name = strtok_r(names, ",", &s2); name;
+	 name = strtok_r(NULL, ",", &s2)) {
+      for (n = 0; n < NFORMATS && strcasecmp(name, formats[n].name); n++)
+	;
+      if (n == NFORMATS) {
+	fprintf(stderr, "%s: unknown format %s\n", argv[0], name);
+	continue;
+      }
+      memset(&settings, 0, sizeof(fc2Format7ImageSettings));
+      settings.width = width;
+      settings.height = height;
+      settings.pixelFormat = formats[n].format;
+      status |= run(device, &settings, formats[n].name, formats[n].bits,
+		    nframes, nwarmup, nslots, &first);
+      fflush(stdout);
+    }
+    free(names);
+  }
+  free(list);
+  printf("\n  ]\n}\n");
+
+  idlpgr_DeviceClose(device);
+
+  return status;
+}
@@ -0,0 +1,113 @@
+//
+// benchunpack.c
+//
+// Micro-benchmark for unpacking 12-bit packed frames.
+// Compares the scalar and vectorized idlpgr kernels with
+// fc2ConvertImageTo on a synthetic 2048x2048 MONO12 frame.
+//
+// Usage: benchunpack [nframes]
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "C/FlyCapture2_C.h"
+#include "idlpgr_simd.h"
+
+#define ROWS 2048
+#define COLS 2048
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void report(const char *name, double elapsed, int nframes)
+{
+  printf("%-20s %8.3f ms/frame %8.1f Mpixel/s\n", name,
+	 1e3 * elapsed / nframes,
+	 1e-6 * (double) ROWS * COLS * nframes / elapsed);
+}
+
+static int bench(const char *name, idlpgr_unpack12_fn unpack,
+		 const unsigned char *src, unsigned short *dest,
+		 const unsigned short *reference, int nframes)
+{
+  double start;
+  int n;
+
+  unpack(src, dest, (size_t) ROWS * COLS);
+  if (reference && memcmp(dest, reference, sizeof(unsigned short) * ROWS * COLS)) {
+    printf("%-20s result differs from scalar kernel\n", name);
+    return 1;
+  }
+  start = now();
+  for (n = 0; n < nframes; n++)
+    unpack(src, dest, (size_t) ROWS * COLS);
+  report(name, now() - start, nframes);
+
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int nframes = (argc > 1) ? atoi(argv[1]) : 100;
+  size_t srcbytes = (size_t) ROWS * COLS * 3 / 2;
+  unsigned char *src;
+  unsigned short *dest, *reference;
+  fc2Image in, out;
+  fc2Error error;
+  double start;
+  size_t i;
+  int n, status = 0;
+
+  src = (unsigned char *) malloc(srcbytes);
+  dest = (unsigned short *) malloc(sizeof(unsigned short) * ROWS * COLS);
+  reference = (unsigned short *) malloc(sizeof(unsigned short) * ROWS * COLS);
+  if (!src || !dest || !reference)
+    return 1;
+  for (i = 0; i < srcbytes; i++)
+    src[i] = (unsigned char) rand();
+
+  printf("host kernels: %s\n", idlpgr_SelectKernels());
+  status |= bench("scalar", idlpgr_Unpack12Scalar, src, reference, NULL, nframes);
+#ifdef IDLPGR_X86
+  if (__builtin_cpu_supports("ssse3"))
+    status |= bench("ssse3", idlpgr_Unpack12SSSE3, src, dest, reference, nframes);
+  if (__builtin_cpu_supports("avx2"))
+    status |= bench("avx2", idlpgr_Unpack12AVX2, src, dest, reference, nframes);
+#endif
+
+  fc2CreateImage(&in);
+  fc2CreateImage(&out);
+  fc2SetImageDimensions(&in, ROWS, COLS, COLS * 3 / 2,
+			FC2_PIXEL_FORMAT_MONO12, FC2_BT_NONE);
+  fc2SetImageData(&in, src, (unsigned int) srcbytes);
+  error = fc2ConvertImageTo(FC2_PIXEL_FORMAT_MONO16, &in, &out);
+  if (error) {
+    printf("%-20s failed: %s\n", "fc2ConvertImageTo",
+	   fc2ErrorToDescription(error));
+  } else {
+    start = now();
+    for (n = 0; n < nframes; n++)
+      fc2ConvertImageTo(FC2_PIXEL_FORMAT_MONO16, &in, &out);
+    report("fc2ConvertImageTo", now() - start, nframes);
+  }
+  fc2DestroyImage(&out);
+  fc2DestroyImage(&in);
+
+  free(reference);
+  free(dest);
+  free(src);
+
+  return status;
+}
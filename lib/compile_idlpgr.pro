@@ -8,16 +8,28 @@
 ; Modification History:
 ; 07/19/2013 Written by David G. Grier, New York University
 ; 04/14/2016 DGG Include local copies of headers.
+; 10/16/2026 DGG Link pthreads for background grabber.
+; 10/16/2026 DGG Compile vectorized pixel kernels.
+; 10/16/2026 DGG Compile demosaicing kernels.
+; 10/16/2026 DGG Compile streaming recorder.
+; 10/16/2026 DGG Compile metadata decoder.
+; 10/16/2026 DGG Compile acquisition machinery.
+; 10/16/2026 DGG Compile acquisition core.
+; 10/16/2026 DGG Compile background estimator.
+; 10/16/2026 DGG Compile frame accumulation.
+; 10/16/2026 DGG Compile shared worker threads.
 ;
 ; Copyright (c) 2013-2016 David G. Grier
 ;
 project_directory = './'
 compile_directory = './build'
-infiles = 'idlpgr'
+infiles = ['idlpgr', 'idlpgr_simd', 'idlpgr_demosaic', 'idlpgr_record', $
+           'idlpgr_metadata', 'idlpgr_capture', 'idlpgr_core', $
+           'idlpgr_background', 'idlpgr_accumulate', 'idlpgr_pool']
 outfile = 'idlpgr'
 
 extra_cflags = '-I"../../flycapture2/include"'
-extra_lflags = '-L"../../flycapture2/lib" -lflycapture-c -lflycapture'
+extra_lflags = '-L"../../flycapture2/lib" -lflycapture-c -lflycapture -lpthread'
 
 ;;;;;
 ;
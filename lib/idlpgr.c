@@ -13,6 +13,33 @@
 // 01/26/2014 DGG Implemented write_register, read_property & write_property
 // 03/02/2015 DGG Better integration of FlyCap2 API with IDL.
 // 05/26/2015 DGG Separate image retrieval from IDL storage.
+// 10/16/2026 DGG Background grabber thread with lock-free frame ring.
+// 10/16/2026 DGG Zero-copy acquisition into user buffers.
+// 10/16/2026 DGG Batched multi-frame read.
+// 10/16/2026 DGG Callback-driven capture of the newest frame.
+// 10/16/2026 DGG Format-aware image transfer.
+// 10/16/2026 DGG Vectorized 12-bit unpacking.
+// 10/16/2026 DGG Native Bayer demosaicing.
+// 10/16/2026 DGG Cached property information and batched property access.
+// 10/16/2026 DGG Synchronized capture from multiple cameras.
+// 10/16/2026 DGG Streaming recorder with asynchronous writer.
+// 10/16/2026 DGG Zero-copy random access to recordings and raw dumps.
+// 10/16/2026 DGG Embedded image information and per-frame metadata.
+// 10/16/2026 DGG Acquisition statistics and latency histograms.
+// 10/16/2026 DGG Capture configuration and retrieval timeouts.
+// 10/16/2026 DGG Format7 region of interest, binning and pixel format.
+// 10/16/2026 DGG Automatic packet-size tuning.
+// 10/16/2026 DGG Pooled image handles and aligned frame buffers.
+// 10/16/2026 DGG Trigger mode and timed software triggers.
+// 10/16/2026 DGG Hardware triggers, strobes and latency measurement.
+// 10/16/2026 DGG Retrieval status without errors, counted by class.
+// 10/16/2026 DGG Acquisition machinery moved to idlpgr_capture.c.
+// 10/16/2026 DGG Camera state and engine moved to idlpgr_core.c.
+// 10/16/2026 DGG Running background estimates and normalization.
+// 10/16/2026 DGG Native accumulation of frames.
+// 10/16/2026 DGG Background estimates updated by the retrieving thread.
+// 10/16/2026 DGG Finer latency histograms.
+// 10/16/2026 DGG Recordings index the camera's frame counter.
 //
 // Copyright (c) 2013-2015 David G. Grier
 //
@@ -20,6 +47,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 // IDL support
 #include "idl_export.h"
@@ -27,6 +55,16 @@
 // Point Grey support
 #include "C/FlyCapture2_C.h"
 
+// Acquisition and pixel kernels
+#include "idlpgr_core.h"
+#include "idlpgr_capture.h"
+#include "idlpgr_simd.h"
+#include "idlpgr_demosaic.h"
+#include "idlpgr_record.h"
+#include "idlpgr_metadata.h"
+#include "idlpgr_background.h"
+#include "idlpgr_accumulate.h"
+
 // Error messages
 static IDL_MSG_DEF msg_arr[] =
   {
@@ -40,6 +78,156 @@ static IDL_MSG_DEF msg_arr[] =
 
 static IDL_MSG_BLOCK msgs;
 
+//
+// idlpgr_ImageType
+//
+// IDL type code for image data with the specified layout.
+//
+static int idlpgr_ImageType(const idlpgr_layout *layout)
+{
+  if (layout->depth == 2)
+    return layout->issigned ? IDL_TYP_INT : IDL_TYP_UINT;
+  return IDL_TYP_BYTE;
+}
+
+//
+// idlpgr_MakeImageArray
+//
+// Create a temporary IDL array for image data with the specified
+// layout.  If nframes is positive, the array holds that many
+// frames along an additional trailing dimension.
+//
+static UCHAR *idlpgr_MakeImageArray(const idlpgr_layout *layout,
+				    IDL_MEMINT nframes,
+				    IDL_VPTR *var)
+{
+  IDL_MEMINT dim[IDL_MAX_ARRAY_DIM];
+  int n, ndims = layout->ndims;
+
+  for (n = 0; n < ndims; n++)
+    dim[n] = (IDL_MEMINT) layout->dim[n];
+  if (nframes > 0)
+    dim[ndims++] = nframes;
+
+  return (UCHAR *) IDL_MakeTempArray(idlpgr_ImageType(layout), ndims, dim,
+				     IDL_ARR_INI_NOP, var);
+}
+
+//
+// idlpgr_NormalizedImage
+//
+// Create a temporary float array holding the frame in image
+// normalized by the background estimates of camera:
+// 1: by the running mean, 2: by the running median.
+//
+static IDL_VPTR idlpgr_NormalizedImage(idlpgr_camera *camera,
+				       const fc2Image *image,
+				       int normalize)
+{
+  idlpgr_layout layout;
+  IDL_MEMINT dim[2];
+  IDL_VPTR idl_image;
+  float *pd;
+  fc2Error error;
+
+  if (!camera)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Image has not received a frame from a camera.");
+  idlpgr_ImageLayout(image, &layout);
+  if (layout.ndims != 2)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Only monochrome and raw images can be normalized.");
+
+  dim[0] = (IDL_MEMINT) layout.dim[0];
+  dim[1] = (IDL_MEMINT) layout.dim[1];
+  pd = (float *) IDL_MakeTempArray(IDL_TYP_FLOAT, 2, dim,
+				   IDL_ARR_INI_NOP, &idl_image);
+  error = idlpgr_FrameNormalize(camera, image, normalize == 2, pd);
+  if (error) {
+    IDL_Deltmp(idl_image);
+    if (error == FC2_ERROR_NOT_INTITIALIZED)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Background has not been estimated.");
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Image does not match the background or dark frame.");
+  }
+
+  return idl_image;
+}
+
+//
+// Frame metadata
+//
+// Items of embedded image information that are enabled on the
+// camera occupy the first pixels of every frame.  The set of
+// enabled items is read from the camera the first time a frame
+// is decoded, and is updated by idlpgr_SetEmbeddedImageInfo.
+// Each camera keeps a clock that unwraps its cycle time into a
+// monotonic time stamp across the frames that are decoded.
+//
+static IDL_STRUCT_TAG_DEF idlpgr_metadata_tags[] = {
+  { "TIMESTAMP",     0, (void *) IDL_TYP_ULONG },
+  { "GAIN",          0, (void *) IDL_TYP_ULONG },
+  { "SHUTTER",       0, (void *) IDL_TYP_ULONG },
+  { "BRIGHTNESS",    0, (void *) IDL_TYP_ULONG },
+  { "EXPOSURE",      0, (void *) IDL_TYP_ULONG },
+  { "WHITEBALANCE",  0, (void *) IDL_TYP_ULONG },
+  { "FRAMECOUNTER",  0, (void *) IDL_TYP_ULONG },
+  { "STROBEPATTERN", 0, (void *) IDL_TYP_ULONG },
+  { "GPIOPINSTATE",  0, (void *) IDL_TYP_ULONG },
+  { "ROIPOSITION",   0, (void *) IDL_TYP_ULONG },
+  { "SECONDS",       0, (void *) IDL_TYP_LONG64 },
+  { "MICROSECONDS",  0, (void *) IDL_TYP_ULONG },
+  { "CYCLESECONDS",  0, (void *) IDL_TYP_ULONG },
+  { "CYCLECOUNT",    0, (void *) IDL_TYP_ULONG },
+  { "CYCLEOFFSET",   0, (void *) IDL_TYP_ULONG },
+  { "TICKS",         0, (void *) IDL_TYP_ULONG64 },
+  { "TIME",          0, (void *) IDL_TYP_DOUBLE },
+  { 0 }
+};
+
+//
+// idlpgr_MakeMetadata
+//
+// Create an array of n idlpgrMetadata structures, returning
+// a pointer to the first element.
+//
+static idlpgr_metadata *idlpgr_MakeMetadata(IDL_MEMINT n, IDL_VPTR *var)
+{
+  IDL_StructDefPtr sdef;
+
+  sdef = IDL_MakeStruct("idlpgrMetadata", idlpgr_metadata_tags);
+  return (idlpgr_metadata *) IDL_MakeTempStruct(sdef, 1, &n, var, TRUE);
+}
+
+//
+// idlpgr_Camera
+//
+// State of context, created if there is none
+//
+static idlpgr_camera *idlpgr_Camera(fc2Context context)
+{
+  idlpgr_camera *camera;
+
+  if (!(camera = idlpgr_CameraGet(context)))
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not allocate camera state");
+
+  return camera;
+}
+
+static idlpgr_group *idlpgr_FindGroup(IDL_VPTR arg)
+{
+  idlpgr_group *group;
+
+  group = idlpgr_GroupFind((void *) IDL_ULong64Scalar(arg));
+  if (!group)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Argument is not a synchronized capture group.");
+
+  return group;
+}
+
 //
 // idlpgr_CreateContext
 //
@@ -67,6 +255,8 @@ void IDL_CDECL idlpgr_DestroyContext(int argc, IDL_VPTR argv[])
 
   context = (fc2Context) IDL_ULong64Scalar(argv[0]);
 
+  idlpgr_CameraForget(context);
+
   error = fc2DestroyContext(context);
   if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
@@ -153,6 +343,12 @@ void IDL_CDECL idlpgr_Connect(int argc, IDL_VPTR argv[])
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
 			 "Could not connect camera to context",
 			 error);
+
+  error = idlpgr_CameraConnect(context);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not read camera information",
+			 error);
 }
 
 //
@@ -217,6 +413,7 @@ void IDL_CDECL idlpgr_StartCapture(int argc, IDL_VPTR argv[])
 {
   fc2Error error;
   fc2Context context;
+  idlpgr_camera *camera;
   
   context = (fc2Context) IDL_ULong64Scalar(argv[0]);
   
@@ -225,40 +422,185 @@ void IDL_CDECL idlpgr_StartCapture(int argc, IDL_VPTR argv[])
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
 			 "Could not start capture",
 			 error);
+
+  // frame counters are compared only within one capture
+  if ((camera = idlpgr_FindCamera(context)))
+    camera->stats.hascounter = 0;
+}
+
+//
+// idlpgr_StartCaptureCallback
+//
+// Start capture with frames delivered to a callback that keeps
+// only the most recent frame.  Use idlpgr_LatestFrame to read it.
+//
+void IDL_CDECL idlpgr_StartCaptureCallback(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  idlpgr_camera *camera;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  camera = idlpgr_Camera(context);
+  if (camera->latest)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Callback capture is already running.");
+  if (!(camera->latest = idlpgr_LatestCreate(&camera->stats,
+					     camera->framesize,
+					     idlpgr_CameraFrame, camera)))
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not allocate frame buffers");
+
+  error = fc2StartCaptureCallback(context, idlpgr_LatestCallback,
+				  camera->latest);
+  if (error) {
+    idlpgr_LatestFree(camera->latest);
+    camera->latest = NULL;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not start capture",
+			 error);
+  }
 }
 
 //
 // idlpgr_StopCapture
 //
+// Stop capture, and with it the grabber or callback capture.
+//
 void IDL_CDECL idlpgr_StopCapture(int argc, IDL_VPTR argv[])
 {
   fc2Error error;
   fc2Context context;
+  idlpgr_camera *camera;
   
   context = (fc2Context) IDL_ULong64Scalar(argv[0]);
   
   error = fc2StopCapture(context);
+
+  // the grabber returns once capture has stopped
+  camera = idlpgr_FindCamera(context);
+  if (camera && camera->grabber) {
+    idlpgr_GrabberStop(camera->grabber);
+    camera->grabber = NULL;
+  }
+  if (camera && camera->latest) {
+    idlpgr_LatestFree(camera->latest);
+    camera->latest = NULL;
+  }
+
   if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
 			 "Could not stop capture",
 			 error);
 }
 
+//
+// idlpgr_LatestFrame
+//
+// Return the most recent frame captured by the callback without
+// waiting.  Returns 0 if no frame has arrived yet.
+// argv[0]: context
+// METADATA: optional output: idlpgrMetadata structure
+//     describing the frame
+// SEQUENCE: optional output: sequence number of the frame,
+//     starting from 1.  Repeated values indicate that no
+//     new frame has arrived since the last call.
+// NORMALIZE: 1: return the frame normalized by the running mean
+//     background as FLOAT, 2: by the running median.
+//     Requires idlpgr_StartBackground.
+//
+IDL_VPTR IDL_CDECL idlpgr_LatestFrame(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Context context;
+  idlpgr_camera *camera;
+  idlpgr_frame *frame;
+  idlpgr_layout layout;
+  IDL_VPTR idl_image, idl_metadata;
+  UCHAR *pd;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR metadata;
+    IDL_LONG normalize;
+    IDL_VPTR sequence;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "METADATA", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(metadata) },
+    { "NORMALIZE", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(normalize) },
+    { "SEQUENCE", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(sequence) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  camera = idlpgr_FindCamera(context);
+  if (!camera || !camera->latest) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Callback capture is not running.");
+  }
+
+  frame = idlpgr_LatestPop(camera->latest);
+  if (kw.sequence)
+    IDL_VarCopy(IDL_GettmpULong64(frame ? frame->sequence : 0),
+		kw.sequence);
+  if (frame && kw.metadata) {
+    idlpgr_FrameMetadata(camera, &frame->image, frame->timestamp,
+			 idlpgr_MakeMetadata(1, &idl_metadata));
+    IDL_VarCopy(idl_metadata, kw.metadata);
+  }
+  IDL_KW_FREE;
+  if (!frame)
+    return IDL_GettmpLong(0);
+
+  if (frame->sequence != camera->latest->consumed) {
+    __atomic_add_fetch(&camera->stats.delivered, 1, __ATOMIC_RELAXED);
+    if (frame->sequence > camera->latest->consumed + 1)
+      __atomic_add_fetch(&camera->stats.skipped,
+			 frame->sequence - camera->latest->consumed - 1,
+			 __ATOMIC_RELAXED);
+    camera->latest->consumed = frame->sequence;
+    if (camera->measurelatency)
+      idlpgr_FrameLatency(camera, &frame->image);
+  }
+
+  if (kw.normalize)
+    return idlpgr_NormalizedImage(camera, &frame->image, (int) kw.normalize);
+
+  idlpgr_ImageLayout(&frame->image, &layout);
+  pd = idlpgr_MakeImageArray(&layout, 0, &idl_image);
+  idlpgr_TimedTransfer(&camera->stats, &frame->image, &layout, pd);
+
+  return idl_image;
+}
+
 //
 // idlpgr_CreateImage
 //
+// argv[0]: context (optional).  If given, the image holds an
+//     aligned buffer sized for frames from the camera.
+//
 IDL_VPTR IDL_CDECL idlpgr_CreateImage(int argc, IDL_VPTR argv[])
 {
   fc2Error error;
+  fc2Context context;
   fc2Image *image;
-  IDL_MEMINT dim;
 
-  dim = (IDL_MEMINT) sizeof(fc2Image);
-  image = (fc2Image *) IDL_MemAlloc(dim, NULL, 0);
-  error = fc2CreateImage(image);
+  context = (argc == 1) ? (fc2Context) IDL_ULong64Scalar(argv[0]) : NULL;
+
+  error = idlpgr_HandleCreate(context, &image);
   if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "Could create image",
+			 "Could not create image",
 			 error);
 
   return IDL_GettmpULong64((IDL_ULONG64) image);
@@ -267,291 +609,3626 @@ IDL_VPTR IDL_CDECL idlpgr_CreateImage(int argc, IDL_VPTR argv[])
 //
 // idlpgr_DestroyImage
 //
+// Return the image to the pool
+//
 void IDL_CDECL idlpgr_DestroyImage(int argc, IDL_VPTR argv[])
 {
-  fc2Error error;
-  fc2Image *image;
-
-  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
-  error = fc2DestroyImage(image);
-  if (error)
-    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "Could not destroy image",
-			 error);
-  IDL_MemFree(image, NULL, 0);
+  if (idlpgr_HandleDestroy((fc2Image *) IDL_ULong64Scalar(argv[0])))
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not destroy image: not a valid image.");
 }
 
 //
 // idlpgr_RetrieveBuffer
 //
 // Transfer image to Point Grey image buffer.
+// If a grabber is running on the context, the next frame
+// is taken from its ring.  Setting NEWEST skips to the
+// most recent frame in the ring.
+// ERROR: optional output: status of the retrieval.
+//     0: complete frame.
+//     -2: frame was delivered with missing data.
+//     Otherwise the fc2Error code of the failure, for example
+//     FC2_ERROR_TIMEOUT or FC2_ERROR_IMAGE_CONSISTENCY_ERROR.
+//     If present, failures return normally instead of raising
+//     an error, and the contents of image should not be used.
+// METADATA: optional output: idlpgrMetadata structure
+//     describing the frame
+// TIMEDOUT: optional output: set to 1 if no frame arrived within
+//     the grab timeout, and to 0 otherwise.  If present, a timeout
+//     returns normally instead of raising an error, and image is
+//     left unchanged.
 //
-void IDL_CDECL idlpgr_RetrieveBuffer(int argc, IDL_VPTR argv[])
+void IDL_CDECL idlpgr_RetrieveBuffer(int argc, IDL_VPTR argv[], char *argk)
 {
   fc2Error error;
   fc2Context context;
   fc2Image *image;
+  IDL_VPTR idl_metadata;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR error;
+    IDL_VPTR metadata;
+    IDL_LONG newest;
+    IDL_VPTR timedout;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "ERROR", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(error) },
+    { "METADATA", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(metadata) },
+    { "NEWEST", IDL_TYP_LONG, 1, IDL_KW_ZERO, 0, IDL_KW_OFFSETOF(newest) },
+    { "TIMEDOUT", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(timedout) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
 
   context = (fc2Context) IDL_ULong64Scalar(argv[0]);
   image = (fc2Image *) IDL_ULong64Scalar(argv[1]);
 
-  error = fc2RetrieveBuffer(context, image);
-  if (error) 
+  error = idlpgr_Retrieve(context, image, kw.newest);
+  if (kw.timedout) {
+    IDL_VarCopy(IDL_GettmpLong(error == FC2_ERROR_TIMEOUT), kw.timedout);
+    if (error == FC2_ERROR_TIMEOUT) {
+      IDL_KW_FREE;
+      return;
+    }
+  }
+  if (!error && kw.metadata) {
+    idlpgr_FrameMetadata(idlpgr_Camera(context), image,
+			 fc2GetImageTimeStamp(image),
+			 idlpgr_MakeMetadata(1, &idl_metadata));
+    IDL_VarCopy(idl_metadata, kw.metadata);
+  }
+  if (kw.error) {
+    IDL_VarCopy(IDL_GettmpLong(idlpgr_FrameStatus(error, image)), kw.error);
+    error = FC2_ERROR_OK;
+  }
+  IDL_KW_FREE;
+  if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
 			 "Could not retrieve image buffer",
 			 error);
 }
 
 //
-// idlpgr_AllocateImage
+// idlpgr_StartGrabber
 //
-// Allocate IDL buffer for image data and transfer image.
-// argv[0]: image
+// Start a background thread that retrieves frames from the camera
+// into a ring of nbuffers images.  Subsequent calls to
+// idlpgr_RetrieveBuffer take frames from the ring.
+// argv[0]: context
+// argv[1]: nbuffers (optional)
 //
-IDL_VPTR IDL_CDECL idlpgr_AllocateImage(int argc, IDL_VPTR argv[])
+void IDL_CDECL idlpgr_StartGrabber(int argc, IDL_VPTR argv[])
 {
   fc2Error error;
-  fc2Image *image;
-  IDL_MEMINT ndims, dim[IDL_MAX_ARRAY_DIM];
-  IDL_VPTR idl_image;
-  UCHAR *pd;
+  fc2Context context;
+  idlpgr_camera *camera;
+  IDL_LONG nbuffers;
 
-  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
-  
-  if (image->cols == image->stride) {
-    ndims = 2;
-    dim[0] = image->cols;
-    dim[1] = image->rows;
-  } else {
-    ndims = 3;
-    dim[0] = 3;
-    dim[1] = image->cols;
-    dim[2] = image->rows;
-  }
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  nbuffers = (argc == 2) ? IDL_LongScalar(argv[1]) : IDLPGR_NBUFFERS;
+  if (nbuffers < 2)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Grabber requires at least two buffers.");
 
-  pd = (UCHAR *) IDL_MakeTempArray(IDL_TYP_BYTE, ndims, dim,
-				   IDL_ARR_INI_NOP, &idl_image);
-  memcpy(pd, image->pData, image->rows*image->stride);
+  camera = idlpgr_Camera(context);
+  if (camera->grabber)
+    return;
 
-  return idl_image;
+  error = idlpgr_GrabberStart(&camera->grabber, context,
+			      (unsigned int) nbuffers,
+			      idlpgr_GrabTimeout(camera), &camera->stats,
+			      camera->framesize, idlpgr_CameraFrame, camera);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not start grabber",
+			 error);
 }
 
 //
-// idlpgr_GetImage
+// idlpgr_StopGrabber
 //
-// Transfer image data to preallocated IDL buffer
+// Stop the background grabber and release its buffers.
+// Frames remaining in the ring are discarded.  Capture is
+// stopped so that a grabber waiting for a trigger returns,
+// and then restarted for idlpgr_RetrieveBuffer.
 //
-void IDL_CDECL idlpgr_GetImage(int argc, IDL_VPTR argv[])
+void IDL_CDECL idlpgr_StopGrabber(int argc, IDL_VPTR argv[])
 {
   fc2Error error;
-  fc2Image *image;
-  IDL_MEMINT ndims, dim[IDL_MAX_ARRAY_DIM];
-  IDL_VPTR idl_image;
-  UCHAR *pd;
+  fc2Context context;
+  idlpgr_camera *camera;
 
-  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
-  
-  if (image->cols == image->stride) {
-    ndims = 2;
-    dim[0] = image->cols;
-    dim[1] = image->rows;
-  } else {
-    ndims = 3;
-    dim[0] = 3;
-    dim[1] = image->cols;
-    dim[2] = image->rows;
-  }
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
 
-  idl_image = argv[1];
-  IDL_ENSURE_ARRAY(idl_image);
-  if (idl_image->value.arr->arr_len == image->stride*image->rows){
-    pd = idl_image->value.arr->data;
-  } else {
+  camera = idlpgr_FindCamera(context);
+  if (!camera || !camera->grabber)
+    return;
+
+  fc2StopCapture(context);
+  idlpgr_GrabberStop(camera->grabber);
+  camera->grabber = NULL;
+
+  error = fc2StartCapture(context);
+  if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "IDL buffer is not the same size as the image.",
+			 "Could not restart capture",
 			 error);
-  }
-  memcpy(pd, image->pData, image->rows*image->stride);
+  camera->stats.hascounter = 0;
 }
 
 //
-// idlpgr_ReadRegister
+// idlpgr_Stats
 //
-// Read contents of specified register
+// Acquisition statistics for a context since it was created or
+// since the statistics were last reset.
+// argv[0]: context
+// RESET: if set, reset the statistics after reading them.
 //
-IDL_VPTR IDL_CDECL idlpgr_ReadRegister(int argc, IDL_VPTR argv[])
+// DROPPED counts frames lost before reaching IDL: frames discarded
+// because the grabber's ring was full (OVERFLOWS) and frames missing
+// from the embedded frame counter (GAPS).  SKIPPED counts frames
+// passed over by NEWEST or by callback capture.  Failed retrievals
+// are counted by class: TIMEOUTS exceeded the grab timeout,
+// INCONSISTENT failed the driver's image consistency check, and
+// ERRORS failed for other reasons.  INCOMPLETE counts frames that
+// were delivered with missing data.  Each stage is an
+// idlpgrHistogram whose TOTAL, MAX and MIN are in nanoseconds.
+// BINS[k] counts intervals of k ns for k < 16.  Above that, each
+// octave from 2^e to 2^(e+1) ns is divided into 16 bins of equal
+// width.  MIN is the largest ULONG64 until COUNT is nonzero.
+//
+IDL_VPTR IDL_CDECL idlpgr_Stats(int argc, IDL_VPTR argv[], char *argk)
 {
-  fc2Error error;
   fc2Context context;
-  unsigned int address, value;
+  idlpgr_camera *camera;
+  idlpgr_stats *stats;
+  static IDL_MEMINT one = 1;
+  static IDL_MEMINT nbins[] = {1, IDLPGR_STATS_NBINS};
+  IDL_VPTR idl_stats;
+  IDL_StructDefPtr sdef, sdef_histogram;
+  IDL_ULONG64 *pd, *ph;
+  unsigned long long queued = 0, nbuffers = 0;
+  size_t n, k;
+
+  static IDL_STRUCT_TAG_DEF histogram_tags[] = {
+    { "COUNT", 0,     (void *) IDL_TYP_ULONG64 },
+    { "TOTAL", 0,     (void *) IDL_TYP_ULONG64 },
+    { "MAX",   0,     (void *) IDL_TYP_ULONG64 },
+    { "MIN",   0,     (void *) IDL_TYP_ULONG64 },
+    { "BINS",  nbins, (void *) IDL_TYP_ULONG64 },
+    { 0 }
+  };
+  static IDL_STRUCT_TAG_DEF tags[] = {
+    { "RETRIEVED", 0, (void *) IDL_TYP_ULONG64 },
+    { "DELIVERED", 0, (void *) IDL_TYP_ULONG64 },
+    { "DROPPED",   0, (void *) IDL_TYP_ULONG64 },
+    { "OVERFLOWS", 0, (void *) IDL_TYP_ULONG64 },
+    { "GAPS",      0, (void *) IDL_TYP_ULONG64 },
+    { "SKIPPED",   0, (void *) IDL_TYP_ULONG64 },
+    { "ERRORS",    0, (void *) IDL_TYP_ULONG64 },
+    { "TIMEOUTS",  0, (void *) IDL_TYP_ULONG64 },
+    { "INCONSISTENT", 0, (void *) IDL_TYP_ULONG64 },
+    { "INCOMPLETE", 0, (void *) IDL_TYP_ULONG64 },
+    { "QUEUED",    0, (void *) IDL_TYP_ULONG64 },
+    { "MAXQUEUED", 0, (void *) IDL_TYP_ULONG64 },
+    { "NBUFFERS",  0, (void *) IDL_TYP_ULONG64 },
+    { "ELAPSED",   0, (void *) IDL_TYP_DOUBLE },
+    { "RETRIEVE",  0, NULL },
+    { "WAIT",      0, NULL },
+    { "CONVERT",   0, NULL },
+    { "COPY",      0, NULL },
+    { "LATENCY",   0, NULL },
+    { "BACKGROUND", 0, NULL },
+    { 0 }
+  };
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG reset;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "RESET", IDL_TYP_LONG, 1, IDL_KW_ZERO, 0, IDL_KW_OFFSETOF(reset) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
 
   context = (fc2Context) IDL_ULong64Scalar(argv[0]);
-  address = (unsigned int) IDL_ULongScalar(argv[1]);
-  
-  error = fc2ReadRegister(context, address, &value);
-  if (error)
-    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "Could not read from specified register",
-			 error);
-  
-  return IDL_GettmpULong((IDL_ULONG) value);
+  camera = idlpgr_Camera(context);
+  stats = &camera->stats;
+
+  if (camera->grabber) {
+    nbuffers = camera->grabber->nslots;
+    queued = __atomic_load_n(&camera->grabber->head, __ATOMIC_ACQUIRE) -
+      camera->grabber->tail;
+  }
+
+  sdef_histogram = IDL_MakeStruct("idlpgrHistogram", histogram_tags);
+  for (k = 14; k < 14 + IDLPGR_NSTAGES; k++)
+    tags[k].type = (void *) sdef_histogram;
+  sdef = IDL_MakeStruct("idlpgrStats", tags);
+  pd = (IDL_ULONG64 *) IDL_MakeTempStruct(sdef, 1, &one, &idl_stats, TRUE);
+
+  pd[0] = __atomic_load_n(&stats->retrieved, __ATOMIC_RELAXED);
+  pd[1] = __atomic_load_n(&stats->delivered, __ATOMIC_RELAXED);
+  pd[3] = __atomic_load_n(&stats->overflows, __ATOMIC_RELAXED);
+  pd[4] = __atomic_load_n(&stats->gaps, __ATOMIC_RELAXED);
+  pd[2] = pd[3] + pd[4];
+  pd[5] = __atomic_load_n(&stats->skipped, __ATOMIC_RELAXED);
+  pd[6] = __atomic_load_n(&stats->errors, __ATOMIC_RELAXED);
+  pd[7] = __atomic_load_n(&stats->timeouts, __ATOMIC_RELAXED);
+  pd[8] = __atomic_load_n(&stats->inconsistent, __ATOMIC_RELAXED);
+  pd[9] = __atomic_load_n(&stats->incomplete, __ATOMIC_RELAXED);
+  pd[10] = queued;
+  pd[11] = __atomic_load_n(&stats->maxqueued, __ATOMIC_RELAXED);
+  pd[12] = nbuffers;
+  *(double *) &pd[13] = 1e-9 * (double) (idlpgr_Now() - stats->start);
+
+  // histograms have the same layout in C and in IDL
+  ph = (IDL_ULONG64 *) stats->stage;
+  for (n = 0; n < IDLPGR_NSTAGES * IDLPGR_HISTOGRAM_WORDS; n++)
+    pd[14 + n] = __atomic_load_n(&ph[n], __ATOMIC_RELAXED);
+
+  if (kw.reset)
+    idlpgr_StatsReset(stats);
+
+  return idl_stats;
 }
 
 //
-// idlpgr_WriteRegister
+// idlpgr_StartSyncCapture
 //
-// Write unsigned integer to specified register
+// Start synchronized capture on several cameras and return
+// a handle to the group.
+// argv[0]: array of contexts
+// NBUFFERS: number of buffers in each camera's ring.
+// CALLBACK: if set, frames are delivered to callbacks that keep
+//     only the most recent frame from each camera.
+// TOLERANCE: maximum difference between time stamps of frames
+//     in one set [s].  Default: half of the frame period.
 //
-void IDL_CDECL idlpgr_WriteRegister(int argc, IDL_VPTR argv[])
+IDL_VPTR IDL_CDECL idlpgr_StartSyncCapture(int argc, IDL_VPTR argv[],
+					   char *argk)
 {
   fc2Error error;
-  fc2Context context;
-  unsigned int address, value;
+  idlpgr_group *group;
+  IDL_ULONG64 *pd;
+  fc2Context *contexts;
+  IDL_MEMINT ncameras, n;
+  IDL_VPTR idl_contexts;
 
-  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
-  address = (unsigned int) IDL_ULongScalar(argv[1]);
-  value =   (unsigned int) IDL_ULongScalar(argv[2]);
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG callback;
+    IDL_LONG nbuffers;
+    int nbuffers_there;
+    double tolerance;
+    int tolerance_there;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "CALLBACK", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(callback) },
+    { "NBUFFERS", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(nbuffers_there), IDL_KW_OFFSETOF(nbuffers) },
+    { "TOLERANCE", IDL_TYP_DOUBLE, 1, 0,
+      (int *) IDL_KW_OFFSETOF(tolerance_there), IDL_KW_OFFSETOF(tolerance) },
+    { NULL }
+  };
+  KW_RESULT kw;
 
-  error = fc2WriteRegister(context, address, value);
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  if (!kw.nbuffers_there)
+    kw.nbuffers = IDLPGR_NBUFFERS;
+  if (kw.nbuffers < 2)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Grabber requires at least two buffers.");
+
+  idl_contexts = IDL_BasicTypeConversion(1, &argv[0], IDL_TYP_ULONG64);
+  IDL_VarGetData(idl_contexts, &ncameras, (char **) &pd, FALSE);
+  contexts = (fc2Context *) calloc(ncameras, sizeof(fc2Context));
+  for (n = 0; contexts && n < ncameras; n++)
+    contexts[n] = (fc2Context) pd[n];
+  if (idl_contexts != argv[0])
+    IDL_Deltmp(idl_contexts);
+  if (!contexts)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not allocate capture group");
+
+  error = idlpgr_GroupStart(&group, (unsigned int) ncameras, contexts,
+			    kw.callback, (unsigned int) kw.nbuffers,
+			    kw.tolerance_there ? fabs(kw.tolerance) : -1.);
+  free(contexts);
+  if (error == FC2_ERROR_ISOCH_ALREADY_STARTED)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Capture is already running on a camera in the group.");
   if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "Could not write value to specified register",
+			 "Could not start synchronized capture",
 			 error);
+
+  return IDL_GettmpULong64((IDL_ULONG64) group);
 }
 
 //
-// idlpgr_GetPropertyInfo
-//
-// Get information about property
+// idlpgr_ReadSyncFrames
 //
-// Reference: FlyCapture2Defs_C.h
+// Return the next matched set of frames from a synchronized
+// capture group.  All cameras must deliver images of the same
+// size and format.  The last dimension of the result is the
+// camera index.
+// argv[0]: group
+// TIMESTAMPS: optional output: DOUBLE[ncameras] time stamps [s]
+// DROPPED: optional output: number of frames discarded so far
+//     because they had no partner from every other camera
 //
-IDL_VPTR IDL_CDECL idlpgr_GetPropertyInfo(int argc, IDL_VPTR argv[])
+IDL_VPTR IDL_CDECL idlpgr_ReadSyncFrames(int argc, IDL_VPTR argv[],
+					 char *argk)
 {
   fc2Error error;
-  fc2Context context;
-  fc2PropertyInfo info;
-  static IDL_MEMINT one = 1;
-  static IDL_MEMINT r[] = {1, 8};
-  static IDL_MEMINT s[] = {1, MAX_STRING_LENGTH};
-  IDL_VPTR idl_info;
-  IDL_StructDefPtr sdef;
-  char *pd;
+  idlpgr_group *group;
+  idlpgr_layout layout, other;
+  fc2Image **image;
+  double *t, *pt;
+  unsigned int n;
+  IDL_VPTR idl_images, idl_timestamps;
+  UCHAR *pd;
 
-  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
-  info.type = (fc2PropertyType) IDL_LongScalar(argv[1]);
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR dropped;
+    IDL_VPTR timestamps;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "DROPPED", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(dropped) },
+    { "TIMESTAMPS", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(timestamps) },
+    { NULL }
+  };
+  KW_RESULT kw;
 
-  error = fc2GetPropertyInfo(context, &info);
-  if (error)
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  group = idlpgr_FindGroup(argv[0]);
+
+  image = (fc2Image **) calloc(group->ncameras, sizeof(fc2Image *));
+  t = (double *) calloc(group->ncameras, sizeof(double));
+  error = (image && t) ? FC2_ERROR_OK : FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+
+  if (!error)
+    error = idlpgr_GroupMatch(group, image, t);
+  if (!error) {
+    idlpgr_ImageLayout(image[0], &layout);
+    for (n = 1; n < group->ncameras; n++) {
+      idlpgr_ImageLayout(image[n], &other);
+      if (other.size != layout.size || other.ndims != layout.ndims ||
+	  idlpgr_ImageType(&other) != idlpgr_ImageType(&layout))
+	error = FC2_ERROR_IMAGE_CONSISTENCY_ERROR;
+    }
+    if (error)
+      idlpgr_GroupRelease(group);
+  }
+  if (error) {
+    free(image);
+    free(t);
+    IDL_KW_FREE;
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "Could not get requested property information",
+			 "Could not read synchronized frames",
 			 error);
+  }
 
-  static IDL_STRUCT_TAG_DEF tags[] = {
-    { "TYPE",             0, (void *) IDL_TYP_LONG },
-    { "PRESENT",          0, (void *) IDL_TYP_LONG },
-    { "AUTOSUPPORTED",    0, (void *) IDL_TYP_LONG },
-    { "MANUALSUPPORTED",  0, (void *) IDL_TYP_LONG },
-    { "ONOFFSUPPORTED",   0, (void *) IDL_TYP_LONG },
-    { "ONEPUSHSUPPORTED", 0, (void *) IDL_TYP_LONG },
-    { "ABSVALSUPPORTED",  0, (void *) IDL_TYP_LONG },
-    { "READOUTSUPPORTED", 0, (void *) IDL_TYP_LONG },
-    { "MIN",              0, (void *) IDL_TYP_ULONG },
-    { "MAX",              0, (void *) IDL_TYP_ULONG },
-    { "ABSMIN",           0, (void *) IDL_TYP_FLOAT },
-    { "ABSMAX",           0, (void *) IDL_TYP_FLOAT },
-    { "PUNITS",           s, (void *) IDL_TYP_BYTE },
-    { "PUNITABBR",        s, (void *) IDL_TYP_BYTE },
-    { "RESERVED",         r, (void *) IDL_TYP_ULONG },
-    { 0 }
-  };
+  pd = idlpgr_MakeImageArray(&layout, group->ncameras, &idl_images);
+  for (n = 0; n < group->ncameras; n++) {
+    idlpgr_TimedTransfer(&group->camera[n]->stats, image[n], &layout,
+			 pd + n*layout.size);
+    __atomic_add_fetch(&group->camera[n]->stats.delivered, 1,
+		       __ATOMIC_RELAXED);
+  }
+  idlpgr_GroupRelease(group);
 
-  sdef = IDL_MakeStruct("fc2PropertyInfo", tags);
-  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_info, TRUE);
-  memcpy(pd, (char *) &info, sizeof(fc2PropertyInfo));
+  if (kw.timestamps) {
+    pt = (double *) IDL_MakeTempVector(IDL_TYP_DOUBLE, group->ncameras,
+				       IDL_ARR_INI_NOP, &idl_timestamps);
+    memcpy(pt, t, group->ncameras * sizeof(double));
+    IDL_VarCopy(idl_timestamps, kw.timestamps);
+  }
+  free(image);
+  free(t);
+  if (kw.dropped)
+    IDL_VarCopy(IDL_GettmpULong64(group->dropped), kw.dropped);
+  IDL_KW_FREE;
 
-  return idl_info;
+  return idl_images;
 }
 
 //
-// idlpgr_GetProperty
-//
-// Read property values from camera
+// idlpgr_StopSyncCapture
 //
-// Reference: FlyCapture2Defs_C.h
+// Stop synchronized capture and release the group.
+// argv[0]: group
 //
-IDL_VPTR IDL_CDECL idlpgr_GetProperty(int argc, IDL_VPTR argv[])
+void IDL_CDECL idlpgr_StopSyncCapture(int argc, IDL_VPTR argv[])
 {
-  fc2Error error;
-  fc2Context context;
-  fc2Property property;
-  static IDL_MEMINT r[] = {1, 8};
+  idlpgr_group *group;
+
+  group = idlpgr_FindGroup(argv[0]);
+  idlpgr_GroupStop(group);
+  idlpgr_GroupFree(group);
+}
+
+//
+// idlpgr_StartRecording
+//
+// Record frames from a capturing camera into a file.  Frames are
+// retrieved and written by background threads, so IDL is free
+// while recording.  Frames cannot be read with idlpgr_RetrieveBuffer
+// while recording.
+// argv[0]: context
+// argv[1]: file name
+// NBUFFERS: number of frames that may wait to be written
+// DIRECT: if set, write with O_DIRECT to bypass the page cache
+//
+void IDL_CDECL idlpgr_StartRecording(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  idlpgr_camera *camera;
+  char *filename;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG direct;
+    IDL_LONG nbuffers;
+    int nbuffers_there;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "DIRECT", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(direct) },
+    { "NBUFFERS", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(nbuffers_there), IDL_KW_OFFSETOF(nbuffers) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  if (!kw.nbuffers_there)
+    kw.nbuffers = IDLPGR_RECORD_NBUFFERS;
+  if (kw.nbuffers < 2)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Recorder requires at least two buffers.");
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  IDL_ENSURE_STRING(argv[1]);
+  IDL_ENSURE_SIMPLE(argv[1]);
+  filename = IDL_VarGetString(argv[1]);
+
+  camera = idlpgr_Camera(context);
+  if (camera->recorder || camera->grabber || camera->latest)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Frames from this camera are already being consumed.");
+
+  error = idlpgr_RecorderStart(&camera->recorder, context, filename,
+			       (unsigned int) kw.nbuffers, kw.direct,
+			       __atomic_load_n(&camera->stats.counteroffset,
+					       __ATOMIC_RELAXED));
+  if (error == FC2_ERROR_FAILED)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORSTRING, IDL_MSG_LONGJMP,
+			 "Could not start recording", strerror(errno));
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not start recording",
+			 error);
+}
+
+//
+// idlpgr_RecordingStatus
+//
+// Progress of a recording
+// argv[0]: context
+//
+IDL_VPTR IDL_CDECL idlpgr_RecordingStatus(int argc, IDL_VPTR argv[])
+{
+  fc2Context context;
+  idlpgr_camera *camera;
+  idlpgr_recordstatus status;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_status;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  camera = idlpgr_FindCamera(context);
+  if (!camera || !camera->recorder)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Camera is not recording.");
+  idlpgr_RecorderStatus(camera->recorder, &status);
+
+  static IDL_STRUCT_TAG_DEF tags[] = {
+    { "CAPTURED", 0, (void *) IDL_TYP_ULONG64 },
+    { "WRITTEN",  0, (void *) IDL_TYP_ULONG64 },
+    { "DROPPED",  0, (void *) IDL_TYP_ULONG64 },
+    { "BYTES",    0, (void *) IDL_TYP_ULONG64 },
+    { "RUNNING",  0, (void *) IDL_TYP_LONG },
+    { "ERROR",    0, (void *) IDL_TYP_LONG },
+    { "SYSERROR", 0, (void *) IDL_TYP_LONG },
+    { "QUEUED",   0, (void *) IDL_TYP_ULONG },
+    { "NBUFFERS", 0, (void *) IDL_TYP_ULONG },
+    { 0 }
+  };
+  sdef = IDL_MakeStruct("idlpgrRecordingStatus", tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_status, TRUE);
+
+  ((IDL_ULONG64 *) pd)[0] = status.captured;
+  ((IDL_ULONG64 *) pd)[1] = status.written;
+  ((IDL_ULONG64 *) pd)[2] = status.dropped;
+  ((IDL_ULONG64 *) pd)[3] = status.bytes;
+  pd += 4 * sizeof(IDL_ULONG64);
+  ((IDL_LONG *) pd)[0] = status.running;
+  ((IDL_LONG *) pd)[1] = status.error;
+  ((IDL_LONG *) pd)[2] = status.syserror;
+  ((IDL_ULONG *) pd)[3] = status.queued;
+  ((IDL_ULONG *) pd)[4] = status.nslots;
+
+  return idl_status;
+}
+
+//
+// idlpgr_StopRecording
+//
+// Write the frames remaining in the queue and the index,
+// and close the recording.  Capture is stopped.
+// argv[0]: context
+//
+void IDL_CDECL idlpgr_StopRecording(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  int syserror;
+  fc2Context context;
+  idlpgr_camera *camera;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  camera = idlpgr_FindCamera(context);
+  if (!camera || !camera->recorder)
+    return;
+
+  error = idlpgr_RecorderStop(camera->recorder);
+  syserror = errno;
+  camera->recorder = NULL;
+  if (syserror)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORSTRING, IDL_MSG_LONGJMP,
+			 "Could not write recording", strerror(syserror));
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Recording stopped",
+			 error);
+}
+
+//
+// Recordings opened for reading
+//
+// Frames are handed to IDL as views of the mapped file where
+// possible.  A recording that is closed while IDL still holds
+// views stays mapped until the last view is released.
+//
+#define IDLPGR_PREFETCH 8       // frames read ahead in sequential mode
+
+typedef struct idlpgr_reader {
+  idlpgr_recording *recording;
+  int closed;                  // closed by IDL, awaiting release of views
+  unsigned long long nheld;    // views held by IDL
+  unsigned int prefetch;       // frames to read ahead of each read
+  struct idlpgr_reader *next;
+} idlpgr_reader;
+
+static idlpgr_reader *readers = NULL;
+
+static idlpgr_reader *idlpgr_FindReader(IDL_VPTR arg)
+{
+  idlpgr_reader *reader, *handle;
+
+  handle = (idlpgr_reader *) IDL_ULong64Scalar(arg);
+  for (reader = readers; reader; reader = reader->next)
+    if (reader == handle && !reader->closed)
+      return reader;
+
+  IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+		       "Argument is not an open recording.");
+  return NULL;
+}
+
+static void idlpgr_ReaderFree(idlpgr_reader *reader)
+{
+  idlpgr_reader **p;
+
+  for (p = &readers; *p; p = &(*p)->next)
+    if (*p == reader) {
+      *p = reader->next;
+      break;
+    }
+  idlpgr_RecordingClose(reader->recording);
+  free(reader);
+}
+
+//
+// idlpgr_ReaderRelease
+//
+// Called by IDL when a view of a recording is freed
+//
+static void idlpgr_ReaderRelease(UCHAR *data)
+{
+  idlpgr_reader *reader;
+  idlpgr_recording *recording;
+
+  for (reader = readers; reader; reader = reader->next) {
+    recording = reader->recording;
+    if (data >= recording->map && data < recording->map + recording->length) {
+      if (!--reader->nheld && reader->closed)
+	idlpgr_ReaderFree(reader);
+      return;
+    }
+  }
+}
+
+//
+// idlpgr_RawFormat
+//
+// Pixel format of frames that were written from IDL arrays with
+// the specified dimensions and type, as returned by idlpgr
+//
+static fc2PixelFormat idlpgr_RawFormat(IDL_MEMINT ndims, IDL_LONG *dim,
+				       int type, idlpgr_recordheader *layout)
+{
+  fc2PixelFormat format = FC2_UNSPECIFIED_PIXEL_FORMAT;
+  unsigned int channels = 1, depth = (type == IDL_TYP_BYTE) ? 1 : 2;
+
+  if (ndims == 3) {
+    channels = (unsigned int) dim[0];
+    dim++;
+  }
+  if (ndims < 2 || ndims > 3 || dim[0] < 1 || dim[1] < 1)
+    return FC2_UNSPECIFIED_PIXEL_FORMAT;
+
+  switch (type) {
+  case IDL_TYP_BYTE:
+    format = (channels == 1) ? FC2_PIXEL_FORMAT_MONO8 :
+      (channels == 2) ? FC2_PIXEL_FORMAT_422YUV8 :
+      (channels == 3) ? FC2_PIXEL_FORMAT_RGB8 :
+      (channels == 4) ? FC2_PIXEL_FORMAT_RGBU :
+      FC2_UNSPECIFIED_PIXEL_FORMAT;
+    break;
+  case IDL_TYP_UINT:
+    format = (channels == 1) ? FC2_PIXEL_FORMAT_MONO16 :
+      (channels == 3) ? FC2_PIXEL_FORMAT_RGB16 :
+      (channels == 4) ? FC2_PIXEL_FORMAT_BGRU16 :
+      FC2_UNSPECIFIED_PIXEL_FORMAT;
+    break;
+  case IDL_TYP_INT:
+    format = (channels == 1) ? FC2_PIXEL_FORMAT_S_MONO16 :
+      (channels == 3) ? FC2_PIXEL_FORMAT_S_RGB16 :
+      FC2_UNSPECIFIED_PIXEL_FORMAT;
+    break;
+  }
+
+  layout->cols = (uint32_t) dim[0];
+  layout->rows = (uint32_t) dim[1];
+  layout->stride = layout->cols * channels * depth;
+  layout->format = format;
+  layout->framesize = (uint64_t) layout->rows * layout->stride;
+
+  return format;
+}
+
+//
+// idlpgr_OpenRecording
+//
+// Map a recording into memory and return a handle to it.
+// argv[0]: file name
+// HEADER: size of the header of a raw dump [bytes].  Default: 0
+// DIMENSIONS: dimensions of each frame of a raw dump, [w, h] or
+//     [3, w, h], as returned by idlpgr.  Setting DIMENSIONS opens
+//     the file as a raw dump of contiguous frames.
+// TYPE: IDL type code of the frames of a raw dump.  Default: 1 (BYTE)
+// SEQUENTIAL: if set, frames will be read in order, and the next
+//     frames are read ahead of each read.
+// PREFETCH: number of frames to read ahead in sequential mode.
+//
+IDL_VPTR IDL_CDECL idlpgr_OpenRecording(int argc, IDL_VPTR argv[],
+					char *argk)
+{
+  fc2Error error;
+  idlpgr_reader *reader;
+  idlpgr_recording *recording;
+  idlpgr_recordheader layout;
+  IDL_VPTR idl_dimensions;
+  IDL_MEMINT ndims;
+  IDL_LONG *dim;
+  int type;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR dimensions;
+    IDL_LONG header;
+    IDL_LONG prefetch;
+    int prefetch_there;
+    IDL_LONG sequential;
+    IDL_LONG type;
+    int type_there;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "DIMENSIONS", IDL_TYP_UNDEF, 1, IDL_KW_VIN | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(dimensions) },
+    { "HEADER", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(header) },
+    { "PREFETCH", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(prefetch_there), IDL_KW_OFFSETOF(prefetch) },
+    { "SEQUENTIAL", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(sequential) },
+    { "TYPE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(type_there), IDL_KW_OFFSETOF(type) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  IDL_ENSURE_STRING(argv[0]);
+  IDL_ENSURE_SIMPLE(argv[0]);
+
+  if (kw.dimensions) {
+    memset(&layout, 0, sizeof(layout));
+    layout.headersize = (uint32_t) ((kw.header > 0) ? kw.header : 0);
+    type = kw.type_there ? (int) kw.type : IDL_TYP_BYTE;
+    idl_dimensions = IDL_BasicTypeConversion(1, &kw.dimensions, IDL_TYP_LONG);
+    IDL_VarGetData(idl_dimensions, &ndims, (char **) &dim, FALSE);
+    idlpgr_RawFormat(ndims, dim, type, &layout);
+    if (idl_dimensions != kw.dimensions)
+      IDL_Deltmp(idl_dimensions);
+    if (layout.format == FC2_UNSPECIFIED_PIXEL_FORMAT) {
+      IDL_KW_FREE;
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Unsupported dimensions or type for raw frames.");
+    }
+    error = idlpgr_RecordingOpenRaw(IDL_VarGetString(argv[0]), &layout,
+				    &recording);
+  } else
+    error = idlpgr_RecordingOpen(IDL_VarGetString(argv[0]), &recording);
+  IDL_KW_FREE;
+
+  if (error == FC2_ERROR_NOT_FOUND)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORSTRING, IDL_MSG_LONGJMP,
+			 "Could not open recording", strerror(errno));
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "File is not a valid recording.");
+
+  if (!(reader = (idlpgr_reader *) calloc(1, sizeof(idlpgr_reader)))) {
+    idlpgr_RecordingClose(recording);
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not allocate recording reader");
+  }
+  reader->recording = recording;
+  if (kw.sequential)
+    reader->prefetch = kw.prefetch_there ?
+      (unsigned int) ((kw.prefetch > 0) ? kw.prefetch : 0) : IDLPGR_PREFETCH;
+  idlpgr_RecordingAdvise(recording, kw.sequential);
+  reader->next = readers;
+  readers = reader;
+
+  return IDL_GettmpULong64((IDL_ULONG64) reader);
+}
+
+//
+// idlpgr_RecordingFrameImage
+//
+// Describe frame n of a recording as an fc2Image
+//
+static void idlpgr_RecordingFrameImage(const idlpgr_recording *recording,
+				       uint64_t n, fc2Image *image)
+{
+  const idlpgr_recordheader *header = &recording->header;
+
+  memset(image, 0, sizeof(fc2Image));
+  image->rows = header->rows;
+  image->cols = header->cols;
+  image->stride = header->stride;
+  image->format = (fc2PixelFormat) header->format;
+  image->bayerFormat = (fc2BayerTileFormat) header->bayerformat;
+  image->dataSize = image->receivedDataSize = (unsigned int) header->framesize;
+  image->pData = (unsigned char *) idlpgr_RecordingFrame(recording, n);
+}
+
+//
+// idlpgr_RecordingInfo
+//
+// Describe an open recording
+// argv[0]: recording
+//
+IDL_VPTR IDL_CDECL idlpgr_RecordingInfo(int argc, IDL_VPTR argv[])
+{
+  idlpgr_reader *reader;
+  const idlpgr_recordheader *header;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_info;
+  IDL_StructDefPtr sdef;
+  IDL_ULONG *pd;
+
+  reader = idlpgr_FindReader(argv[0]);
+  header = &reader->recording->header;
+
+  static IDL_STRUCT_TAG_DEF tags[] = {
+    { "ROWS",        0, (void *) IDL_TYP_ULONG },
+    { "COLS",        0, (void *) IDL_TYP_ULONG },
+    { "STRIDE",      0, (void *) IDL_TYP_ULONG },
+    { "FORMAT",      0, (void *) IDL_TYP_ULONG },
+    { "BAYERFORMAT", 0, (void *) IDL_TYP_ULONG },
+    { "INDEXED",     0, (void *) IDL_TYP_ULONG },
+    { "NFRAMES",     0, (void *) IDL_TYP_ULONG64 },
+    { "FRAMECOUNTER", 0, (void *) IDL_TYP_ULONG },
+    { 0 }
+  };
+  sdef = IDL_MakeStruct("idlpgrRecordingInfo", tags);
+  pd = (IDL_ULONG *) IDL_MakeTempStruct(sdef, 1, &one, &idl_info, TRUE);
+  pd[0] = header->rows;
+  pd[1] = header->cols;
+  pd[2] = header->stride;
+  pd[3] = header->format;
+  pd[4] = header->bayerformat;
+  pd[5] = (reader->recording->index != NULL);
+  *(IDL_ULONG64 *) (pd + 6) = reader->recording->nframes;
+  pd[8] = (header->flags & IDLPGR_RECORD_FRAMECOUNTER) != 0;
+
+  return idl_info;
+}
+
+//
+// idlpgr_ReadRecording
+//
+// Return frame n of a recording, or a range of frames.  Frames are
+// returned as views of the mapped file, without copying, when the
+// stored data can be presented directly as an IDL array.  Packed
+// and padded frames are copied.
+// argv[0]: recording
+// argv[1]: n
+// COUNT: number of consecutive frames to return.  If set, the
+//     result has a trailing dimension for the frame index.
+// COPY: if set, always copy frames into a new array.
+// TIMESTAMP: optional output: time stamp of each frame [s]
+// COUNTER: optional output: frame counter embedded by the camera
+//     in each frame, if it was enabled when recording started, and
+//     otherwise the number of frames retrieved from the camera up
+//     to and including each frame.  Gaps indicate frames that were
+//     lost, by the driver or in transit when the frame counter is
+//     embedded, and by the recorder in either case.  The
+//     FRAMECOUNTER field of idlpgr_RecordingInfo tells which.
+//
+IDL_VPTR IDL_CDECL idlpgr_ReadRecording(int argc, IDL_VPTR argv[], char *argk)
+{
+  idlpgr_reader *reader;
+  idlpgr_recording *recording;
+  idlpgr_layout layout;
+  fc2Image image;
+  IDL_LONG64 n, count, i;
+  IDL_MEMINT ndims, dim[IDL_MAX_ARRAY_DIM];
+  IDL_VPTR idl_image, idl_timestamp, idl_counter;
+  double *pt = NULL;
+  IDL_ULONG64 *pc = NULL;
+  UCHAR *pd;
+  int view;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG copy;
+    IDL_LONG count;
+    int count_there;
+    IDL_VPTR counter;
+    IDL_VPTR timestamp;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "COPY", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(copy) },
+    { "COUNT", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(count_there), IDL_KW_OFFSETOF(count) },
+    { "COUNTER", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(counter) },
+    { "TIMESTAMP", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(timestamp) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  reader = idlpgr_FindReader(argv[0]);
+  recording = reader->recording;
+  n = IDL_Long64Scalar(argv[1]);
+  count = kw.count_there ? kw.count : 1;
+  if (n < 0 || count < 1 || (uint64_t) (n + count) > recording->nframes) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Frame number is out of range.");
+  }
+
+  if (reader->prefetch)
+    idlpgr_RecordingPrefetch(recording, (uint64_t) (n + count),
+			     reader->prefetch);
+
+  idlpgr_RecordingFrameImage(recording, (uint64_t) n, &image);
+  idlpgr_ImageLayout(&image, &layout);
+
+  // frames that must be unpacked or trimmed cannot be shared
+  view = !kw.copy && !layout.packed12 && image.stride == layout.rowbytes &&
+    (count == 1 || recording->header.slotsize == layout.size);
+
+  if (view) {
+    ndims = layout.ndims;
+    for (i = 0; i < ndims; i++)
+      dim[i] = (IDL_MEMINT) layout.dim[i];
+    if (kw.count_there)
+      dim[ndims++] = (IDL_MEMINT) count;
+    idl_image = IDL_ImportArray((int) ndims, dim, idlpgr_ImageType(&layout),
+				image.pData, idlpgr_ReaderRelease, NULL);
+    reader->nheld++;
+  } else {
+    pd = idlpgr_MakeImageArray(&layout, kw.count_there ? count : 0,
+			       &idl_image);
+    for (i = 0; i < count; i++) {
+      idlpgr_RecordingFrameImage(recording, (uint64_t) (n + i), &image);
+      idlpgr_TransferImage(&image, &layout, pd + i*layout.size);
+    }
+  }
+
+  if (kw.timestamp) {
+    if (kw.count_there)
+      pt = (double *) IDL_MakeTempVector(IDL_TYP_DOUBLE, count,
+					 IDL_ARR_INI_ZERO, &idl_timestamp);
+    else {
+      idl_timestamp = IDL_GettmpDouble(0.);
+      pt = &idl_timestamp->value.d;
+    }
+  }
+  if (kw.counter) {
+    if (kw.count_there)
+      pc = (IDL_ULONG64 *) IDL_MakeTempVector(IDL_TYP_ULONG64, count,
+					      IDL_ARR_INI_NOP, &idl_counter);
+    else {
+      idl_counter = IDL_GettmpULong64(0);
+      pc = &idl_counter->value.ul64;
+    }
+  }
+  for (i = 0; i < count; i++) {
+    if (pt && recording->index)
+      pt[i] = recording->index[n + i].timestamp;
+    if (pc)
+      pc[i] = recording->index ? recording->index[n + i].counter : n + i + 1;
+  }
+  if (pt)
+    IDL_VarCopy(idl_timestamp, kw.timestamp);
+  if (pc)
+    IDL_VarCopy(idl_counter, kw.counter);
+  IDL_KW_FREE;
+
+  return idl_image;
+}
+
+//
+// idlpgr_CloseRecording
+//
+// Close a recording.  The file remains mapped until IDL
+// releases every view of its frames.
+// argv[0]: recording
+//
+void IDL_CDECL idlpgr_CloseRecording(int argc, IDL_VPTR argv[])
+{
+  idlpgr_reader *reader;
+
+  reader = idlpgr_FindReader(argv[0]);
+  reader->closed = 1;
+  if (!reader->nheld)
+    idlpgr_ReaderFree(reader);
+}
+
+//
+// idlpgr_AllocateImage
+//
+// Allocate IDL buffer for image data and transfer image.
+// argv[0]: image
+//
+IDL_VPTR IDL_CDECL idlpgr_AllocateImage(int argc, IDL_VPTR argv[])
+{
+  fc2Image *image;
+  idlpgr_layout layout;
+  IDL_VPTR idl_image;
+  UCHAR *pd;
+
+  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
+  
+  idlpgr_ImageLayout(image, &layout);
+  pd = idlpgr_MakeImageArray(&layout, 0, &idl_image);
+  idlpgr_TimedTransfer(idlpgr_ImageStats(image), image, &layout, pd);
+
+  return idl_image;
+}
+
+//
+// idlpgr_GetImage
+//
+// Transfer image data to preallocated IDL buffer
+// ERROR: optional output: status of the image, as for
+//     idlpgr_RetrieveBuffer.  If present, an image that does not
+//     fit the buffer is reported as FC2_ERROR_IMAGE_CONSISTENCY_ERROR
+//     and not transferred, instead of raising an error.
+//
+void IDL_CDECL idlpgr_GetImage(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Image *image;
+  idlpgr_layout layout;
+  IDL_VPTR idl_image;
+  int fits;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR error;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "ERROR", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(error) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
+  
+  idl_image = argv[1];
+  if (!(idl_image->flags & IDL_V_ARR)) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "IDL buffer must be an array.");
+  }
+  idlpgr_ImageLayout(image, &layout);
+  fits = ((size_t) idl_image->value.arr->arr_len == layout.size &&
+	  idl_image->type == idlpgr_ImageType(&layout));
+  if (kw.error)
+    IDL_VarCopy(IDL_GettmpLong(fits ? idlpgr_FrameStatus(FC2_ERROR_OK, image) :
+			       FC2_ERROR_IMAGE_CONSISTENCY_ERROR),
+		kw.error);
+  IDL_KW_FREE;
+  if (!fits) {
+    if (kw.error)
+      return;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "IDL buffer is not the same size as the image.");
+  }
+  idlpgr_TimedTransfer(idlpgr_ImageStats(image), image, &layout,
+		       idl_image->value.arr->data);
+}
+
+//
+// idlpgr_Demosaic
+//
+// Interpolate 8-bit Bayer data into an array of RGB triplets
+// argv[0]: image
+// METHOD: 1: nearest neighbor, 2: bilinear (default), 3: edge sensing
+// BAYER: Bayer tile format, as fc2BayerTileFormat.
+//     Default: tile format reported by the camera.
+// THREADS: number of threads.  Default: one per processor.
+//
+IDL_VPTR IDL_CDECL idlpgr_Demosaic(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Image *image;
+  IDL_MEMINT dim[3];
+  IDL_VPTR idl_image;
+  UCHAR *pd;
+  int tile, method, status;
+  unsigned long long start;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    int bayer_there;
+    IDL_LONG bayer;
+    int method_there;
+    IDL_LONG method;
+    IDL_LONG threads;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "BAYER", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      (int *) IDL_KW_OFFSETOF(bayer_there), IDL_KW_OFFSETOF(bayer) },
+    { "METHOD", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      (int *) IDL_KW_OFFSETOF(method_there), IDL_KW_OFFSETOF(method) },
+    { "THREADS", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(threads) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
+  tile = kw.bayer_there ? (int) kw.bayer : (int) image->bayerFormat;
+  method = kw.method_there ? (int) kw.method : IDLPGR_DEMOSAIC_BILINEAR;
+  IDL_KW_FREE;
+
+  if (image->format != FC2_PIXEL_FORMAT_RAW8 &&
+      image->format != FC2_PIXEL_FORMAT_MONO8)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Demosaicing requires 8-bit raw image data.");
+
+  dim[0] = 3;
+  dim[1] = image->cols;
+  dim[2] = image->rows;
+  pd = (UCHAR *) IDL_MakeTempArray(IDL_TYP_BYTE, 3, dim,
+				   IDL_ARR_INI_NOP, &idl_image);
+  start = idlpgr_Now();
+  status = idlpgr_DemosaicBayer8(image->pData, image->stride,
+				 image->rows, image->cols,
+				 tile, method, (int) kw.threads, pd);
+  idlpgr_StatsTime(idlpgr_ImageStats(image), IDLPGR_STAGE_CONVERT, start);
+  if (status) {
+    IDL_Deltmp(idl_image);
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Unsupported Bayer tile format or demosaic method.");
+  }
+
+  return idl_image;
+}
+
+//
+// idlpgr_GetImageInfo
+//
+// Returns the geometry and pixel format of an image
+// argv[0]: image
+//
+IDL_VPTR IDL_CDECL idlpgr_GetImageInfo(int argc, IDL_VPTR argv[])
+{
+  fc2Image *image;
+  IDL_StructDefPtr sdef;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_info;
+  IDL_ULONG *pd;
+
+  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
+
+  static IDL_STRUCT_TAG_DEF tags[] = {
+    { "ROWS",             0, (void *) IDL_TYP_ULONG },
+    { "COLS",             0, (void *) IDL_TYP_ULONG },
+    { "STRIDE",           0, (void *) IDL_TYP_ULONG },
+    { "DATASIZE",         0, (void *) IDL_TYP_ULONG },
+    { "RECEIVEDDATASIZE", 0, (void *) IDL_TYP_ULONG },
+    { "FORMAT",           0, (void *) IDL_TYP_ULONG },
+    { "BAYERFORMAT",      0, (void *) IDL_TYP_ULONG },
+    { 0 }
+  };
+  sdef = IDL_MakeStruct("fc2ImageInfo", tags);
+  pd = (IDL_ULONG *) IDL_MakeTempStruct(sdef, 1, &one, &idl_info, TRUE);
+  pd[0] = image->rows;
+  pd[1] = image->cols;
+  pd[2] = image->stride;
+  pd[3] = image->dataSize;
+  pd[4] = image->receivedDataSize;
+  pd[5] = (IDL_ULONG) image->format;
+  pd[6] = (IDL_ULONG) image->bayerFormat;
+
+  return idl_info;
+}
+
+//
+// idlpgr_SetUserBuffers
+//
+// Register a pool of nbuffers buffers of size bytes with the
+// camera.  Must be called while capture is stopped.
+// argv[0]: context
+// argv[1]: size
+// argv[2]: nbuffers
+//
+void IDL_CDECL idlpgr_SetUserBuffers(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  idlpgr_camera *camera;
+  IDL_ULONG size;
+  IDL_LONG nbuffers;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  size = IDL_ULongScalar(argv[1]);
+  nbuffers = IDL_LongScalar(argv[2]);
+  if (nbuffers < 2)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "At least two user buffers are required.");
+
+  camera = idlpgr_Camera(context);
+  if (camera->userbuffers) {
+    if (camera->userbuffers->nheld)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "User buffers are still held by IDL.");
+    idlpgr_UserBuffersFree(camera->userbuffers);
+    camera->userbuffers = NULL;
+  }
+
+  error = idlpgr_UserBuffersCreate(&camera->userbuffers, context,
+				   (unsigned int) size,
+				   (unsigned int) nbuffers);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not set user buffers",
+			 error);
+}
+
+//
+// idlpgr_AcquireImage
+//
+// Retrieve the next frame into a user buffer and return an
+// IDL array that refers to the buffer without copying.
+// The buffer is returned to the driver when IDL frees the array.
+// argv[0]: context
+// ERROR: optional output: status of the retrieval, as for
+//     idlpgr_RetrieveBuffer.  If present, a failed retrieval
+//     returns 0 instead of raising an error.
+// NORMALIZE: 1: return the frame normalized by the running mean
+//     background as FLOAT, 2: by the running median.  The buffer
+//     is returned to the driver at once.
+//     Requires idlpgr_StartBackground.
+//
+IDL_VPTR IDL_CDECL idlpgr_AcquireImage(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  idlpgr_camera *camera;
+  idlpgr_userbuffers *pool;
+  fc2Image *image;
+  idlpgr_layout layout;
+  IDL_MEMINT ndims, dim[IDL_MAX_ARRAY_DIM];
+  IDL_VPTR idl_image;
+  UCHAR *pd;
+  unsigned int n;
+  int i;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR error;
+    IDL_LONG normalize;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "ERROR", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(error) },
+    { "NORMALIZE", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(normalize) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  camera = idlpgr_FindCamera(context);
+  if (!camera || !(pool = camera->userbuffers)) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "User buffers have not been set for this context.");
+  }
+  if (pool->nheld == pool->nimages) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "All user buffers are held by IDL.");
+  }
+
+  for (n = pool->next; pool->held[n]; n = (n + 1) % pool->nimages)
+    ;
+  pool->next = (n + 1) % pool->nimages;
+  image = &pool->image[n];
+
+  error = idlpgr_Retrieve(context, image, 0);
+  if (kw.error)
+    IDL_VarCopy(IDL_GettmpLong(idlpgr_FrameStatus(error, image)), kw.error);
+  IDL_KW_FREE;
+  if (error && kw.error)
+    return IDL_GettmpLong(0);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not retrieve image buffer",
+			 error);
+
+  // the normalized frame is a new array, so the buffer is not held
+  if (kw.normalize)
+    return idlpgr_NormalizedImage(camera, image, (int) kw.normalize);
+
+  // frames that must be unpacked or trimmed cannot be shared
+  idlpgr_ImageLayout(image, &layout);
+  if (layout.packed12 || image->stride != layout.rowbytes) {
+    pd = idlpgr_MakeImageArray(&layout, 0, &idl_image);
+    idlpgr_TimedTransfer(&camera->stats, image, &layout, pd);
+    return idl_image;
+  }
+
+  ndims = layout.ndims;
+  for (i = 0; i < ndims; i++)
+    dim[i] = (IDL_MEMINT) layout.dim[i];
+  idl_image = IDL_ImportArray(ndims, dim, idlpgr_ImageType(&layout),
+			      image->pData, idlpgr_UserBuffersRelease, NULL);
+  pool->held[n] = 1;
+  pool->nheld++;
+
+  return idl_image;
+}
+
+//
+// idlpgr_ReadFrames
+//
+// Retrieve n consecutive frames into an IDL array whose last
+// dimension is the frame index.
+// argv[0]: context
+// argv[1]: image
+// argv[2]: n
+// METADATA: optional output: idlpgrMetadata[n] describing each frame
+// TIMESTAMPS: optional output: DOUBLE[n] frame time stamps in seconds
+//
+IDL_VPTR IDL_CDECL idlpgr_ReadFrames(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Image *image;
+  idlpgr_layout layout;
+  IDL_MEMINT nframes;
+  IDL_VPTR idl_images, idl_timestamps, idl_metadata;
+  UCHAR *pd;
+  double *pt = NULL;
+  idlpgr_metadata *pm = NULL;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR metadata;
+    IDL_VPTR timestamps;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "METADATA", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(metadata) },
+    { "TIMESTAMPS", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(timestamps) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  image = (fc2Image *) IDL_ULong64Scalar(argv[1]);
+  nframes = (IDL_MEMINT) IDL_LongScalar(argv[2]);
+  if (nframes < 1) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Number of frames must be positive.");
+  }
+
+  // first frame determines the geometry of the burst
+  error = idlpgr_Retrieve(context, image, 0);
+  if (error) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not retrieve image buffer",
+			 error);
+  }
+  idlpgr_ImageLayout(image, &layout);
+  pd = idlpgr_MakeImageArray(&layout, nframes, &idl_images);
+  if (kw.timestamps)
+    pt = (double *) IDL_MakeTempVector(IDL_TYP_DOUBLE, nframes,
+				       IDL_ARR_INI_NOP, &idl_timestamps);
+  if (kw.metadata)
+    pm = idlpgr_MakeMetadata(nframes, &idl_metadata);
+
+  error = idlpgr_ReadBurst(context, image, (unsigned int) nframes,
+			   &layout, pd, pt, pm, NULL);
+  if (error) {
+    IDL_Deltmp(idl_images);
+    if (pt)
+      IDL_Deltmp(idl_timestamps);
+    if (pm)
+      IDL_Deltmp(idl_metadata);
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not retrieve image buffer",
+			 error);
+  }
+
+  if (pt)
+    IDL_VarCopy(idl_timestamps, kw.timestamps);
+  if (pm)
+    IDL_VarCopy(idl_metadata, kw.metadata);
+  IDL_KW_FREE;
+
+  return idl_images;
+}
+
+//
+// idlpgr_AccumulateFrames
+//
+// Retrieve n consecutive frames and return their sum, so that
+// only one frame is transferred to IDL.  The result has the
+// dimensions of a frame, and is ULONG unless AVERAGE or FLOAT
+// is set.  Frames must be monochrome or raw Bayer.  Packed 12-bit
+// frames are unpacked before they are added.
+// argv[0]: context
+// argv[1]: image
+// argv[2]: n
+// AVERAGE: If set, return the mean of the frames as FLOAT.
+// FLOAT: If set, accumulate in FLOAT rather than in 32-bit integers,
+//     which cannot add more than 16843009 8-bit frames or 65537
+//     16-bit frames.
+// VARIANCE: optional output: FLOAT unbiased variance of each pixel
+//     over the frames.
+//
+IDL_VPTR IDL_CDECL idlpgr_AccumulateFrames(int argc, IDL_VPTR argv[],
+					   char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Image *image;
+  idlpgr_accumulator *acc;
+  idlpgr_layout layout;
+  IDL_LONG nframes;
+  IDL_MEMINT n, dim[IDL_MAX_ARRAY_DIM];
+  IDL_VPTR idl_sum, idl_variance;
+  UCHAR *pd;
+  float *pv;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG average;
+    IDL_LONG isfloat;
+    IDL_VPTR variance;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "AVERAGE", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(average) },
+    { "FLOAT", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(isfloat) },
+    { "VARIANCE", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(variance) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  image = (fc2Image *) IDL_ULong64Scalar(argv[1]);
+  nframes = IDL_LongScalar(argv[2]);
+  if (nframes < 1) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Number of frames must be positive.");
+  }
+
+  memset(&layout, 0, sizeof(idlpgr_layout));
+  error = idlpgr_Accumulate(context, image, (unsigned int) nframes,
+			    (int) kw.isfloat, kw.variance != NULL,
+			    &layout, &acc);
+  if (error == FC2_ERROR_NOT_SUPPORTED) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Frames must be monochrome or raw, of 8 to 16 bits.");
+  }
+  // the layout is known once the first frame has been retrieved
+  if (error == FC2_ERROR_INVALID_PARAMETER && layout.size) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Too many frames for integer sums: set FLOAT.");
+  }
+  if (error) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not accumulate frames",
+			 error);
+  }
+
+  for (n = 0; n < layout.ndims; n++)
+    dim[n] = (IDL_MEMINT) layout.dim[n];
+  pd = (UCHAR *) IDL_MakeTempArray((kw.average || kw.isfloat) ?
+				   IDL_TYP_FLOAT : IDL_TYP_ULONG,
+				   layout.ndims, dim,
+				   IDL_ARR_INI_NOP, &idl_sum);
+  // ULONG and FLOAT sums are stored as they are in IDL
+  if (kw.average)
+    idlpgr_AccumulatorAverage(acc, (float *) pd);
+  else
+    memcpy(pd, acc->sum, idl_sum->value.arr->arr_len);
+
+  if (kw.variance) {
+    pv = (float *) IDL_MakeTempArray(IDL_TYP_FLOAT, layout.ndims, dim,
+				     IDL_ARR_INI_NOP, &idl_variance);
+    idlpgr_AccumulatorVariance(acc, pv);
+    IDL_VarCopy(idl_variance, kw.variance);
+  }
+  IDL_KW_FREE;
+
+  return idl_sum;
+}
+
+//
+// idlpgr_ReadRegister
+//
+// Read contents of specified register
+//
+IDL_VPTR IDL_CDECL idlpgr_ReadRegister(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  unsigned int address, value;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  address = (unsigned int) IDL_ULongScalar(argv[1]);
+  
+  error = fc2ReadRegister(context, address, &value);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not read from specified register",
+			 error);
+  
+  return IDL_GettmpULong((IDL_ULONG) value);
+}
+
+//
+// idlpgr_WriteRegister
+//
+// Write unsigned integer to specified register
+//
+void IDL_CDECL idlpgr_WriteRegister(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  unsigned int address, value;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  address = (unsigned int) IDL_ULongScalar(argv[1]);
+  value =   (unsigned int) IDL_ULongScalar(argv[2]);
+
+  error = fc2WriteRegister(context, address, value);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not write value to specified register",
+			 error);
+}
+
+//
+// Structure definitions for property information and property values
+//
+// Reference: FlyCapture2Defs_C.h
+//
+static IDL_MEMINT idlpgr_reserved[] = {1, 8};
+static IDL_MEMINT idlpgr_string[] = {1, MAX_STRING_LENGTH};
+
+static IDL_STRUCT_TAG_DEF idlpgr_propertyinfo_tags[] = {
+  { "TYPE",             0, (void *) IDL_TYP_LONG },
+  { "PRESENT",          0, (void *) IDL_TYP_LONG },
+  { "AUTOSUPPORTED",    0, (void *) IDL_TYP_LONG },
+  { "MANUALSUPPORTED",  0, (void *) IDL_TYP_LONG },
+  { "ONOFFSUPPORTED",   0, (void *) IDL_TYP_LONG },
+  { "ONEPUSHSUPPORTED", 0, (void *) IDL_TYP_LONG },
+  { "ABSVALSUPPORTED",  0, (void *) IDL_TYP_LONG },
+  { "READOUTSUPPORTED", 0, (void *) IDL_TYP_LONG },
+  { "MIN",              0, (void *) IDL_TYP_ULONG },
+  { "MAX",              0, (void *) IDL_TYP_ULONG },
+  { "ABSMIN",           0, (void *) IDL_TYP_FLOAT },
+  { "ABSMAX",           0, (void *) IDL_TYP_FLOAT },
+  { "PUNITS",           idlpgr_string,   (void *) IDL_TYP_BYTE },
+  { "PUNITABBR",        idlpgr_string,   (void *) IDL_TYP_BYTE },
+  { "RESERVED",         idlpgr_reserved, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+static IDL_STRUCT_TAG_DEF idlpgr_property_tags[] = {
+  { "TYPE",           0, (void *) IDL_TYP_LONG },
+  { "PRESENT",        0, (void *) IDL_TYP_LONG },
+  { "ABSCONTROL",     0, (void *) IDL_TYP_LONG },
+  { "ONEPUSH",        0, (void *) IDL_TYP_LONG },
+  { "ONOFF",          0, (void *) IDL_TYP_LONG },
+  { "AUTOMANUALMODE", 0, (void *) IDL_TYP_LONG },
+  { "VALUEA",         0, (void *) IDL_TYP_ULONG },
+  { "VALUEB",         0, (void *) IDL_TYP_ULONG },
+  { "ABSVALUE",       0, (void *) IDL_TYP_FLOAT },
+  { "RESERVED",       idlpgr_reserved, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+//
+// idlpgr_PropertyTypes
+//
+// Convert a scalar or array of property types to LONG
+//
+static IDL_VPTR idlpgr_PropertyTypes(IDL_VPTR arg, IDL_MEMINT *n,
+				     IDL_LONG **types)
+{
+  IDL_VPTR idl_types;
+  
+  idl_types = IDL_BasicTypeConversion(1, &arg, IDL_TYP_LONG);
+  IDL_VarGetData(idl_types, n, (char **) types, FALSE);
+
+  return idl_types;
+}
+
+//
+// idlpgr_EnsureProperty
+//
+// Check that an argument is an array of fc2Property structures
+//
+static void idlpgr_EnsureProperty(IDL_VPTR arg)
+{
+  char *sname;
+
+  IDL_ENSURE_STRUCTURE(arg);
+  IDL_StructTagNameByIndex(arg->value.s.sdef, 0, IDL_MSG_LONGJMP, &sname);
+  if (strcmp(sname, "fc2Property"))
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Argument is not of type fc2Property.");
+}
+
+//
+// idlpgr_GetPropertyInfo
+//
+// Get information about one property, or about an array of
+// properties.  Information is cached when the camera is connected,
+// so this does not communicate with the camera.
+//
+// Reference: FlyCapture2Defs_C.h
+//
+IDL_VPTR IDL_CDECL idlpgr_GetPropertyInfo(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2PropertyInfo info;
+  IDL_VPTR idl_types, idl_info;
+  IDL_StructDefPtr sdef;
+  IDL_LONG *types;
+  IDL_MEMINT n, i, len;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  idl_types = idlpgr_PropertyTypes(argv[1], &n, &types);
+
+  sdef = IDL_MakeStruct("fc2PropertyInfo", idlpgr_propertyinfo_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &n, &idl_info, TRUE);
+  len = idl_info->value.s.arr->elt_len;
+
+  for (i = 0; i < n; i++, pd += len) {
+    info.type = (fc2PropertyType) types[i];
+    error = idlpgr_PropertyInfo(context, &info);
+    if (error) {
+      IDL_Deltmp(idl_info);
+      if (idl_types != argv[1])
+	IDL_Deltmp(idl_types);
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			   "Could not get requested property information",
+			   error);
+    }
+    memcpy(pd, (char *) &info, sizeof(fc2PropertyInfo));
+  }
+
+  if (idl_types != argv[1])
+    IDL_Deltmp(idl_types);
+
+  return idl_info;
+}
+
+//
+// idlpgr_GetProperty
+//
+// Read property values from camera
+//
+// Reference: FlyCapture2Defs_C.h
+//
+IDL_VPTR IDL_CDECL idlpgr_GetProperty(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Property property;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_property;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  property.type = (fc2PropertyType) IDL_LongScalar(argv[1]);
+
+  error = fc2GetProperty(context, &property);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get requested property",
+			 error);
+  
+  sdef = IDL_MakeStruct("fc2Property", idlpgr_property_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_property, TRUE);
+  memcpy(pd, (char *) &property, sizeof(fc2Property));
+
+  return idl_property;
+}
+
+//
+// idlpgr_GetProperties
+//
+// Read an array of properties from the camera in one call
+//
+// Reference: FlyCapture2Defs_C.h
+//
+IDL_VPTR IDL_CDECL idlpgr_GetProperties(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Property property;
+  IDL_VPTR idl_types, idl_properties;
+  IDL_StructDefPtr sdef;
+  IDL_LONG *types;
+  IDL_MEMINT n, i, len;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  idl_types = idlpgr_PropertyTypes(argv[1], &n, &types);
+
+  sdef = IDL_MakeStruct("fc2Property", idlpgr_property_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &n, &idl_properties, TRUE);
+  len = idl_properties->value.s.arr->elt_len;
+
+  for (i = 0; i < n; i++, pd += len) {
+    memset(&property, 0, sizeof(fc2Property));
+    property.type = (fc2PropertyType) types[i];
+    error = fc2GetProperty(context, &property);
+    if (error) {
+      IDL_Deltmp(idl_properties);
+      if (idl_types != argv[1])
+	IDL_Deltmp(idl_types);
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			   "Could not get requested property",
+			   error);
+    }
+    memcpy(pd, (char *) &property, sizeof(fc2Property));
+  }
+
+  if (idl_types != argv[1])
+    IDL_Deltmp(idl_types);
+
+  return idl_properties;
+}
+
+//
+// idlpgr_SetProperty
+//
+// Write property values to camera
+//
+// Reference: FlyCapture2Defs_C.h
+//
+void IDL_CDECL idlpgr_SetProperty(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Property property;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  idlpgr_EnsureProperty(argv[1]);
+  memcpy((char *) &property, (char *) argv[1]->value.s.arr->data, 
+	 sizeof(fc2Property));
+
+  error = idlpgr_WriteProperty(context, &property);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not set requested property",
+			 error);
+}
+
+//
+// idlpgr_SetProperties
+//
+// Write an array of properties to the camera in one call.
+// Properties are written in order.
+//
+// Reference: FlyCapture2Defs_C.h
+//
+void IDL_CDECL idlpgr_SetProperties(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Property property;
+  IDL_MEMINT n, i, len;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  idlpgr_EnsureProperty(argv[1]);
+  n = argv[1]->value.s.arr->n_elts;
+  len = argv[1]->value.s.arr->elt_len;
+  pd = (char *) argv[1]->value.s.arr->data;
+
+  for (i = 0; i < n; i++, pd += len) {
+    memcpy((char *) &property, pd, sizeof(fc2Property));
+    error = idlpgr_WriteProperty(context, &property);
+    if (error)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			   "Could not set requested property",
+			   error);
+  }
+}
+
+//
+// idlpgr_GetEmbeddedImageInfo
+//
+// Report which items of image information the camera can
+// embed in each frame, and which are enabled.
+//
+// Reference: FlyCapture2Defs_C.h
+//
+IDL_VPTR IDL_CDECL idlpgr_GetEmbeddedImageInfo(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2EmbeddedImageInfo info;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_info;
+  IDL_StructDefPtr sdef, sdef_item;
+  char *pd;
+
+  static IDL_STRUCT_TAG_DEF item_tags[] = {
+    { "AVAILABLE", 0, (void *) IDL_TYP_LONG },
+    { "ONOFF",     0, (void *) IDL_TYP_LONG },
+    { 0 }
+  };
+  static IDL_STRUCT_TAG_DEF tags[] = {
+    { "TIMESTAMP",     0, NULL },
+    { "GAIN",          0, NULL },
+    { "SHUTTER",       0, NULL },
+    { "BRIGHTNESS",    0, NULL },
+    { "EXPOSURE",      0, NULL },
+    { "WHITEBALANCE",  0, NULL },
+    { "FRAMECOUNTER",  0, NULL },
+    { "STROBEPATTERN", 0, NULL },
+    { "GPIOPINSTATE",  0, NULL },
+    { "ROIPOSITION",   0, NULL },
+    { 0 }
+  };
+  int n;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  error = fc2GetEmbeddedImageInfo(context, &info);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get embedded image information",
+			 error);
+
+  sdef_item = IDL_MakeStruct("fc2EmbeddedImageInfoProperty", item_tags);
+  for (n = 0; n < IDLPGR_EMBEDDED_ITEMS; n++)
+    tags[n].type = (void *) sdef_item;
+  sdef = IDL_MakeStruct("fc2EmbeddedImageInfo", tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_info, TRUE);
+  memcpy(pd, (char *) &info, sizeof(fc2EmbeddedImageInfo));
+
+  return idl_info;
+}
+
+//
+// idlpgr_SetEmbeddedImageInfo
+//
+// Enable or disable items of image information embedded in
+// the first pixels of each frame.  Items named by keywords are
+// turned on or off; other items are left unchanged.  With no
+// keywords, the time stamp, frame counter, shutter, gain and
+// GPIO pin state are enabled.  Items that the camera does not
+// support are ignored.
+//
+void IDL_CDECL idlpgr_SetEmbeddedImageInfo(int argc, IDL_VPTR argv[],
+					   char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2EmbeddedImageInfo info;
+  idlpgr_camera *camera;
+  fc2EmbeddedImageInfoProperty *item[IDLPGR_EMBEDDED_ITEMS];
+  int n, nset;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    int there[IDLPGR_EMBEDDED_ITEMS];
+    IDL_LONG value[IDLPGR_EMBEDDED_ITEMS];
+  } KW_RESULT;
+  // keywords in alphabetical order; values in fc2EmbeddedImageInfo order
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "BRIGHTNESS", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[3]), IDL_KW_OFFSETOF(value[3]) },
+    { "EXPOSURE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[4]), IDL_KW_OFFSETOF(value[4]) },
+    { "FRAMECOUNTER", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[6]), IDL_KW_OFFSETOF(value[6]) },
+    { "GAIN", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[1]), IDL_KW_OFFSETOF(value[1]) },
+    { "GPIOPINSTATE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[8]), IDL_KW_OFFSETOF(value[8]) },
+    { "ROIPOSITION", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[9]), IDL_KW_OFFSETOF(value[9]) },
+    { "SHUTTER", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[2]), IDL_KW_OFFSETOF(value[2]) },
+    { "STROBEPATTERN", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[7]), IDL_KW_OFFSETOF(value[7]) },
+    { "TIMESTAMP", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[0]), IDL_KW_OFFSETOF(value[0]) },
+    { "WHITEBALANCE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(there[5]), IDL_KW_OFFSETOF(value[5]) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  memset(&kw, 0, sizeof(KW_RESULT));
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  error = fc2GetEmbeddedImageInfo(context, &info);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get embedded image information",
+			 error);
+
+  item[0] = &info.timestamp;
+  item[1] = &info.gain;
+  item[2] = &info.shutter;
+  item[3] = &info.brightness;
+  item[4] = &info.exposure;
+  item[5] = &info.whiteBalance;
+  item[6] = &info.frameCounter;
+  item[7] = &info.strobePattern;
+  item[8] = &info.GPIOPinState;
+  item[9] = &info.ROIPosition;
+
+  for (n = 0, nset = 0; n < IDLPGR_EMBEDDED_ITEMS; n++)
+    nset += kw.there[n];
+  if (!nset) {
+    kw.there[0] = kw.value[0] = 1; // timestamp
+    kw.there[1] = kw.value[1] = 1; // gain
+    kw.there[2] = kw.value[2] = 1; // shutter
+    kw.there[6] = kw.value[6] = 1; // frame counter
+    kw.there[8] = kw.value[8] = 1; // GPIO pin state
+  }
+
+  for (n = 0; n < IDLPGR_EMBEDDED_ITEMS; n++)
+    if (kw.there[n] && item[n]->available)
+      item[n]->onOff = (kw.value[n] != 0);
+
+  error = fc2SetEmbeddedImageInfo(context, &info);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not set embedded image information",
+			 error);
+
+  // read back the items that the camera actually enabled
+  camera = idlpgr_Camera(context);
+  idlpgr_CacheEmbeddedImageInfo(camera);
+}
+
+//
+// Structure definition for the capture configuration
+//
+// Reference: FlyCapture2Defs_C.h
+//
+static IDL_MEMINT idlpgr_reserved16[] = {1, 16};
+
+static IDL_STRUCT_TAG_DEF idlpgr_config_tags[] = {
+  { "NUMBUFFERS",               0, (void *) IDL_TYP_ULONG },
+  { "NUMIMAGENOTIFICATIONS",    0, (void *) IDL_TYP_ULONG },
+  { "MINNUMIMAGENOTIFICATIONS", 0, (void *) IDL_TYP_ULONG },
+  { "GRABTIMEOUT",              0, (void *) IDL_TYP_LONG },
+  { "GRABMODE",                 0, (void *) IDL_TYP_LONG },
+  { "ISOCHBUSSPEED",            0, (void *) IDL_TYP_LONG },
+  { "ASYNCBUSSPEED",            0, (void *) IDL_TYP_LONG },
+  { "BANDWIDTHALLOCATION",      0, (void *) IDL_TYP_LONG },
+  { "REGISTERTIMEOUTRETRIES",   0, (void *) IDL_TYP_ULONG },
+  { "REGISTERTIMEOUT",          0, (void *) IDL_TYP_ULONG },
+  { "RESERVED",                 idlpgr_reserved16, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+//
+// idlpgr_GetConfiguration
+//
+// Read the capture configuration of the camera: the number of
+// buffers held by the driver, the grab mode and the grab timeout.
+//
+// Reference: FlyCapture2Defs_C.h
+//
+IDL_VPTR IDL_CDECL idlpgr_GetConfiguration(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Config config;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_config;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  error = fc2GetConfiguration(context, &config);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get capture configuration",
+			 error);
+
+  sdef = IDL_MakeStruct("fc2Config", idlpgr_config_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_config, TRUE);
+  memcpy(pd, (char *) &config, sizeof(fc2Config));
+
+  return idl_config;
+}
+
+//
+// idlpgr_SetConfiguration
+//
+// Write the capture configuration of the camera.  The number of
+// buffers takes effect when capture next starts.
+// argv[0]: context
+// argv[1]: fc2Config structure (optional).
+//     Default: the current configuration.
+// GRABMODE: 0: FC2_DROP_FRAMES keeps only the newest frames,
+//     1: FC2_BUFFER_FRAMES keeps every frame until it is retrieved.
+// GRABTIMEOUT: time limit for retrieving a frame [ms].
+//     -1: FC2_TIMEOUT_INFINITE.
+// NUMBUFFERS: number of frames buffered by the driver.
+//
+void IDL_CDECL idlpgr_SetConfiguration(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Config config;
+  idlpgr_camera *camera;
+  char *sname;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    int grabmode_there;
+    IDL_LONG grabmode;
+    int grabtimeout_there;
+    IDL_LONG grabtimeout;
+    int numbuffers_there;
+    IDL_LONG numbuffers;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "GRABMODE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(grabmode_there), IDL_KW_OFFSETOF(grabmode) },
+    { "GRABTIMEOUT", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(grabtimeout_there),
+      IDL_KW_OFFSETOF(grabtimeout) },
+    { "NUMBUFFERS", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(numbuffers_there),
+      IDL_KW_OFFSETOF(numbuffers) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  if (argc == 2) {
+    IDL_ENSURE_STRUCTURE(argv[1]);
+    IDL_StructTagNameByIndex(argv[1]->value.s.sdef, 0, IDL_MSG_LONGJMP,
+			     &sname);
+    if (strcmp(sname, "NUMBUFFERS"))
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Argument is not of type fc2Config.");
+    memcpy((char *) &config, (char *) argv[1]->value.s.arr->data,
+	   sizeof(fc2Config));
+  } else {
+    error = fc2GetConfiguration(context, &config);
+    if (error)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			   "Could not get capture configuration",
+			   error);
+  }
+
+  if (kw.grabmode_there)
+    config.grabMode = (fc2GrabMode) kw.grabmode;
+  if (kw.grabtimeout_there)
+    config.grabTimeout = (int) kw.grabtimeout;
+  if (kw.numbuffers_there) {
+    if (kw.numbuffers < 1)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "At least one buffer is required.");
+    config.numBuffers = (unsigned int) kw.numbuffers;
+  }
+
+  error = fc2SetConfiguration(context, &config);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not set capture configuration",
+			 error);
+
+  camera = idlpgr_Camera(context);
+  idlpgr_CacheConfiguration(camera);
+  if (camera->grabber)
+    __atomic_store_n(&camera->grabber->timeout, idlpgr_GrabTimeout(camera),
+		     __ATOMIC_RELAXED);
+}
+
+//
+// Structure definitions for Format7 modes, settings and packets
+//
+// Reference: FlyCapture2Defs_C.h
+//
+static IDL_MEMINT idlpgr_reserved8[] = {1, 8};
+
+static IDL_STRUCT_TAG_DEF idlpgr_format7info_tags[] = {
+  { "MODE",                      0, (void *) IDL_TYP_LONG },
+  { "MAXWIDTH",                  0, (void *) IDL_TYP_ULONG },
+  { "MAXHEIGHT",                 0, (void *) IDL_TYP_ULONG },
+  { "OFFSETHSTEPSIZE",           0, (void *) IDL_TYP_ULONG },
+  { "OFFSETVSTEPSIZE",           0, (void *) IDL_TYP_ULONG },
+  { "IMAGEHSTEPSIZE",            0, (void *) IDL_TYP_ULONG },
+  { "IMAGEVSTEPSIZE",            0, (void *) IDL_TYP_ULONG },
+  { "PIXELFORMATBITFIELD",       0, (void *) IDL_TYP_ULONG },
+  { "VENDORPIXELFORMATBITFIELD", 0, (void *) IDL_TYP_ULONG },
+  { "PACKETSIZE",                0, (void *) IDL_TYP_ULONG },
+  { "MINPACKETSIZE",             0, (void *) IDL_TYP_ULONG },
+  { "MAXPACKETSIZE",             0, (void *) IDL_TYP_ULONG },
+  { "PERCENTAGE",                0, (void *) IDL_TYP_FLOAT },
+  { "RESERVED",                  idlpgr_reserved16, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+static IDL_STRUCT_TAG_DEF idlpgr_format7settings_tags[] = {
+  { "MODE",        0, (void *) IDL_TYP_LONG },
+  { "OFFSETX",     0, (void *) IDL_TYP_ULONG },
+  { "OFFSETY",     0, (void *) IDL_TYP_ULONG },
+  { "WIDTH",       0, (void *) IDL_TYP_ULONG },
+  { "HEIGHT",      0, (void *) IDL_TYP_ULONG },
+  { "PIXELFORMAT", 0, (void *) IDL_TYP_ULONG },
+  { "RESERVED",    idlpgr_reserved8, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+static IDL_STRUCT_TAG_DEF idlpgr_format7packet_tags[] = {
+  { "RECOMMENDEDBYTESPERPACKET", 0, (void *) IDL_TYP_ULONG },
+  { "MAXBYTESPERPACKET",         0, (void *) IDL_TYP_ULONG },
+  { "UNITBYTESPERPACKET",        0, (void *) IDL_TYP_ULONG },
+  { "RESERVED",                  idlpgr_reserved8, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+//
+// Check that an argument is an fc2Format7ImageSettings structure
+// and copy it into settings
+//
+static void idlpgr_Format7Settings(IDL_VPTR arg,
+				   fc2Format7ImageSettings *settings)
+{
+  char *sname;
+
+  IDL_ENSURE_STRUCTURE(arg);
+  IDL_StructTagNameByIndex(arg->value.s.sdef, 1, IDL_MSG_LONGJMP, &sname);
+  if (strcmp(sname, "OFFSETX"))
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Argument is not of type fc2Format7ImageSettings.");
+  memcpy((char *) settings, (char *) arg->value.s.arr->data,
+	 sizeof(fc2Format7ImageSettings));
+}
+
+//
+// idlpgr_GetFormat7Info
+//
+// Describe a Format7 mode: the largest region of interest, the
+// steps in which its offset and size may change, the supported
+// pixel formats and the range of packet sizes.  Binned modes
+// report the reduced sensor size.
+// argv[0]: context
+// argv[1]: mode
+// SUPPORTED: optional output: 1 if the camera supports the mode
+//
+IDL_VPTR IDL_CDECL idlpgr_GetFormat7Info(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Format7Info info;
+  BOOL supported;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_info;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR supported;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "SUPPORTED", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(supported) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  memset(&info, 0, sizeof(fc2Format7Info));
+  info.mode = (fc2Mode) IDL_LongScalar(argv[1]);
+  error = fc2GetFormat7Info(context, &info, &supported);
+  if (error) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get Format7 information",
+			 error);
+  }
+
+  if (kw.supported)
+    IDL_VarCopy(IDL_GettmpLong(supported != 0), kw.supported);
+  IDL_KW_FREE;
+
+  sdef = IDL_MakeStruct("fc2Format7Info", idlpgr_format7info_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_info, TRUE);
+  memcpy(pd, (char *) &info, sizeof(fc2Format7Info));
+
+  return idl_info;
+}
+
+//
+// idlpgr_ValidateFormat7Settings
+//
+// Returns 1 if the camera accepts the Format7 settings,
+// and 0 otherwise.
+// argv[0]: context
+// argv[1]: fc2Format7ImageSettings structure
+// PACKETINFO: optional output: fc2Format7PacketInfo structure
+//     with the recommended and largest packet sizes for the settings
+//
+IDL_VPTR IDL_CDECL idlpgr_ValidateFormat7Settings(int argc, IDL_VPTR argv[],
+						  char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Format7ImageSettings settings;
+  fc2Format7PacketInfo packetinfo;
+  BOOL valid;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_packetinfo;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR packetinfo;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "PACKETINFO", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(packetinfo) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  idlpgr_Format7Settings(argv[1], &settings);
+
+  memset(&packetinfo, 0, sizeof(fc2Format7PacketInfo));
+  error = fc2ValidateFormat7Settings(context, &settings, &valid, &packetinfo);
+  if (error) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not validate Format7 settings",
+			 error);
+  }
+
+  if (kw.packetinfo) {
+    sdef = IDL_MakeStruct("fc2Format7PacketInfo", idlpgr_format7packet_tags);
+    pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_packetinfo, TRUE);
+    memcpy(pd, (char *) &packetinfo, sizeof(fc2Format7PacketInfo));
+    IDL_VarCopy(idl_packetinfo, kw.packetinfo);
+  }
+  IDL_KW_FREE;
+
+  return IDL_GettmpLong(valid != 0);
+}
+
+//
+// idlpgr_GetFormat7Configuration
+//
+// Returns the current Format7 settings as an
+// fc2Format7ImageSettings structure.
+// argv[0]: context
+// PACKETSIZE: optional output: bytes per packet
+// PERCENTAGE: optional output: share of the bus bandwidth [%]
+//
+IDL_VPTR IDL_CDECL idlpgr_GetFormat7Configuration(int argc, IDL_VPTR argv[],
+						  char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Format7ImageSettings settings;
+  unsigned int packetsize;
+  float percentage;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_settings;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_VPTR packetsize;
+    IDL_VPTR percentage;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "PACKETSIZE", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(packetsize) },
+    { "PERCENTAGE", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(percentage) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  error = fc2GetFormat7Configuration(context, &settings,
+				     &packetsize, &percentage);
+  if (error) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get Format7 configuration",
+			 error);
+  }
+
+  if (kw.packetsize)
+    IDL_VarCopy(IDL_GettmpULong(packetsize), kw.packetsize);
+  if (kw.percentage)
+    IDL_VarCopy(IDL_GettmpFloat(percentage), kw.percentage);
+  IDL_KW_FREE;
+
+  sdef = IDL_MakeStruct("fc2Format7ImageSettings",
+			idlpgr_format7settings_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_settings, TRUE);
+  memcpy(pd, (char *) &settings, sizeof(fc2Format7ImageSettings));
+
+  return idl_settings;
+}
+
+//
+// idlpgr_AllocateFormat7Image
+//
+// Allocate IDL buffer for frames captured with Format7 settings,
+// without waiting for a frame.
+// argv[0]: fc2Format7ImageSettings structure
+//
+IDL_VPTR IDL_CDECL idlpgr_AllocateFormat7Image(int argc, IDL_VPTR argv[])
+{
+  fc2Format7ImageSettings settings;
+  idlpgr_layout layout;
+  IDL_VPTR idl_image;
+  UCHAR *pd;
+
+  idlpgr_Format7Settings(argv[0], &settings);
+
+  idlpgr_Format7Layout(&settings, &layout);
+  pd = idlpgr_MakeImageArray(&layout, 0, &idl_image);
+  memset(pd, 0, layout.size);
+
+  return idl_image;
+}
+
+//
+// idlpgr_SetFormat7Configuration
+//
+// Select a Format7 mode, region of interest and pixel format.
+// Must be called while capture is stopped.  The settings are
+// validated before they are applied.  Property information is
+// read again, because the range of the shutter depends on the
+// frame rate that the new region allows.  If the camera writes
+// into user buffers that are too small for the new frames, the
+// buffers are reallocated.
+// argv[0]: context
+// argv[1]: fc2Format7ImageSettings structure
+// PACKETSIZE: bytes per packet.
+//     Default: the packet size recommended for the settings.
+//
+void IDL_CDECL idlpgr_SetFormat7Configuration(int argc, IDL_VPTR argv[],
+					      char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Format7ImageSettings settings;
+  fc2Format7PacketInfo packetinfo;
+  BOOL valid;
+  unsigned int packetsize;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    int packetsize_there;
+    IDL_LONG packetsize;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "PACKETSIZE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(packetsize_there),
+      IDL_KW_OFFSETOF(packetsize) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  idlpgr_Format7Settings(argv[1], &settings);
+
+  memset(&packetinfo, 0, sizeof(fc2Format7PacketInfo));
+  error = fc2ValidateFormat7Settings(context, &settings, &valid, &packetinfo);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not validate Format7 settings",
+			 error);
+  if (!valid)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Format7 settings are not valid for this camera.");
+
+  packetsize = packetinfo.recommendedBytesPerPacket;
+  if (kw.packetsize_there) {
+    if (kw.packetsize < 1 ||
+	(unsigned int) kw.packetsize > packetinfo.maxBytesPerPacket)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Packet size is out of range.");
+    packetsize = (unsigned int) kw.packetsize;
+  }
+
+  error = idlpgr_Format7Apply(context, &settings, packetsize);
+  if (error == FC2_ERROR_BUFFER_TOO_SMALL)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "User buffers are still held by IDL.");
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not set Format7 configuration",
+			 error);
+}
+
+//
+// Structure definition for the results of packet-size tuning
+// (see idlpgr_core.h)
+//
+static IDL_STRUCT_TAG_DEF idlpgr_tuning_tags[] = {
+  { "RATE",       0, (void *) IDL_TYP_DOUBLE },
+  { "BANDWIDTH",  0, (void *) IDL_TYP_DOUBLE },
+  { "PACKETSIZE", 0, (void *) IDL_TYP_ULONG },
+  { "DELAY",      0, (void *) IDL_TYP_ULONG },
+  { "FRAMES",     0, (void *) IDL_TYP_ULONG },
+  { "INCOMPLETE", 0, (void *) IDL_TYP_ULONG },
+  { "ERRORS",     0, (void *) IDL_TYP_ULONG },
+  { "TIMEOUTS",   0, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+//
+// idlpgr_TunePacketSize
+//
+// Find the packet size, and for GigE cameras the inter-packet delay,
+// that sustains the highest frame rate without losing data, apply it,
+// and return an idlpgrTuning structure describing it.  Must be called
+// while capture is stopped.  If no frames arrive at any setting, the
+// original setting is restored and an error is raised.
+// argv[0]: context
+// MAXDELAY: largest GigE inter-packet delay to try.  Default: 6250.
+// NFRAMES: frames measured at each setting.  Default: 20.
+// NSTEPS: settings tried for each parameter.  Default: 8.
+// RESULTS: optional output: idlpgrTuning[n] describing every
+//     setting that was tried
+// TIMEOUT: time limit for retrieving each frame [ms].  Default: 1000.
+//
+IDL_VPTR IDL_CDECL idlpgr_TunePacketSize(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  idlpgr_tuning tuning[2 * IDLPGR_TUNE_MAXSTEPS];
+  unsigned int npoints, best;
+  int nsteps, nframes;
+  static IDL_MEMINT one = 1;
+  IDL_MEMINT dim;
+  IDL_VPTR idl_tuning, idl_results;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    int maxdelay_there;
+    IDL_LONG maxdelay;
+    int nframes_there;
+    IDL_LONG nframes;
+    int nsteps_there;
+    IDL_LONG nsteps;
+    IDL_VPTR results;
+    int timeout_there;
+    IDL_LONG timeout;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "MAXDELAY", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(maxdelay_there), IDL_KW_OFFSETOF(maxdelay) },
+    { "NFRAMES", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(nframes_there), IDL_KW_OFFSETOF(nframes) },
+    { "NSTEPS", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(nsteps_there), IDL_KW_OFFSETOF(nsteps) },
+    { "RESULTS", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(results) },
+    { "TIMEOUT", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(timeout_there), IDL_KW_OFFSETOF(timeout) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  nframes = kw.nframes_there ? kw.nframes : 20;
+  nsteps = kw.nsteps_there ? kw.nsteps : 8;
+  if (nframes < 2 || nsteps < 2 || nsteps > IDLPGR_TUNE_MAXSTEPS) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "NFRAMES must be at least 2, and NSTEPS from 2 to 32.");
+  }
+  if (!kw.maxdelay_there)
+    kw.maxdelay = 6250;
+  if (kw.maxdelay < 0)
+    kw.maxdelay = 0;
+
+  error = idlpgr_Tune(context, (unsigned int) nframes, (unsigned int) nsteps,
+		      kw.timeout_there ? (int) kw.timeout : 1000,
+		      (unsigned int) kw.maxdelay,
+		      tuning, &npoints, &best);
+  if (error) {
+    IDL_KW_FREE;
+    if (error == FC2_ERROR_ISOCH_ALREADY_STARTED)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Capture must be stopped while tuning.");
+    if (error == FC2_ERROR_NOT_SUPPORTED)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Packet size can be tuned only for GigE cameras "
+			   "or in Format7 modes.");
+    if (error == FC2_ERROR_TIMEOUT && npoints)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "No frames were received at any setting.");
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not tune packet size",
+			 error);
+  }
+
+  sdef = IDL_MakeStruct("idlpgrTuning", idlpgr_tuning_tags);
+  if (kw.results) {
+    dim = npoints;
+    pd = IDL_MakeTempStruct(sdef, 1, &dim, &idl_results, TRUE);
+    memcpy(pd, (char *) tuning, npoints * sizeof(idlpgr_tuning));
+    IDL_VarCopy(idl_results, kw.results);
+  }
+  IDL_KW_FREE;
+
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_tuning, TRUE);
+  memcpy(pd, (char *) &tuning[best], sizeof(idlpgr_tuning));
+
+  return idl_tuning;
+}
+
+//
+// Structure definition for the trigger mode
+//
+// Reference: FlyCapture2Defs_C.h
+//
+static IDL_STRUCT_TAG_DEF idlpgr_triggermode_tags[] = {
+  { "ONOFF",     0, (void *) IDL_TYP_LONG },
+  { "POLARITY",  0, (void *) IDL_TYP_ULONG },
+  { "SOURCE",    0, (void *) IDL_TYP_ULONG },
+  { "MODE",      0, (void *) IDL_TYP_ULONG },
+  { "PARAMETER", 0, (void *) IDL_TYP_ULONG },
+  { "RESERVED",  idlpgr_reserved8, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+//
+// idlpgr_GetTriggerMode
+//
+// Returns the trigger mode of the camera as an
+// fc2TriggerMode structure.
+// argv[0]: context
+//
+IDL_VPTR IDL_CDECL idlpgr_GetTriggerMode(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2TriggerMode mode;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_mode;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  error = fc2GetTriggerMode(context, &mode);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get trigger mode",
+			 error);
+
+  sdef = IDL_MakeStruct("fc2TriggerMode", idlpgr_triggermode_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_mode, TRUE);
+  memcpy(pd, (char *) &mode, sizeof(fc2TriggerMode));
+
+  return idl_mode;
+}
+
+//
+// idlpgr_SetTriggerMode
+//
+// Write the trigger mode of the camera.
+// argv[0]: context
+// argv[1]: fc2TriggerMode structure (optional).
+//     Default: the current trigger mode.
+// BROADCAST: If set, write the trigger mode to every camera
+//     on the bus.
+// MODE: trigger mode number, e.g. 0: exposure begins on the
+//     trigger, 14: overlapped exposure and readout.
+// ONOFF: 1: frames are triggered, 0: frames run freely.
+// PARAMETER: parameter of the trigger mode.
+// POLARITY: 0: falling edge (active low), 1: rising edge.
+// SOURCE: GPIO pin of the trigger, or 7 for software triggers.
+//
+void IDL_CDECL idlpgr_SetTriggerMode(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2TriggerMode mode;
+  char *sname;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG broadcast;
+    int mode_there;
+    IDL_LONG mode;
+    int onoff_there;
+    IDL_LONG onoff;
+    int parameter_there;
+    IDL_LONG parameter;
+    int polarity_there;
+    IDL_LONG polarity;
+    int source_there;
+    IDL_LONG source;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "BROADCAST", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(broadcast) },
+    { "MODE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(mode_there), IDL_KW_OFFSETOF(mode) },
+    { "ONOFF", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(onoff_there), IDL_KW_OFFSETOF(onoff) },
+    { "PARAMETER", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(parameter_there), IDL_KW_OFFSETOF(parameter) },
+    { "POLARITY", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(polarity_there), IDL_KW_OFFSETOF(polarity) },
+    { "SOURCE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(source_there), IDL_KW_OFFSETOF(source) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  if (argc == 2) {
+    IDL_ENSURE_STRUCTURE(argv[1]);
+    IDL_StructTagNameByIndex(argv[1]->value.s.sdef, 1, IDL_MSG_LONGJMP,
+			     &sname);
+    if (strcmp(sname, "POLARITY"))
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Argument is not of type fc2TriggerMode.");
+    memcpy((char *) &mode, (char *) argv[1]->value.s.arr->data,
+	   sizeof(fc2TriggerMode));
+  } else {
+    error = fc2GetTriggerMode(context, &mode);
+    if (error)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			   "Could not get trigger mode",
+			   error);
+  }
+
+  if (kw.mode_there)
+    mode.mode = (unsigned int) kw.mode;
+  if (kw.onoff_there)
+    mode.onOff = (kw.onoff != 0);
+  if (kw.parameter_there)
+    mode.parameter = (unsigned int) kw.parameter;
+  if (kw.polarity_there)
+    mode.polarity = (unsigned int) kw.polarity;
+  if (kw.source_there)
+    mode.source = (unsigned int) kw.source;
+
+  error = kw.broadcast ?
+    fc2SetTriggerModeBroadcast(context, &mode) :
+    fc2SetTriggerMode(context, &mode);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not set trigger mode",
+			 error);
+}
+
+//
+// idlpgr_FireSoftwareTrigger
+//
+// argv[0]: context
+// BROADCAST: If set, trigger every camera on the bus at once.
+//
+void IDL_CDECL idlpgr_FireSoftwareTrigger(int argc, IDL_VPTR argv[],
+					  char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG broadcast;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "BROADCAST", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(broadcast) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  error = kw.broadcast ?
+    fc2FireSoftwareTriggerBroadcast(context) :
+    fc2FireSoftwareTrigger(context);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not fire software trigger",
+			 error);
+}
+
+//
+// idlpgr_TriggerAndRead
+//
+// Fire n software triggers at regular intervals and return the
+// n frames that they expose as an IDL array whose last dimension
+// is the frame index.  The camera must be capturing in a trigger
+// mode whose source is the software trigger.
+// argv[0]: context
+// argv[1]: image
+// argv[2]: n
+// argv[3]: interval between triggers [s].  0: as fast as possible.
+// BROADCAST: If set, trigger every camera on the bus at once,
+//     so that other cameras expose their frames simultaneously.
+// FIRED: optional output: DOUBLE[n] time at which each trigger
+//     fired, relative to the first deadline [s]
+// LATENCY: optional output: DOUBLE[n] time from each trigger to
+//     the delivery of its frame [s]
+// METADATA: optional output: idlpgrMetadata[n] describing each frame
+// TIMESTAMPS: optional output: DOUBLE[n] frame time stamps in seconds
+//
+IDL_VPTR IDL_CDECL idlpgr_TriggerAndRead(int argc, IDL_VPTR argv[],
+					 char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2Image *image;
+  idlpgr_layout layout;
+  idlpgr_trigger trigger;
+  unsigned long long *fired;
+  IDL_MEMINT n, nframes;
+  IDL_VPTR idl_images = NULL, idl_timestamps, idl_metadata, idl_fired;
+  IDL_VPTR idl_latency;
+  UCHAR *pd = NULL;
+  double interval, *pt = NULL, *pf, *pl;
+  idlpgr_metadata *pm = NULL;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG broadcast;
+    IDL_VPTR fired;
+    IDL_VPTR latency;
+    IDL_VPTR metadata;
+    IDL_VPTR timestamps;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "BROADCAST", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(broadcast) },
+    { "FIRED", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(fired) },
+    { "LATENCY", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(latency) },
+    { "METADATA", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(metadata) },
+    { "TIMESTAMPS", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(timestamps) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  image = (fc2Image *) IDL_ULong64Scalar(argv[1]);
+  nframes = (IDL_MEMINT) IDL_LongScalar(argv[2]);
+  interval = IDL_DoubleScalar(argv[3]);
+  if (nframes < 1 || interval < 0.) {
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Number of frames must be positive, "
+			 "and the interval must not be negative.");
+  }
+
+  // times at which triggers fired, followed by delivery times
+  fired = (unsigned long long *) calloc(2*nframes, sizeof(unsigned long long));
+  error = fired ?
+    idlpgr_TriggerStart(&trigger, context, (unsigned int) nframes,
+			interval, kw.broadcast, fired) :
+    FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  if (error) {
+    free(fired);
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not start trigger thread",
+			 error);
+  }
+
+  // first frame determines the geometry of the burst
+  error = idlpgr_Retrieve(context, image, 0);
+  if (!error) {
+    fired[nframes] = idlpgr_Now();
+    idlpgr_ImageLayout(image, &layout);
+    pd = idlpgr_MakeImageArray(&layout, nframes, &idl_images);
+    if (kw.timestamps)
+      pt = (double *) IDL_MakeTempVector(IDL_TYP_DOUBLE, nframes,
+					 IDL_ARR_INI_NOP, &idl_timestamps);
+    if (kw.metadata)
+      pm = idlpgr_MakeMetadata(nframes, &idl_metadata);
+    error = idlpgr_ReadBurst(context, image, (unsigned int) nframes,
+			     &layout, pd, pt, pm, fired + nframes);
+  }
+
+  // a trigger that failed explains a missing frame
+  if (idlpgr_TriggerStop(&trigger))
+    error = trigger.error;
+
+  if (error) {
+    free(fired);
+    if (pd)
+      IDL_Deltmp(idl_images);
+    if (pt)
+      IDL_Deltmp(idl_timestamps);
+    if (pm)
+      IDL_Deltmp(idl_metadata);
+    IDL_KW_FREE;
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not read triggered frames",
+			 error);
+  }
+
+  if (kw.fired) {
+    pf = (double *) IDL_MakeTempVector(IDL_TYP_DOUBLE, nframes,
+				       IDL_ARR_INI_NOP, &idl_fired);
+    for (n = 0; n < nframes; n++)
+      pf[n] = 1e-9 * ((double) fired[n] - (double) trigger.start);
+    IDL_VarCopy(idl_fired, kw.fired);
+  }
+  if (kw.latency) {
+    pl = (double *) IDL_MakeTempVector(IDL_TYP_DOUBLE, nframes,
+				       IDL_ARR_INI_NOP, &idl_latency);
+    for (n = 0; n < nframes; n++)
+      pl[n] = 1e-9 * ((double) fired[nframes + n] - (double) fired[n]);
+    IDL_VarCopy(idl_latency, kw.latency);
+  }
+  free(fired);
+  if (pt)
+    IDL_VarCopy(idl_timestamps, kw.timestamps);
+  if (pm)
+    IDL_VarCopy(idl_metadata, kw.metadata);
+  IDL_KW_FREE;
+
+  return idl_images;
+}
+
+//
+// Structure definitions for trigger and strobe information
+//
+// Reference: FlyCapture2Defs_C.h
+//
+static IDL_STRUCT_TAG_DEF idlpgr_triggermodeinfo_tags[] = {
+  { "PRESENT",                  0, (void *) IDL_TYP_LONG },
+  { "READOUTSUPPORTED",         0, (void *) IDL_TYP_LONG },
+  { "ONOFFSUPPORTED",           0, (void *) IDL_TYP_LONG },
+  { "POLARITYSUPPORTED",        0, (void *) IDL_TYP_LONG },
+  { "VALUEREADABLE",            0, (void *) IDL_TYP_LONG },
+  { "SOURCEMASK",               0, (void *) IDL_TYP_ULONG },
+  { "SOFTWARETRIGGERSUPPORTED", 0, (void *) IDL_TYP_LONG },
+  { "MODEMASK",                 0, (void *) IDL_TYP_ULONG },
+  { "RESERVED",                 idlpgr_reserved8, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+static IDL_STRUCT_TAG_DEF idlpgr_strobeinfo_tags[] = {
+  { "SOURCE",            0, (void *) IDL_TYP_ULONG },
+  { "PRESENT",           0, (void *) IDL_TYP_LONG },
+  { "READOUTSUPPORTED",  0, (void *) IDL_TYP_LONG },
+  { "ONOFFSUPPORTED",    0, (void *) IDL_TYP_LONG },
+  { "POLARITYSUPPORTED", 0, (void *) IDL_TYP_LONG },
+  { "MINVALUE",          0, (void *) IDL_TYP_FLOAT },
+  { "MAXVALUE",          0, (void *) IDL_TYP_FLOAT },
+  { "RESERVED",          idlpgr_reserved8, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+static IDL_STRUCT_TAG_DEF idlpgr_strobecontrol_tags[] = {
+  { "SOURCE",   0, (void *) IDL_TYP_ULONG },
+  { "ONOFF",    0, (void *) IDL_TYP_LONG },
+  { "POLARITY", 0, (void *) IDL_TYP_ULONG },
+  { "DELAY",    0, (void *) IDL_TYP_FLOAT },
+  { "DURATION", 0, (void *) IDL_TYP_FLOAT },
+  { "RESERVED", idlpgr_reserved8, (void *) IDL_TYP_ULONG },
+  { 0 }
+};
+
+//
+// idlpgr_GetTriggerModeInfo
+//
+// Report the trigger modes, sources and polarities that
+// the camera supports.
+// argv[0]: context
+//
+IDL_VPTR IDL_CDECL idlpgr_GetTriggerModeInfo(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2TriggerModeInfo info;
   static IDL_MEMINT one = 1;
-  IDL_VPTR idl_property;
+  IDL_VPTR idl_info;
   IDL_StructDefPtr sdef;
   char *pd;
 
   context = (fc2Context) IDL_ULong64Scalar(argv[0]);
-  property.type = (fc2PropertyType) IDL_LongScalar(argv[1]);
 
-  error = fc2GetProperty(context, &property);
+  error = fc2GetTriggerModeInfo(context, &info);
   if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "Could not get requested property",
+			 "Could not get trigger mode information",
 			 error);
-  
-  static IDL_STRUCT_TAG_DEF tags[] = {
-    { "TYPE",           0, (void *) IDL_TYP_LONG },
-    { "PRESENT",        0, (void *) IDL_TYP_LONG },
-    { "ABSCONTROL",     0, (void *) IDL_TYP_LONG },
-    { "ONEPUSH",        0, (void *) IDL_TYP_LONG },
-    { "ONOFF",          0, (void *) IDL_TYP_LONG },
-    { "AUTOMANUALMODE", 0, (void *) IDL_TYP_LONG },
-    { "VALUEA",         0, (void *) IDL_TYP_ULONG },
-    { "VALUEB",         0, (void *) IDL_TYP_ULONG },
-    { "ABSVALUE",       0, (void *) IDL_TYP_FLOAT },
-    { "RESERVED",       r, (void *) IDL_TYP_ULONG },
-    { 0 }
+
+  sdef = IDL_MakeStruct("fc2TriggerModeInfo", idlpgr_triggermodeinfo_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_info, TRUE);
+  memcpy(pd, (char *) &info, sizeof(fc2TriggerModeInfo));
+
+  return idl_info;
+}
+
+//
+// idlpgr_GetTriggerDelay
+//
+// Returns the delay between the trigger and the start of
+// exposure as an fc2Property structure.
+// argv[0]: context
+//
+IDL_VPTR IDL_CDECL idlpgr_GetTriggerDelay(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2TriggerDelay delay;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_delay;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  memset(&delay, 0, sizeof(fc2TriggerDelay));
+  delay.type = FC2_TRIGGER_DELAY;
+  error = fc2GetTriggerDelay(context, &delay);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get trigger delay",
+			 error);
+
+  sdef = IDL_MakeStruct("fc2Property", idlpgr_property_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_delay, TRUE);
+  memcpy(pd, (char *) &delay, sizeof(fc2TriggerDelay));
+
+  return idl_delay;
+}
+
+//
+// idlpgr_SetTriggerDelay
+//
+// argv[0]: context
+// argv[1]: delay between the trigger and the start of exposure [s]
+// BROADCAST: If set, set the delay of every camera on the bus.
+//
+void IDL_CDECL idlpgr_SetTriggerDelay(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2TriggerDelay delay;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG broadcast;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "BROADCAST", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(broadcast) },
+    { NULL }
   };
-  sdef = IDL_MakeStruct("fc2Property", tags);
-  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_property, TRUE);
-  memcpy(pd, (char *) &property, sizeof(fc2Property));
+  KW_RESULT kw;
 
-  return idl_property;
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  memset(&delay, 0, sizeof(fc2TriggerDelay));
+  delay.type = FC2_TRIGGER_DELAY;
+  error = fc2GetTriggerDelay(context, &delay);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get trigger delay",
+			 error);
+
+  delay.absControl = TRUE;
+  delay.onOff = TRUE;
+  delay.autoManualMode = FALSE;
+  delay.absValue = (float) IDL_DoubleScalar(argv[1]);
+  error = kw.broadcast ?
+    fc2SetTriggerDelayBroadcast(context, &delay) :
+    fc2SetTriggerDelay(context, &delay);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not set trigger delay",
+			 error);
 }
 
 //
-// idlpgr_SetProperty
+// idlpgr_GetStrobeInfo
 //
-// Write property values to camera
+// Report the capabilities of one strobe output.
+// argv[0]: context
+// argv[1]: source: GPIO pin of the strobe
 //
-// Reference: FlyCapture2Defs_C.h
+IDL_VPTR IDL_CDECL idlpgr_GetStrobeInfo(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  fc2StrobeInfo info;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_info;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  memset(&info, 0, sizeof(fc2StrobeInfo));
+  info.source = IDL_ULongScalar(argv[1]);
+  error = fc2GetStrobeInfo(context, &info);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get strobe information",
+			 error);
+
+  sdef = IDL_MakeStruct("fc2StrobeInfo", idlpgr_strobeinfo_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_info, TRUE);
+  memcpy(pd, (char *) &info, sizeof(fc2StrobeInfo));
+
+  return idl_info;
+}
+
 //
-void IDL_CDECL idlpgr_SetProperty(int argc, IDL_VPTR argv[])
+// idlpgr_GetStrobe
+//
+// Returns the settings of one strobe output as an
+// fc2StrobeControl structure.
+// argv[0]: context
+// argv[1]: source: GPIO pin of the strobe
+//
+IDL_VPTR IDL_CDECL idlpgr_GetStrobe(int argc, IDL_VPTR argv[])
 {
   fc2Error error;
   fc2Context context;
-  fc2Property property;
+  fc2StrobeControl strobe;
+  static IDL_MEMINT one = 1;
+  IDL_VPTR idl_strobe;
+  IDL_StructDefPtr sdef;
+  char *pd;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  memset(&strobe, 0, sizeof(fc2StrobeControl));
+  strobe.source = IDL_ULongScalar(argv[1]);
+  error = fc2GetStrobe(context, &strobe);
+  if (error)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			 "Could not get strobe",
+			 error);
+
+  sdef = IDL_MakeStruct("fc2StrobeControl", idlpgr_strobecontrol_tags);
+  pd = IDL_MakeTempStruct(sdef, 1, &one, &idl_strobe, TRUE);
+  memcpy(pd, (char *) &strobe, sizeof(fc2StrobeControl));
+
+  return idl_strobe;
+}
+
+//
+// idlpgr_SetStrobe
+//
+// Configure a strobe output.
+// argv[0]: context
+// argv[1]: fc2StrobeControl structure (optional).
+//     Default: the current settings of the strobe given by SOURCE.
+// BROADCAST: If set, configure the strobe of every camera on the bus.
+// DELAY: delay from the start of exposure to the strobe [ms].
+// DURATION: duration of the strobe [ms].  0: the exposure time.
+// ONOFF: 1: strobe is enabled, 0: disabled.
+// POLARITY: 0: active low, 1: active high.
+// SOURCE: GPIO pin of the strobe.  Default: 0, or the source
+//     given in the structure.
+//
+void IDL_CDECL idlpgr_SetStrobe(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Error error;
+  fc2Context context;
+  fc2StrobeControl strobe;
   char *sname;
 
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG broadcast;
+    int delay_there;
+    float delay;
+    int duration_there;
+    float duration;
+    int onoff_there;
+    IDL_LONG onoff;
+    int polarity_there;
+    IDL_LONG polarity;
+    int source_there;
+    IDL_LONG source;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "BROADCAST", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(broadcast) },
+    { "DELAY", IDL_TYP_FLOAT, 1, 0,
+      (int *) IDL_KW_OFFSETOF(delay_there), IDL_KW_OFFSETOF(delay) },
+    { "DURATION", IDL_TYP_FLOAT, 1, 0,
+      (int *) IDL_KW_OFFSETOF(duration_there), IDL_KW_OFFSETOF(duration) },
+    { "ONOFF", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(onoff_there), IDL_KW_OFFSETOF(onoff) },
+    { "POLARITY", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(polarity_there), IDL_KW_OFFSETOF(polarity) },
+    { "SOURCE", IDL_TYP_LONG, 1, 0,
+      (int *) IDL_KW_OFFSETOF(source_there), IDL_KW_OFFSETOF(source) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
   context = (fc2Context) IDL_ULong64Scalar(argv[0]);
 
-  IDL_ENSURE_STRUCTURE(argv[1]);
-  IDL_StructTagNameByIndex(argv[1]->value.s.sdef, 0, IDL_MSG_LONGJMP, &sname);
-  if (strcmp(sname, "fc2Property"))
-    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
-			 "Argument is not of type fc2Property.");
+  if (argc == 2) {
+    IDL_ENSURE_STRUCTURE(argv[1]);
+    IDL_StructTagNameByIndex(argv[1]->value.s.sdef, 3, IDL_MSG_LONGJMP,
+			     &sname);
+    if (strcmp(sname, "DELAY"))
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Argument is not of type fc2StrobeControl.");
+    memcpy((char *) &strobe, (char *) argv[1]->value.s.arr->data,
+	   sizeof(fc2StrobeControl));
+    if (kw.source_there)
+      strobe.source = (unsigned int) kw.source;
+  } else {
+    memset(&strobe, 0, sizeof(fc2StrobeControl));
+    strobe.source = kw.source_there ? (unsigned int) kw.source : 0;
+    error = fc2GetStrobe(context, &strobe);
+    if (error)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			   "Could not get strobe",
+			   error);
+  }
 
-  memcpy((char *) &property, (char *) argv[1]->value.s.arr->data, 
-	 sizeof(fc2Property));
+  if (kw.delay_there)
+    strobe.delay = kw.delay;
+  if (kw.duration_there)
+    strobe.duration = kw.duration;
+  if (kw.onoff_there)
+    strobe.onOff = (kw.onoff != 0);
+  if (kw.polarity_there)
+    strobe.polarity = (unsigned int) kw.polarity;
 
-  error = fc2SetProperty(context, &property);
+  error = kw.broadcast ?
+    fc2SetStrobeBroadcast(context, &strobe) :
+    fc2SetStrobe(context, &strobe);
   if (error)
     IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
-			 "Could not set requested property",
+			 "Could not set strobe",
 			 error);
 }
 
+//
+// idlpgr_MeasureLatency
+//
+// Measure the latency from the start of exposure of each frame to
+// its delivery to IDL.  Measurements accumulate in the LATENCY
+// histogram of idlpgr_Stats.  Measuring latency enables the
+// embedded time stamp.
+// argv[0]: context
+// argv[1]: 1: measure latency (default), 0: stop measuring.
+//
+void IDL_CDECL idlpgr_MeasureLatency(int argc, IDL_VPTR argv[])
+{
+  fc2Error error;
+  fc2Context context;
+  idlpgr_camera *camera;
+  fc2EmbeddedImageInfo info;
+  int on;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  on = (argc == 2) ? (IDL_LongScalar(argv[1]) != 0) : 1;
+
+  camera = idlpgr_Camera(context);
+  if (on && !camera->embedded.timestamp.onOff) {
+    error = fc2GetEmbeddedImageInfo(context, &info);
+    if (!error && !info.timestamp.available)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			   "Camera cannot embed time stamps.");
+    if (!error) {
+      info.timestamp.onOff = TRUE;
+      error = fc2SetEmbeddedImageInfo(context, &info);
+    }
+    if (error)
+      IDL_MessageFromBlock(msgs, M_IDLPGR_ERRORCODE, IDL_MSG_LONGJMP,
+			   "Could not embed time stamps",
+			   error);
+    idlpgr_CacheEmbeddedImageInfo(camera);
+  }
+
+  camera->measurelatency = on;
+  camera->latency = -1.;
+}
+
+//
+// idlpgr_Latency
+//
+// Returns the latency [s] of the last frame delivered to IDL,
+// or -1 if it was not measured.
+// argv[0]: context
+//
+IDL_VPTR IDL_CDECL idlpgr_Latency(int argc, IDL_VPTR argv[])
+{
+  fc2Context context;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  return IDL_GettmpDouble(idlpgr_Camera(context)->latency);
+}
+
+//
+// Background
+//
+// Every frame retrieved from a camera whose background is being
+// estimated updates a running mean and an approximate running
+// median of each pixel.  The estimates are updated by the thread
+// that retrieves the frames, so frames that IDL never reads still
+// contribute.  Frames can then be returned normalized as
+// (I - dark) / (B - dark), where B is either estimate.
+//
+
+//
+// idlpgr_StartBackground
+//
+// Start estimating the background of frames from a camera,
+// discarding previous estimates.  The dark frame is kept.
+// argv[0]: context
+// WEIGHT: weight of each new frame, so that the estimates follow
+//     roughly the last 1/WEIGHT frames.  Frames are averaged
+//     equally until that many have arrived.  0: average all frames.
+//     Default: 0.01.
+// THREADS: number of threads.  Default: one per processor.
+//
+void IDL_CDECL idlpgr_StartBackground(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Context context;
+  idlpgr_camera *camera;
+  idlpgr_background *background;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG threads;
+    int weight_there;
+    float weight;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "THREADS", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(threads) },
+    { "WEIGHT", IDL_TYP_FLOAT, 1, 0,
+      (int *) IDL_KW_OFFSETOF(weight_there), IDL_KW_OFFSETOF(weight) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  if (!kw.weight_there)
+    kw.weight = 0.01;
+  if (kw.weight < 0. || kw.weight > 1.)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "WEIGHT must be between 0 and 1.");
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+  camera = idlpgr_Camera(context);
+
+  pthread_mutex_lock(&camera->lock);
+  if (!(background = camera->background))
+    background = camera->background =
+      idlpgr_BackgroundCreate(kw.weight, (int) kw.threads);
+  if (background) {
+    background->weight = kw.weight;
+    background->nthreads = (int) kw.threads;
+    idlpgr_BackgroundReset(background);
+  }
+  pthread_mutex_unlock(&camera->lock);
+  if (!background)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not allocate background.");
+}
+
+//
+// idlpgr_StopBackground
+//
+// Stop estimating the background and discard the estimates
+// and the dark frame.
+// argv[0]: context
+//
+void IDL_CDECL idlpgr_StopBackground(int argc, IDL_VPTR argv[])
+{
+  fc2Context context;
+  idlpgr_camera *camera;
+  idlpgr_background *background;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  camera = idlpgr_FindCamera(context);
+  if (camera && camera->background) {
+    pthread_mutex_lock(&camera->lock);
+    background = camera->background;
+    camera->background = NULL;
+    pthread_mutex_unlock(&camera->lock);
+    idlpgr_BackgroundFree(background);
+  }
+}
+
+//
+// idlpgr_SetDark
+//
+// Set the dark level that is subtracted from frames and background
+// before normalization.
+// argv[0]: context
+// argv[1]: dark frame [w, h] of the same geometry as the frames,
+//     or a scalar dark level.
+//
+void IDL_CDECL idlpgr_SetDark(int argc, IDL_VPTR argv[])
+{
+  fc2Context context;
+  idlpgr_camera *camera;
+  IDL_VPTR idl_dark;
+  IDL_ARRAY *arr;
+  float level;
+  int status;
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  camera = idlpgr_FindCamera(context);
+  if (!camera || !camera->background)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Background is not being estimated.");
+
+  IDL_ENSURE_SIMPLE(argv[1]);
+  if (!(argv[1]->flags & IDL_V_ARR)) {
+    level = (float) IDL_DoubleScalar(argv[1]);
+    pthread_mutex_lock(&camera->lock);
+    idlpgr_BackgroundSetDark(camera->background, NULL, 0, 0, level);
+    pthread_mutex_unlock(&camera->lock);
+    return;
+  }
+
+  arr = argv[1]->value.arr;
+  if (arr->n_dim != 2)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Dark frame must be a two-dimensional array.");
+  idl_dark = IDL_BasicTypeConversion(1, &argv[1], IDL_TYP_FLOAT);
+  pthread_mutex_lock(&camera->lock);
+  status = idlpgr_BackgroundSetDark(camera->background,
+				    (float *) idl_dark->value.arr->data,
+				    (unsigned int) arr->dim[1],
+				    (unsigned int) arr->dim[0], 0.);
+  pthread_mutex_unlock(&camera->lock);
+  if (idl_dark != argv[1])
+    IDL_Deltmp(idl_dark);
+  if (status)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not allocate dark frame.");
+}
+
+//
+// idlpgr_FreeEstimate
+//
+// Called by IDL when a copy of the background estimates is freed
+//
+static void idlpgr_FreeEstimate(UCHAR *data)
+{
+  free(data);
+}
+
+//
+// idlpgr_GetBackground
+//
+// Returns the background estimated for a camera as FLOAT[w, h].
+// argv[0]: context
+// MEDIAN: If set, return the running median.
+//     Default: the running mean.
+// NFRAMES: optional output: number of frames in the estimate.
+//
+IDL_VPTR IDL_CDECL idlpgr_GetBackground(int argc, IDL_VPTR argv[], char *argk)
+{
+  fc2Context context;
+  idlpgr_camera *camera;
+  unsigned int rows = 0, cols = 0;
+  unsigned long long nframes = 0;
+  IDL_MEMINT dim[2];
+  float *estimate = NULL;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG median;
+    IDL_VPTR nframes;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "MEDIAN", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(median) },
+    { "NFRAMES", IDL_TYP_UNDEF, 1, IDL_KW_OUT | IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(nframes) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+
+  context = (fc2Context) IDL_ULong64Scalar(argv[0]);
+
+  // the estimates are copied while the grabber cannot update them
+  camera = idlpgr_FindCamera(context);
+  if (camera)
+    estimate = idlpgr_BackgroundEstimate(camera, (int) kw.median,
+					 &rows, &cols, &nframes);
+  if (kw.nframes)
+    IDL_VarCopy(IDL_GettmpULong64(nframes), kw.nframes);
+  IDL_KW_FREE;
+  if (!nframes)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Background has not been estimated.");
+  if (!estimate)
+    IDL_MessageFromBlock(msgs, M_IDLPGR_ERROR, IDL_MSG_LONGJMP,
+			 "Could not allocate background.");
+
+  dim[0] = cols;
+  dim[1] = rows;
+  return IDL_ImportArray(2, dim, IDL_TYP_FLOAT, (UCHAR *) estimate,
+			 idlpgr_FreeEstimate, NULL);
+}
+
+//
+// idlpgr_NormalizeImage
+//
+// Returns the frame in an image normalized by the background
+// of the camera that delivered it, as FLOAT[w, h].
+// argv[0]: image
+// MEDIAN: If set, normalize by the running median.
+//     Default: the running mean.
+//
+IDL_VPTR IDL_CDECL idlpgr_NormalizeImage(int argc, IDL_VPTR argv[],
+					 char *argk)
+{
+  fc2Image *image;
+
+  typedef struct {
+    IDL_KW_RESULT_FIRST_FIELD;
+    IDL_LONG median;
+  } KW_RESULT;
+  static IDL_KW_PAR kw_pars[] = {
+    IDL_KW_FAST_SCAN,
+    { "MEDIAN", IDL_TYP_LONG, 1, IDL_KW_ZERO,
+      0, IDL_KW_OFFSETOF(median) },
+    { NULL }
+  };
+  KW_RESULT kw;
+
+  argc = IDL_KWProcessByOffset(argc, argv, argk, kw_pars,
+			       (IDL_VPTR *) 0, 1, &kw);
+  IDL_KW_FREE;
+
+  image = (fc2Image *) IDL_ULong64Scalar(argv[0]);
+
+  return idlpgr_NormalizedImage(idlpgr_ImageCamera(image), image,
+				kw.median ? 2 : 1);
+}
+
 //
 // IDL_Load
 //
@@ -565,11 +4242,75 @@ int IDL_Load (void)
     { idlpgr_GetNumOfCameras,    "IDLPGR_GETNUMOFCAMERAS",    1, 1, 0, 0 },
     { idlpgr_GetCameraFromIndex, "IDLPGR_GETCAMERAFROMINDEX", 1, 2, 0, 0 },
     { idlpgr_GetCameraInfo,      "IDLPGR_GETCAMERAINFO",      1, 1, 0, 0 },
-    { idlpgr_CreateImage,        "IDLPGR_CREATEIMAGE",        0, 0, 0, 0 },
+    { idlpgr_CreateImage,        "IDLPGR_CREATEIMAGE",        0, 1, 0, 0 },
     { idlpgr_AllocateImage,      "IDLPGR_ALLOCATEIMAGE",      1, 1, 0, 0 },
+    { idlpgr_GetImageInfo,       "IDLPGR_GETIMAGEINFO",       1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_Demosaic,           "IDLPGR_DEMOSAIC",           1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_AcquireImage,       "IDLPGR_ACQUIREIMAGE",       1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_LatestFrame,        "IDLPGR_LATESTFRAME",        1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_ReadFrames,         "IDLPGR_READFRAMES",         3, 3,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_AccumulateFrames,   "IDLPGR_ACCUMULATEFRAMES",   3, 3,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
     { idlpgr_ReadRegister,       "IDLPGR_READREGISTER",       2, 2, 0, 0 },
     { idlpgr_GetPropertyInfo,    "IDLPGR_GETPROPERTYINFO",    2, 2, 0, 0 },
     { idlpgr_GetProperty,        "IDLPGR_GETPROPERTY",        2, 2, 0, 0 },
+    { idlpgr_GetProperties,      "IDLPGR_GETPROPERTIES",      2, 2, 0, 0 },
+    { idlpgr_GetEmbeddedImageInfo, "IDLPGR_GETEMBEDDEDIMAGEINFO", 1, 1, 0, 0 },
+    { idlpgr_GetConfiguration,   "IDLPGR_GETCONFIGURATION",   1, 1, 0, 0 },
+    { idlpgr_RecordingStatus,    "IDLPGR_RECORDINGSTATUS",    1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_OpenRecording,      "IDLPGR_OPENRECORDING",      1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { idlpgr_RecordingInfo,      "IDLPGR_RECORDINGINFO",      1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_ReadRecording,      "IDLPGR_READRECORDING",      2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StartSyncCapture,   "IDLPGR_STARTSYNCCAPTURE",   1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_ReadSyncFrames,     "IDLPGR_READSYNCFRAMES",     1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_Stats,              "IDLPGR_STATS",              1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_GetFormat7Info,     "IDLPGR_GETFORMAT7INFO",     2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_ValidateFormat7Settings, "IDLPGR_VALIDATEFORMAT7SETTINGS", 2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_GetFormat7Configuration, "IDLPGR_GETFORMAT7CONFIGURATION", 1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { idlpgr_AllocateFormat7Image, "IDLPGR_ALLOCATEFORMAT7IMAGE", 1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_TunePacketSize,     "IDLPGR_TUNEPACKETSIZE",     1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { idlpgr_GetTriggerMode,     "IDLPGR_GETTRIGGERMODE",     1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_TriggerAndRead,     "IDLPGR_TRIGGERANDREAD",     4, 4,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { idlpgr_GetTriggerModeInfo, "IDLPGR_GETTRIGGERMODEINFO", 1, 1, 0, 0 },
+    { idlpgr_GetTriggerDelay,    "IDLPGR_GETTRIGGERDELAY",    1, 1, 0, 0 },
+    { idlpgr_GetStrobeInfo,      "IDLPGR_GETSTROBEINFO",      2, 2, 0, 0 },
+    { idlpgr_GetStrobe,          "IDLPGR_GETSTROBE",          2, 2, 0, 0 },
+    { idlpgr_Latency,            "IDLPGR_LATENCY",            1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_GetBackground,      "IDLPGR_GETBACKGROUND",      1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_NormalizeImage,     "IDLPGR_NORMALIZEIMAGE",     1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
   };
 
   static IDL_SYSFUN_DEF2 procedure_addr[] = {
@@ -581,18 +4322,71 @@ int IDL_Load (void)
       idlpgr_StartCapture,   "IDLPGR_STARTCAPTURE",   1, 1, 0, 0 },
     { (IDL_SYSRTN_GENERIC)
       idlpgr_StopCapture,    "IDLPGR_STOPCAPTURE",    1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StartCaptureCallback, "IDLPGR_STARTCAPTURECALLBACK", 1, 1, 0, 0 },
     { (IDL_SYSRTN_GENERIC)
       idlpgr_DestroyImage,   "IDLPGR_DESTROYIMAGE",   1, 1, 0, 0 },
     { (IDL_SYSRTN_GENERIC)
-      idlpgr_RetrieveBuffer, "IDLPGR_RETRIEVEBUFFER", 2, 2, 0, 0 },
+      idlpgr_RetrieveBuffer, "IDLPGR_RETRIEVEBUFFER", 2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StartGrabber,   "IDLPGR_STARTGRABBER",   1, 2, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StopGrabber,    "IDLPGR_STOPGRABBER",    1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StopSyncCapture, "IDLPGR_STOPSYNCCAPTURE", 1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StartRecording, "IDLPGR_STARTRECORDING", 2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
     { (IDL_SYSRTN_GENERIC)
-      idlpgr_GetImage,       "IDLPGR_GETIMAGE",       2, 2, 0, 0 },
+      idlpgr_StopRecording,  "IDLPGR_STOPRECORDING",  1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_CloseRecording, "IDLPGR_CLOSERECORDING", 1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_GetImage,       "IDLPGR_GETIMAGE",       2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetUserBuffers, "IDLPGR_SETUSERBUFFERS", 3, 3, 0, 0 },
     { (IDL_SYSRTN_GENERIC)
       idlpgr_WriteRegister,  "IDLPGR_WRITEREGISTER",  3, 3, 0, 0 },
     { (IDL_SYSRTN_GENERIC)
       idlpgr_SetProperty,    "IDLPGR_SETPROPERTY",    2, 2, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetProperties,  "IDLPGR_SETPROPERTIES",  2, 2, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetEmbeddedImageInfo, "IDLPGR_SETEMBEDDEDIMAGEINFO", 1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetConfiguration, "IDLPGR_SETCONFIGURATION", 1, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetFormat7Configuration, "IDLPGR_SETFORMAT7CONFIGURATION", 2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetTriggerMode, "IDLPGR_SETTRIGGERMODE", 1, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_FireSoftwareTrigger, "IDLPGR_FIRESOFTWARETRIGGER", 1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetTriggerDelay, "IDLPGR_SETTRIGGERDELAY", 2, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetStrobe,      "IDLPGR_SETSTROBE",      1, 2,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_MeasureLatency, "IDLPGR_MEASURELATENCY", 1, 2, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StartBackground, "IDLPGR_STARTBACKGROUND", 1, 1,
+      IDL_SYSFUN_DEF_F_KEYWORDS, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_StopBackground, "IDLPGR_STOPBACKGROUND", 1, 1, 0, 0 },
+    { (IDL_SYSRTN_GENERIC)
+      idlpgr_SetDark,        "IDLPGR_SETDARK",        2, 2, 0, 0 },
   };
 
+  idlpgr_SelectAllKernels();
+
   nmsgs = IDL_CARRAY_ELTS(msg_arr);
   msgs = IDL_MessageDefineBlock("idlpgr", nmsgs, msg_arr);
   if (!msgs)
@@ -0,0 +1,446 @@
+//
+// idlpgr_accumulate.c
+//
+// Accumulation of frames for idlpgr.
+//
+// Sums are kept in 32-bit integers, which are exact, or in floats,
+// which cannot overflow.  The variance of each pixel is accumulated
+// with Welford's update,
+//
+//   d = x - mean,  mean += d/n,  m2 += d (x - mean),
+//
+// which does not lose precision to the cancellation of large sums
+// of squares, as the variance of a bright pixel usually is small
+// compared with the square of its mean.
+//
+// The bands of rows of each frame are processed by the persistent
+// worker threads of idlpgr_pool.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Persistent worker threads.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdlib.h>
+#include <string.h>
+
+#include "idlpgr_accumulate.h"
+#include "idlpgr_pool.h"
+#include "idlpgr_simd.h"
+
+#ifdef IDLPGR_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*idlpgr_sum_fn)(const void *src, unsigned int n, void *sum);
+typedef void (*idlpgr_welford_fn)(const void *src, unsigned int n,
+				  float *mean, float *m2, float inv);
+
+static void idlpgr_SumRow8Scalar(const void *src, unsigned int n, void *sum)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  unsigned int *s = (unsigned int *) sum;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    s[i] += p[i];
+}
+
+static void idlpgr_SumRow16Scalar(const void *src, unsigned int n, void *sum)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  unsigned int *s = (unsigned int *) sum;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    s[i] += p[i];
+}
+
+static void idlpgr_SumRow8FloatScalar(const void *src, unsigned int n,
+				      void *sum)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  float *s = (float *) sum;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    s[i] += (float) p[i];
+}
+
+static void idlpgr_SumRow16FloatScalar(const void *src, unsigned int n,
+				       void *sum)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  float *s = (float *) sum;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    s[i] += (float) p[i];
+}
+
+static inline void idlpgr_WelfordPixel(float x, float *mean, float *m2,
+				       float inv)
+{
+  float d = x - *mean;
+
+  *mean += d * inv;
+  *m2 += d * (x - *mean);
+}
+
+static void idlpgr_WelfordRow8Scalar(const void *src, unsigned int n,
+				     float *mean, float *m2, float inv)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    idlpgr_WelfordPixel((float) p[i], &mean[i], &m2[i], inv);
+}
+
+static void idlpgr_WelfordRow16Scalar(const void *src, unsigned int n,
+				      float *mean, float *m2, float inv)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    idlpgr_WelfordPixel((float) p[i], &mean[i], &m2[i], inv);
+}
+
+#ifdef IDLPGR_X86
+
+//
+// 8 elements per iteration.  Floating-point operations are those
+// of the scalar kernels, in the same order and without fused
+// multiply-add, so that the results do not depend on the CPU.
+//
+__attribute__((target("avx2")))
+static inline __m256i idlpgr_Widen8(const unsigned char *p)
+{
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) p));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i idlpgr_Widen16(const unsigned short *p)
+{
+  return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) p));
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_SumRow8AVX2(const void *src, unsigned int n, void *sum)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  unsigned int *s = (unsigned int *) sum;
+  __m256i *ps;
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    ps = (__m256i *) (s + i);
+    _mm256_storeu_si256(ps, _mm256_add_epi32(_mm256_loadu_si256(ps),
+					     idlpgr_Widen8(p + i)));
+  }
+  for (; i < n; i++)
+    s[i] += p[i];
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_SumRow16AVX2(const void *src, unsigned int n, void *sum)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  unsigned int *s = (unsigned int *) sum;
+  __m256i *ps;
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    ps = (__m256i *) (s + i);
+    _mm256_storeu_si256(ps, _mm256_add_epi32(_mm256_loadu_si256(ps),
+					     idlpgr_Widen16(p + i)));
+  }
+  for (; i < n; i++)
+    s[i] += p[i];
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_SumRow8FloatAVX2(const void *src, unsigned int n,
+				    void *sum)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  float *s = (float *) sum;
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(s + i,
+		     _mm256_add_ps(_mm256_loadu_ps(s + i),
+				   _mm256_cvtepi32_ps(idlpgr_Widen8(p + i))));
+  for (; i < n; i++)
+    s[i] += (float) p[i];
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_SumRow16FloatAVX2(const void *src, unsigned int n,
+				     void *sum)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  float *s = (float *) sum;
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(s + i,
+		     _mm256_add_ps(_mm256_loadu_ps(s + i),
+				   _mm256_cvtepi32_ps(idlpgr_Widen16(p + i))));
+  for (; i < n; i++)
+    s[i] += (float) p[i];
+}
+
+__attribute__((target("avx2")))
+static inline void idlpgr_WelfordAVX2(__m256 x, float *mean, float *m2,
+				      __m256 inv)
+{
+  __m256 m, d;
+
+  m = _mm256_loadu_ps(mean);
+  d = _mm256_sub_ps(x, m);
+  m = _mm256_add_ps(m, _mm256_mul_ps(d, inv));
+  _mm256_storeu_ps(mean, m);
+  _mm256_storeu_ps(m2, _mm256_add_ps(_mm256_loadu_ps(m2),
+				     _mm256_mul_ps(d, _mm256_sub_ps(x, m))));
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_WelfordRow8AVX2(const void *src, unsigned int n,
+				   float *mean, float *m2, float inv)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  const __m256 vinv = _mm256_set1_ps(inv);
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    idlpgr_WelfordAVX2(_mm256_cvtepi32_ps(idlpgr_Widen8(p + i)),
+		       mean + i, m2 + i, vinv);
+  for (; i < n; i++)
+    idlpgr_WelfordPixel((float) p[i], &mean[i], &m2[i], inv);
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_WelfordRow16AVX2(const void *src, unsigned int n,
+				    float *mean, float *m2, float inv)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  const __m256 vinv = _mm256_set1_ps(inv);
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    idlpgr_WelfordAVX2(_mm256_cvtepi32_ps(idlpgr_Widen16(p + i)),
+		       mean + i, m2 + i, vinv);
+  for (; i < n; i++)
+    idlpgr_WelfordPixel((float) p[i], &mean[i], &m2[i], inv);
+}
+
+#endif
+
+static idlpgr_sum_fn idlpgr_SumRow8 = idlpgr_SumRow8Scalar;
+static idlpgr_sum_fn idlpgr_SumRow16 = idlpgr_SumRow16Scalar;
+static idlpgr_sum_fn idlpgr_SumRow8Float = idlpgr_SumRow8FloatScalar;
+static idlpgr_sum_fn idlpgr_SumRow16Float = idlpgr_SumRow16FloatScalar;
+static idlpgr_welford_fn idlpgr_WelfordRow8 = idlpgr_WelfordRow8Scalar;
+static idlpgr_welford_fn idlpgr_WelfordRow16 = idlpgr_WelfordRow16Scalar;
+
+//
+// Frame processed in bands of rows by the worker threads
+//
+typedef struct idlpgr_accband {
+  idlpgr_accumulator *accumulator;
+  const unsigned char *data;
+  size_t stride;
+  float inv;                   // 1 / number of frames
+} idlpgr_accband;
+
+static void idlpgr_AccumulateBand(void *arg, unsigned int row0,
+				  unsigned int row1)
+{
+  idlpgr_accband *band = (idlpgr_accband *) arg;
+  idlpgr_accumulator *acc = band->accumulator;
+  idlpgr_sum_fn sumrow;
+  idlpgr_welford_fn welfordrow;
+  const unsigned char *src;
+  size_t offset;
+  unsigned int y;
+
+  if (acc->depth == 1) {
+    sumrow = acc->isfloat ? idlpgr_SumRow8Float : idlpgr_SumRow8;
+    welfordrow = idlpgr_WelfordRow8;
+  } else {
+    sumrow = acc->isfloat ? idlpgr_SumRow16Float : idlpgr_SumRow16;
+    welfordrow = idlpgr_WelfordRow16;
+  }
+
+  for (y = row0; y < row1; y++) {
+    src = band->data + y * band->stride;
+    offset = (size_t) y * acc->cols;
+    sumrow(src, acc->cols, (unsigned int *) acc->sum + offset);
+    if (acc->variance)
+      welfordrow(src, acc->cols, acc->mean + offset, acc->m2 + offset,
+		 band->inv);
+  }
+}
+
+idlpgr_accumulator *idlpgr_AccumulatorCreate(int nthreads)
+{
+  idlpgr_accumulator *accumulator;
+
+  accumulator = (idlpgr_accumulator *) calloc(1, sizeof(idlpgr_accumulator));
+  if (accumulator)
+    accumulator->nthreads = nthreads;
+
+  return accumulator;
+}
+
+void idlpgr_AccumulatorFree(idlpgr_accumulator *accumulator)
+{
+  if (!accumulator)
+    return;
+  idlpgr_PoolFree(accumulator->pool);
+  free(accumulator->sum);
+  free(accumulator->mean);
+  free(accumulator->m2);
+  free(accumulator->scratch);
+  free(accumulator);
+}
+
+unsigned int idlpgr_AccumulatorMaxFrames(unsigned int depth)
+{
+  return 0xFFFFFFFFU / ((depth == 1) ? 0xFFU : 0xFFFFU);
+}
+
+static void *idlpgr_AccumulatorAlloc(size_t n)
+{
+  void *p;
+
+  return posix_memalign(&p, 64, n * sizeof(float)) ? NULL : p;
+}
+
+int idlpgr_AccumulatorStart(idlpgr_accumulator *accumulator,
+			    unsigned int rows, unsigned int cols,
+			    unsigned int depth,
+			    int isfloat, int variance)
+{
+  size_t npixels = (size_t) rows * cols;
+
+  if ((depth != 1 && depth != 2) || !npixels)
+    return -1;
+
+  // buffers are kept from one integration to the next
+  if (npixels > accumulator->capacity) {
+    free(accumulator->sum);
+    free(accumulator->mean);
+    free(accumulator->m2);
+    accumulator->mean = accumulator->m2 = NULL;
+    accumulator->capacity = 0;
+    if (!(accumulator->sum = idlpgr_AccumulatorAlloc(npixels)))
+      return -1;
+    accumulator->capacity = npixels;
+  }
+  if (variance && !accumulator->mean) {
+    accumulator->mean = (float *) idlpgr_AccumulatorAlloc(accumulator->capacity);
+    accumulator->m2 = (float *) idlpgr_AccumulatorAlloc(accumulator->capacity);
+    if (!accumulator->mean || !accumulator->m2) {
+      free(accumulator->mean);
+      free(accumulator->m2);
+      accumulator->mean = accumulator->m2 = NULL;
+      return -1;
+    }
+  }
+
+  accumulator->rows = rows;
+  accumulator->cols = cols;
+  accumulator->depth = depth;
+  accumulator->isfloat = isfloat;
+  accumulator->variance = variance;
+  accumulator->nframes = 0;
+  memset(accumulator->sum, 0, npixels * sizeof(float));
+  if (variance) {
+    memset(accumulator->mean, 0, npixels * sizeof(float));
+    memset(accumulator->m2, 0, npixels * sizeof(float));
+  }
+
+  return 0;
+}
+
+int idlpgr_AccumulatorAdd(idlpgr_accumulator *accumulator,
+			  const void *data, size_t stride)
+{
+  idlpgr_accband band;
+
+  if (!accumulator->isfloat &&
+      accumulator->nframes >= idlpgr_AccumulatorMaxFrames(accumulator->depth))
+    return -1;
+
+  accumulator->nframes++;
+  band.accumulator = accumulator;
+  band.data = (const unsigned char *) data;
+  band.stride = stride;
+  band.inv = 1.f / (float) accumulator->nframes;
+  idlpgr_PoolRun(&accumulator->pool, accumulator->nthreads,
+		 accumulator->rows, idlpgr_AccumulateBand, &band);
+
+  return 0;
+}
+
+void idlpgr_AccumulatorAverage(const idlpgr_accumulator *accumulator,
+			       float *dest)
+{
+  size_t i, npixels = (size_t) accumulator->rows * accumulator->cols;
+  float inv = accumulator->nframes ? 1.f / (float) accumulator->nframes : 0.f;
+  const unsigned int *isum = (const unsigned int *) accumulator->sum;
+  const float *fsum = (const float *) accumulator->sum;
+
+  if (accumulator->isfloat)
+    for (i = 0; i < npixels; i++)
+      dest[i] = fsum[i] * inv;
+  else
+    for (i = 0; i < npixels; i++)
+      dest[i] = (float) isum[i] * inv;
+}
+
+void idlpgr_AccumulatorVariance(const idlpgr_accumulator *accumulator,
+				float *dest)
+{
+  size_t i, npixels = (size_t) accumulator->rows * accumulator->cols;
+  float inv;
+
+  if (!accumulator->variance || accumulator->nframes < 2) {
+    memset(dest, 0, npixels * sizeof(float));
+    return;
+  }
+
+  inv = 1.f / (float) (accumulator->nframes - 1);
+  for (i = 0; i < npixels; i++)
+    dest[i] = accumulator->m2[i] * inv;
+}
+
+//
+// idlpgr_SelectAccumulateKernels
+//
+const char *idlpgr_SelectAccumulateKernels(void)
+{
+#ifdef IDLPGR_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    idlpgr_SumRow8 = idlpgr_SumRow8AVX2;
+    idlpgr_SumRow16 = idlpgr_SumRow16AVX2;
+    idlpgr_SumRow8Float = idlpgr_SumRow8FloatAVX2;
+    idlpgr_SumRow16Float = idlpgr_SumRow16FloatAVX2;
+    idlpgr_WelfordRow8 = idlpgr_WelfordRow8AVX2;
+    idlpgr_WelfordRow16 = idlpgr_WelfordRow16AVX2;
+    return "avx2";
+  }
+#endif
+  idlpgr_SumRow8 = idlpgr_SumRow8Scalar;
+  idlpgr_SumRow16 = idlpgr_SumRow16Scalar;
+  idlpgr_SumRow8Float = idlpgr_SumRow8FloatScalar;
+  idlpgr_SumRow16Float = idlpgr_SumRow16FloatScalar;
+  idlpgr_WelfordRow8 = idlpgr_WelfordRow8Scalar;
+  idlpgr_WelfordRow16 = idlpgr_WelfordRow16Scalar;
+  return "scalar";
+}
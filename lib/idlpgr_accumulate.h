@@ -0,0 +1,81 @@
+//
+// idlpgr_accumulate.h
+//
+// Accumulation of consecutive frames into per-pixel sums, with
+// optional per-pixel variance, so that only the result of a long
+// integration needs to be transferred.  The kernels operate on
+// 8-bit and 16-bit pixel data and do not depend on IDL.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Persistent worker threads.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_ACCUMULATE_H
+#define IDLPGR_ACCUMULATE_H
+
+#include <stddef.h>
+
+typedef struct idlpgr_accumulator {
+  int nthreads;                // <= 0: one per processor
+  int isfloat;                 // sums are floats, not 32-bit integers
+  int variance;                // variance is accumulated
+  unsigned int rows;
+  unsigned int cols;           // elements per row
+  unsigned int depth;          // bytes per element: 1 or 2
+  unsigned int nframes;        // frames added since the start
+  void *sum;                   // unsigned int or float [rows * cols]
+  float *mean;                 // running mean, if variance is set
+  float *m2;                   // sum of squared deviations from the mean
+  size_t capacity;             // elements allocated
+  unsigned char *scratch;      // frames that must be unpacked first
+  size_t scratchsize;
+  struct idlpgr_pool *pool;    // worker threads, started with the
+                               // first frame that needs them
+} idlpgr_accumulator;
+
+idlpgr_accumulator *idlpgr_AccumulatorCreate(int nthreads);
+void idlpgr_AccumulatorFree(idlpgr_accumulator *accumulator);
+
+//
+// Largest number of frames of depth bytes whose sum cannot
+// overflow a 32-bit integer
+//
+unsigned int idlpgr_AccumulatorMaxFrames(unsigned int depth);
+
+//
+// Clear the sums for frames of rows x cols elements of depth
+// bytes.  Returns 0 on success, or -1 if depth is not supported
+// or memory could not be allocated.
+//
+int idlpgr_AccumulatorStart(idlpgr_accumulator *accumulator,
+			    unsigned int rows, unsigned int cols,
+			    unsigned int depth,
+			    int isfloat, int variance);
+
+//
+// Add a frame with the geometry given to idlpgr_AccumulatorStart
+// and the specified row stride in bytes.  Returns 0 on success,
+// or -1 if integer sums could overflow.
+//
+int idlpgr_AccumulatorAdd(idlpgr_accumulator *accumulator,
+			  const void *data, size_t stride);
+
+//
+// Mean of the frames added, and unbiased per-pixel variance,
+// rows x cols floats at dest.  The variance requires variance
+// to have been set at the start, and is 0 for a single frame.
+//
+void idlpgr_AccumulatorAverage(const idlpgr_accumulator *accumulator,
+			       float *dest);
+void idlpgr_AccumulatorVariance(const idlpgr_accumulator *accumulator,
+				float *dest);
+
+//
+// Choose the fastest kernels supported by the host CPU.
+// Returns the name of the selected instruction set.
+//
+const char *idlpgr_SelectAccumulateKernels(void);
+
+#endif
@@ -0,0 +1,351 @@
+//
+// idlpgr_api.c
+//
+// Stable C interface to the idlpgr acquisition engine.
+// See idlpgr_api.h.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Structures are filled up to the caller's size.
+// 10/16/2026 DGG Kernels are selected when a device is opened.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdlib.h>
+#include <string.h>
+
+#include "idlpgr_api.h"
+#include "idlpgr_core.h"
+
+struct idlpgr_device {
+  fc2Context context;
+  fc2Image *image;             // pooled handle that receives frames
+  int pending;                 // image holds a frame not yet transferred
+  fc2Error status;             // status of the pending frame
+  int running;
+};
+
+//
+// Copy no more of src than the caller's structure at dest holds,
+// and record in its structsize how many bytes were filled.
+// Every structure filled here begins with structsize.
+//
+static void idlpgr_StructCopy(void *dest, const void *src, size_t size)
+{
+  size_t structsize;
+
+  memcpy(&structsize, dest, sizeof(size_t));
+  if (structsize < sizeof(size_t))
+    return;
+  if (structsize > size)
+    structsize = size;
+  memcpy(dest, src, structsize);
+  memcpy(dest, &structsize, sizeof(size_t));
+}
+
+int idlpgr_APIVersion(void)
+{
+  return IDLPGR_API_VERSION;
+}
+
+const char *idlpgr_ErrorString(int error)
+{
+  if (error == IDLPGR_ERROR_INCOMPLETE)
+    return "Frame is incomplete.";
+
+  return fc2ErrorToDescription((fc2Error) error);
+}
+
+void idlpgr_Kernels(idlpgr_kernels *result)
+{
+  const idlpgr_kernelnames *names = idlpgr_SelectAllKernels();
+  idlpgr_kernels kernels;
+
+  memset(&kernels, 0, sizeof(idlpgr_kernels));
+  kernels.unpack = names->unpack;
+  kernels.demosaic = names->demosaic;
+  kernels.background = names->background;
+  kernels.accumulate = names->accumulate;
+  idlpgr_StructCopy(result, &kernels, sizeof(idlpgr_kernels));
+}
+
+int idlpgr_DeviceCount(unsigned int *ncameras)
+{
+  fc2Context context;
+  fc2Error error;
+
+  if ((error = fc2CreateContext(&context)))
+    return error;
+  error = fc2GetNumOfCameras(context, ncameras);
+  fc2DestroyContext(context);
+
+  return error;
+}
+
+int idlpgr_DeviceOpen(unsigned int index, idlpgr_device **pdevice)
+{
+  idlpgr_device *device;
+  fc2PGRGuid guid;
+  fc2Error error;
+
+  idlpgr_SelectAllKernels();
+  device = (idlpgr_device *) calloc(1, sizeof(idlpgr_device));
+  if (!device)
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  if ((error = fc2CreateContext(&device->context))) {
+    free(device);
+    return error;
+  }
+
+  if (!(error = fc2GetCameraFromIndex(device->context, index, &guid)) &&
+      !(error = fc2Connect(device->context, &guid)) &&
+      !(error = idlpgr_CameraConnect(device->context)))
+    error = idlpgr_HandleCreate(device->context, &device->image);
+  if (error) {
+    idlpgr_CameraForget(device->context);
+    fc2DestroyContext(device->context);
+    free(device);
+    return error;
+  }
+
+  *pdevice = device;
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_DeviceClose(idlpgr_device *device)
+{
+  if (!device)
+    return;
+
+  idlpgr_DeviceStop(device);
+  idlpgr_CameraForget(device->context);
+  idlpgr_HandleDestroy(device->image);
+  fc2DestroyContext(device->context);
+  free(device);
+}
+
+void *idlpgr_DeviceContext(idlpgr_device *device)
+{
+  return device->context;
+}
+
+int idlpgr_DeviceSetROI(idlpgr_device *device,
+			unsigned int x, unsigned int y,
+			unsigned int width, unsigned int height)
+{
+  fc2Format7ImageSettings settings;
+  fc2Format7PacketInfo packetinfo;
+  unsigned int packetsize;
+  float percentage;
+  BOOL valid;
+  fc2Error error;
+
+  if (device->running)
+    return FC2_ERROR_ISOCH_ALREADY_STARTED;
+
+  error = fc2GetFormat7Configuration(device->context, &settings,
+				     &packetsize, &percentage);
+  if (error)
+    return error;
+  settings.offsetX = x;
+  settings.offsetY = y;
+  settings.width = width;
+  settings.height = height;
+
+  memset(&packetinfo, 0, sizeof(fc2Format7PacketInfo));
+  error = fc2ValidateFormat7Settings(device->context, &settings,
+				     &valid, &packetinfo);
+  if (error)
+    return error;
+  if (!valid)
+    return FC2_ERROR_INVALID_SETTINGS;
+
+  device->pending = FALSE;
+  return idlpgr_Format7Apply(device->context, &settings,
+			     packetinfo.recommendedBytesPerPacket);
+}
+
+int idlpgr_DeviceStart(idlpgr_device *device, unsigned int nbuffers)
+{
+  idlpgr_camera *camera;
+  fc2Error error;
+
+  if (device->running)
+    return FC2_ERROR_ISOCH_ALREADY_STARTED;
+  if (!(camera = idlpgr_CameraGet(device->context)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+
+  // settings may have been changed directly through the context
+  idlpgr_CacheEmbeddedImageInfo(camera);
+  idlpgr_CacheFrameSize(camera);
+  if (camera->framesize &&
+      (error = idlpgr_HandlesReserve(device->context, camera->framesize)))
+    return error;
+
+  if ((error = fc2StartCapture(device->context)))
+    return error;
+  if (nbuffers >= 2) {
+    error = idlpgr_GrabberStart(&camera->grabber, device->context,
+				nbuffers, idlpgr_GrabTimeout(camera),
+				&camera->stats, camera->framesize,
+				idlpgr_CameraFrame, camera);
+    if (error) {
+      camera->grabber = NULL;
+      fc2StopCapture(device->context);
+      return error;
+    }
+  }
+
+  device->pending = FALSE;
+  device->running = TRUE;
+  return FC2_ERROR_OK;
+}
+
+int idlpgr_DeviceStop(idlpgr_device *device)
+{
+  idlpgr_camera *camera;
+  fc2Error error;
+
+  if (!device->running)
+    return FC2_ERROR_OK;
+  device->running = FALSE;
+
+  // stopping capture releases a grabber waiting for a frame
+  error = fc2StopCapture(device->context);
+  camera = idlpgr_FindCamera(device->context);
+  if (camera && camera->grabber) {
+    idlpgr_GrabberStop(camera->grabber);
+    camera->grabber = NULL;
+  }
+
+  return error;
+}
+
+int idlpgr_DeviceRead(idlpgr_device *device,
+		      void *dest, size_t size,
+		      idlpgr_frameinfo *info,
+		      int newest)
+{
+  fc2Image *image = device->image;
+  idlpgr_camera *camera;
+  idlpgr_layout layout;
+  idlpgr_frameinfo frameinfo;
+  fc2Error error;
+
+  // a frame that did not fit is kept for the next call
+  if (!device->pending) {
+    error = idlpgr_Retrieve(device->context, image, newest);
+    if (error)
+      return error;
+    device->pending = TRUE;
+  }
+
+  idlpgr_ImageLayout(image, &layout);
+  if (info) {
+    memset(&frameinfo, 0, sizeof(idlpgr_frameinfo));
+    frameinfo.channels = layout.ndims == 3 ? (unsigned int) layout.dim[0] : 1;
+    frameinfo.width = (unsigned int) layout.dim[layout.ndims - 2];
+    frameinfo.height = (unsigned int) layout.dim[layout.ndims - 1];
+    frameinfo.depth = layout.depth;
+    frameinfo.issigned = layout.issigned;
+    frameinfo.size = layout.size;
+    frameinfo.timestamp =
+      idlpgr_TimeStampSeconds(fc2GetImageTimeStamp(image));
+    frameinfo.status = idlpgr_FrameStatus(FC2_ERROR_OK, image);
+    idlpgr_StructCopy(info, &frameinfo, sizeof(idlpgr_frameinfo));
+  }
+  if (!dest || size < layout.size)
+    return FC2_ERROR_BUFFER_TOO_SMALL;
+
+  camera = idlpgr_FindCamera(device->context);
+  idlpgr_TimedTransfer(&camera->stats, image, &layout, dest);
+  device->pending = FALSE;
+
+  return idlpgr_FrameStatus(FC2_ERROR_OK, image);
+}
+
+int idlpgr_DeviceGetProperty(idlpgr_device *device, int type, float *value)
+{
+  fc2Property property;
+  fc2Error error;
+
+  memset(&property, 0, sizeof(fc2Property));
+  property.type = (fc2PropertyType) type;
+  if ((error = fc2GetProperty(device->context, &property)))
+    return error;
+  *value = property.absValue;
+
+  return FC2_ERROR_OK;
+}
+
+int idlpgr_DeviceSetProperty(idlpgr_device *device, int type, float value)
+{
+  fc2Property property;
+  fc2Error error;
+
+  memset(&property, 0, sizeof(fc2Property));
+  property.type = (fc2PropertyType) type;
+  if ((error = fc2GetProperty(device->context, &property)))
+    return error;
+  property.onOff = TRUE;
+  property.autoManualMode = FALSE;
+  property.absControl = TRUE;
+  property.absValue = value;
+
+  return idlpgr_WriteProperty(device->context, &property);
+}
+
+//
+// Counters are read with relaxed atomic loads, because the grabber
+// thread updates them concurrently.
+//
+void idlpgr_DeviceStats(idlpgr_device *device, idlpgr_devicestats *result)
+{
+  idlpgr_camera *camera;
+  idlpgr_devicestats all, *stats = &all;
+  idlpgr_stats *s;
+  idlpgr_histogram *h;
+  idlpgr_timing *t;
+  int n;
+
+  memset(stats, 0, sizeof(idlpgr_devicestats));
+  if (!(camera = idlpgr_FindCamera(device->context))) {
+    idlpgr_StructCopy(result, stats, sizeof(idlpgr_devicestats));
+    return;
+  }
+  s = &camera->stats;
+
+#define IDLPGR_LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+  stats->elapsed = 1e-9 * (double) (idlpgr_Now() - s->start);
+  stats->retrieved = IDLPGR_LOAD(s->retrieved);
+  stats->delivered = IDLPGR_LOAD(s->delivered);
+  stats->overflows = IDLPGR_LOAD(s->overflows);
+  stats->skipped = IDLPGR_LOAD(s->skipped);
+  stats->gaps = IDLPGR_LOAD(s->gaps);
+  stats->errors = IDLPGR_LOAD(s->errors);
+  stats->timeouts = IDLPGR_LOAD(s->timeouts);
+  stats->inconsistent = IDLPGR_LOAD(s->inconsistent);
+  stats->incomplete = IDLPGR_LOAD(s->incomplete);
+  for (n = 0; n < IDLPGR_API_NSTAGES && n < IDLPGR_NSTAGES; n++) {
+    h = &s->stage[n];
+    t = &stats->stage[n];
+    t->count = IDLPGR_LOAD(h->count);
+    if (!t->count)
+      continue;
+    t->mean = 1e-9 * (double) IDLPGR_LOAD(h->total) / (double) t->count;
+    t->p50 = 1e-9 * idlpgr_HistogramPercentile(h, 0.5);
+    t->p99 = 1e-9 * idlpgr_HistogramPercentile(h, 0.99);
+    t->max = 1e-9 * (double) IDLPGR_LOAD(h->max);
+  }
+#undef IDLPGR_LOAD
+
+  idlpgr_StructCopy(result, stats, sizeof(idlpgr_devicestats));
+}
+
+void idlpgr_DeviceResetStats(idlpgr_device *device)
+{
+  idlpgr_camera *camera;
+
+  if ((camera = idlpgr_FindCamera(device->context)))
+    idlpgr_StatsReset(&camera->stats);
+}
@@ -0,0 +1,202 @@
+//
+// idlpgr_api.h
+//
+// Stable C interface to the idlpgr acquisition engine for native
+// programs, test harnesses and bindings from other languages.
+// Built into libidlpgr by `make core`, which exports only the
+// functions declared here.
+//
+// A device is a connected camera together with its capture state.
+// Functions that can fail return 0 on success, an fc2Error code
+// on failure, or IDLPGR_ERROR_INCOMPLETE for a frame that arrived
+// with missing data.  None of them exits or jumps.
+//
+// Structures in this header only grow at their ends, and
+// IDLPGR_API_VERSION increases whenever they or the functions
+// change.  Callers should check idlpgr_APIVersion() at run time.
+// Structures that the library fills begin with structsize, which
+// the caller sets to the size of the structure it was compiled
+// with.  The library writes no more than that, and sets structsize
+// to the number of bytes it filled, so that callers built with
+// either an older or a newer header can tell which members are valid.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Version 2: background stage.
+// 10/16/2026 DGG Version 3: caller-supplied structure sizes.
+// 10/16/2026 DGG Version 4: kernels selected by the library.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_API_H
+#define IDLPGR_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IDLPGR_API_VERSION 4
+
+#if defined(__GNUC__)
+#define IDLPGR_API __attribute__((visibility("default")))
+#else
+#define IDLPGR_API
+#endif
+
+#ifndef IDLPGR_ERROR_INCOMPLETE
+#define IDLPGR_ERROR_INCOMPLETE (-2)
+#endif
+
+typedef struct idlpgr_device idlpgr_device;
+
+//
+// Geometry and status of a frame returned by idlpgr_DeviceRead
+//
+typedef struct idlpgr_frameinfo {
+  size_t structsize;           // sizeof(idlpgr_frameinfo), set by the caller
+  unsigned int width;          // pixels
+  unsigned int height;         // pixels
+  unsigned int channels;       // 1 for mono and raw Bayer, 2-4 for color
+  unsigned int depth;          // bytes per channel
+  int issigned;
+  size_t size;                 // bytes of transferred image
+  double timestamp;            // [s] time stamp of the frame
+  int status;                  // 0 or IDLPGR_ERROR_INCOMPLETE
+} idlpgr_frameinfo;
+
+//
+// Stages timed by idlpgr_DeviceStats
+//
+enum {
+  IDLPGR_API_RETRIEVE,         // fc2RetrieveBuffer
+  IDLPGR_API_WAIT,             // waiting for the grabber
+  IDLPGR_API_CONVERT,          // unpacking
+  IDLPGR_API_COPY,             // copying pixel data
+  IDLPGR_API_LATENCY,          // start of exposure to delivery
+  IDLPGR_API_BACKGROUND,       // updating the background estimates
+  IDLPGR_API_NSTAGES
+};
+
+typedef struct idlpgr_timing {
+  unsigned long long count;
+  double mean;                 // [s]
+  double p50;                  // [s]
+  double p99;                  // [s]
+  double max;                  // [s]
+} idlpgr_timing;
+
+typedef struct idlpgr_devicestats {
+  size_t structsize;           // sizeof(idlpgr_devicestats), set by the caller
+  double elapsed;              // [s] since the last reset
+  unsigned long long retrieved; // frames received from the camera
+  unsigned long long delivered; // frames read by the caller
+  unsigned long long overflows; // frames discarded because the ring was full
+  unsigned long long skipped;  // frames superseded before they were read
+  unsigned long long gaps;     // frames missing from the frame counter
+  unsigned long long errors;   // failed retrievals of other kinds
+  unsigned long long timeouts; // retrievals that timed out
+  unsigned long long inconsistent; // image consistency errors
+  unsigned long long incomplete; // frames received with missing data
+  idlpgr_timing stage[IDLPGR_API_NSTAGES];
+} idlpgr_devicestats;
+
+//
+// Instruction sets of the pixel kernels that the library chose
+// for the host CPU, such as "avx2", "ssse3" or "scalar"
+//
+typedef struct idlpgr_kernels {
+  size_t structsize;           // sizeof(idlpgr_kernels), set by the caller
+  const char *unpack;          // 12-bit formats
+  const char *demosaic;        // Bayer patterns
+  const char *background;      // background estimates
+  const char *accumulate;      // accumulated frames
+} idlpgr_kernels;
+
+//
+// IDLPGR_API_VERSION of the library
+//
+IDLPGR_API int idlpgr_APIVersion(void);
+
+//
+// Description of a status returned by these functions
+//
+IDLPGR_API const char *idlpgr_ErrorString(int error);
+
+//
+// Kernels used by every device.  The structsize of kernels
+// must be set.
+//
+IDLPGR_API void idlpgr_Kernels(idlpgr_kernels *kernels);
+
+IDLPGR_API int idlpgr_DeviceCount(unsigned int *ncameras);
+
+//
+// Connect the camera with the given bus index
+//
+IDLPGR_API int idlpgr_DeviceOpen(unsigned int index, idlpgr_device **pdevice);
+
+//
+// Stop capture and disconnect.  Frees device.
+//
+IDLPGR_API void idlpgr_DeviceClose(idlpgr_device *device);
+
+//
+// The fc2Context of device, for calls directly into FlyCapture2.
+// Settings changed this way take effect at idlpgr_DeviceStart.
+//
+IDLPGR_API void *idlpgr_DeviceContext(idlpgr_device *device);
+
+//
+// Set the Format7 region of interest, keeping the mode and pixel
+// format, with the recommended packet size.  Capture must be stopped.
+//
+IDLPGR_API int idlpgr_DeviceSetROI(idlpgr_device *device,
+				   unsigned int x, unsigned int y,
+				   unsigned int width, unsigned int height);
+
+//
+// Start capture.  If nbuffers >= 2, a background grabber retrieves
+// frames into a ring of nbuffers slots; otherwise each frame is
+// retrieved by idlpgr_DeviceRead.
+//
+IDLPGR_API int idlpgr_DeviceStart(idlpgr_device *device,
+				  unsigned int nbuffers);
+IDLPGR_API int idlpgr_DeviceStop(idlpgr_device *device);
+
+//
+// Retrieve the next frame, or the newest one in the grabber's
+// ring if newest is set, and transfer it into the size bytes at
+// dest, unpacking 12-bit formats to 16 bits.  Returns
+// FC2_ERROR_BUFFER_TOO_SMALL, with info describing the frame,
+// if dest is NULL or too small.  info may be NULL; otherwise its
+// structsize must be set.
+//
+IDLPGR_API int idlpgr_DeviceRead(idlpgr_device *device,
+				 void *dest, size_t size,
+				 idlpgr_frameinfo *info,
+				 int newest);
+
+//
+// Absolute value of a property, by fc2PropertyType.
+// Setting a value turns off automatic control.
+//
+IDLPGR_API int idlpgr_DeviceGetProperty(idlpgr_device *device,
+					int type, float *value);
+IDLPGR_API int idlpgr_DeviceSetProperty(idlpgr_device *device,
+					int type, float value);
+
+//
+// Counters and stage timings since the last reset.
+// The structsize of stats must be set.
+//
+IDLPGR_API void idlpgr_DeviceStats(idlpgr_device *device,
+				   idlpgr_devicestats *stats);
+IDLPGR_API void idlpgr_DeviceResetStats(idlpgr_device *device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
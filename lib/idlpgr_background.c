@@ -0,0 +1,477 @@
+//
+// idlpgr_background.c
+//
+// Running background estimates for idlpgr.
+//
+// Each frame x updates the estimates of every pixel with weight
+// a = max(weight, 1/n), where n counts the frames added so far,
+// so that the first frames are averaged equally until the running
+// window is full:
+//
+//   mean   += a (x - mean)
+//   spread += a (|x - median| - spread)
+//   median += a (pi/2) spread sign(x - median)
+//
+// The median follows a stochastic approximation whose step is
+// scaled by the mean absolute deviation: for normally distributed
+// noise, (pi/2) spread is 1/(2 f) where f is the probability
+// density at the median, which is the step that makes the estimate
+// converge fastest.  The median needs two floats per pixel, rather
+// than the histogram of every pixel, and like the mean it is
+// updated in a single pass over the frame.  Transient features
+// such as particles passing through the field of view pull the
+// mean toward them, but move the median by at most one step.
+//
+// The bands of rows of each frame are processed by the persistent
+// worker threads of idlpgr_pool.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Persistent worker threads.
+// 10/16/2026 DGG Worker threads shared through idlpgr_pool.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "idlpgr_background.h"
+#include "idlpgr_pool.h"
+#include "idlpgr_simd.h"
+
+#ifdef IDLPGR_X86
+#include <immintrin.h>
+#endif
+
+#define IDLPGR_HALF_PI 1.57079632679489661923f
+
+typedef void (*idlpgr_update_fn)(const void *src, unsigned int n,
+				 float *mean, float *median, float *spread,
+				 float a, float b);
+typedef void (*idlpgr_normalize_fn)(const void *src, unsigned int n,
+				    const float *background,
+				    const float *dark, float level,
+				    float *dest);
+
+static inline void idlpgr_UpdatePixel(float x, float *mean, float *median,
+				      float *spread, float a, float b)
+{
+  float d = x - *median;
+
+  *mean += a * (x - *mean);
+  *spread += a * (fabsf(d) - *spread);
+  *median += b * *spread * (float) ((d > 0.f) - (d < 0.f));
+}
+
+static inline float idlpgr_NormalizePixel(float x, float background,
+					  float dark)
+{
+  float den = background - dark;
+
+  return (den > 0.f) ? (x - dark) / den : 0.f;
+}
+
+static void idlpgr_UpdateRow8Scalar(const void *src, unsigned int n,
+				    float *mean, float *median, float *spread,
+				    float a, float b)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    idlpgr_UpdatePixel((float) p[i], &mean[i], &median[i], &spread[i], a, b);
+}
+
+static void idlpgr_UpdateRow16Scalar(const void *src, unsigned int n,
+				     float *mean, float *median, float *spread,
+				     float a, float b)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    idlpgr_UpdatePixel((float) p[i], &mean[i], &median[i], &spread[i], a, b);
+}
+
+static void idlpgr_NormalizeRow8Scalar(const void *src, unsigned int n,
+				       const float *background,
+				       const float *dark, float level,
+				       float *dest)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    dest[i] = idlpgr_NormalizePixel((float) p[i], background[i],
+				    dark ? dark[i] : level);
+}
+
+static void idlpgr_NormalizeRow16Scalar(const void *src, unsigned int n,
+					const float *background,
+					const float *dark, float level,
+					float *dest)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    dest[i] = idlpgr_NormalizePixel((float) p[i], background[i],
+				    dark ? dark[i] : level);
+}
+
+#ifdef IDLPGR_X86
+
+//
+// 8 pixels per iteration.  The operations are those of the scalar
+// kernels, in the same order and without fused multiply-add.
+//
+__attribute__((target("avx2")))
+static inline void idlpgr_UpdateAVX2(__m256 x, float *mean, float *median,
+				     float *spread, __m256 a, __m256 b)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 sign = _mm256_set1_ps(-0.f);
+  __m256 m, md, s, d, sg;
+
+  m = _mm256_loadu_ps(mean);
+  md = _mm256_loadu_ps(median);
+  s = _mm256_loadu_ps(spread);
+  d = _mm256_sub_ps(x, md);
+  m = _mm256_add_ps(m, _mm256_mul_ps(a, _mm256_sub_ps(x, m)));
+  s = _mm256_add_ps(s, _mm256_mul_ps(a, _mm256_sub_ps(_mm256_andnot_ps(sign, d),
+						       s)));
+  sg = _mm256_sub_ps(_mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ), one),
+		     _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_LT_OQ), one));
+  md = _mm256_add_ps(md, _mm256_mul_ps(_mm256_mul_ps(b, s), sg));
+  _mm256_storeu_ps(mean, m);
+  _mm256_storeu_ps(median, md);
+  _mm256_storeu_ps(spread, s);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 idlpgr_NormalizeAVX2(__m256 x, const float *background,
+					  const float *dark, float level)
+{
+  __m256 dk, den;
+
+  dk = dark ? _mm256_loadu_ps(dark) : _mm256_set1_ps(level);
+  den = _mm256_sub_ps(_mm256_loadu_ps(background), dk);
+  return _mm256_and_ps(_mm256_cmp_ps(den, _mm256_setzero_ps(), _CMP_GT_OQ),
+		       _mm256_div_ps(_mm256_sub_ps(x, dk), den));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 idlpgr_Load8(const unsigned char *p)
+{
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) p)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 idlpgr_Load16(const unsigned short *p)
+{
+  return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) p)));
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_UpdateRow8AVX2(const void *src, unsigned int n,
+				  float *mean, float *median, float *spread,
+				  float a, float b)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  const __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b);
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    idlpgr_UpdateAVX2(idlpgr_Load8(p + i), mean + i, median + i, spread + i,
+		      va, vb);
+  for (; i < n; i++)
+    idlpgr_UpdatePixel((float) p[i], &mean[i], &median[i], &spread[i], a, b);
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_UpdateRow16AVX2(const void *src, unsigned int n,
+				   float *mean, float *median, float *spread,
+				   float a, float b)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  const __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b);
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    idlpgr_UpdateAVX2(idlpgr_Load16(p + i), mean + i, median + i, spread + i,
+		      va, vb);
+  for (; i < n; i++)
+    idlpgr_UpdatePixel((float) p[i], &mean[i], &median[i], &spread[i], a, b);
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_NormalizeRow8AVX2(const void *src, unsigned int n,
+				     const float *background,
+				     const float *dark, float level,
+				     float *dest)
+{
+  const unsigned char *p = (const unsigned char *) src;
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(dest + i,
+		     idlpgr_NormalizeAVX2(idlpgr_Load8(p + i), background + i,
+					  dark ? dark + i : NULL, level));
+  for (; i < n; i++)
+    dest[i] = idlpgr_NormalizePixel((float) p[i], background[i],
+				    dark ? dark[i] : level);
+}
+
+__attribute__((target("avx2")))
+static void idlpgr_NormalizeRow16AVX2(const void *src, unsigned int n,
+				      const float *background,
+				      const float *dark, float level,
+				      float *dest)
+{
+  const unsigned short *p = (const unsigned short *) src;
+  unsigned int i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(dest + i,
+		     idlpgr_NormalizeAVX2(idlpgr_Load16(p + i), background + i,
+					  dark ? dark + i : NULL, level));
+  for (; i < n; i++)
+    dest[i] = idlpgr_NormalizePixel((float) p[i], background[i],
+				    dark ? dark[i] : level);
+}
+
+#endif
+
+static idlpgr_update_fn idlpgr_UpdateRow8 = idlpgr_UpdateRow8Scalar;
+static idlpgr_update_fn idlpgr_UpdateRow16 = idlpgr_UpdateRow16Scalar;
+static idlpgr_normalize_fn idlpgr_NormalizeRow8 = idlpgr_NormalizeRow8Scalar;
+static idlpgr_normalize_fn idlpgr_NormalizeRow16 = idlpgr_NormalizeRow16Scalar;
+
+//
+// Frame processed in bands of rows by the worker threads
+//
+enum {
+  IDLPGR_BACKGROUND_START,     // first frame initializes the estimates
+  IDLPGR_BACKGROUND_UPDATE,
+  IDLPGR_BACKGROUND_NORMALIZE
+};
+
+typedef struct idlpgr_bgband {
+  idlpgr_background *background;
+  int op;
+  const unsigned char *data;
+  size_t stride;
+  unsigned int depth;
+  float a, b;                  // weights of an update
+  const float *estimate;       // background for normalization
+  float *dest;
+} idlpgr_bgband;
+
+static void idlpgr_BackgroundBand(void *arg, unsigned int row0,
+				  unsigned int row1)
+{
+  idlpgr_bgband *band = (idlpgr_bgband *) arg;
+  idlpgr_background *bg = band->background;
+  const unsigned char *src;
+  const float *dark;
+  size_t offset;
+  unsigned int y, x, cols = bg->cols;
+
+  for (y = row0; y < row1; y++) {
+    src = band->data + y * band->stride;
+    offset = (size_t) y * cols;
+    switch (band->op) {
+    case IDLPGR_BACKGROUND_START:
+      for (x = 0; x < cols; x++) {
+	bg->mean[offset + x] = bg->median[offset + x] = (band->depth == 1) ?
+	  (float) src[x] : (float) ((const unsigned short *) src)[x];
+	bg->spread[offset + x] = 0.f;
+      }
+      break;
+    case IDLPGR_BACKGROUND_UPDATE:
+      (band->depth == 1 ? idlpgr_UpdateRow8 : idlpgr_UpdateRow16)
+	(src, cols, bg->mean + offset, bg->median + offset,
+	 bg->spread + offset, band->a, band->b);
+      break;
+    case IDLPGR_BACKGROUND_NORMALIZE:
+      dark = bg->dark ? bg->dark + offset : NULL;
+      (band->depth == 1 ? idlpgr_NormalizeRow8 : idlpgr_NormalizeRow16)
+	(src, cols, band->estimate + offset, dark, bg->darklevel,
+	 band->dest + offset);
+      break;
+    }
+  }
+}
+
+static void idlpgr_BackgroundRun(idlpgr_bgband *band)
+{
+  idlpgr_background *background = band->background;
+
+  idlpgr_PoolRun(&background->pool, background->nthreads, background->rows,
+		 idlpgr_BackgroundBand, band);
+}
+
+idlpgr_background *idlpgr_BackgroundCreate(float weight, int nthreads)
+{
+  idlpgr_background *background;
+
+  background = (idlpgr_background *) calloc(1, sizeof(idlpgr_background));
+  if (background) {
+    background->weight = weight;
+    background->nthreads = nthreads;
+  }
+
+  return background;
+}
+
+static void idlpgr_BackgroundRelease(idlpgr_background *background)
+{
+  free(background->mean);
+  free(background->median);
+  free(background->spread);
+  background->mean = background->median = background->spread = NULL;
+  background->rows = background->cols = 0;
+  background->nframes = 0;
+}
+
+void idlpgr_BackgroundFree(idlpgr_background *background)
+{
+  if (!background)
+    return;
+  idlpgr_PoolFree(background->pool);
+  idlpgr_BackgroundRelease(background);
+  free(background->dark);
+  free(background->scratch);
+  free(background);
+}
+
+void idlpgr_BackgroundReset(idlpgr_background *background)
+{
+  background->nframes = 0;
+}
+
+static float *idlpgr_FloatAlloc(size_t n)
+{
+  void *p;
+
+  return posix_memalign(&p, 64, n * sizeof(float)) ? NULL : (float *) p;
+}
+
+int idlpgr_BackgroundUpdate(idlpgr_background *background,
+			    const void *data, size_t stride,
+			    unsigned int rows, unsigned int cols,
+			    unsigned int depth)
+{
+  idlpgr_bgband band;
+  size_t npixels = (size_t) rows * cols;
+  float a;
+
+  if ((depth != 1 && depth != 2) || !npixels)
+    return -1;
+
+  if (rows != background->rows || cols != background->cols) {
+    idlpgr_BackgroundRelease(background);
+    background->mean = idlpgr_FloatAlloc(npixels);
+    background->median = idlpgr_FloatAlloc(npixels);
+    background->spread = idlpgr_FloatAlloc(npixels);
+    if (!background->mean || !background->median || !background->spread) {
+      idlpgr_BackgroundRelease(background);
+      return -1;
+    }
+    background->rows = rows;
+    background->cols = cols;
+  }
+
+  memset(&band, 0, sizeof(idlpgr_bgband));
+  band.background = background;
+  band.data = (const unsigned char *) data;
+  band.stride = stride;
+  band.depth = depth;
+  if (!background->nframes)
+    band.op = IDLPGR_BACKGROUND_START;
+  else {
+    band.op = IDLPGR_BACKGROUND_UPDATE;
+    a = 1.f / (float) (background->nframes + 1);
+    band.a = (background->weight > a) ? background->weight : a;
+    band.b = band.a * IDLPGR_HALF_PI;
+  }
+  idlpgr_BackgroundRun(&band);
+  background->nframes++;
+
+  return 0;
+}
+
+int idlpgr_BackgroundSetDark(idlpgr_background *background,
+			     const float *dark,
+			     unsigned int rows, unsigned int cols,
+			     float level)
+{
+  size_t npixels = (size_t) rows * cols;
+  float *copy = NULL;
+
+  if (dark) {
+    if (!npixels || !(copy = idlpgr_FloatAlloc(npixels)))
+      return -1;
+    memcpy(copy, dark, npixels * sizeof(float));
+  }
+
+  free(background->dark);
+  background->dark = copy;
+  background->darkrows = copy ? rows : 0;
+  background->darkcols = copy ? cols : 0;
+  background->darklevel = copy ? 0.f : level;
+
+  return 0;
+}
+
+int idlpgr_BackgroundNormalize(idlpgr_background *background,
+			       const void *data, size_t stride,
+			       unsigned int rows, unsigned int cols,
+			       unsigned int depth,
+			       int median, float *dest)
+{
+  idlpgr_bgband band;
+
+  if ((depth != 1 && depth != 2) || !background->nframes ||
+      rows != background->rows || cols != background->cols)
+    return -1;
+  if (background->dark &&
+      (rows != background->darkrows || cols != background->darkcols))
+    return -1;
+
+  memset(&band, 0, sizeof(idlpgr_bgband));
+  band.background = background;
+  band.op = IDLPGR_BACKGROUND_NORMALIZE;
+  band.data = (const unsigned char *) data;
+  band.stride = stride;
+  band.depth = depth;
+  band.estimate = median ? background->median : background->mean;
+  band.dest = dest;
+  idlpgr_BackgroundRun(&band);
+
+  return 0;
+}
+
+//
+// idlpgr_SelectBackgroundKernels
+//
+const char *idlpgr_SelectBackgroundKernels(void)
+{
+#ifdef IDLPGR_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    idlpgr_UpdateRow8 = idlpgr_UpdateRow8AVX2;
+    idlpgr_UpdateRow16 = idlpgr_UpdateRow16AVX2;
+    idlpgr_NormalizeRow8 = idlpgr_NormalizeRow8AVX2;
+    idlpgr_NormalizeRow16 = idlpgr_NormalizeRow16AVX2;
+    return "avx2";
+  }
+#endif
+  idlpgr_UpdateRow8 = idlpgr_UpdateRow8Scalar;
+  idlpgr_UpdateRow16 = idlpgr_UpdateRow16Scalar;
+  idlpgr_NormalizeRow8 = idlpgr_NormalizeRow8Scalar;
+  idlpgr_NormalizeRow16 = idlpgr_NormalizeRow16Scalar;
+  return "scalar";
+}
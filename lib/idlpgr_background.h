@@ -0,0 +1,92 @@
+//
+// idlpgr_background.h
+//
+// Running background estimates for the normalization of holograms.
+// Each pixel keeps an exponential running mean and an approximate
+// running median of the frames that are added, and frames are
+// normalized by the background as (I - dark) / (B - dark).
+// The kernels operate on 8-bit and 16-bit pixel data and do
+// not depend on IDL.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Persistent worker threads.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_BACKGROUND_H
+#define IDLPGR_BACKGROUND_H
+
+#include <stddef.h>
+
+typedef struct idlpgr_background {
+  float weight;                // weight of each new frame, or 0 for
+                               // the mean of all frames
+  int nthreads;                // <= 0: one per processor
+  unsigned int rows, cols;     // geometry of the estimates
+  unsigned long long nframes;  // frames added since the last reset
+  float *mean;                 // running mean
+  float *median;               // approximate running median
+  float *spread;               // running mean absolute deviation
+                               // from the median
+  float *dark;                 // dark frame, or NULL
+  unsigned int darkrows, darkcols;
+  float darklevel;             // dark level if dark is NULL
+  unsigned char *scratch;      // frames that must be unpacked first
+  size_t scratchsize;
+  struct idlpgr_pool *pool;    // worker threads, started with the
+                               // first frame that needs them
+} idlpgr_background;
+
+idlpgr_background *idlpgr_BackgroundCreate(float weight, int nthreads);
+void idlpgr_BackgroundFree(idlpgr_background *background);
+
+//
+// Discard the estimates.  The next frame starts them afresh.
+//
+void idlpgr_BackgroundReset(idlpgr_background *background);
+
+//
+// Add a frame of rows x cols pixels of depth bytes (1 or 2) with
+// the specified row stride in bytes.  A frame whose geometry
+// differs from that of the estimates restarts them.  Returns 0
+// on success, or -1 if depth is not supported or memory could
+// not be allocated.
+//
+int idlpgr_BackgroundUpdate(idlpgr_background *background,
+			    const void *data, size_t stride,
+			    unsigned int rows, unsigned int cols,
+			    unsigned int depth);
+
+//
+// Subtract the dark frame of rows x cols pixels from frames and
+// background before normalization.  If dark is NULL, subtract
+// level from every pixel instead.  Returns 0 on success, or -1
+// if memory could not be allocated.
+//
+int idlpgr_BackgroundSetDark(idlpgr_background *background,
+			     const float *dark,
+			     unsigned int rows, unsigned int cols,
+			     float level);
+
+//
+// Normalize a frame by the running median if median is set, and
+// otherwise by the running mean, writing rows x cols floats at
+// dest.  Pixels whose background does not exceed the dark level
+// are set to 0.  Returns 0 on success, or -1 if no frame has been
+// added, or if the geometry of the frame differs from that of the
+// estimates or of the dark frame.
+//
+int idlpgr_BackgroundNormalize(idlpgr_background *background,
+			       const void *data, size_t stride,
+			       unsigned int rows, unsigned int cols,
+			       unsigned int depth,
+			       int median, float *dest);
+
+//
+// Choose the fastest kernels supported by the host CPU.
+// Returns the name of the selected instruction set.
+//
+const char *idlpgr_SelectBackgroundKernels(void);
+
+#endif
@@ -0,0 +1,717 @@
+//
+// idlpgr_capture.c
+//
+// Acquisition machinery shared by the idlpgr DLM and native
+// programs.  See idlpgr_capture.h.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Factored out of idlpgr.c.
+// 10/16/2026 DGG Histograms divide each octave into linear bins.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "idlpgr_capture.h"
+#include "idlpgr_simd.h"
+#include "idlpgr_metadata.h"
+
+//
+// Statistics
+//
+// Each camera counts the frames that pass through idlpgr and
+// accumulates histograms of the time spent in each stage of
+// acquisition.  The grabber thread and the driver's callback
+// thread update the counters concurrently with the consumer,
+// so updates are relaxed atomic operations.  Histograms have
+// IDLPGR_STATS_SUBBINS linear bins in each octave, as described
+// in idlpgr_capture.h.
+//
+unsigned long long idlpgr_Now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void idlpgr_StatsMax(unsigned long long *max, unsigned long long value)
+{
+  unsigned long long old = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+  while (value > old &&
+	 !__atomic_compare_exchange_n(max, &old, value, 1,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+void idlpgr_StatsMin(unsigned long long *min, unsigned long long value)
+{
+  unsigned long long old = __atomic_load_n(min, __ATOMIC_RELAXED);
+
+  while (value < old &&
+	 !__atomic_compare_exchange_n(min, &old, value, 1,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+//
+// Histogram bin of an interval of dt ns, and the interval
+// [lo, lo + width) ns that bin k spans
+//
+static int idlpgr_HistogramBin(unsigned long long dt)
+{
+  int e, k;
+
+  if (dt < IDLPGR_STATS_SUBBINS)
+    return (int) dt;
+  e = 63 - __builtin_clzll(dt);
+  k = (e - IDLPGR_STATS_SUBBITS + 1) * IDLPGR_STATS_SUBBINS +
+    (int) ((dt >> (e - IDLPGR_STATS_SUBBITS)) - IDLPGR_STATS_SUBBINS);
+
+  return (k < IDLPGR_STATS_NBINS) ? k : IDLPGR_STATS_NBINS - 1;
+}
+
+static void idlpgr_HistogramSpan(int k, double *lo, double *width)
+{
+  int e;
+
+  if (k < IDLPGR_STATS_SUBBINS) {
+    *lo = k;
+    *width = 1.;
+    return;
+  }
+  e = k / IDLPGR_STATS_SUBBINS + IDLPGR_STATS_SUBBITS - 1;
+  *width = ldexp(1., e - IDLPGR_STATS_SUBBITS);
+  *lo = (IDLPGR_STATS_SUBBINS + k % IDLPGR_STATS_SUBBINS) * *width;
+}
+
+//
+// idlpgr_StatsInterval
+//
+// Record an interval of dt ns in the histogram of stage.
+//
+void idlpgr_StatsInterval(idlpgr_stats *stats, int stage,
+			  unsigned long long dt)
+{
+  idlpgr_histogram *histogram;
+  int k;
+
+  if (!stats)
+    return;
+  histogram = &stats->stage[stage];
+  k = idlpgr_HistogramBin(dt);
+  __atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&histogram->total, dt, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&histogram->bin[k], 1, __ATOMIC_RELAXED);
+  idlpgr_StatsMax(&histogram->max, dt);
+  idlpgr_StatsMin(&histogram->min, dt);
+}
+
+//
+// idlpgr_StatsTime
+//
+// Record the time elapsed since start in the histogram of stage.
+//
+void idlpgr_StatsTime(idlpgr_stats *stats, int stage,
+		      unsigned long long start)
+{
+  if (stats)
+    idlpgr_StatsInterval(stats, stage, idlpgr_Now() - start);
+}
+
+//
+// idlpgr_StatsFrame
+//
+// Count a frame received from the camera, and any frames that
+// are missing from the embedded frame counter.  Called only by
+// the thread that retrieves frames.
+//
+void idlpgr_StatsFrame(idlpgr_stats *stats, const fc2Image *image)
+{
+  unsigned int counter;
+  int offset;
+
+  __atomic_add_fetch(&stats->retrieved, 1, __ATOMIC_RELAXED);
+  if (image->receivedDataSize < image->dataSize)
+    __atomic_add_fetch(&stats->incomplete, 1, __ATOMIC_RELAXED);
+
+  offset = __atomic_load_n(&stats->counteroffset, __ATOMIC_RELAXED);
+  if (offset < 0 || !image->pData ||
+      (size_t) offset + 4 > (size_t) image->rows * image->stride)
+    return;
+  counter = idlpgr_MetadataWord(image->pData + offset);
+  // a counter that resets or runs backwards is not a gap
+  if (stats->hascounter && (int) (counter - stats->lastcounter) > 1)
+    __atomic_add_fetch(&stats->gaps, counter - stats->lastcounter - 1,
+		       __ATOMIC_RELAXED);
+  stats->lastcounter = counter;
+  stats->hascounter = 1;
+}
+
+//
+// idlpgr_StatsError
+//
+// Count a failed retrieval according to its class.
+//
+void idlpgr_StatsError(idlpgr_stats *stats, fc2Error error)
+{
+  unsigned long long *counter;
+
+  if (error == FC2_ERROR_TIMEOUT)
+    counter = &stats->timeouts;
+  else if (error == FC2_ERROR_IMAGE_CONSISTENCY_ERROR)
+    counter = &stats->inconsistent;
+  else
+    counter = &stats->errors;
+  __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+}
+
+void idlpgr_StatsReset(idlpgr_stats *stats)
+{
+  unsigned long long *p;
+  size_t n;
+
+  __atomic_store_n(&stats->retrieved, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->delivered, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->overflows, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->skipped, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->gaps, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->errors, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->timeouts, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->inconsistent, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->incomplete, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->maxqueued, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->hascounter, 0, __ATOMIC_RELAXED);
+  p = (unsigned long long *) stats->stage;
+  for (n = 0; n < IDLPGR_NSTAGES * IDLPGR_HISTOGRAM_WORDS; n++)
+    __atomic_store_n(&p[n], 0, __ATOMIC_RELAXED);
+  for (n = 0; n < IDLPGR_NSTAGES; n++)
+    __atomic_store_n(&stats->stage[n].min, ~0ULL, __ATOMIC_RELAXED);
+  stats->start = idlpgr_Now();
+}
+
+double idlpgr_HistogramPercentile(const idlpgr_histogram *histogram,
+				  double p)
+{
+  unsigned long long count = 0, target;
+  double lo, width, value;
+  int k;
+
+  if (!histogram->count)
+    return 0.;
+  target = (unsigned long long) ceil(p * histogram->count);
+  if (target < 1)
+    target = 1;
+  for (k = 0; k < IDLPGR_STATS_NBINS; k++) {
+    if (count + histogram->bin[k] >= target)
+      break;
+    count += histogram->bin[k];
+  }
+  if (k == IDLPGR_STATS_NBINS)
+    return (double) histogram->max;
+
+  // intervals are taken to be spread evenly across bin k
+  idlpgr_HistogramSpan(k, &lo, &width);
+  value = lo + width * (double) (target - count) / histogram->bin[k];
+  if (value > histogram->max)
+    value = histogram->max;
+  if (value < histogram->min)
+    value = histogram->min;
+
+  return value;
+}
+
+//
+// Aligned frame buffers
+//
+// Frames that idlpgr retrieves through fc2Images land in buffers
+// that are allocated once, sized for the camera's Format7
+// configuration, aligned for the vector kernels, and touched when
+// they are allocated so that no page faults occur in the frame
+// path.  Buffers of a few megabytes or more are aligned to huge
+// pages and offered to the kernel for transparent huge pages.
+//
+// A buffer given to an fc2Image with fc2SetImageData travels with
+// the fc2Image's contents when the grabber exchanges them, so
+// ownership is tracked by address rather than by fc2Image.
+// Buffers are only allocated and freed by the consumer's thread.
+//
+#define IDLPGR_ALIGN    64
+#define IDLPGR_HUGEPAGE (2UL << 20)
+
+typedef struct idlpgr_buffer {
+  unsigned char *data;
+  size_t size;
+  struct idlpgr_buffer *next;
+} idlpgr_buffer;
+
+static idlpgr_buffer *buffers = NULL;
+
+//
+// Allocate an aligned, prefaulted buffer of at least *size bytes.
+// On return, *size is the usable size.
+//
+unsigned char *idlpgr_BufferAlloc(size_t *size)
+{
+  size_t align;
+  void *data;
+
+  align = (*size >= IDLPGR_HUGEPAGE) ? IDLPGR_HUGEPAGE : IDLPGR_ALIGN;
+  *size = (*size + align - 1) & ~(align - 1);
+  if (posix_memalign(&data, align, *size))
+    return NULL;
+#ifdef MADV_HUGEPAGE
+  if (align == IDLPGR_HUGEPAGE)
+    madvise(data, *size, MADV_HUGEPAGE);
+#endif
+  memset(data, 0, *size);
+
+  return (unsigned char *) data;
+}
+
+static idlpgr_buffer **idlpgr_BufferFind(const unsigned char *data)
+{
+  idlpgr_buffer **pbuffer;
+
+  for (pbuffer = &buffers; *pbuffer; pbuffer = &(*pbuffer)->next)
+    if ((*pbuffer)->data == data)
+      break;
+
+  return pbuffer;
+}
+
+//
+// Give image a buffer of at least size bytes, unless
+// the buffer that it holds is already large enough.
+//
+fc2Error idlpgr_ImageReserve(fc2Image *image, size_t size)
+{
+  idlpgr_buffer *buffer, **pbuffer;
+  fc2Error error;
+
+  pbuffer = idlpgr_BufferFind(image->pData);
+  if (image->pData && *pbuffer && (*pbuffer)->size >= size)
+    return FC2_ERROR_OK;
+
+  if (!(buffer = (idlpgr_buffer *) calloc(1, sizeof(idlpgr_buffer))))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  buffer->size = size;
+  if (!(buffer->data = idlpgr_BufferAlloc(&buffer->size))) {
+    free(buffer);
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  error = fc2SetImageData(image, buffer->data, (unsigned int) buffer->size);
+  if (error) {
+    free(buffer->data);
+    free(buffer);
+    return error;
+  }
+
+  // the image no longer refers to its previous buffer
+  if (*pbuffer) {
+    buffer->next = (*pbuffer)->next;
+    free((*pbuffer)->data);
+    free(*pbuffer);
+    *pbuffer = buffer;
+  } else {
+    buffer->next = buffers;
+    buffers = buffer;
+  }
+
+  return FC2_ERROR_OK;
+}
+
+//
+// Destroy image and free the buffer that it holds, if it
+// was allocated by idlpgr_ImageReserve
+//
+void idlpgr_ImageRelease(fc2Image *image)
+{
+  idlpgr_buffer *buffer, **pbuffer;
+  unsigned char *data = image->pData;
+
+  fc2DestroyImage(image);
+  pbuffer = idlpgr_BufferFind(data);
+  if (data && (buffer = *pbuffer)) {
+    *pbuffer = buffer->next;
+    free(buffer->data);
+    free(buffer);
+  }
+}
+
+//
+// Background grabber
+//
+// A native thread owns the fc2RetrieveBuffer loop and deposits
+// frames into a preallocated ring of fc2Images.  The ring has a
+// single producer (the grabber thread) and a single consumer
+// (the IDL interpreter, or a native program), so head and tail
+// are advanced without locks: the producer only writes head and
+// the consumer only writes tail.
+// Frames are handed to the consumer by exchanging the contents of
+// the consumer's fc2Image with the contents of the ring slot,
+// so no pixel data is copied.  A retrieval that times out does
+// not stop the grabber; the consumer instead observes the timeout
+// when no frame arrives in the ring within the grab timeout.
+// The hook sees each frame before it is published, including
+// frames discarded because the ring is full.
+//
+static void *idlpgr_GrabberThread(void *arg)
+{
+  idlpgr_grabber *grabber = (idlpgr_grabber *) arg;
+  unsigned long long head, tail, start;
+  fc2Image *image;
+  fc2Error error;
+  int full;
+
+  while (__atomic_load_n(&grabber->running, __ATOMIC_ACQUIRE)) {
+    head = grabber->head;
+    tail = __atomic_load_n(&grabber->tail, __ATOMIC_ACQUIRE);
+    full = (head - tail >= grabber->nslots);
+    image = full ? &grabber->scratch : &grabber->slot[head % grabber->nslots];
+    start = idlpgr_Now();
+    error = fc2RetrieveBuffer(grabber->context, image);
+    idlpgr_StatsTime(grabber->stats, IDLPGR_STAGE_RETRIEVE, start);
+    if (error)
+      idlpgr_StatsError(grabber->stats, error);
+    // frames that time out or fail consistency checks are skipped
+    if (error == FC2_ERROR_TIMEOUT ||
+	error == FC2_ERROR_IMAGE_CONSISTENCY_ERROR)
+      continue;
+    if (error) {
+      grabber->error = error;
+      __atomic_store_n(&grabber->running, 0, __ATOMIC_RELEASE);
+      break;
+    }
+    idlpgr_StatsFrame(grabber->stats, image);
+    if (grabber->onframe)
+      grabber->onframe(grabber->data, image);
+    if (full) {
+      __atomic_add_fetch(&grabber->overflows, 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&grabber->stats->overflows, 1, __ATOMIC_RELAXED);
+    } else
+      __atomic_store_n(&grabber->head, head + 1, __ATOMIC_RELEASE);
+  }
+
+  return NULL;
+}
+
+static void idlpgr_GrabberFree(idlpgr_grabber *grabber)
+{
+  unsigned int n;
+
+  for (n = 0; n < grabber->nslots; n++)
+    idlpgr_ImageRelease(&grabber->slot[n]);
+  idlpgr_ImageRelease(&grabber->scratch);
+  free(grabber->slot);
+  free(grabber);
+}
+
+//
+// Frames of framesize bytes are retrieved into aligned buffers.
+// If framesize is 0, the driver allocates the buffers.
+//
+fc2Error idlpgr_GrabberStart(idlpgr_grabber **pgrabber,
+			     fc2Context context,
+			     unsigned int nslots,
+			     int timeout,
+			     idlpgr_stats *stats,
+			     size_t framesize,
+			     idlpgr_framefn onframe,
+			     void *data)
+{
+  idlpgr_grabber *grabber;
+  fc2Error error = FC2_ERROR_OK;
+  unsigned int n;
+
+  grabber = (idlpgr_grabber *) calloc(1, sizeof(idlpgr_grabber));
+  if (!grabber)
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  grabber->slot = (fc2Image *) calloc(nslots, sizeof(fc2Image));
+  if (!grabber->slot) {
+    free(grabber);
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  grabber->context = context;
+  grabber->nslots = nslots;
+  grabber->timeout = timeout;
+  grabber->stats = stats;
+  grabber->onframe = onframe;
+  grabber->data = data;
+  if (stats)
+    stats->hascounter = 0;
+  fc2CreateImage(&grabber->scratch);
+  for (n = 0; n < nslots; n++)
+    fc2CreateImage(&grabber->slot[n]);
+  if (framesize) {
+    error = idlpgr_ImageReserve(&grabber->scratch, framesize);
+    for (n = 0; !error && n < nslots; n++)
+      error = idlpgr_ImageReserve(&grabber->slot[n], framesize);
+  }
+  if (error) {
+    idlpgr_GrabberFree(grabber);
+    return error;
+  }
+
+  grabber->running = 1;
+  if (pthread_create(&grabber->thread, NULL, idlpgr_GrabberThread, grabber)) {
+    idlpgr_GrabberFree(grabber);
+    return FC2_ERROR_FAILED;
+  }
+
+  *pgrabber = grabber;
+  return FC2_ERROR_OK;
+}
+
+//
+// Capture must be stopped first: a grabber waiting for a frame
+// that never arrives, such as in trigger mode with no triggers,
+// returns from fc2RetrieveBuffer only when capture stops.
+//
+void idlpgr_GrabberStop(idlpgr_grabber *grabber)
+{
+  __atomic_store_n(&grabber->running, 0, __ATOMIC_RELEASE);
+  pthread_join(grabber->thread, NULL);
+  idlpgr_GrabberFree(grabber);
+}
+
+//
+// idlpgr_GrabberWait
+//
+// Wait until the ring holds at least one frame and report the
+// index of the next slot to be filled.  Returns the error that
+// stopped the grabber if the ring is empty and the grabber is
+// no longer running, and FC2_ERROR_TIMEOUT if no frame arrives
+// within the grabber's timeout.
+//
+static fc2Error idlpgr_GrabberWait(idlpgr_grabber *grabber,
+				   unsigned long long *phead)
+{
+  struct timespec pause = { 0, 100000 };
+  unsigned long long head, tail, deadline = 0;
+  int timeout;
+
+  timeout = __atomic_load_n(&grabber->timeout, __ATOMIC_RELAXED);
+  if (timeout >= 0)
+    deadline = idlpgr_Now() + 1000000ULL * (unsigned long long) timeout;
+
+  tail = grabber->tail;
+  while ((head = __atomic_load_n(&grabber->head, __ATOMIC_ACQUIRE)) == tail) {
+    if (!__atomic_load_n(&grabber->running, __ATOMIC_ACQUIRE) &&
+	head == __atomic_load_n(&grabber->head, __ATOMIC_ACQUIRE))
+      return grabber->error ? grabber->error : FC2_ERROR_ISOCH_NOT_STARTED;
+    if (timeout >= 0 && idlpgr_Now() >= deadline)
+      return FC2_ERROR_TIMEOUT;
+    nanosleep(&pause, NULL);
+  }
+  *phead = head;
+
+  return FC2_ERROR_OK;
+}
+
+//
+// idlpgr_GrabberPeek
+//
+// Wait for the oldest frame in the ring without consuming it.
+// The frame remains valid until idlpgr_GrabberDrop is called.
+//
+fc2Error idlpgr_GrabberPeek(idlpgr_grabber *grabber,
+			    fc2Image **image)
+{
+  unsigned long long head;
+  fc2Error error;
+
+  if ((error = idlpgr_GrabberWait(grabber, &head)))
+    return error;
+  *image = &grabber->slot[grabber->tail % grabber->nslots];
+
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_GrabberDrop(idlpgr_grabber *grabber)
+{
+  __atomic_store_n(&grabber->tail, grabber->tail + 1, __ATOMIC_RELEASE);
+}
+
+//
+// idlpgr_GrabberPop
+//
+// Wait for the next (or newest) frame in the ring and hand it
+// to image.
+//
+fc2Error idlpgr_GrabberPop(idlpgr_grabber *grabber,
+			   fc2Image *image,
+			   int newest)
+{
+  unsigned long long head, tail;
+  fc2Image *slot, swap;
+  fc2Error error;
+
+  if ((error = idlpgr_GrabberWait(grabber, &head)))
+    return error;
+
+  idlpgr_StatsMax(&grabber->stats->maxqueued, head - grabber->tail);
+  tail = newest ? head - 1 : grabber->tail;
+  if (tail > grabber->tail)
+    __atomic_add_fetch(&grabber->stats->skipped, tail - grabber->tail,
+		       __ATOMIC_RELAXED);
+  slot = &grabber->slot[tail % grabber->nslots];
+  swap = *image;
+  *image = *slot;
+  *slot = swap;
+  __atomic_store_n(&grabber->tail, tail + 1, __ATOMIC_RELEASE);
+
+  return FC2_ERROR_OK;
+}
+
+//
+// Image transfer
+//
+// The layout of transferred image data is determined by the pixel
+// format: 8-bit formats are transferred as bytes, 16-bit formats
+// as 16-bit integers, and packed 12-bit formats are unpacked into
+// 16-bit integers.  Multi-channel formats gain a leading dimension
+// for the channel.  Rows are copied one at a time only when
+// the camera pads rows beyond the pixel data.
+//
+void idlpgr_ImageLayout(const fc2Image *image, idlpgr_layout *layout)
+{
+  unsigned int channels = 1;
+
+  memset(layout, 0, sizeof(idlpgr_layout));
+  layout->depth = 1;
+
+  switch (image->format) {
+  case FC2_PIXEL_FORMAT_MONO8:
+  case FC2_PIXEL_FORMAT_RAW8:
+    break;
+  case FC2_PIXEL_FORMAT_S_MONO16:
+    layout->issigned = 1;
+    // fall through
+  case FC2_PIXEL_FORMAT_MONO16:
+  case FC2_PIXEL_FORMAT_RAW16:
+    layout->depth = 2;
+    break;
+  case FC2_PIXEL_FORMAT_MONO12:
+  case FC2_PIXEL_FORMAT_RAW12:
+    layout->depth = 2;
+    layout->packed12 = 1;
+    break;
+  case FC2_PIXEL_FORMAT_422YUV8:
+    channels = 2;
+    break;
+  case FC2_PIXEL_FORMAT_444YUV8:
+  case FC2_PIXEL_FORMAT_RGB8:
+  case FC2_PIXEL_FORMAT_BGR:
+    channels = 3;
+    break;
+  case FC2_PIXEL_FORMAT_BGRU:
+  case FC2_PIXEL_FORMAT_RGBU:
+    channels = 4;
+    break;
+  case FC2_PIXEL_FORMAT_S_RGB16:
+    layout->issigned = 1;
+    // fall through
+  case FC2_PIXEL_FORMAT_RGB16:
+  case FC2_PIXEL_FORMAT_BGR16:
+    layout->depth = 2;
+    channels = 3;
+    break;
+  case FC2_PIXEL_FORMAT_BGRU16:
+    layout->depth = 2;
+    channels = 4;
+    break;
+  case FC2_UNSPECIFIED_PIXEL_FORMAT:
+    if (image->cols != image->stride)
+      channels = 3;
+    break;
+  default:
+    // 411YUV8, JPEG and vendor formats: transfer raw bytes
+    layout->ndims = 2;
+    layout->dim[0] = layout->rowbytes = layout->srcbytes = image->stride;
+    layout->dim[1] = image->rows;
+    layout->size = layout->rowbytes * image->rows;
+    return;
+  }
+
+  if (channels > 1) {
+    layout->ndims = 3;
+    layout->dim[0] = channels;
+    layout->dim[1] = image->cols;
+    layout->dim[2] = image->rows;
+  } else {
+    layout->ndims = 2;
+    layout->dim[0] = image->cols;
+    layout->dim[1] = image->rows;
+  }
+  layout->rowbytes = (size_t) image->cols * channels * layout->depth;
+  layout->srcbytes = layout->packed12 ?
+    ((size_t) image->cols * 3 + 1) / 2 : layout->rowbytes;
+  layout->size = layout->rowbytes * image->rows;
+}
+
+//
+// Layout of frames captured with the given settings, known
+// without retrieving a frame.  Formats whose packing is not
+// known to idlpgr_ImageLayout are allowed four bytes per pixel.
+//
+void idlpgr_Format7Layout(const fc2Format7ImageSettings *settings,
+			  idlpgr_layout *layout)
+{
+  fc2Image image;
+
+  memset(&image, 0, sizeof(fc2Image));
+  image.rows = settings->height;
+  image.cols = settings->width;
+  image.stride = 4 * settings->width;
+  image.format = settings->pixelFormat;
+  idlpgr_ImageLayout(&image, layout);
+}
+
+//
+// Bytes of pixel data in a frame with the given settings.
+//
+unsigned int idlpgr_Format7FrameSize(const fc2Format7ImageSettings *settings)
+{
+  idlpgr_layout layout;
+
+  idlpgr_Format7Layout(settings, &layout);
+
+  return (unsigned int) (layout.srcbytes * settings->height);
+}
+
+//
+// idlpgr_TransferImage
+//
+// Copy image data into dest according to layout.
+//
+void idlpgr_TransferImage(const fc2Image *image,
+			  const idlpgr_layout *layout,
+			  void *dest)
+{
+  const unsigned char *src = image->pData;
+  unsigned char *pd = (unsigned char *) dest;
+  unsigned int row;
+
+  if (layout->packed12) {
+    if (image->stride == layout->srcbytes && !(image->cols & 1))
+      idlpgr_Unpack12(src, (unsigned short *) pd,
+		      (size_t) image->rows * image->cols);
+    else
+      for (row = 0; row < image->rows; row++, src += image->stride,
+	     pd += layout->rowbytes)
+	idlpgr_Unpack12(src, (unsigned short *) pd, image->cols);
+  } else if (image->stride == layout->rowbytes) {
+    memcpy(pd, src, layout->size);
+  } else {
+    for (row = 0; row < image->rows; row++, src += image->stride,
+	   pd += layout->rowbytes)
+      memcpy(pd, src, layout->rowbytes);
+  }
+}
@@ -0,0 +1,170 @@
+//
+// idlpgr_capture.h
+//
+// Acquisition machinery shared by the idlpgr DLM and native
+// programs: timing and statistics, aligned frame buffers, the
+// background grabber and the transfer of frames into arrays.
+// Does not depend on IDL.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Added background stage.
+// 10/16/2026 DGG Grabber passes every frame to a hook.
+// 10/16/2026 DGG Histograms divide each octave into linear bins.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_CAPTURE_H
+#define IDLPGR_CAPTURE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "C/FlyCapture2_C.h"
+
+//
+// Statistics
+//
+// Intervals shorter than IDLPGR_STATS_SUBBINS ns each have a bin.
+// Each octave from 2^e to 2^(e+1) ns above that is divided into
+// IDLPGR_STATS_SUBBINS bins of equal width, so that no bin is wider
+// than 1/IDLPGR_STATS_SUBBINS of the intervals it counts.  The last
+// bin, for intervals up to 2^32 ns, also counts longer intervals.
+//
+#define IDLPGR_STATS_SUBBITS 4
+#define IDLPGR_STATS_SUBBINS (1 << IDLPGR_STATS_SUBBITS)
+#define IDLPGR_STATS_NBINS \
+  ((32 - IDLPGR_STATS_SUBBITS + 1) * IDLPGR_STATS_SUBBINS)
+
+enum {
+  IDLPGR_STAGE_RETRIEVE,       // fc2RetrieveBuffer
+  IDLPGR_STAGE_WAIT,           // consumer waiting for the grabber
+  IDLPGR_STAGE_CONVERT,        // unpacking, demosaicing and accumulating
+  IDLPGR_STAGE_COPY,           // copying pixel data
+  IDLPGR_STAGE_LATENCY,        // start of exposure to delivery
+  IDLPGR_STAGE_BACKGROUND,     // updating the background estimates
+  IDLPGR_NSTAGES
+};
+
+typedef struct idlpgr_histogram {
+  unsigned long long count;
+  unsigned long long total;    // [ns]
+  unsigned long long max;      // [ns]
+  unsigned long long min;      // [ns], ~0 until an interval is recorded
+  unsigned long long bin[IDLPGR_STATS_NBINS];
+} idlpgr_histogram;
+
+#define IDLPGR_HISTOGRAM_WORDS \
+  (sizeof(idlpgr_histogram) / sizeof(unsigned long long))
+
+typedef struct idlpgr_stats {
+  unsigned long long retrieved; // frames received from the camera
+  unsigned long long delivered; // frames handed to the consumer
+  unsigned long long overflows; // frames discarded because the ring was full
+  unsigned long long skipped;  // frames superseded before they were read
+  unsigned long long gaps;     // frames missing from the frame counter
+  unsigned long long errors;   // failed retrievals of other kinds
+  unsigned long long timeouts; // retrievals that timed out
+  unsigned long long inconsistent; // image consistency errors
+  unsigned long long incomplete; // frames received with missing data
+  unsigned long long maxqueued; // most frames waiting in the ring
+  unsigned long long start;    // [ns] time of last reset
+  int counteroffset;           // offset of embedded frame counter, or -1
+  int hascounter;              // lastcounter is valid
+  unsigned int lastcounter;
+  idlpgr_histogram stage[IDLPGR_NSTAGES];
+} idlpgr_stats;
+
+//
+// Monotonic time [ns]
+//
+unsigned long long idlpgr_Now(void);
+
+void idlpgr_StatsMax(unsigned long long *max, unsigned long long value);
+void idlpgr_StatsMin(unsigned long long *min, unsigned long long value);
+void idlpgr_StatsInterval(idlpgr_stats *stats, int stage,
+			  unsigned long long dt);
+void idlpgr_StatsTime(idlpgr_stats *stats, int stage,
+		      unsigned long long start);
+void idlpgr_StatsFrame(idlpgr_stats *stats, const fc2Image *image);
+void idlpgr_StatsError(idlpgr_stats *stats, fc2Error error);
+void idlpgr_StatsReset(idlpgr_stats *stats);
+
+//
+// Interval [ns] below which the fraction p of the intervals in
+// histogram fall, interpolated linearly within a bin and limited
+// to the shortest and longest intervals recorded.
+//
+double idlpgr_HistogramPercentile(const idlpgr_histogram *histogram,
+				  double p);
+
+//
+// Aligned frame buffers
+//
+unsigned char *idlpgr_BufferAlloc(size_t *size);
+fc2Error idlpgr_ImageReserve(fc2Image *image, size_t size);
+void idlpgr_ImageRelease(fc2Image *image);
+
+//
+// Called in the thread that retrieves frames with each frame
+// received, whether or not it reaches the consumer
+//
+typedef void (*idlpgr_framefn)(void *data, const fc2Image *image);
+
+//
+// Background grabber
+//
+typedef struct idlpgr_grabber {
+  fc2Context context;
+  pthread_t thread;
+  int running;                 // cleared to stop the thread
+  fc2Error error;              // error that stopped the thread
+  int timeout;                 // [ms] consumer wait, or < 0 for no limit
+  unsigned int nslots;
+  fc2Image *slot;
+  fc2Image scratch;            // receives frames when the ring is full
+  unsigned long long head;     // next slot to be filled
+  unsigned long long tail;     // next slot to be consumed
+  unsigned long long overflows; // frames dropped because the ring was full
+  idlpgr_stats *stats;
+  idlpgr_framefn onframe;      // or NULL
+  void *data;                  // passed to onframe
+} idlpgr_grabber;
+
+fc2Error idlpgr_GrabberStart(idlpgr_grabber **pgrabber,
+			     fc2Context context,
+			     unsigned int nslots,
+			     int timeout,
+			     idlpgr_stats *stats,
+			     size_t framesize,
+			     idlpgr_framefn onframe,
+			     void *data);
+void idlpgr_GrabberStop(idlpgr_grabber *grabber);
+fc2Error idlpgr_GrabberPeek(idlpgr_grabber *grabber, fc2Image **image);
+void idlpgr_GrabberDrop(idlpgr_grabber *grabber);
+fc2Error idlpgr_GrabberPop(idlpgr_grabber *grabber, fc2Image *image,
+			   int newest);
+
+//
+// Image transfer
+//
+typedef struct idlpgr_layout {
+  int ndims;
+  size_t dim[3];
+  unsigned int depth;          // bytes per element
+  int issigned;
+  int packed12;                // source is packed 12-bit
+  size_t rowbytes;             // bytes per transferred row
+  size_t srcbytes;             // bytes of pixel data per source row
+  size_t size;                 // bytes of transferred image
+} idlpgr_layout;
+
+void idlpgr_ImageLayout(const fc2Image *image, idlpgr_layout *layout);
+void idlpgr_Format7Layout(const fc2Format7ImageSettings *settings,
+			  idlpgr_layout *layout);
+unsigned int idlpgr_Format7FrameSize(const fc2Format7ImageSettings *settings);
+void idlpgr_TransferImage(const fc2Image *image,
+			  const idlpgr_layout *layout,
+			  void *dest);
+
+#endif
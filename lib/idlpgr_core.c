@@ -0,0 +1,1473 @@
+//
+// idlpgr_core.c
+//
+// Per-camera state and acquisition engine of idlpgr.
+// See idlpgr_core.h.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Factored out of idlpgr.c.
+// 10/16/2026 DGG Added background estimates.
+// 10/16/2026 DGG Added frame accumulation.
+// 10/16/2026 DGG Kernels selected by the core.
+// 10/16/2026 DGG Tuning reports configuration errors.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "idlpgr_core.h"
+#include "idlpgr_simd.h"
+#include "idlpgr_demosaic.h"
+
+//
+// Pixel kernels
+//
+static pthread_once_t kernelsonce = PTHREAD_ONCE_INIT;
+static idlpgr_kernelnames kernelnames;
+
+static void idlpgr_SelectKernelsOnce(void)
+{
+  kernelnames.unpack = idlpgr_SelectKernels();
+  kernelnames.demosaic = idlpgr_SelectDemosaicKernels();
+  kernelnames.background = idlpgr_SelectBackgroundKernels();
+  kernelnames.accumulate = idlpgr_SelectAccumulateKernels();
+}
+
+const idlpgr_kernelnames *idlpgr_SelectAllKernels(void)
+{
+  pthread_once(&kernelsonce, idlpgr_SelectKernelsOnce);
+  return &kernelnames;
+}
+
+//
+// Image handles
+//
+// Handles are never freed, so that an image address held by a
+// caller remains valid, if unused, after it has been destroyed.
+//
+static idlpgr_handle *handles = NULL;
+
+idlpgr_handle *idlpgr_FindHandle(const fc2Image *image)
+{
+  idlpgr_handle *handle;
+
+  for (handle = handles; handle; handle = handle->next)
+    if (&handle->image == image)
+      break;
+
+  return handle;
+}
+
+//
+// Grow the buffers of the handles in use on context to framesize
+//
+fc2Error idlpgr_HandlesReserve(fc2Context context, size_t framesize)
+{
+  idlpgr_handle *handle;
+  fc2Error error = FC2_ERROR_OK;
+
+  for (handle = handles; !error && handle; handle = handle->next)
+    if (handle->inuse && handle->context == context)
+      error = idlpgr_ImageReserve(&handle->image, framesize);
+
+  return error;
+}
+
+fc2Error idlpgr_HandleCreate(fc2Context context, fc2Image **pimage)
+{
+  idlpgr_handle *handle;
+  idlpgr_camera *camera;
+  fc2Error error;
+
+  for (handle = handles; handle; handle = handle->next)
+    if (!handle->inuse)
+      break;
+  if (!handle) {
+    if (!(handle = (idlpgr_handle *) calloc(1, sizeof(idlpgr_handle))))
+      return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+    if ((error = fc2CreateImage(&handle->image))) {
+      free(handle);
+      return error;
+    }
+    handle->next = handles;
+    handles = handle;
+  }
+  handle->inuse = TRUE;
+  handle->context = context;
+
+  if (context) {
+    if (!(camera = idlpgr_CameraGet(context)))
+      error = FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+    else if (camera->framesize)
+      error = idlpgr_ImageReserve(&handle->image, camera->framesize);
+    else
+      error = FC2_ERROR_OK;
+    if (error) {
+      handle->inuse = FALSE;
+      handle->context = NULL;
+      return error;
+    }
+  }
+
+  *pimage = &handle->image;
+  return FC2_ERROR_OK;
+}
+
+fc2Error idlpgr_HandleDestroy(fc2Image *image)
+{
+  idlpgr_handle *handle;
+
+  handle = idlpgr_FindHandle(image);
+  if (!handle || !handle->inuse)
+    return FC2_ERROR_INVALID_PARAMETER;
+  handle->inuse = FALSE;
+  handle->context = NULL;
+
+  return FC2_ERROR_OK;
+}
+
+//
+// User buffers
+//
+// Pools are listed so that a released frame can be found in the
+// pool that holds it, even after the pool's context is destroyed.
+//
+static idlpgr_userbuffers *userbuffers = NULL;
+
+//
+// Cameras, and the synchronized capture groups that they belong to
+//
+static idlpgr_camera *cameras = NULL;
+static idlpgr_group *groups = NULL;
+
+idlpgr_camera *idlpgr_FindCamera(fc2Context context)
+{
+  idlpgr_camera *camera;
+
+  for (camera = cameras; camera; camera = camera->next)
+    if (camera->context == context)
+      break;
+
+  return camera;
+}
+
+idlpgr_camera *idlpgr_CameraGet(fc2Context context)
+{
+  idlpgr_camera *camera;
+
+  if ((camera = idlpgr_FindCamera(context)))
+    return camera;
+
+  camera = (idlpgr_camera *) calloc(1, sizeof(idlpgr_camera));
+  if (!camera)
+    return NULL;
+  camera->context = context;
+  pthread_mutex_init(&camera->lock, NULL);
+  camera->stats.counteroffset = -1;
+  camera->latency = -1.;
+  idlpgr_StatsReset(&camera->stats);
+  camera->next = cameras;
+  cameras = camera;
+
+  return camera;
+}
+
+//
+// Property information is static for a connected camera, except
+// that the range of the shutter depends on the frame rate.
+// Reading it once at connect time saves a register round trip
+// on every subsequent property access.
+//
+static void idlpgr_CachePropertyInfo(idlpgr_camera *camera,
+				     fc2PropertyType type)
+{
+  fc2PropertyInfo *info = &camera->propinfo[type];
+
+  memset(info, 0, sizeof(fc2PropertyInfo));
+  info->type = type;
+  if (fc2GetPropertyInfo(camera->context, info))
+    info->present = FALSE;
+}
+
+void idlpgr_CacheAllPropertyInfo(idlpgr_camera *camera)
+{
+  int type;
+
+  for (type = 0; type < FC2_UNSPECIFIED_PROPERTY_TYPE; type++)
+    idlpgr_CachePropertyInfo(camera, (fc2PropertyType) type);
+  camera->haspropinfo = TRUE;
+}
+
+//
+// The set of embedded items determines where each item lies
+// in the pixel data, and in particular where the statistics
+// find the frame counter.
+//
+void idlpgr_CacheEmbeddedImageInfo(idlpgr_camera *camera)
+{
+  if (fc2GetEmbeddedImageInfo(camera->context, &camera->embedded))
+    memset(&camera->embedded, 0, sizeof(fc2EmbeddedImageInfo));
+  camera->hasembedded = TRUE;
+
+  camera->stats.hascounter = 0;
+  __atomic_store_n(&camera->stats.counteroffset,
+		   idlpgr_MetadataOffset(&camera->embedded,
+					 &camera->embedded.frameCounter),
+		   __ATOMIC_RELAXED);
+}
+
+//
+// The capture configuration is read at connect time and
+// updated whenever it is set through idlpgr.
+//
+void idlpgr_CacheConfiguration(idlpgr_camera *camera)
+{
+  camera->hasconfig = !fc2GetConfiguration(camera->context, &camera->config);
+}
+
+int idlpgr_GrabTimeout(const idlpgr_camera *camera)
+{
+  return camera->hasconfig ? camera->config.grabTimeout : FC2_TIMEOUT_INFINITE;
+}
+
+fc2Error idlpgr_PropertyInfo(fc2Context context, fc2PropertyInfo *info)
+{
+  idlpgr_camera *camera;
+
+  camera = idlpgr_FindCamera(context);
+  if (camera && camera->haspropinfo &&
+      info->type >= 0 && info->type < FC2_UNSPECIFIED_PROPERTY_TYPE) {
+    memcpy(info, &camera->propinfo[info->type], sizeof(fc2PropertyInfo));
+    return FC2_ERROR_OK;
+  }
+
+  return fc2GetPropertyInfo(context, info);
+}
+
+fc2Error idlpgr_WriteProperty(fc2Context context, fc2Property *property)
+{
+  idlpgr_camera *camera;
+  fc2Error error;
+
+  error = fc2SetProperty(context, property);
+  if (!error && property->type == FC2_FRAME_RATE) {
+    camera = idlpgr_FindCamera(context);
+    if (camera && camera->haspropinfo)
+      idlpgr_CachePropertyInfo(camera, FC2_SHUTTER);
+  }
+
+  return error;
+}
+
+void idlpgr_UserBuffersFree(idlpgr_userbuffers *pool)
+{
+  idlpgr_userbuffers **plink;
+  unsigned int n;
+
+  for (plink = &userbuffers; *plink; plink = &(*plink)->link)
+    if (*plink == pool) {
+      *plink = pool->link;
+      break;
+    }
+  for (n = 0; n < pool->nimages; n++)
+    fc2DestroyImage(&pool->image[n]);
+  free(pool->image);
+  free(pool->held);
+  free(pool->data);
+  free(pool);
+}
+
+fc2Error idlpgr_UserBuffersCreate(idlpgr_userbuffers **ppool,
+				  fc2Context context,
+				  unsigned int size,
+				  unsigned int nbuffers)
+{
+  idlpgr_userbuffers *pool;
+  fc2Error error;
+  unsigned int n;
+  void *data;
+
+  pool = (idlpgr_userbuffers *) calloc(1, sizeof(idlpgr_userbuffers));
+  if (!pool)
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  pool->context = context;
+  pool->size = size;
+  pool->nbuffers = nbuffers;
+  pool->nimages = nbuffers - 1;
+  pool->image = (fc2Image *) calloc(pool->nimages, sizeof(fc2Image));
+  pool->held = (int *) calloc(pool->nimages, sizeof(int));
+  if (!pool->image || !pool->held ||
+      posix_memalign(&data, 4096, (size_t) size * nbuffers)) {
+    free(pool->image);
+    free(pool->held);
+    free(pool);
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  pool->data = (unsigned char *) data;
+  for (n = 0; n < pool->nimages; n++)
+    fc2CreateImage(&pool->image[n]);
+  pool->link = userbuffers;
+  userbuffers = pool;
+
+  error = fc2SetUserBuffers(context, pool->data, (int) size, (int) nbuffers);
+  if (error) {
+    idlpgr_UserBuffersFree(pool);
+    return error;
+  }
+
+  *ppool = pool;
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_UserBuffersRelease(unsigned char *data)
+{
+  idlpgr_userbuffers *pool;
+  unsigned int n;
+
+  for (pool = userbuffers; pool; pool = pool->link)
+    for (n = 0; n < pool->nimages; n++)
+      if (pool->held[n] && pool->image[n].pData == data) {
+	pool->held[n] = 0;
+	pool->nheld--;
+	if (!pool->context && !pool->nheld)
+	  idlpgr_UserBuffersFree(pool);
+	return;
+      }
+}
+
+void idlpgr_LatestCallback(fc2Image *image, void *data)
+{
+  idlpgr_latest *latest = (idlpgr_latest *) data;
+  idlpgr_frame *frame = &latest->frame[latest->back];
+  size_t size = (size_t) image->rows * image->stride;
+  size_t capacity = size;
+  unsigned char *buffer;
+  unsigned long long start;
+
+  idlpgr_StatsFrame(latest->stats, image);
+  if (size > frame->size) {
+    // only if the frame size was not known when capture started
+    // (see idlpgr_CacheFrameSize), or the camera's mode changed
+    if (!(buffer = idlpgr_BufferAlloc(&capacity))) {
+      __atomic_add_fetch(&latest->stats->errors, 1, __ATOMIC_RELAXED);
+      return;
+    }
+    free(frame->data);
+    frame->data = buffer;
+    frame->size = capacity;
+  }
+  start = idlpgr_Now();
+  memcpy(frame->data, image->pData, size);
+  idlpgr_StatsTime(latest->stats, IDLPGR_STAGE_COPY, start);
+  frame->image = *image;
+  frame->image.pData = frame->data;
+  frame->timestamp = fc2GetImageTimeStamp(image);
+  frame->sequence = ++latest->sequence;
+  if (latest->onframe)
+    latest->onframe(latest->data, &frame->image);
+
+  latest->back = __atomic_exchange_n(&latest->middle,
+				     latest->back | IDLPGR_FRESH,
+				     __ATOMIC_ACQ_REL) & 3;
+}
+
+idlpgr_latest *idlpgr_LatestCreate(idlpgr_stats *stats, size_t framesize,
+				   idlpgr_framefn onframe, void *data)
+{
+  idlpgr_latest *latest;
+  int n;
+
+  latest = (idlpgr_latest *) calloc(1, sizeof(idlpgr_latest));
+  if (latest) {
+    latest->front = 0;
+    latest->middle = 1;
+    latest->back = 2;
+    latest->stats = stats;
+    latest->onframe = onframe;
+    latest->data = data;
+    stats->hascounter = 0;
+    for (n = 0; framesize && n < 3; n++) {
+      latest->frame[n].size = framesize;
+      latest->frame[n].data = idlpgr_BufferAlloc(&latest->frame[n].size);
+      if (!latest->frame[n].data)
+	latest->frame[n].size = 0;
+    }
+  }
+
+  return latest;
+}
+
+void idlpgr_LatestFree(idlpgr_latest *latest)
+{
+  int n;
+
+  for (n = 0; n < 3; n++)
+    free(latest->frame[n].data);
+  free(latest);
+}
+
+idlpgr_frame *idlpgr_LatestPop(idlpgr_latest *latest)
+{
+  if (__atomic_load_n(&latest->middle, __ATOMIC_ACQUIRE) & IDLPGR_FRESH)
+    latest->front = __atomic_exchange_n(&latest->middle, latest->front,
+					__ATOMIC_ACQ_REL) & 3;
+
+  return latest->frame[latest->front].sequence ?
+    &latest->frame[latest->front] : NULL;
+}
+
+//
+// Width, height and bits per pixel of the standard video modes,
+// in the order of fc2VideoMode
+//
+static const unsigned short idlpgr_videomodes[FC2_VIDEOMODE_FORMAT7][3] = {
+  {  160,  120, 24 }, {  320,  240, 16 }, {  640,  480, 12 },
+  {  640,  480, 16 }, {  640,  480, 24 }, {  640,  480,  8 },
+  {  640,  480, 16 }, {  800,  600, 16 }, {  800,  600, 24 },
+  {  800,  600,  8 }, {  800,  600, 16 }, { 1024,  768, 16 },
+  { 1024,  768, 24 }, { 1024,  768,  8 }, { 1024,  768, 16 },
+  { 1280,  960, 16 }, { 1280,  960, 24 }, { 1280,  960,  8 },
+  { 1280,  960, 16 }, { 1600, 1200, 16 }, { 1600, 1200, 24 },
+  { 1600, 1200,  8 }, { 1600, 1200, 16 }
+};
+
+//
+// The frame size is read at connect time and whenever the
+// Format7 configuration is set through idlpgr, so that frame
+// buffers can be allocated before capture starts.  Cameras in a
+// standard video mode have the size of that mode.  Frame size 0
+// means that the size is not known, and the driver allocates
+// the frame buffers.
+//
+void idlpgr_CacheFrameSize(idlpgr_camera *camera)
+{
+  fc2VideoMode mode;
+  fc2FrameRate rate;
+  fc2Format7ImageSettings settings;
+  unsigned int packetsize;
+  float percentage;
+  const unsigned short *size;
+
+  if (!fc2GetVideoModeAndFrameRate(camera->context, &mode, &rate) &&
+      mode >= 0 && mode < FC2_VIDEOMODE_FORMAT7) {
+    size = idlpgr_videomodes[mode];
+    camera->framesize = (size_t) size[0] * size[1] * size[2] / 8;
+    return;
+  }
+
+  camera->framesize =
+    fc2GetFormat7Configuration(camera->context, &settings,
+			       &packetsize, &percentage) ? 0 :
+    idlpgr_Format7FrameSize(&settings);
+}
+
+fc2Error idlpgr_CameraConnect(fc2Context context)
+{
+  idlpgr_camera *camera;
+
+  if (!(camera = idlpgr_CameraGet(context)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  idlpgr_CacheAllPropertyInfo(camera);
+  idlpgr_CacheEmbeddedImageInfo(camera);
+  idlpgr_CacheConfiguration(camera);
+  idlpgr_CacheFrameSize(camera);
+
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_CameraForget(fc2Context context)
+{
+  idlpgr_camera *camera, **pcamera;
+  idlpgr_group *group, *next;
+  idlpgr_handle *handle;
+  unsigned int n;
+
+  for (group = groups; group; group = next) {
+    next = group->next;
+    for (n = 0; n < group->ncameras; n++)
+      if (group->context[n] == context) {
+	idlpgr_GroupStop(group);
+	idlpgr_GroupFree(group);
+	break;
+      }
+  }
+
+  for (pcamera = &cameras; (camera = *pcamera); pcamera = &camera->next)
+    if (camera->context == context) {
+      // stopping capture releases threads waiting for frames
+      if (camera->recorder)
+	idlpgr_RecorderStop(camera->recorder);
+      fc2StopCapture(context);
+      if (camera->grabber)
+	idlpgr_GrabberStop(camera->grabber);
+      if (camera->latest)
+	idlpgr_LatestFree(camera->latest);
+      idlpgr_BackgroundFree(camera->background);
+      pthread_mutex_destroy(&camera->lock);
+      idlpgr_AccumulatorFree(camera->accumulator);
+      if (camera->userbuffers) {
+	camera->userbuffers->context = NULL;
+	if (!camera->userbuffers->nheld)
+	  idlpgr_UserBuffersFree(camera->userbuffers);
+      }
+      *pcamera = camera->next;
+      free(camera);
+      break;
+    }
+
+  // images keep their buffers, but are no longer sized for the camera
+  for (handle = handles; handle; handle = handle->next)
+    if (handle->context == context)
+      handle->context = NULL;
+}
+
+//
+// User buffers must be replaced before the driver writes into them.
+// Property information is read again, because the range of the
+// shutter depends on the frame rate that the new settings allow.
+//
+fc2Error idlpgr_Format7Apply(fc2Context context,
+			     fc2Format7ImageSettings *settings,
+			     unsigned int packetsize)
+{
+  idlpgr_camera *camera;
+  idlpgr_userbuffers *pool;
+  unsigned int size, nbuffers;
+  fc2Error error;
+
+  if (!(camera = idlpgr_CameraGet(context)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+
+  size = idlpgr_Format7FrameSize(settings);
+  if ((pool = camera->userbuffers) && pool->size < size) {
+    if (pool->nheld)
+      return FC2_ERROR_BUFFER_TOO_SMALL;
+    nbuffers = pool->nbuffers;
+    idlpgr_UserBuffersFree(pool);
+    camera->userbuffers = NULL;
+    error = idlpgr_UserBuffersCreate(&camera->userbuffers, context,
+				     size, nbuffers);
+    if (error)
+      return error;
+  }
+
+  error = fc2SetFormat7ConfigurationPacket(context, settings, packetsize);
+  if (error)
+    return error;
+
+  camera->image = NULL;
+  idlpgr_CacheAllPropertyInfo(camera);
+  idlpgr_CacheFrameSize(camera);
+  if (camera->framesize)
+    return idlpgr_HandlesReserve(context, camera->framesize);
+
+  return FC2_ERROR_OK;
+}
+
+//
+// Latency
+//
+// The camera's embedded time stamp records the bus cycle time at
+// the start of each exposure, which in triggered modes follows the
+// trigger by the trigger delay.  Reading the cycle time again when
+// the frame is delivered measures the latency of the whole
+// pipeline on the camera's clock.  Reading the cycle time costs a
+// register access, so latency is measured only on request.
+//
+void idlpgr_FrameLatency(idlpgr_camera *camera, const fc2Image *image)
+{
+  fc2TimeStamp now;
+  double latency;
+  int offset;
+
+  offset = idlpgr_MetadataOffset(&camera->embedded,
+				 &camera->embedded.timestamp);
+  if (offset < 0 || !image->pData ||
+      (size_t) offset + 4 > (size_t) image->rows * image->stride ||
+      fc2GetCycleTime(camera->context, &now))
+    return;
+
+  latency = idlpgr_CycleInterval(idlpgr_MetadataWord(image->pData + offset),
+				 idlpgr_CycleTime(now));
+  idlpgr_StatsInterval(&camera->stats, IDLPGR_STAGE_LATENCY,
+		       (unsigned long long) (1e9 * latency));
+  camera->latency = latency;
+}
+
+int idlpgr_FrameStatus(fc2Error error, const fc2Image *image)
+{
+  if (error)
+    return (int) error;
+  if (image->receivedDataSize < image->dataSize)
+    return IDLPGR_ERROR_INCOMPLETE;
+  return 0;
+}
+
+fc2Error idlpgr_Retrieve(fc2Context context, fc2Image *image, int newest)
+{
+  idlpgr_camera *camera;
+  unsigned long long start;
+  fc2Error error;
+
+  if (!(camera = idlpgr_CameraGet(context)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  start = idlpgr_Now();
+  if (camera->grabber) {
+    error = idlpgr_GrabberPop(camera->grabber, image, newest);
+    idlpgr_StatsTime(&camera->stats, IDLPGR_STAGE_WAIT, start);
+  } else {
+    error = fc2RetrieveBuffer(context, image);
+    idlpgr_StatsTime(&camera->stats, IDLPGR_STAGE_RETRIEVE, start);
+    if (error)
+      idlpgr_StatsError(&camera->stats, error);
+    else {
+      idlpgr_StatsFrame(&camera->stats, image);
+      idlpgr_FrameBackground(camera, image);
+    }
+  }
+  if (!error) {
+    __atomic_add_fetch(&camera->stats.delivered, 1, __ATOMIC_RELAXED);
+    camera->image = image;
+    if (camera->measurelatency)
+      idlpgr_FrameLatency(camera, image);
+  }
+
+  return error;
+}
+
+idlpgr_camera *idlpgr_ImageCamera(const fc2Image *image)
+{
+  idlpgr_camera *camera;
+
+  for (camera = cameras; camera; camera = camera->next)
+    if (camera->image == image)
+      return camera;
+
+  return NULL;
+}
+
+idlpgr_stats *idlpgr_ImageStats(const fc2Image *image)
+{
+  idlpgr_camera *camera = idlpgr_ImageCamera(image);
+
+  return camera ? &camera->stats : NULL;
+}
+
+void idlpgr_TimedTransfer(idlpgr_stats *stats, const fc2Image *image,
+			  const idlpgr_layout *layout, void *dest)
+{
+  unsigned long long start;
+
+  start = idlpgr_Now();
+  idlpgr_TransferImage(image, layout, dest);
+  idlpgr_StatsTime(stats, layout->packed12 ?
+		   IDLPGR_STAGE_CONVERT : IDLPGR_STAGE_COPY, start);
+}
+
+//
+// Frames whose pixels the background and accumulation kernels can
+// read: monochrome and raw Bayer, and unspecified formats that are
+// transferred as such.  Color frames would be summed channel by
+// channel into an array of the wrong shape, and compressed or
+// vendor formats are transferred as raw bytes.
+//
+static int idlpgr_IsMonochrome(const fc2Image *image,
+			       const idlpgr_layout *layout)
+{
+  switch (image->format) {
+  case FC2_PIXEL_FORMAT_MONO8:
+  case FC2_PIXEL_FORMAT_MONO12:
+  case FC2_PIXEL_FORMAT_MONO16:
+  case FC2_PIXEL_FORMAT_RAW8:
+  case FC2_PIXEL_FORMAT_RAW12:
+  case FC2_PIXEL_FORMAT_RAW16:
+    return 1;
+  case FC2_UNSPECIFIED_PIXEL_FORMAT:
+    return layout->ndims == 2;
+  default:
+    return 0;
+  }
+}
+
+//
+// Background
+//
+// Pixel data of image as the background kernels read them,
+// unpacking packed 12-bit frames into the estimator's scratch buffer.
+//
+static fc2Error idlpgr_BackgroundSource(idlpgr_background *background,
+					const fc2Image *image,
+					idlpgr_layout *layout,
+					const void **data, size_t *stride)
+{
+  unsigned char *scratch;
+
+  idlpgr_ImageLayout(image, layout);
+  if (!idlpgr_IsMonochrome(image, layout) || !image->pData)
+    return FC2_ERROR_INVALID_PARAMETER;
+
+  if (!layout->packed12) {
+    *data = image->pData;
+    *stride = image->stride;
+    return FC2_ERROR_OK;
+  }
+
+  if (background->scratchsize < layout->size) {
+    if (!(scratch = (unsigned char *) realloc(background->scratch,
+					      layout->size)))
+      return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+    background->scratch = scratch;
+    background->scratchsize = layout->size;
+  }
+  idlpgr_TransferImage(image, layout, background->scratch);
+  *data = background->scratch;
+  *stride = layout->rowbytes;
+
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_FrameBackground(idlpgr_camera *camera, const fc2Image *image)
+{
+  idlpgr_layout layout;
+  const void *data;
+  size_t stride;
+  unsigned long long start;
+
+  pthread_mutex_lock(&camera->lock);
+  start = idlpgr_Now();
+  if (camera->background &&
+      !idlpgr_BackgroundSource(camera->background, image, &layout,
+			       &data, &stride)) {
+    idlpgr_BackgroundUpdate(camera->background, data, stride,
+			    (unsigned int) layout.dim[1],
+			    (unsigned int) layout.dim[0], layout.depth);
+    idlpgr_StatsTime(&camera->stats, IDLPGR_STAGE_BACKGROUND, start);
+  }
+  pthread_mutex_unlock(&camera->lock);
+}
+
+void idlpgr_CameraFrame(void *data, const fc2Image *image)
+{
+  idlpgr_FrameBackground((idlpgr_camera *) data, image);
+}
+
+float *idlpgr_BackgroundEstimate(idlpgr_camera *camera, int median,
+				 unsigned int *rows, unsigned int *cols,
+				 unsigned long long *nframes)
+{
+  idlpgr_background *background;
+  float *copy = NULL;
+  size_t size;
+
+  pthread_mutex_lock(&camera->lock);
+  background = camera->background;
+  *nframes = background ? background->nframes : 0;
+  if (*nframes) {
+    *rows = background->rows;
+    *cols = background->cols;
+    size = (size_t) *rows * *cols * sizeof(float);
+    if ((copy = (float *) malloc(size)))
+      memcpy(copy, median ? background->median : background->mean, size);
+  }
+  pthread_mutex_unlock(&camera->lock);
+
+  return copy;
+}
+
+fc2Error idlpgr_FrameNormalize(idlpgr_camera *camera, const fc2Image *image,
+			       int median, float *dest)
+{
+  idlpgr_layout layout;
+  const void *data;
+  size_t stride;
+  unsigned long long start;
+  fc2Error error;
+
+  pthread_mutex_lock(&camera->lock);
+  start = idlpgr_Now();
+  if (!camera->background || !camera->background->nframes)
+    error = FC2_ERROR_NOT_INTITIALIZED;
+  else
+    error = idlpgr_BackgroundSource(camera->background, image, &layout,
+				    &data, &stride);
+  if (!error &&
+      idlpgr_BackgroundNormalize(camera->background, data, stride,
+				 (unsigned int) layout.dim[1],
+				 (unsigned int) layout.dim[0], layout.depth,
+				 median, dest))
+    error = FC2_ERROR_INVALID_PARAMETER;
+  pthread_mutex_unlock(&camera->lock);
+  if (!error)
+    idlpgr_StatsTime(&camera->stats, IDLPGR_STAGE_CONVERT, start);
+
+  return error;
+}
+
+//
+// Accumulation
+//
+// The time spent adding frames is recorded as conversion.
+//
+static fc2Error idlpgr_AccumulateFrame(idlpgr_camera *camera,
+				       const fc2Image *image,
+				       const idlpgr_layout *layout)
+{
+  idlpgr_accumulator *acc = camera->accumulator;
+  unsigned char *scratch;
+  unsigned long long start;
+  int status;
+
+  start = idlpgr_Now();
+  if (layout->packed12) {
+    if (acc->scratchsize < layout->size) {
+      if (!(scratch = (unsigned char *) realloc(acc->scratch, layout->size)))
+	return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+      acc->scratch = scratch;
+      acc->scratchsize = layout->size;
+    }
+    idlpgr_TransferImage(image, layout, acc->scratch);
+    status = idlpgr_AccumulatorAdd(acc, acc->scratch, layout->rowbytes);
+  } else
+    status = idlpgr_AccumulatorAdd(acc, image->pData, image->stride);
+  idlpgr_StatsTime(&camera->stats, IDLPGR_STAGE_CONVERT, start);
+
+  return status ? FC2_ERROR_INVALID_PARAMETER : FC2_ERROR_OK;
+}
+
+fc2Error idlpgr_Accumulate(fc2Context context, fc2Image *image,
+			   unsigned int nframes,
+			   int isfloat, int variance,
+			   idlpgr_layout *layout,
+			   idlpgr_accumulator **paccumulator)
+{
+  idlpgr_camera *camera;
+  unsigned int n, rows, cols;
+  fc2PixelFormat format;
+  fc2Error error;
+
+  if (!nframes)
+    return FC2_ERROR_INVALID_PARAMETER;
+  if (!(camera = idlpgr_CameraGet(context)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  if (!camera->accumulator &&
+      !(camera->accumulator = idlpgr_AccumulatorCreate(0)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+
+  // first frame determines the geometry of the integration
+  if ((error = idlpgr_Retrieve(context, image, 0)))
+    return error;
+  rows = image->rows;
+  cols = image->cols;
+  format = image->format;
+  idlpgr_ImageLayout(image, layout);
+  if (!idlpgr_IsMonochrome(image, layout))
+    return FC2_ERROR_NOT_SUPPORTED;
+  if (!isfloat && nframes > idlpgr_AccumulatorMaxFrames(layout->depth))
+    return FC2_ERROR_INVALID_PARAMETER;
+  if (idlpgr_AccumulatorStart(camera->accumulator,
+			      (unsigned int) layout->dim[layout->ndims - 1],
+			      (unsigned int) (layout->rowbytes / layout->depth),
+			      layout->depth, isfloat, variance))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+
+  for (n = 0; n < nframes; n++) {
+    if (n > 0) {
+      error = idlpgr_Retrieve(context, image, 0);
+      if (!error && (image->rows != rows || image->cols != cols ||
+		     image->format != format))
+	error = FC2_ERROR_IMAGE_CONSISTENCY_ERROR;
+      if (error)
+	return error;
+    }
+    if ((error = idlpgr_AccumulateFrame(camera, image, layout)))
+      return error;
+  }
+
+  *paccumulator = camera->accumulator;
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_FrameMetadata(idlpgr_camera *camera, const fc2Image *image,
+			  fc2TimeStamp ts, idlpgr_metadata *metadata)
+{
+  if (!camera->hasembedded)
+    idlpgr_CacheEmbeddedImageInfo(camera);
+
+  idlpgr_MetadataDecode(image->pData, (size_t) image->rows * image->stride,
+			&camera->embedded, ts, &camera->clock, metadata);
+}
+
+fc2Error idlpgr_ReadBurst(fc2Context context, fc2Image *image,
+			  unsigned int nframes,
+			  const idlpgr_layout *layout, void *dest,
+			  double *timestamps,
+			  idlpgr_metadata *metadata,
+			  unsigned long long *delivered)
+{
+  idlpgr_camera *camera;
+  unsigned char *pd = (unsigned char *) dest;
+  unsigned int n, rows, cols;
+  fc2PixelFormat format;
+  fc2TimeStamp ts;
+  fc2Error error;
+
+  if (!(camera = idlpgr_CameraGet(context)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+
+  // first frame determines the geometry of the burst
+  rows = image->rows;
+  cols = image->cols;
+  format = image->format;
+  for (n = 0; n < nframes; n++) {
+    if (n > 0) {
+      error = idlpgr_Retrieve(context, image, 0);
+      if (delivered)
+	delivered[n] = idlpgr_Now();
+      if (!error && (image->rows != rows || image->cols != cols ||
+		     image->format != format))
+	error = FC2_ERROR_IMAGE_CONSISTENCY_ERROR;
+      if (error)
+	return error;
+    }
+    idlpgr_TimedTransfer(&camera->stats, image, layout,
+			 pd + n * layout->size);
+    ts = fc2GetImageTimeStamp(image);
+    if (timestamps)
+      timestamps[n] = idlpgr_TimeStampSeconds(ts);
+    if (metadata)
+      idlpgr_FrameMetadata(camera, image, ts, metadata + n);
+  }
+
+  return FC2_ERROR_OK;
+}
+
+//
+// Synchronized capture
+//
+// A group starts capture on several cameras together with
+// fc2StartSyncCapture.  Each camera either has a grabber thread
+// retrieving frames into its own ring, or delivers frames to a
+// callback that keeps the most recent one.  Frames are assembled
+// into sets by time stamp: a frame that is older than the newest
+// frame in the set by more than the tolerance belongs to an
+// earlier set and is discarded, so a frame missed by one camera
+// does not shift the pairing of later frames.
+//
+double idlpgr_TimeStampSeconds(fc2TimeStamp ts)
+{
+  return (double) ts.seconds + 1e-6 * (double) ts.microSeconds;
+}
+
+void idlpgr_GroupFree(idlpgr_group *group)
+{
+  idlpgr_group **p;
+
+  for (p = &groups; *p; p = &(*p)->next)
+    if (*p == group) {
+      *p = group->next;
+      break;
+    }
+  free(group->context);
+  free(group->camera);
+  free(group->sequence);
+  free(group);
+}
+
+idlpgr_group *idlpgr_GroupFind(const void *handle)
+{
+  idlpgr_group *group;
+
+  for (group = groups; group; group = group->next)
+    if (group == handle)
+      break;
+
+  return group;
+}
+
+fc2Error idlpgr_GroupStart(idlpgr_group **pgroup,
+			   unsigned int ncameras,
+			   const fc2Context *context,
+			   int callback,
+			   unsigned int nbuffers,
+			   double tolerance)
+{
+  fc2Error error;
+  fc2Property property;
+  fc2ImageEventCallback *callbacks;
+  void **data;
+  idlpgr_group *group;
+  idlpgr_camera *camera;
+  unsigned int n;
+
+  group = (idlpgr_group *) calloc(1, sizeof(idlpgr_group));
+  if (group) {
+    group->context = (fc2Context *) calloc(ncameras, sizeof(fc2Context));
+    group->camera = (idlpgr_camera **) calloc(ncameras,
+					      sizeof(idlpgr_camera *));
+    group->sequence = (unsigned long long *)
+      calloc(ncameras, sizeof(unsigned long long));
+  }
+  if (!group || !group->context || !group->camera || !group->sequence) {
+    if (group)
+      idlpgr_GroupFree(group);
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  group->ncameras = ncameras;
+  group->callback = callback;
+  for (n = 0; n < ncameras; n++) {
+    group->context[n] = context[n];
+    group->camera[n] = camera = idlpgr_CameraGet(context[n]);
+    error = !camera ? FC2_ERROR_MEMORY_ALLOCATION_FAILED :
+      (camera->grabber || camera->latest || camera->recorder) ?
+      FC2_ERROR_ISOCH_ALREADY_STARTED : FC2_ERROR_OK;
+    if (error) {
+      idlpgr_GroupFree(group);
+      return error;
+    }
+  }
+
+  group->tolerance = IDLPGR_SYNC_TOLERANCE;
+  memset(&property, 0, sizeof(fc2Property));
+  property.type = FC2_FRAME_RATE;
+  if (tolerance >= 0.)
+    group->tolerance = tolerance;
+  else if (!fc2GetProperty(group->context[0], &property) &&
+	   property.absValue > 0.)
+    group->tolerance = 0.5 / property.absValue;
+
+  if (group->callback) {
+    callbacks = (fc2ImageEventCallback *)
+      calloc(ncameras, sizeof(fc2ImageEventCallback));
+    data = (void **) calloc(ncameras, sizeof(void *));
+    error = (callbacks && data) ? FC2_ERROR_OK :
+      FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+    for (n = 0; !error && n < group->ncameras; n++) {
+      if (!(group->camera[n]->latest =
+	    idlpgr_LatestCreate(&group->camera[n]->stats,
+				group->camera[n]->framesize,
+				idlpgr_CameraFrame, group->camera[n])))
+	error = FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+      callbacks[n] = idlpgr_LatestCallback;
+      data[n] = group->camera[n]->latest;
+    }
+    if (!error)
+      error = fc2StartSyncCaptureCallback(group->ncameras, group->context,
+					  callbacks, data);
+    free(callbacks);
+    free(data);
+  } else {
+    error = fc2StartSyncCapture(group->ncameras, group->context);
+    for (n = 0; !error && n < group->ncameras; n++)
+      error = idlpgr_GrabberStart(&group->camera[n]->grabber,
+				  group->context[n],
+				  nbuffers,
+				  idlpgr_GrabTimeout(group->camera[n]),
+				  &group->camera[n]->stats,
+				  group->camera[n]->framesize,
+				  idlpgr_CameraFrame, group->camera[n]);
+  }
+  if (error) {
+    idlpgr_GroupStop(group);
+    idlpgr_GroupFree(group);
+    return error;
+  }
+
+  group->next = groups;
+  groups = group;
+
+  *pgroup = group;
+  return FC2_ERROR_OK;
+}
+
+//
+// Stop capture on every camera in the group and release
+// the per-camera buffers.
+//
+void idlpgr_GroupStop(idlpgr_group *group)
+{
+  idlpgr_camera *camera;
+  unsigned int n;
+
+  for (n = 0; n < group->ncameras; n++)
+    fc2StopCapture(group->context[n]);
+
+  for (n = 0; n < group->ncameras; n++) {
+    camera = group->camera[n];
+    if (camera->grabber) {
+      idlpgr_GrabberStop(camera->grabber);
+      camera->grabber = NULL;
+    }
+    if (camera->latest) {
+      idlpgr_LatestFree(camera->latest);
+      camera->latest = NULL;
+    }
+  }
+}
+
+fc2Error idlpgr_GroupMatch(idlpgr_group *group, fc2Image **image, double *t)
+{
+  struct timespec pause = { 0, 100000 };
+  idlpgr_frame *frame;
+  unsigned int n;
+  double tmax, waited;
+  fc2Error error;
+  int ready;
+
+  if (!group->callback) {
+    for (;;) {
+      tmax = -HUGE_VAL;
+      for (n = 0; n < group->ncameras; n++) {
+	error = idlpgr_GrabberPeek(group->camera[n]->grabber, &image[n]);
+	if (error)
+	  return error;
+	t[n] = idlpgr_TimeStampSeconds(fc2GetImageTimeStamp(image[n]));
+	if (t[n] > tmax)
+	  tmax = t[n];
+      }
+      ready = 1;
+      for (n = 0; n < group->ncameras; n++)
+	if (t[n] < tmax - group->tolerance) {
+	  idlpgr_GrabberDrop(group->camera[n]->grabber);
+	  group->dropped++;
+	  ready = 0;
+	}
+      if (ready)
+	return FC2_ERROR_OK;
+    }
+  }
+
+  for (waited = 0.; waited < IDLPGR_SYNC_TIMEOUT; waited += 1e-4) {
+    tmax = -HUGE_VAL;
+    ready = 1;
+    for (n = 0; n < group->ncameras; n++) {
+      frame = idlpgr_LatestPop(group->camera[n]->latest);
+      if (!frame || frame->sequence == group->sequence[n]) {
+	ready = 0;
+	continue;
+      }
+      image[n] = &frame->image;
+      t[n] = idlpgr_TimeStampSeconds(frame->timestamp);
+      if (t[n] > tmax)
+	tmax = t[n];
+    }
+    for (n = 0; ready && n < group->ncameras; n++)
+      if (t[n] < tmax - group->tolerance)
+	ready = 0;
+    if (ready) {
+      for (n = 0; n < group->ncameras; n++) {
+	frame = group->camera[n]->latest->frame +
+	  group->camera[n]->latest->front;
+	if (frame->sequence > group->sequence[n] + 1)
+	  group->dropped += frame->sequence - group->sequence[n] - 1;
+	group->sequence[n] = frame->sequence;
+      }
+      return FC2_ERROR_OK;
+    }
+    nanosleep(&pause, NULL);
+  }
+
+  return FC2_ERROR_TIMEOUT;
+}
+
+void idlpgr_GroupRelease(idlpgr_group *group)
+{
+  unsigned int n;
+
+  if (!group->callback)
+    for (n = 0; n < group->ncameras; n++)
+      idlpgr_GrabberDrop(group->camera[n]->grabber);
+}
+
+//
+// Packet-size tuning
+//
+// Each candidate setting is applied and measured with a short burst
+// of frames.
+//
+// The first frame may have been exposed before the setting
+// took effect, and is discarded.
+//
+static void idlpgr_TuneBurst(fc2Context context, fc2Image *image,
+			     unsigned int nframes, idlpgr_tuning *tuning)
+{
+  fc2Error error;
+  unsigned long long now, first = 0, last = 0;
+  unsigned int n, datasize = 0;
+
+  tuning->rate = tuning->bandwidth = 0.;
+  tuning->frames = tuning->incomplete = tuning->errors = tuning->timeouts = 0;
+
+  if (fc2StartCapture(context)) {
+    tuning->errors = nframes;
+    return;
+  }
+
+  error = fc2RetrieveBuffer(context, image);
+  if (error == FC2_ERROR_TIMEOUT)
+    tuning->timeouts++;
+  else if (error && error != FC2_ERROR_IMAGE_CONSISTENCY_ERROR) {
+    // capture failed, and so would every frame of the burst
+    tuning->errors = nframes;
+    fc2StopCapture(context);
+    return;
+  }
+  for (n = 0; n < nframes; n++) {
+    error = fc2RetrieveBuffer(context, image);
+    now = idlpgr_Now();
+    if (error == FC2_ERROR_TIMEOUT)
+      tuning->timeouts++;
+    else if (error)
+      tuning->errors++;
+    else {
+      if (image->receivedDataSize < image->dataSize)
+	tuning->incomplete++;
+      if (!tuning->frames++)
+	first = now;
+      last = now;
+      datasize = image->dataSize;
+    }
+  }
+  fc2StopCapture(context);
+
+  if (tuning->frames > 1 && last > first) {
+    tuning->rate = 1e9 * (tuning->frames - 1) / (double) (last - first);
+    tuning->bandwidth = 1e-6 * tuning->rate * datasize;
+  }
+}
+
+static unsigned int idlpgr_TuneBad(const idlpgr_tuning *tuning)
+{
+  return tuning->incomplete + tuning->errors + tuning->timeouts;
+}
+
+//
+// A setting is stable if every frame of its burst arrives complete.
+// The best setting is the stable one with the highest frame rate;
+// if no setting is stable, the one with the fewest bad frames wins.
+// Candidates are measured in order of preference, so that ties go
+// to larger packets and shorter delays.
+//
+static int idlpgr_TuneBetter(const idlpgr_tuning *a, const idlpgr_tuning *b)
+{
+  if (idlpgr_TuneBad(a) != idlpgr_TuneBad(b))
+    return idlpgr_TuneBad(a) < idlpgr_TuneBad(b);
+  return a->rate > b->rate;
+}
+
+//
+// Format7 packet sizes are spread up to the largest size that the
+// camera allows for the current settings, in multiples of the packet
+// unit.  GigE packet sizes are spread from the standard to the jumbo
+// frame payload, and the inter-packet delay is then swept at the
+// best packet size.
+//
+fc2Error idlpgr_Tune(fc2Context context,
+		     unsigned int nframes, unsigned int nsteps,
+		     int timeout, unsigned int maxdelay,
+		     idlpgr_tuning *tuning,
+		     unsigned int *npoints, unsigned int *best)
+{
+  fc2Error error, restored;
+  fc2Config config, saved;
+  fc2CameraInfo info;
+  fc2GigEStreamChannel channel, original;
+  fc2Format7ImageSettings settings;
+  fc2Format7PacketInfo packetinfo;
+  fc2Image image;
+  unsigned int n, packetsize, unit, size;
+  float percentage;
+  BOOL valid;
+  idlpgr_camera *camera;
+  int gige, received;
+
+  *npoints = *best = 0;
+  if (nframes < 2 || nsteps < 2 || nsteps > IDLPGR_TUNE_MAXSTEPS)
+    return FC2_ERROR_INVALID_PARAMETER;
+  if (!(camera = idlpgr_CameraGet(context)))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  if (camera->grabber || camera->latest || camera->recorder)
+    return FC2_ERROR_ISOCH_ALREADY_STARTED;
+
+  if ((error = fc2GetCameraInfo(context, &info)) ||
+      (error = fc2GetConfiguration(context, &config)))
+    return error;
+  gige = (info.interfaceType == FC2_INTERFACE_GIGE);
+
+  if (gige)
+    error = fc2GetGigEStreamChannelInfo(context, 0, &channel);
+  else {
+    error = fc2GetFormat7Configuration(context, &settings,
+				       &packetsize, &percentage);
+    if (!error)
+      error = fc2ValidateFormat7Settings(context, &settings,
+					 &valid, &packetinfo);
+  }
+  if (error)
+    return FC2_ERROR_NOT_SUPPORTED;
+
+  // a lost frame must not stall the sweep
+  saved = config;
+  config.grabTimeout = timeout;
+  if ((error = fc2SetConfiguration(context, &config)))
+    return error;
+  fc2CreateImage(&image);
+
+  if (gige) {
+    original = channel;
+    for (n = 0; n < nsteps; n++, (*npoints)++) {
+      memset(&tuning[*npoints], 0, sizeof(idlpgr_tuning));
+      tuning[*npoints].packetsize = (IDLPGR_TUNE_MAXPACKET -
+	(IDLPGR_TUNE_MAXPACKET - IDLPGR_TUNE_MINPACKET) * n / (nsteps - 1)) &
+	~3U;
+      tuning[*npoints].delay = channel.interPacketDelay;
+      channel.packetSize = tuning[*npoints].packetsize;
+      if (fc2SetGigEStreamChannelInfo(context, 0, &channel))
+	tuning[*npoints].errors = nframes;
+      else
+	idlpgr_TuneBurst(context, &image, nframes, &tuning[*npoints]);
+      if (idlpgr_TuneBetter(&tuning[*npoints], &tuning[*best]))
+	*best = *npoints;
+    }
+    channel.packetSize = tuning[*best].packetsize;
+    for (n = 0; n < nsteps; n++, (*npoints)++) {
+      memset(&tuning[*npoints], 0, sizeof(idlpgr_tuning));
+      tuning[*npoints].packetsize = channel.packetSize;
+      tuning[*npoints].delay = maxdelay * n / (nsteps - 1);
+      channel.interPacketDelay = tuning[*npoints].delay;
+      if (fc2SetGigEStreamChannelInfo(context, 0, &channel))
+	tuning[*npoints].errors = nframes;
+      else
+	idlpgr_TuneBurst(context, &image, nframes, &tuning[*npoints]);
+      if (idlpgr_TuneBetter(&tuning[*npoints], &tuning[*best]))
+	*best = *npoints;
+    }
+    // without frames, the best setting is no better than the original
+    received = (tuning[*best].frames > 0);
+    if (received) {
+      channel.packetSize = tuning[*best].packetsize;
+      channel.interPacketDelay = tuning[*best].delay;
+    } else
+      channel = original;
+    error = fc2SetGigEStreamChannelInfo(context, 0, &channel);
+  } else {
+    unit = packetinfo.unitBytesPerPacket ? packetinfo.unitBytesPerPacket : 4;
+    for (n = nsteps; n > 0; n--) {
+      size = packetinfo.maxBytesPerPacket * n / nsteps;
+      size = (size / unit) * unit;
+      if (size < unit ||
+	  (*npoints && size == tuning[*npoints - 1].packetsize))
+	continue;
+      memset(&tuning[*npoints], 0, sizeof(idlpgr_tuning));
+      tuning[*npoints].packetsize = size;
+      if (fc2SetFormat7ConfigurationPacket(context, &settings, size))
+	tuning[*npoints].errors = nframes;
+      else
+	idlpgr_TuneBurst(context, &image, nframes, &tuning[*npoints]);
+      if (idlpgr_TuneBetter(&tuning[*npoints], &tuning[*best]))
+	*best = *npoints;
+      (*npoints)++;
+    }
+    received = *npoints && (tuning[*best].frames > 0);
+    error = fc2SetFormat7ConfigurationPacket(context, &settings,
+					     received ?
+					     tuning[*best].packetsize :
+					     packetsize);
+  }
+
+  fc2DestroyImage(&image);
+  restored = fc2SetConfiguration(context, &saved);
+  if (!error)
+    error = restored;
+  idlpgr_CacheConfiguration(camera);
+
+  if (!error && !received)
+    error = *npoints ? FC2_ERROR_TIMEOUT : FC2_ERROR_NOT_SUPPORTED;
+  return error;
+}
+
+//
+// Timed software triggers
+//
+// A native thread fires a train of software triggers at absolute
+// deadlines on the monotonic clock while the interpreter retrieves
+// the frames, so that neither retrieval nor the interpreter delays
+// the triggers.  The thread sleeps until shortly before each
+// deadline and spins for the remainder, which trades a fraction of
+// a millisecond of processor time per trigger for timing that is
+// limited by the clock rather than by the scheduler.
+//
+static void idlpgr_SleepUntil(unsigned long long deadline)
+{
+  struct timespec ts;
+  unsigned long long wake;
+
+  if (deadline > IDLPGR_TRIGGER_SPIN + idlpgr_Now()) {
+    wake = deadline - IDLPGR_TRIGGER_SPIN;
+    ts.tv_sec = (time_t) (wake / 1000000000ULL);
+    ts.tv_nsec = (long) (wake % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+      ;
+  }
+  while (idlpgr_Now() < deadline)
+    ;
+}
+
+static void *idlpgr_TriggerThread(void *arg)
+{
+  idlpgr_trigger *trigger = (idlpgr_trigger *) arg;
+  fc2Error error;
+  unsigned int n;
+
+  for (n = 0; n < trigger->ntriggers; n++) {
+    if (!__atomic_load_n(&trigger->running, __ATOMIC_ACQUIRE))
+      break;
+    idlpgr_SleepUntil(trigger->start + n * trigger->interval);
+    error = trigger->broadcast ?
+      fc2FireSoftwareTriggerBroadcast(trigger->context) :
+      fc2FireSoftwareTrigger(trigger->context);
+    trigger->fired[n] = idlpgr_Now();
+    if (error) {
+      trigger->error = error;
+      break;
+    }
+    __atomic_store_n(&trigger->nfired, n + 1, __ATOMIC_RELEASE);
+  }
+
+  return NULL;
+}
+
+fc2Error idlpgr_TriggerStart(idlpgr_trigger *trigger,
+			     fc2Context context,
+			     unsigned int ntriggers,
+			     double interval,
+			     int broadcast,
+			     unsigned long long *fired)
+{
+  memset(trigger, 0, sizeof(idlpgr_trigger));
+  trigger->context = context;
+  trigger->broadcast = broadcast;
+  trigger->ntriggers = ntriggers;
+  trigger->interval = (unsigned long long) (1e9 * interval);
+  trigger->fired = fired;
+  trigger->running = 1;
+  trigger->start = idlpgr_Now() + IDLPGR_TRIGGER_SPIN;
+
+  if (pthread_create(&trigger->thread, NULL, idlpgr_TriggerThread, trigger))
+    return FC2_ERROR_FAILED;
+
+  return FC2_ERROR_OK;
+}
+
+fc2Error idlpgr_TriggerStop(idlpgr_trigger *trigger)
+{
+  __atomic_store_n(&trigger->running, 0, __ATOMIC_RELEASE);
+  pthread_join(trigger->thread, NULL);
+
+  return trigger->error;
+}
@@ -0,0 +1,525 @@
+//
+// idlpgr_core.h
+//
+// Per-camera state and acquisition engine of idlpgr: pooled
+// image handles, user buffers, newest-frame capture, the camera
+// registry, synchronized capture groups, packet-size tuning and
+// timed software triggers.  The idlpgr DLM marshals IDL arguments
+// onto these functions, and idlpgr_api.h exposes them to native
+// programs.  Does not depend on IDL.
+//
+// Functions that can fail return an fc2Error and never exit
+// or jump, so that each binding reports errors in its own way.
+// None of this state is protected against concurrent calls from
+// several threads; the grabber, recorder and driver callbacks
+// synchronize with it as described for each of them.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Added background estimates.
+// 10/16/2026 DGG Added frame accumulation.
+// 10/16/2026 DGG Background estimates updated as frames are retrieved.
+// 10/16/2026 DGG Kernels selected by the core.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_CORE_H
+#define IDLPGR_CORE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "C/FlyCapture2_C.h"
+
+#include "idlpgr_capture.h"
+#include "idlpgr_record.h"
+#include "idlpgr_metadata.h"
+#include "idlpgr_background.h"
+#include "idlpgr_accumulate.h"
+
+//
+// Slots in the ring of the background grabber,
+// by default and when recording
+//
+#define IDLPGR_NBUFFERS 10
+#define IDLPGR_RECORD_NBUFFERS 64
+
+//
+// Pixel kernels
+//
+// The unpacking, demosaicing, background and accumulation kernels
+// are chosen for the host CPU once per process, by the first call
+// to idlpgr_SelectAllKernels.  Each binding calls it before any
+// frame is transferred.  Safe to call from several threads.
+//
+typedef struct idlpgr_kernelnames {
+  const char *unpack;          // instruction set of each stage
+  const char *demosaic;
+  const char *background;
+  const char *accumulate;
+} idlpgr_kernelnames;
+
+const idlpgr_kernelnames *idlpgr_SelectAllKernels(void);
+
+//
+// Image handles
+//
+// fc2Images handed out by idlpgr_HandleCreate are drawn from a
+// pool and returned to it by idlpgr_HandleDestroy, so that their
+// buffers are reused rather than freed and allocated again.
+// A handle created for a context holds an aligned buffer sized
+// for the camera's frames, which grows when a larger Format7
+// configuration is set.
+//
+typedef struct idlpgr_handle {
+  fc2Image image;              // first, so that the handle is the image
+  fc2Context context;          // camera that the buffer is sized for
+  int inuse;
+  struct idlpgr_handle *next;
+} idlpgr_handle;
+
+idlpgr_handle *idlpgr_FindHandle(const fc2Image *image);
+
+//
+// Image from the pool, with a buffer sized for frames
+// from context, if context is not NULL.
+//
+fc2Error idlpgr_HandleCreate(fc2Context context, fc2Image **pimage);
+
+//
+// Return image to the pool.  FC2_ERROR_INVALID_PARAMETER
+// if image was not created by idlpgr_HandleCreate.
+//
+fc2Error idlpgr_HandleDestroy(fc2Image *image);
+
+//
+// Grow the buffers of the handles in use on context to framesize
+//
+fc2Error idlpgr_HandlesReserve(fc2Context context, size_t framesize);
+
+//
+// User buffers
+//
+// A pool of page-aligned buffers registered with fc2SetUserBuffers
+// so that the driver writes frames directly into memory that the
+// caller can read.  The driver does not recycle a buffer while an
+// fc2Image still refers to it, so each frame handed out is held by
+// one of the pool's fc2Images until idlpgr_UserBuffersRelease is
+// called for its data.  One buffer is always left to the driver.
+// A pool whose context has been destroyed survives until the last
+// of its frames is released.
+//
+typedef struct idlpgr_userbuffers {
+  fc2Context context;          // NULL once the context is destroyed
+  unsigned char *data;
+  unsigned int size;           // bytes per buffer
+  unsigned int nbuffers;
+  unsigned int nimages;        // frames that may be held at once
+  unsigned int nheld;
+  unsigned int next;           // next image to try
+  fc2Image *image;
+  int *held;
+  struct idlpgr_userbuffers *link;
+} idlpgr_userbuffers;
+
+fc2Error idlpgr_UserBuffersCreate(idlpgr_userbuffers **ppool,
+				  fc2Context context,
+				  unsigned int size,
+				  unsigned int nbuffers);
+void idlpgr_UserBuffersFree(idlpgr_userbuffers *pool);
+
+//
+// The frame at data is no longer in use.  Has the signature
+// of an IDL_ImportArray callback.
+//
+void idlpgr_UserBuffersRelease(unsigned char *data);
+
+//
+// Newest-frame capture
+//
+// Frames delivered by fc2StartCaptureCallback are copied into
+// a triple buffer that retains only the most recent frame.
+// The driver's callback thread owns the back buffer and the
+// consumer owns the front buffer.  The middle buffer is exchanged
+// atomically with either side, and its index is packed together
+// with a flag that marks it as holding a frame the consumer
+// has not yet seen.
+//
+#define IDLPGR_FRESH 4
+
+typedef struct idlpgr_frame {
+  fc2Image image;              // geometry; pData refers to data
+  unsigned char *data;
+  size_t size;                 // capacity of data
+  unsigned long long sequence;
+  fc2TimeStamp timestamp;
+} idlpgr_frame;
+
+typedef struct idlpgr_latest {
+  idlpgr_frame frame[3];
+  int middle;                  // index of middle buffer | IDLPGR_FRESH
+  int back;                    // owned by the callback
+  int front;                   // owned by the consumer
+  unsigned long long sequence; // frames received
+  unsigned long long consumed; // sequence of the last frame read
+  idlpgr_stats *stats;
+  idlpgr_framefn onframe;      // or NULL
+  void *data;                  // passed to onframe
+} idlpgr_latest;
+
+//
+// Frame buffers of framesize bytes are allocated in advance,
+// so that the callback does not allocate memory.  onframe is
+// called in the callback with each frame, as in the grabber.
+//
+idlpgr_latest *idlpgr_LatestCreate(idlpgr_stats *stats, size_t framesize,
+				   idlpgr_framefn onframe, void *data);
+void idlpgr_LatestFree(idlpgr_latest *latest);
+
+//
+// fc2ImageEventCallback with data pointing to an idlpgr_latest
+//
+void idlpgr_LatestCallback(fc2Image *image, void *data);
+
+//
+// Most recent frame delivered by the callback, or NULL if no
+// frame has arrived yet.  Never blocks.
+//
+idlpgr_frame *idlpgr_LatestPop(idlpgr_latest *latest);
+
+//
+// Cameras
+//
+// State kept for each context on which the core has been used.
+//
+typedef struct idlpgr_camera {
+  fc2Context context;
+  idlpgr_grabber *grabber;
+  idlpgr_userbuffers *userbuffers;
+  idlpgr_latest *latest;
+  idlpgr_recorder *recorder;
+  int haspropinfo;             // propinfo has been read from the camera
+  fc2PropertyInfo propinfo[FC2_UNSPECIFIED_PROPERTY_TYPE];
+  int hasembedded;             // embedded has been read from the camera
+  fc2EmbeddedImageInfo embedded;
+  idlpgr_clock clock;          // unwraps the camera's cycle time
+  int hasconfig;               // config has been read from the camera
+  fc2Config config;
+  idlpgr_stats stats;
+  const fc2Image *image;       // image that last received a frame
+  size_t framesize;            // bytes per frame, or 0 if not known
+  int measurelatency;          // latency of each frame is measured
+  double latency;              // [s] of the last frame measured, or -1
+  pthread_mutex_t lock;        // guards background, which is updated
+                               // in the thread that retrieves frames
+  idlpgr_background *background; // estimates updated with each frame
+  idlpgr_accumulator *accumulator; // sums of the last integration
+  struct idlpgr_camera *next;
+} idlpgr_camera;
+
+//
+// State of context, or NULL if there is none
+//
+idlpgr_camera *idlpgr_FindCamera(fc2Context context);
+
+//
+// State of context, created if there is none.
+// NULL only if it could not be allocated.
+//
+idlpgr_camera *idlpgr_CameraGet(fc2Context context);
+
+//
+// Read the camera's static information after fc2Connect
+//
+fc2Error idlpgr_CameraConnect(fc2Context context);
+
+//
+// Stop everything running on context and discard its state,
+// before fc2DestroyContext.  Synchronized capture stops if
+// any of its cameras is forgotten.
+//
+void idlpgr_CameraForget(fc2Context context);
+
+void idlpgr_CacheAllPropertyInfo(idlpgr_camera *camera);
+void idlpgr_CacheEmbeddedImageInfo(idlpgr_camera *camera);
+void idlpgr_CacheConfiguration(idlpgr_camera *camera);
+void idlpgr_CacheFrameSize(idlpgr_camera *camera);
+
+//
+// Time limit [ms] for retrieving a frame, or < 0 for no limit
+//
+int idlpgr_GrabTimeout(const idlpgr_camera *camera);
+
+//
+// fc2GetPropertyInfo and fc2SetProperty through the cache
+//
+fc2Error idlpgr_PropertyInfo(fc2Context context, fc2PropertyInfo *info);
+fc2Error idlpgr_WriteProperty(fc2Context context, fc2Property *property);
+
+//
+// Apply Format7 settings that the camera has validated, replacing
+// user buffers that are too small for the new frames and growing
+// the buffers of image handles.  FC2_ERROR_BUFFER_TOO_SMALL if
+// the user buffers must be replaced while frames are still held.
+//
+fc2Error idlpgr_Format7Apply(fc2Context context,
+			     fc2Format7ImageSettings *settings,
+			     unsigned int packetsize);
+
+//
+// Retrieval
+//
+// Status of a frame that was delivered with missing data.
+// Not an fc2Error: FlyCapture2 delivers such frames without
+// an error.
+//
+#define IDLPGR_ERROR_INCOMPLETE (-2)
+
+//
+// Status of a retrieval: the fc2Error of a failed retrieval,
+// IDLPGR_ERROR_INCOMPLETE for a frame with missing data, and
+// 0 for a complete frame.
+//
+int idlpgr_FrameStatus(fc2Error error, const fc2Image *image);
+
+//
+// Retrieve the next frame for context into image, taking it
+// from the grabber's ring if a grabber is running.
+//
+fc2Error idlpgr_Retrieve(fc2Context context, fc2Image *image, int newest);
+
+//
+// Measure the latency of image, recording it in the camera's
+// statistics.
+//
+void idlpgr_FrameLatency(idlpgr_camera *camera, const fc2Image *image);
+
+//
+// Statistics of the camera that last delivered a frame into image,
+// or NULL if no camera has.
+//
+idlpgr_stats *idlpgr_ImageStats(const fc2Image *image);
+
+//
+// Camera that last delivered a frame into image, or NULL
+//
+idlpgr_camera *idlpgr_ImageCamera(const fc2Image *image);
+
+//
+// Transfer image data as idlpgr_TransferImage does, recording the
+// time as conversion if the data are unpacked, and otherwise as copying.
+//
+void idlpgr_TimedTransfer(idlpgr_stats *stats, const fc2Image *image,
+			  const idlpgr_layout *layout, void *dest);
+
+//
+// Background
+//
+// Add the frame in image to the camera's background estimates,
+// if there are any.  Monochrome and raw frames of 8 and 16 bits
+// are added directly, and packed 12-bit frames are unpacked first.
+// Frames of other formats are ignored.  Every frame retrieved
+// from the camera is added, in the thread that retrieves it:
+// the grabber, the capture callback, or the caller of
+// idlpgr_Retrieve when neither is running.  Frames that overflow
+// the grabber's ring or are superseded in the callback's buffer
+// therefore still reach the estimates.  Takes camera->lock,
+// which other users of camera->background must also hold.
+//
+void idlpgr_FrameBackground(idlpgr_camera *camera, const fc2Image *image);
+
+//
+// idlpgr_framefn with data pointing to an idlpgr_camera
+//
+void idlpgr_CameraFrame(void *data, const fc2Image *image);
+
+//
+// Copy of the camera's running median if median is set, and
+// otherwise of its running mean, as rows x cols floats allocated
+// with malloc.  nframes receives the number of frames in the
+// estimates.  NULL if there are no estimates, if no frame has
+// been added, or if memory could not be allocated.
+//
+float *idlpgr_BackgroundEstimate(idlpgr_camera *camera, int median,
+				 unsigned int *rows, unsigned int *cols,
+				 unsigned long long *nframes);
+
+//
+// Normalize the frame in image by the camera's running median if
+// median is set, and otherwise by its running mean, writing floats
+// at dest.  FC2_ERROR_NOT_INTITIALIZED if no frame has been added
+// to the estimates, and FC2_ERROR_INVALID_PARAMETER if the format
+// or geometry of the frame does not match them.
+//
+fc2Error idlpgr_FrameNormalize(idlpgr_camera *camera, const fc2Image *image,
+			       int median, float *dest);
+
+//
+// Accumulation
+//
+// Retrieve nframes frames into image and add them to the camera's
+// accumulator, which is started with the layout of the first frame
+// and returned in *paccumulator.  Monochrome and raw frames of 8
+// and 16 bits are added directly, and packed 12-bit frames are
+// unpacked first.  FC2_ERROR_NOT_SUPPORTED for color, signed,
+// compressed and vendor formats,
+// FC2_ERROR_INVALID_PARAMETER if integer sums of nframes frames
+// could overflow, and FC2_ERROR_IMAGE_CONSISTENCY_ERROR if the
+// geometry changes.
+//
+fc2Error idlpgr_Accumulate(fc2Context context, fc2Image *image,
+			   unsigned int nframes,
+			   int isfloat, int variance,
+			   idlpgr_layout *layout,
+			   idlpgr_accumulator **paccumulator);
+
+//
+// Decode the metadata of a frame with time stamp ts
+// delivered by camera.
+//
+void idlpgr_FrameMetadata(idlpgr_camera *camera, const fc2Image *image,
+			  fc2TimeStamp ts, idlpgr_metadata *metadata);
+
+//
+// Bursts
+//
+// Transfer the frame in image, retrieved by idlpgr_Retrieve and
+// described by layout, and the next nframes - 1 frames into dest,
+// frame n at dest + n * layout->size.  Unless they are NULL,
+// timestamps[n] receives the time stamp of frame n [s], metadata[n]
+// its metadata, and delivered[n] the time [ns] at which it was
+// retrieved, for every frame but the first.
+// FC2_ERROR_IMAGE_CONSISTENCY_ERROR if the geometry changes.
+//
+fc2Error idlpgr_ReadBurst(fc2Context context, fc2Image *image,
+			  unsigned int nframes,
+			  const idlpgr_layout *layout, void *dest,
+			  double *timestamps,
+			  idlpgr_metadata *metadata,
+			  unsigned long long *delivered);
+
+//
+// Synchronized capture
+//
+// A group starts capture on several cameras together with
+// fc2StartSyncCapture.  Each camera either has a grabber thread
+// retrieving frames into its own ring, or delivers frames to a
+// callback that keeps the most recent one.
+//
+#define IDLPGR_SYNC_TOLERANCE 0.005 // [s] when frame rate is unknown
+#define IDLPGR_SYNC_TIMEOUT 5.      // [s] callback capture
+
+typedef struct idlpgr_group {
+  unsigned int ncameras;
+  fc2Context *context;
+  idlpgr_camera **camera;
+  int callback;                // frames are delivered by callbacks
+  double tolerance;            // [s] maximum spread of a set
+  unsigned long long *sequence; // last frame used from each camera
+  unsigned long long dropped;  // frames discarded to keep sets aligned
+  struct idlpgr_group *next;
+} idlpgr_group;
+
+//
+// Start capture on ncameras cameras with nbuffers slots in each
+// grabber's ring, or with callbacks.  If tolerance < 0, it is half
+// of the frame period of the first camera.  FC2_ERROR_ISOCH_ALREADY_STARTED
+// if capture is already running on one of the cameras.
+//
+fc2Error idlpgr_GroupStart(idlpgr_group **pgroup,
+			   unsigned int ncameras,
+			   const fc2Context *context,
+			   int callback,
+			   unsigned int nbuffers,
+			   double tolerance);
+
+//
+// Group at address handle, or NULL if there is none
+//
+idlpgr_group *idlpgr_GroupFind(const void *handle);
+
+void idlpgr_GroupStop(idlpgr_group *group);
+void idlpgr_GroupFree(idlpgr_group *group);
+
+//
+// Find the next set of frames whose time stamps agree within
+// the tolerance.  On success, image[n] refers to the frame from
+// camera n and t[n] is its time stamp [s].  Frames from grabbers
+// remain in their rings until idlpgr_GroupRelease is called.
+//
+fc2Error idlpgr_GroupMatch(idlpgr_group *group, fc2Image **image, double *t);
+void idlpgr_GroupRelease(idlpgr_group *group);
+
+double idlpgr_TimeStampSeconds(fc2TimeStamp ts);
+
+//
+// Packet-size tuning
+//
+#define IDLPGR_TUNE_MAXSTEPS   32
+#define IDLPGR_TUNE_MINPACKET  1400   // GigE payload of a standard frame
+#define IDLPGR_TUNE_MAXPACKET  9000   // GigE payload of a jumbo frame
+
+typedef struct idlpgr_tuning {
+  double rate;                 // frames per second
+  double bandwidth;            // MB/s
+  unsigned int packetsize;     // bytes per packet
+  unsigned int delay;          // GigE inter-packet delay
+  unsigned int frames;         // frames retrieved
+  unsigned int incomplete;     // frames retrieved with missing data
+  unsigned int errors;         // retrievals that failed
+  unsigned int timeouts;       // retrievals that timed out
+} idlpgr_tuning;
+
+//
+// Find the packet size, and for GigE cameras the inter-packet delay
+// up to maxdelay, that sustains the highest frame rate without losing
+// data, and apply it.  Each of nsteps settings per parameter is
+// measured with nframes frames retrieved within timeout [ms].  The
+// settings tried are described in tuning, which holds up to
+// 2 * nsteps entries, and tuning[*best] is the one applied.
+// FC2_ERROR_ISOCH_ALREADY_STARTED if frames are being consumed,
+// FC2_ERROR_NOT_SUPPORTED unless the camera is a GigE camera or
+// in a Format7 mode, and FC2_ERROR_TIMEOUT, with the original
+// setting restored, if no frames arrived at any setting.
+//
+fc2Error idlpgr_Tune(fc2Context context,
+		     unsigned int nframes, unsigned int nsteps,
+		     int timeout, unsigned int maxdelay,
+		     idlpgr_tuning *tuning,
+		     unsigned int *npoints, unsigned int *best);
+
+//
+// Timed software triggers
+//
+#define IDLPGR_TRIGGER_SPIN 200000ULL  // [ns] spin before each deadline
+
+typedef struct idlpgr_trigger {
+  fc2Context context;
+  pthread_t thread;
+  int broadcast;
+  unsigned int ntriggers;
+  unsigned long long start;    // deadline of the first trigger [ns]
+  unsigned long long interval; // [ns]
+  unsigned long long *fired;   // time at which each trigger fired [ns]
+  unsigned int nfired;
+  int running;                 // cleared to stop the thread
+  fc2Error error;              // error that stopped the thread
+} idlpgr_trigger;
+
+//
+// Fire ntriggers software triggers at intervals [s] from a native
+// thread, recording the time at which each fired in fired.
+//
+fc2Error idlpgr_TriggerStart(idlpgr_trigger *trigger,
+			     fc2Context context,
+			     unsigned int ntriggers,
+			     double interval,
+			     int broadcast,
+			     unsigned long long *fired);
+
+//
+// Wait for the thread, returning the error that stopped it
+//
+fc2Error idlpgr_TriggerStop(idlpgr_trigger *trigger);
+
+#endif
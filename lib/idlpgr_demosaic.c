@@ -0,0 +1,319 @@
+//
+// idlpgr_demosaic.c
+//
+// Bayer demosaicing for idlpgr.
+//
+// Each output row is computed from the raw row and its neighbors
+// above and below.  Sites on a row alternate between green and
+// one chroma color (red on red rows, blue on blue rows), so every
+// pixel is assigned its own chroma value c, green g, and the other
+// chroma value o:
+//
+//                  colored site      green site
+//   nearest        c  = center       c = right
+//                  g  = right        g = center
+//                  o  = lower right  o = below
+//   bilinear       c  = center       c = mean(left, right)
+//                  g  = mean(4 edge  g = center
+//                       neighbors)
+//                  o  = mean(4       o = mean(above, below)
+//                       diagonals)
+//   edge           as bilinear, but g is averaged along the
+//                  direction with the smaller gradient
+//
+// Means are formed from rounded pairwise averages so that
+// the scalar and vector kernels agree exactly.  Neighbors beyond
+// the edges of the image are mirrored, which preserves the
+// Bayer pattern.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Persistent worker threads.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "idlpgr_demosaic.h"
+#include "idlpgr_pool.h"
+#include "idlpgr_simd.h"
+
+#ifdef IDLPGR_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*idlpgr_demosaic_row_fn)(const unsigned char *up,
+				       const unsigned char *cur,
+				       const unsigned char *dn,
+				       unsigned char *out,
+				       unsigned int cols,
+				       int cparity, int isred, int method);
+
+static inline unsigned char avg(unsigned char a, unsigned char b)
+{
+  return (unsigned char) ((a + b + 1) >> 1);
+}
+
+//
+// idlpgr_DemosaicPixel
+//
+static inline void idlpgr_DemosaicPixel(const unsigned char *up,
+					const unsigned char *cur,
+					const unsigned char *dn,
+					unsigned char *out,
+					unsigned int x, unsigned int cols,
+					int cparity, int isred, int method)
+{
+  unsigned int xl = (x > 0) ? x - 1 : x + 1;
+  unsigned int xr = (x + 1 < cols) ? x + 1 : x - 1;
+  unsigned char c, g, o, h, v;
+  int dh, dv;
+
+  h = avg(cur[xl], cur[xr]);
+  v = avg(up[x], dn[x]);
+  if ((int) (x & 1) == cparity) {
+    c = cur[x];
+    if (method == IDLPGR_DEMOSAIC_NEAREST) {
+      g = cur[xr];
+      o = dn[xr];
+    } else {
+      o = avg(avg(up[xl], up[xr]), avg(dn[xl], dn[xr]));
+      g = avg(h, v);
+      if (method == IDLPGR_DEMOSAIC_EDGE) {
+	dh = abs(cur[xl] - cur[xr]);
+	dv = abs(up[x] - dn[x]);
+	if (dh < dv)
+	  g = h;
+	else if (dv < dh)
+	  g = v;
+      }
+    }
+  } else {
+    g = cur[x];
+    if (method == IDLPGR_DEMOSAIC_NEAREST) {
+      c = cur[xr];
+      o = dn[x];
+    } else {
+      c = h;
+      o = v;
+    }
+  }
+
+  out[3*x]   = isred ? c : o;
+  out[3*x+1] = g;
+  out[3*x+2] = isred ? o : c;
+}
+
+static void idlpgr_DemosaicRowScalar(const unsigned char *up,
+				     const unsigned char *cur,
+				     const unsigned char *dn,
+				     unsigned char *out,
+				     unsigned int cols,
+				     int cparity, int isred, int method)
+{
+  unsigned int x;
+
+  for (x = 0; x < cols; x++)
+    idlpgr_DemosaicPixel(up, cur, dn, out, x, cols, cparity, isred, method);
+}
+
+#ifdef IDLPGR_X86
+
+//
+// Shuffles that interleave three planes of 16 bytes into 48 bytes
+// of RGB triplets: interleave[k][p] gathers plane p into output
+// vector k.
+//
+static unsigned char interleave[3][3][16] __attribute__((aligned(16)));
+
+static void idlpgr_InitInterleave(void)
+{
+  int k, j, idx;
+
+  for (k = 0; k < 3; k++)
+    for (j = 0; j < 16; j++) {
+      idx = 16*k + j;
+      interleave[k][0][j] = (idx % 3 == 0) ? idx / 3 : 0x80;
+      interleave[k][1][j] = (idx % 3 == 1) ? idx / 3 : 0x80;
+      interleave[k][2][j] = (idx % 3 == 2) ? idx / 3 : 0x80;
+    }
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i select8(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i gather(int k, __m128i r, __m128i g, __m128i b)
+{
+  const __m128i *m = (const __m128i *) interleave[k];
+
+  return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, m[0]),
+				   _mm_shuffle_epi8(g, m[1])),
+		      _mm_shuffle_epi8(b, m[2]));
+}
+
+//
+// idlpgr_DemosaicRowSSSE3
+//
+// 16 pixels per iteration.  Blocks start at odd columns so that
+// the left neighbor of the first pixel is in the row, and
+// the lane pattern of colored sites is the same for every block.
+//
+__attribute__((target("ssse3")))
+static void idlpgr_DemosaicRowSSSE3(const unsigned char *up,
+				    const unsigned char *cur,
+				    const unsigned char *dn,
+				    unsigned char *out,
+				    unsigned int cols,
+				    int cparity, int isred, int method)
+{
+  const __m128i even = _mm_set1_epi16(0x00FF);
+  const __m128i colored = cparity ? even : _mm_slli_epi16(even, 8);
+  __m128i cl, cc, cr, ul, uc, ur, dl, dc, dr;
+  __m128i h, v, g4, d4, c, g, o, r, b, dh, dv, hv, vh;
+  __m128i *po;
+  unsigned int x;
+
+  idlpgr_DemosaicPixel(up, cur, dn, out, 0, cols, cparity, isred, method);
+  for (x = 1; x + 17 <= cols; x += 16) {
+    cl = _mm_loadu_si128((const __m128i *) (cur + x - 1));
+    cc = _mm_loadu_si128((const __m128i *) (cur + x));
+    cr = _mm_loadu_si128((const __m128i *) (cur + x + 1));
+    uc = _mm_loadu_si128((const __m128i *) (up + x));
+    dc = _mm_loadu_si128((const __m128i *) (dn + x));
+    dr = _mm_loadu_si128((const __m128i *) (dn + x + 1));
+    if (method == IDLPGR_DEMOSAIC_NEAREST) {
+      c = select8(colored, cc, cr);
+      g = select8(colored, cr, cc);
+      o = select8(colored, dr, dc);
+    } else {
+      ul = _mm_loadu_si128((const __m128i *) (up + x - 1));
+      ur = _mm_loadu_si128((const __m128i *) (up + x + 1));
+      dl = _mm_loadu_si128((const __m128i *) (dn + x - 1));
+      h = _mm_avg_epu8(cl, cr);
+      v = _mm_avg_epu8(uc, dc);
+      g4 = _mm_avg_epu8(h, v);
+      d4 = _mm_avg_epu8(_mm_avg_epu8(ul, ur), _mm_avg_epu8(dl, dr));
+      if (method == IDLPGR_DEMOSAIC_EDGE) {
+	dh = _mm_or_si128(_mm_subs_epu8(cl, cr), _mm_subs_epu8(cr, cl));
+	dv = _mm_or_si128(_mm_subs_epu8(uc, dc), _mm_subs_epu8(dc, uc));
+	// hv: dh < dv, vh: dv < dh
+	hv = _mm_andnot_si128(_mm_cmpeq_epi8(dh, dv),
+			      _mm_cmpeq_epi8(_mm_min_epu8(dh, dv), dh));
+	vh = _mm_andnot_si128(_mm_cmpeq_epi8(dh, dv),
+			      _mm_cmpeq_epi8(_mm_min_epu8(dh, dv), dv));
+	g4 = select8(hv, h, select8(vh, v, g4));
+      }
+      c = select8(colored, cc, h);
+      g = select8(colored, g4, cc);
+      o = select8(colored, d4, v);
+    }
+    r = isred ? c : o;
+    b = isred ? o : c;
+    po = (__m128i *) (out + 3*x);
+    _mm_storeu_si128(po,     gather(0, r, g, b));
+    _mm_storeu_si128(po + 1, gather(1, r, g, b));
+    _mm_storeu_si128(po + 2, gather(2, r, g, b));
+  }
+  for (; x < cols; x++)
+    idlpgr_DemosaicPixel(up, cur, dn, out, x, cols, cparity, isred, method);
+}
+
+#endif
+
+static idlpgr_demosaic_row_fn idlpgr_DemosaicRow = idlpgr_DemosaicRowScalar;
+
+//
+// Frame processed in bands of rows by the worker threads,
+// which are shared by every call
+//
+typedef struct idlpgr_band {
+  const unsigned char *src;
+  size_t stride;
+  unsigned int rows, cols;
+  int rx, ry;                  // position of red site in the tile
+  int method;
+  unsigned char *dest;
+} idlpgr_band;
+
+static pthread_mutex_t poollock = PTHREAD_MUTEX_INITIALIZER;
+static idlpgr_pool *pool = NULL;
+
+static void idlpgr_DemosaicBand(void *arg, unsigned int row0,
+				unsigned int row1)
+{
+  idlpgr_band *band = (idlpgr_band *) arg;
+  const unsigned char *up, *cur, *dn;
+  unsigned int y;
+  int isred;
+
+  for (y = row0; y < row1; y++) {
+    cur = band->src + y * band->stride;
+    up = (y > 0) ? cur - band->stride : cur + band->stride;
+    dn = (y + 1 < band->rows) ? cur + band->stride : cur - band->stride;
+    isred = ((int) (y & 1) == band->ry);
+    idlpgr_DemosaicRow(up, cur, dn, band->dest + (size_t) 3 * band->cols * y,
+		       band->cols, isred ? band->rx : !band->rx,
+		       isred, band->method);
+  }
+}
+
+//
+// idlpgr_DemosaicBayer8
+//
+int idlpgr_DemosaicBayer8(const unsigned char *src, size_t stride,
+		    unsigned int rows, unsigned int cols,
+		    int tile, int method, int nthreads,
+		    unsigned char *dest)
+{
+  idlpgr_band band;
+  int rx, ry;
+
+  switch (tile) {
+  case IDLPGR_BAYER_RGGB: rx = 0; ry = 0; break;
+  case IDLPGR_BAYER_GRBG: rx = 1; ry = 0; break;
+  case IDLPGR_BAYER_GBRG: rx = 0; ry = 1; break;
+  case IDLPGR_BAYER_BGGR: rx = 1; ry = 1; break;
+  default:
+    return -1;
+  }
+  if (method < IDLPGR_DEMOSAIC_NEAREST || method > IDLPGR_DEMOSAIC_EDGE)
+    return -1;
+  if (rows < 2 || cols < 2)
+    return -1;
+
+  band.src = src;
+  band.stride = stride;
+  band.rows = rows;
+  band.cols = cols;
+  band.rx = rx;
+  band.ry = ry;
+  band.method = method;
+  band.dest = dest;
+  pthread_mutex_lock(&poollock);
+  idlpgr_PoolRun(&pool, nthreads, rows, idlpgr_DemosaicBand, &band);
+  pthread_mutex_unlock(&poollock);
+
+  return 0;
+}
+
+//
+// idlpgr_SelectDemosaicKernels
+//
+const char *idlpgr_SelectDemosaicKernels(void)
+{
+#ifdef IDLPGR_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) {
+    idlpgr_InitInterleave();
+    idlpgr_DemosaicRow = idlpgr_DemosaicRowSSSE3;
+    return "ssse3";
+  }
+#endif
+  idlpgr_DemosaicRow = idlpgr_DemosaicRowScalar;
+  return "scalar";
+}
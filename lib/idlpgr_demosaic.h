@@ -0,0 +1,52 @@
+//
+// idlpgr_demosaic.h
+//
+// Bayer demosaicing for idlpgr.  The kernels operate directly on
+// 8-bit raw sensor data and do not depend on IDL.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Persistent worker threads.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_DEMOSAIC_H
+#define IDLPGR_DEMOSAIC_H
+
+#include <stddef.h>
+
+//
+// Interpolation methods, in order of increasing quality and cost
+//
+#define IDLPGR_DEMOSAIC_NEAREST  1  // copy from within each 2x2 tile
+#define IDLPGR_DEMOSAIC_BILINEAR 2  // average nearest like-colored sites
+#define IDLPGR_DEMOSAIC_EDGE     3  // interpolate green along edges
+
+//
+// Bayer tiles, numbered as fc2BayerTileFormat
+//
+#define IDLPGR_BAYER_RGGB 1
+#define IDLPGR_BAYER_GRBG 2
+#define IDLPGR_BAYER_GBRG 3
+#define IDLPGR_BAYER_BGGR 4
+
+//
+// Interpolate rows x cols raw pixels with the specified row stride
+// into interleaved RGB triplets at dest, using nthreads threads
+// that each handle a band of rows.  nthreads <= 0 uses one thread
+// per processor.  The threads persist between calls, which are
+// serialized.  Returns 0 on success, or -1 if tile or method
+// is not recognized.
+//
+int idlpgr_DemosaicBayer8(const unsigned char *src, size_t stride,
+		    unsigned int rows, unsigned int cols,
+		    int tile, int method, int nthreads,
+		    unsigned char *dest);
+
+//
+// Choose the fastest row kernel supported by the host CPU.
+// Returns the name of the selected instruction set.
+//
+const char *idlpgr_SelectDemosaicKernels(void);
+
+#endif
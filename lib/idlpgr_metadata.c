@@ -0,0 +1,154 @@
+//
+// idlpgr_metadata.c
+//
+// Decoding of embedded image information.
+// See idlpgr_metadata.h for the layout of the embedded words.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Offsets of individual items.
+// 10/16/2026 DGG Intervals between cycle times.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <string.h>
+#include <math.h>
+
+#include "idlpgr_metadata.h"
+
+#define IDLPGR_CYCLE_COUNTS  8000     // cycles per second
+#define IDLPGR_CYCLE_OFFSETS 3072     // ticks per cycle
+#define IDLPGR_CYCLE_PERIOD  (128ULL * IDLPGR_CYCLE_COUNTS * IDLPGR_CYCLE_OFFSETS)
+
+uint32_t idlpgr_MetadataWord(const unsigned char *p)
+{
+  return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+    ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+int idlpgr_MetadataOffset(const fc2EmbeddedImageInfo *info,
+			  const fc2EmbeddedImageInfoProperty *item)
+{
+  const fc2EmbeddedImageInfoProperty *p = &info->timestamp;
+  int offset = 0;
+
+  if (!item->onOff)
+    return -1;
+
+  // items are laid out in fc2EmbeddedImageInfo in embedding order
+  for (; p < item; p++)
+    if (p->onOff)
+      offset += 4;
+
+  return offset;
+}
+
+static uint64_t idlpgr_CycleTicks(uint32_t seconds, uint32_t count,
+				  uint32_t offset)
+{
+  return ((uint64_t) (seconds % 128) * IDLPGR_CYCLE_COUNTS +
+	  count % IDLPGR_CYCLE_COUNTS) * IDLPGR_CYCLE_OFFSETS +
+    offset % IDLPGR_CYCLE_OFFSETS;
+}
+
+static uint64_t idlpgr_WordTicks(uint32_t word)
+{
+  return idlpgr_CycleTicks(word >> 25, (word >> 12) & 0x1FFF, word & 0xFFF);
+}
+
+uint32_t idlpgr_CycleTime(fc2TimeStamp ts)
+{
+  return ((ts.cycleSeconds % 128) << 25) |
+    ((ts.cycleCount & 0x1FFF) << 12) | (ts.cycleOffset & 0xFFF);
+}
+
+double idlpgr_CycleInterval(uint32_t from, uint32_t to)
+{
+  uint64_t delta;
+
+  delta = (idlpgr_WordTicks(to) + IDLPGR_CYCLE_PERIOD - idlpgr_WordTicks(from))
+    % IDLPGR_CYCLE_PERIOD;
+
+  return delta / IDLPGR_CYCLE_RATE;
+}
+
+//
+// Advance clock to the cycle time given in ticks,
+// using the host time to count whole wraps that
+// the cycle time alone cannot reveal.
+//
+static void idlpgr_ClockAdvance(idlpgr_clock *clock, uint32_t cycle,
+				double host)
+{
+  uint64_t delta;
+  double wraps;
+
+  if (!clock->started) {
+    clock->started = 1;
+    clock->ticks = cycle;
+  } else {
+    delta = (cycle + IDLPGR_CYCLE_PERIOD - clock->last) % IDLPGR_CYCLE_PERIOD;
+    if (host > 0. && clock->host > 0.) {
+      wraps = floor((host - clock->host - delta/IDLPGR_CYCLE_RATE)/128. + 0.5);
+      if (wraps > 0.)
+	delta += (uint64_t) wraps * IDLPGR_CYCLE_PERIOD;
+    }
+    clock->ticks += delta;
+  }
+  clock->last = cycle;
+  clock->host = host;
+}
+
+void idlpgr_MetadataDecode(const unsigned char *data, size_t size,
+			   const fc2EmbeddedImageInfo *info,
+			   fc2TimeStamp ts,
+			   idlpgr_clock *clock,
+			   idlpgr_metadata *metadata)
+{
+  const fc2EmbeddedImageInfoProperty *item[IDLPGR_EMBEDDED_ITEMS] = {
+    &info->timestamp, &info->gain, &info->shutter, &info->brightness,
+    &info->exposure, &info->whiteBalance, &info->frameCounter,
+    &info->strobePattern, &info->GPIOPinState, &info->ROIPosition
+  };
+  uint32_t *word[IDLPGR_EMBEDDED_ITEMS] = {
+    &metadata->timestamp, &metadata->gain, &metadata->shutter,
+    &metadata->brightness, &metadata->exposure, &metadata->whitebalance,
+    &metadata->framecounter, &metadata->strobepattern,
+    &metadata->gpiopinstate, &metadata->roiposition
+  };
+  size_t offset;
+  uint32_t cycle;
+  int i;
+
+  memset(metadata, 0, sizeof(idlpgr_metadata));
+
+  // embedded words appear in the order of the enabled items
+  for (i = 0, offset = 0; i < IDLPGR_EMBEDDED_ITEMS; i++) {
+    if (!item[i]->onOff)
+      continue;
+    if (data && offset + 4 <= size)
+      *word[i] = idlpgr_MetadataWord(data + offset);
+    offset += 4;
+  }
+
+  metadata->seconds = ts.seconds;
+  metadata->microseconds = ts.microSeconds;
+  if (info->timestamp.onOff) {
+    metadata->cycleseconds = metadata->timestamp >> 25;
+    metadata->cyclecount = (metadata->timestamp >> 12) & 0x1FFF;
+    metadata->cycleoffset = metadata->timestamp & 0xFFF;
+  } else {
+    metadata->cycleseconds = ts.cycleSeconds;
+    metadata->cyclecount = ts.cycleCount;
+    metadata->cycleoffset = ts.cycleOffset;
+  }
+
+  cycle = (uint32_t) idlpgr_CycleTicks(metadata->cycleseconds,
+				       metadata->cyclecount,
+				       metadata->cycleoffset);
+  idlpgr_ClockAdvance(clock, cycle,
+		      (double) ts.seconds + 1e-6 * ts.microSeconds);
+
+  metadata->ticks = clock->ticks;
+  metadata->time = clock->ticks / IDLPGR_CYCLE_RATE;
+}
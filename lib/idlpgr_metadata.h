@@ -0,0 +1,110 @@
+//
+// idlpgr_metadata.h
+//
+// Decoding of the image information that the camera embeds in
+// the first pixels of each frame.  Does not depend on IDL.
+//
+// Each enabled item of fc2EmbeddedImageInfo replaces four bytes
+// at the start of the image with a big-endian 32-bit word, in the
+// order in which the items appear in fc2EmbeddedImageInfo.
+//
+// The embedded time stamp is the camera's 1394 cycle time, which
+// wraps every 128 seconds:
+//
+//   bits 31-25  seconds      (0-127)
+//   bits 24-12  cycle count  (0-7999, 8 kHz)
+//   bits 11-0   cycle offset (0-3071, 24.576 MHz)
+//
+// Successive cycle times are unwrapped into a monotonic 64-bit
+// count of 24.576 MHz ticks.  The host time stamp of each frame
+// resolves the number of wraps between frames that are decoded
+// more than 128 seconds apart.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Offsets of individual items.
+// 10/16/2026 DGG Intervals between cycle times.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_METADATA_H
+#define IDLPGR_METADATA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "C/FlyCapture2_C.h"
+
+#define IDLPGR_EMBEDDED_ITEMS 10        // items in fc2EmbeddedImageInfo
+#define IDLPGR_CYCLE_RATE     24576000. // cycle time ticks per second
+
+//
+// Metadata of one frame.  The layout matches the idlpgrMetadata
+// structure returned to IDL.
+//
+typedef struct idlpgr_metadata {
+  uint32_t timestamp;          // embedded words, or 0 if not enabled
+  uint32_t gain;
+  uint32_t shutter;
+  uint32_t brightness;
+  uint32_t exposure;
+  uint32_t whitebalance;
+  uint32_t framecounter;
+  uint32_t strobepattern;
+  uint32_t gpiopinstate;
+  uint32_t roiposition;
+  int64_t seconds;             // host time stamp
+  uint32_t microseconds;
+  uint32_t cycleseconds;       // camera cycle time
+  uint32_t cyclecount;
+  uint32_t cycleoffset;
+  uint64_t ticks;              // unwrapped cycle time [1/IDLPGR_CYCLE_RATE s]
+  double time;                 // unwrapped cycle time [s]
+} idlpgr_metadata;
+
+//
+// State for unwrapping the cycle time of one camera
+//
+typedef struct idlpgr_clock {
+  int started;
+  uint32_t last;               // previous cycle time in ticks
+  double host;                 // previous host time [s]
+  uint64_t ticks;
+} idlpgr_clock;
+
+//
+// Byte offset of an enabled item of info in the pixel data,
+// or -1 if the item is not enabled.
+//
+int idlpgr_MetadataOffset(const fc2EmbeddedImageInfo *info,
+			  const fc2EmbeddedImageInfoProperty *item);
+
+//
+// Embedded word at the start of p
+//
+uint32_t idlpgr_MetadataWord(const unsigned char *p);
+
+//
+// Cycle time of a time stamp, in the layout of the embedded word
+//
+uint32_t idlpgr_CycleTime(fc2TimeStamp ts);
+
+//
+// Interval [s] from cycle time from to cycle time to,
+// both in the layout of the embedded word, modulo 128 s.
+//
+double idlpgr_CycleInterval(uint32_t from, uint32_t to);
+
+//
+// Decode the metadata of a frame whose pixel data begins at data,
+// given the items enabled in info and the frame's time stamp.
+// If the embedded time stamp is not enabled, the cycle time is
+// taken from ts.  Advances clock.
+//
+void idlpgr_MetadataDecode(const unsigned char *data, size_t size,
+			   const fc2EmbeddedImageInfo *info,
+			   fc2TimeStamp ts,
+			   idlpgr_clock *clock,
+			   idlpgr_metadata *metadata);
+
+#endif
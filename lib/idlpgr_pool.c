@@ -0,0 +1,177 @@
+//
+// idlpgr_pool.c
+//
+// Persistent worker threads for idlpgr.  See idlpgr_pool.h.
+//
+// The caller processes the first band itself and worker n the
+// band n + 1.  Each run advances generation, which wakes the
+// workers, and the caller waits until all of them are done.
+// Workers without a band in a run are given an empty one,
+// so the pool is replaced only when more workers are needed.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "idlpgr_pool.h"
+
+typedef struct idlpgr_worker {
+  struct idlpgr_pool *pool;
+  unsigned int index;
+  pthread_t thread;
+} idlpgr_worker;
+
+struct idlpgr_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t start;        // generation advanced, or quit set
+  pthread_cond_t done;         // remaining reached 0
+  unsigned long long generation;
+  unsigned int remaining;      // workers still processing this run
+  int quit;
+  unsigned int requested;      // workers asked for
+  unsigned int nworkers;       // workers started
+  idlpgr_worker worker[IDLPGR_MAXBANDS - 1];
+  idlpgr_bandfn fn;            // this run
+  void *arg;
+  unsigned int rows, nbands, rowsperband;
+};
+
+static void idlpgr_PoolBand(idlpgr_pool *pool, unsigned int n)
+{
+  unsigned int row0, row1;
+
+  if (n >= pool->nbands)
+    return;
+  row0 = n * pool->rowsperband;
+  row1 = row0 + pool->rowsperband;
+  if (row1 > pool->rows)
+    row1 = pool->rows;
+  if (row0 < row1)
+    pool->fn(pool->arg, row0, row1);
+}
+
+static void *idlpgr_PoolWorker(void *arg)
+{
+  idlpgr_worker *worker = (idlpgr_worker *) arg;
+  idlpgr_pool *pool = worker->pool;
+  unsigned long long generation = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->generation == generation && !pool->quit)
+      pthread_cond_wait(&pool->start, &pool->lock);
+    if (pool->quit)
+      break;
+    generation = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+    idlpgr_PoolBand(pool, worker->index + 1);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->remaining == 0)
+      pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+void idlpgr_PoolFree(idlpgr_pool *pool)
+{
+  unsigned int n;
+
+  if (!pool)
+    return;
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+  for (n = 0; n < pool->nworkers; n++)
+    pthread_join(pool->worker[n].thread, NULL);
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->start);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+}
+
+//
+// Pool of up to nworkers threads, or NULL if none could be started
+//
+static idlpgr_pool *idlpgr_PoolCreate(unsigned int nworkers)
+{
+  idlpgr_pool *pool;
+  unsigned int n;
+
+  if (!(pool = (idlpgr_pool *) calloc(1, sizeof(idlpgr_pool))))
+    return NULL;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  pool->requested = nworkers;
+  for (n = 0; n < nworkers; n++) {
+    pool->worker[n].pool = pool;
+    pool->worker[n].index = n;
+    if (pthread_create(&pool->worker[n].thread, NULL,
+		       idlpgr_PoolWorker, &pool->worker[n]))
+      break;
+    pool->nworkers++;
+  }
+  if (!pool->nworkers) {
+    idlpgr_PoolFree(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+void idlpgr_PoolRun(idlpgr_pool **ppool, int nthreads, unsigned int rows,
+		    idlpgr_bandfn fn, void *arg)
+{
+  idlpgr_pool *pool;
+  unsigned int nbands;
+
+  if (nthreads <= 0)
+    nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (nthreads > IDLPGR_MAXBANDS)
+    nthreads = IDLPGR_MAXBANDS;
+  // bands should be tall enough to amortize waking a thread
+  if ((unsigned int) nthreads > rows / 64)
+    nthreads = rows / 64;
+  nbands = (nthreads < 1) ? 1 : (unsigned int) nthreads;
+
+  pool = *ppool;
+  if (nbands > 1 && (!pool || pool->requested < nbands - 1)) {
+    idlpgr_PoolFree(pool);
+    pool = *ppool = idlpgr_PoolCreate(nbands - 1);
+  }
+  if (!pool)
+    nbands = 1;
+  else if (nbands > pool->nworkers + 1)
+    nbands = pool->nworkers + 1;
+
+  if (nbands == 1) {
+    fn(arg, 0, rows);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->fn = fn;
+  pool->arg = arg;
+  pool->rows = rows;
+  pool->nbands = nbands;
+  pool->rowsperband = (rows + nbands - 1) / nbands;
+  pool->remaining = pool->nworkers;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  idlpgr_PoolBand(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->remaining)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,48 @@
+//
+// idlpgr_pool.h
+//
+// Persistent worker threads that process the bands of rows of a
+// frame in parallel, for the demosaicing, background and
+// accumulation kernels.  Workers are started once and wait for
+// the next frame, rather than being started for every frame.
+// Does not depend on IDL.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_POOL_H
+#define IDLPGR_POOL_H
+
+//
+// Most bands into which a frame is divided
+//
+#define IDLPGR_MAXBANDS 64
+
+//
+// Process rows [row0, row1) of the frame described by arg
+//
+typedef void (*idlpgr_bandfn)(void *arg, unsigned int row0,
+			      unsigned int row1);
+
+typedef struct idlpgr_pool idlpgr_pool;
+
+//
+// Process rows of a frame with fn in bands on nthreads threads,
+// one of which is the caller.  nthreads <= 0 uses one thread per
+// processor.  Bands are no shorter than 64 rows, so that waking
+// a worker is amortized.  *ppool holds the workers between calls,
+// starting with NULL, and is replaced when more are needed.  The
+// frame is processed by the caller alone if no worker can be
+// started.  Calls with the same *ppool must not overlap.
+//
+void idlpgr_PoolRun(idlpgr_pool **ppool, int nthreads, unsigned int rows,
+		    idlpgr_bandfn fn, void *arg);
+
+//
+// Stop the workers and free pool, which may be NULL
+//
+void idlpgr_PoolFree(idlpgr_pool *pool);
+
+#endif
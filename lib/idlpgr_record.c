@@ -0,0 +1,556 @@
+//
+// idlpgr_record.c
+//
+// Streaming recorder and reader for idlpgr recordings.
+// See idlpgr_record.h for the layout of a recording.
+//
+// The acquisition thread and the writer thread share a
+// single-producer, single-consumer ring of slots.  The slots are
+// one contiguous aligned allocation, so a run of queued frames
+// that does not wrap around the end of the ring is written with
+// one call.  Slot sizes, file offsets and buffer addresses are
+// all multiples of IDLPGR_RECORD_ALIGN, as O_DIRECT requires.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Raw dumps and read-ahead.
+// 10/16/2026 DGG Retrieval timeouts do not stop recording.
+// 10/16/2026 DGG Index holds the camera's frame counter.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             // O_DIRECT
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "idlpgr_record.h"
+#include "idlpgr_metadata.h"
+
+struct idlpgr_recorder {
+  fc2Context context;
+  char *filename;
+  int fd;
+  int direct;
+  int counteroffset;           // of the embedded frame counter, or -1
+  pthread_t acquirer;
+  pthread_t writer;
+  int acquiring;               // cleared to stop acquisition
+  int done;                    // set when acquisition has stopped
+  fc2Error error;              // error that stopped acquisition
+  int syserror;                // errno of failed write
+  idlpgr_recordheader *header; // aligned for O_DIRECT
+  unsigned int nslots;
+  unsigned char *ring;         // nslots * slotsize bytes
+  idlpgr_recordindex *meta;    // time stamp and counter of each slot
+  idlpgr_recordindex *index;   // frames written so far
+  size_t nindex;               // capacity of index
+  unsigned long long head;     // next slot to be filled
+  unsigned long long tail;     // next slot to be written
+  unsigned long long captured;
+  unsigned long long written;
+  unsigned long long dropped;
+  unsigned long long bytes;
+};
+
+static uint64_t idlpgr_RecordAlign(uint64_t n)
+{
+  return (n + IDLPGR_RECORD_ALIGN - 1) & ~((uint64_t) IDLPGR_RECORD_ALIGN - 1);
+}
+
+static int idlpgr_WriteAll(int fd, const unsigned char *buffer,
+			   size_t length, off_t offset)
+{
+  ssize_t n;
+
+  while (length > 0) {
+    n = pwrite(fd, buffer, length, offset);
+    if (n < 0) {
+      if (errno == EINTR)
+	continue;
+      return errno;
+    }
+    buffer += n;
+    length -= n;
+    offset += n;
+  }
+
+  return 0;
+}
+
+//
+// idlpgr_RecorderSetup
+//
+// Describe the recording with the geometry of its first frame
+// and allocate the ring.
+//
+static fc2Error idlpgr_RecorderSetup(idlpgr_recorder *recorder,
+				     const fc2Image *image)
+{
+  idlpgr_recordheader *header = recorder->header;
+  void *ring;
+
+  memcpy(header->magic, IDLPGR_RECORD_MAGIC, sizeof(header->magic));
+  header->version = IDLPGR_RECORD_VERSION;
+  header->headersize = IDLPGR_RECORD_HEADERSIZE;
+  header->rows = image->rows;
+  header->cols = image->cols;
+  header->stride = image->stride;
+  header->format = image->format;
+  header->bayerformat = image->bayerFormat;
+  header->framesize = (uint64_t) image->rows * image->stride;
+  header->slotsize = idlpgr_RecordAlign(header->framesize);
+  if (recorder->counteroffset >= 0 &&
+      (uint64_t) recorder->counteroffset + 4 <= header->framesize)
+    header->flags |= IDLPGR_RECORD_FRAMECOUNTER;
+
+  if (posix_memalign(&ring, IDLPGR_RECORD_ALIGN,
+		     recorder->nslots * header->slotsize))
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  recorder->meta = (idlpgr_recordindex *)
+    calloc(recorder->nslots, sizeof(idlpgr_recordindex));
+  if (!recorder->meta) {
+    free(ring);
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  // padding between frames is written to the file
+  memset(ring, 0, recorder->nslots * header->slotsize);
+  recorder->ring = (unsigned char *) ring;
+
+  return FC2_ERROR_OK;
+}
+
+static void *idlpgr_RecorderAcquire(void *arg)
+{
+  idlpgr_recorder *recorder = (idlpgr_recorder *) arg;
+  idlpgr_recordheader *header = recorder->header;
+  unsigned long long head, tail, counter;
+  unsigned int slot;
+  fc2TimeStamp ts;
+  fc2Image image;
+  fc2Error error = FC2_ERROR_OK;
+
+  fc2CreateImage(&image);
+
+  while (__atomic_load_n(&recorder->acquiring, __ATOMIC_ACQUIRE)) {
+    error = fc2RetrieveBuffer(recorder->context, &image);
+    if (error == FC2_ERROR_TIMEOUT)
+      continue;                 // camera stalled; check for stop
+    if (error)
+      break;
+    counter = __atomic_add_fetch(&recorder->captured, 1, __ATOMIC_RELAXED);
+    if (!recorder->ring) {
+      if ((error = idlpgr_RecorderSetup(recorder, &image)))
+	break;
+    } else if (image.rows != header->rows || image.cols != header->cols ||
+	       image.stride != header->stride ||
+	       image.format != (fc2PixelFormat) header->format) {
+      error = FC2_ERROR_IMAGE_CONSISTENCY_ERROR;
+      break;
+    }
+
+    head = recorder->head;
+    tail = __atomic_load_n(&recorder->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= recorder->nslots) {
+      __atomic_add_fetch(&recorder->dropped, 1, __ATOMIC_RELAXED);
+      continue;
+    }
+    slot = head % recorder->nslots;
+    memcpy(recorder->ring + slot * header->slotsize, image.pData,
+	   header->framesize);
+    if (header->flags & IDLPGR_RECORD_FRAMECOUNTER)
+      counter = idlpgr_MetadataWord(image.pData + recorder->counteroffset);
+    ts = fc2GetImageTimeStamp(&image);
+    recorder->meta[slot].timestamp =
+      (double) ts.seconds + 1e-6 * (double) ts.microSeconds;
+    recorder->meta[slot].counter = counter;
+    __atomic_store_n(&recorder->head, head + 1, __ATOMIC_RELEASE);
+  }
+
+  // errors caused by stopping capture are not errors of the recording
+  if (error && __atomic_load_n(&recorder->acquiring, __ATOMIC_ACQUIRE))
+    recorder->error = error;
+  __atomic_store_n(&recorder->acquiring, 0, __ATOMIC_RELEASE);
+  fc2DestroyImage(&image);
+
+  return NULL;
+}
+
+static void *idlpgr_RecorderWrite(void *arg)
+{
+  idlpgr_recorder *recorder = (idlpgr_recorder *) arg;
+  idlpgr_recordheader *header = recorder->header;
+  struct timespec pause = { 0, 1000000 };
+  unsigned long long head, tail, n, i;
+  unsigned int slot;
+  idlpgr_recordindex *index;
+  uint64_t offset;
+  size_t length;
+  int done;
+
+  for (;;) {
+    done = __atomic_load_n(&recorder->done, __ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
+    tail = recorder->tail;
+    if (head == tail) {
+      if (done)
+	break;
+      nanosleep(&pause, NULL);
+      continue;
+    }
+
+    if (tail == 0 &&
+	(recorder->syserror = idlpgr_WriteAll(recorder->fd,
+					      (unsigned char *) header,
+					      IDLPGR_RECORD_HEADERSIZE, 0)))
+      break;
+
+    // run of queued frames that does not wrap around the ring
+    slot = tail % recorder->nslots;
+    n = head - tail;
+    if (n > recorder->nslots - slot)
+      n = recorder->nslots - slot;
+
+    if (recorder->written + n > recorder->nindex) {
+      length = 2 * recorder->nindex + n;
+      index = (idlpgr_recordindex *)
+	realloc(recorder->index, length * sizeof(idlpgr_recordindex));
+      if (!index) {
+	recorder->syserror = ENOMEM;
+	break;
+      }
+      recorder->index = index;
+      recorder->nindex = length;
+    }
+
+    offset = header->headersize + recorder->written * header->slotsize;
+    length = n * header->slotsize;
+    recorder->syserror =
+      idlpgr_WriteAll(recorder->fd, recorder->ring + slot * header->slotsize,
+		      length, (off_t) offset);
+    if (recorder->syserror)
+      break;
+
+    for (i = 0; i < n; i++) {
+      index = &recorder->index[recorder->written + i];
+      *index = recorder->meta[slot + i];
+      index->offset = offset + i * header->slotsize;
+    }
+    __atomic_add_fetch(&recorder->written, n, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&recorder->bytes, length, __ATOMIC_RELAXED);
+    __atomic_store_n(&recorder->tail, tail + n, __ATOMIC_RELEASE);
+  }
+
+  // a recording that cannot be written stops acquisition
+  if (recorder->syserror)
+    __atomic_store_n(&recorder->acquiring, 0, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+static void idlpgr_RecorderFree(idlpgr_recorder *recorder)
+{
+  free(recorder->ring);
+  free(recorder->meta);
+  free(recorder->index);
+  free(recorder->header);
+  free(recorder->filename);
+  free(recorder);
+}
+
+fc2Error idlpgr_RecorderStart(idlpgr_recorder **precorder,
+			      fc2Context context,
+			      const char *filename,
+			      unsigned int nslots,
+			      int direct,
+			      int counteroffset)
+{
+  idlpgr_recorder *recorder;
+  void *header;
+  int flags;
+
+  if (nslots < 2)
+    return FC2_ERROR_INVALID_PARAMETER;
+
+  recorder = (idlpgr_recorder *) calloc(1, sizeof(idlpgr_recorder));
+  if (!recorder)
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  if (posix_memalign(&header, IDLPGR_RECORD_ALIGN, IDLPGR_RECORD_HEADERSIZE) ||
+      !(recorder->filename = strdup(filename))) {
+    free(recorder);
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  memset(header, 0, IDLPGR_RECORD_HEADERSIZE);
+  recorder->header = (idlpgr_recordheader *) header;
+  recorder->context = context;
+  recorder->nslots = nslots;
+  recorder->direct = direct;
+  recorder->counteroffset = counteroffset;
+
+  flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  if (direct)
+    flags |= O_DIRECT;
+#endif
+  if ((recorder->fd = open(filename, flags, 0644)) < 0) {
+    idlpgr_RecorderFree(recorder);
+    return FC2_ERROR_FAILED;
+  }
+
+  recorder->acquiring = 1;
+  if (pthread_create(&recorder->writer, NULL,
+		     idlpgr_RecorderWrite, recorder)) {
+    close(recorder->fd);
+    idlpgr_RecorderFree(recorder);
+    return FC2_ERROR_FAILED;
+  }
+  if (pthread_create(&recorder->acquirer, NULL,
+		     idlpgr_RecorderAcquire, recorder)) {
+    __atomic_store_n(&recorder->done, 1, __ATOMIC_RELEASE);
+    pthread_join(recorder->writer, NULL);
+    close(recorder->fd);
+    idlpgr_RecorderFree(recorder);
+    return FC2_ERROR_FAILED;
+  }
+
+  *precorder = recorder;
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_RecorderStatus(idlpgr_recorder *recorder,
+			   idlpgr_recordstatus *status)
+{
+  unsigned long long head, tail;
+
+  status->running = __atomic_load_n(&recorder->acquiring, __ATOMIC_ACQUIRE);
+  status->error = recorder->error;
+  status->syserror = recorder->syserror;
+  status->captured = __atomic_load_n(&recorder->captured, __ATOMIC_RELAXED);
+  status->written = __atomic_load_n(&recorder->written, __ATOMIC_ACQUIRE);
+  status->dropped = __atomic_load_n(&recorder->dropped, __ATOMIC_RELAXED);
+  status->bytes = __atomic_load_n(&recorder->bytes, __ATOMIC_RELAXED);
+  tail = __atomic_load_n(&recorder->tail, __ATOMIC_ACQUIRE);
+  head = __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
+  status->queued = (unsigned int) (head - tail);
+  status->nslots = recorder->nslots;
+}
+
+fc2Error idlpgr_RecorderStop(idlpgr_recorder *recorder)
+{
+  idlpgr_recordheader *header = recorder->header;
+  fc2Error error;
+  int syserror;
+
+  // stopping capture releases an acquirer waiting for a trigger
+  __atomic_store_n(&recorder->acquiring, 0, __ATOMIC_RELEASE);
+  fc2StopCapture(recorder->context);
+  pthread_join(recorder->acquirer, NULL);
+  __atomic_store_n(&recorder->done, 1, __ATOMIC_RELEASE);
+  pthread_join(recorder->writer, NULL);
+
+  // the index is not aligned, so it is written through the page cache
+  if (recorder->direct) {
+    close(recorder->fd);
+    recorder->fd = open(recorder->filename, O_WRONLY);
+  }
+  syserror = recorder->syserror;
+  if (recorder->fd < 0 && !syserror)
+    syserror = errno;
+  if (!syserror && recorder->written > 0) {
+    header->nframes = recorder->written;
+    header->indexoffset = header->headersize +
+      recorder->written * header->slotsize;
+    syserror = idlpgr_WriteAll(recorder->fd,
+			       (unsigned char *) recorder->index,
+			       recorder->written * sizeof(idlpgr_recordindex),
+			       (off_t) header->indexoffset);
+    if (!syserror)
+      syserror = idlpgr_WriteAll(recorder->fd, (unsigned char *) header,
+				 sizeof(idlpgr_recordheader), 0);
+  }
+  if (recorder->fd >= 0 && close(recorder->fd) && !syserror)
+    syserror = errno;
+
+  error = recorder->error;
+  if (!error && syserror)
+    error = FC2_ERROR_FAILED;
+  idlpgr_RecorderFree(recorder);
+  errno = syserror;
+
+  return error;
+}
+
+//
+// idlpgr_RecordingMap
+//
+// Map a file into memory
+//
+static fc2Error idlpgr_RecordingMap(const char *filename,
+				    idlpgr_recording **precording)
+{
+  idlpgr_recording *recording;
+  struct stat st;
+  int syserror;
+
+  recording = (idlpgr_recording *) calloc(1, sizeof(idlpgr_recording));
+  if (!recording)
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+
+  if ((recording->fd = open(filename, O_RDONLY)) < 0) {
+    free(recording);
+    return FC2_ERROR_NOT_FOUND;
+  }
+  if (fstat(recording->fd, &st) || st.st_size == 0) {
+    syserror = errno;
+    idlpgr_RecordingClose(recording);
+    errno = syserror;
+    return FC2_ERROR_INVALID_PARAMETER;
+  }
+  recording->length = (size_t) st.st_size;
+  recording->map = (unsigned char *) mmap(NULL, recording->length,
+					  PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE, recording->fd, 0);
+  if (recording->map == MAP_FAILED) {
+    syserror = errno;
+    recording->map = NULL;
+    idlpgr_RecordingClose(recording);
+    errno = syserror;
+    return FC2_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+
+  *precording = recording;
+  return FC2_ERROR_OK;
+}
+
+fc2Error idlpgr_RecordingOpen(const char *filename,
+			      idlpgr_recording **precording)
+{
+  idlpgr_recording *recording;
+  idlpgr_recordheader *header;
+  fc2Error error;
+  uint64_t end;
+
+  if ((error = idlpgr_RecordingMap(filename, &recording)))
+    return error;
+
+  header = &recording->header;
+  if (recording->length < sizeof(idlpgr_recordheader))
+    goto invalid;
+  memcpy(header, recording->map, sizeof(idlpgr_recordheader));
+  if (memcmp(header->magic, IDLPGR_RECORD_MAGIC, sizeof(header->magic)) ||
+      header->version != IDLPGR_RECORD_VERSION ||
+      header->slotsize < header->framesize || header->slotsize == 0 ||
+      header->headersize > recording->length)
+    goto invalid;
+
+  if (header->indexoffset) {
+    end = header->indexoffset + header->nframes * sizeof(idlpgr_recordindex);
+    if (end > recording->length ||
+	header->indexoffset < header->headersize +
+	header->nframes * header->slotsize)
+      goto invalid;
+    recording->nframes = header->nframes;
+    recording->index = (const idlpgr_recordindex *)
+      (recording->map + header->indexoffset);
+  } else
+    recording->nframes = (recording->length - header->headersize) /
+      header->slotsize;
+
+  *precording = recording;
+  return FC2_ERROR_OK;
+
+ invalid:
+  idlpgr_RecordingClose(recording);
+  return FC2_ERROR_INVALID_PARAMETER;
+}
+
+fc2Error idlpgr_RecordingOpenRaw(const char *filename,
+				 const idlpgr_recordheader *layout,
+				 idlpgr_recording **precording)
+{
+  idlpgr_recording *recording;
+  idlpgr_recordheader *header;
+  fc2Error error;
+
+  if (layout->framesize == 0 ||
+      layout->framesize < (uint64_t) layout->rows * layout->stride)
+    return FC2_ERROR_INVALID_PARAMETER;
+
+  if ((error = idlpgr_RecordingMap(filename, &recording)))
+    return error;
+
+  header = &recording->header;
+  memset(header, 0, sizeof(idlpgr_recordheader));
+  header->headersize = layout->headersize;
+  header->rows = layout->rows;
+  header->cols = layout->cols;
+  header->stride = layout->stride;
+  header->format = layout->format;
+  header->bayerformat = layout->bayerformat;
+  header->framesize = layout->framesize;
+  header->slotsize = layout->framesize;
+  if (header->headersize > recording->length) {
+    idlpgr_RecordingClose(recording);
+    return FC2_ERROR_INVALID_PARAMETER;
+  }
+  recording->nframes = (recording->length - header->headersize) /
+    header->slotsize;
+  header->nframes = recording->nframes;
+
+  *precording = recording;
+  return FC2_ERROR_OK;
+}
+
+void idlpgr_RecordingAdvise(const idlpgr_recording *recording,
+			    int sequential)
+{
+  madvise(recording->map, recording->length,
+	  sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+}
+
+void idlpgr_RecordingPrefetch(const idlpgr_recording *recording,
+			      uint64_t first, uint64_t count)
+{
+  const idlpgr_recordheader *header = &recording->header;
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  uint64_t start, end;
+
+  if (first >= recording->nframes || count == 0)
+    return;
+  if (count > recording->nframes - first)
+    count = recording->nframes - first;
+
+  start = header->headersize + first * header->slotsize;
+  end = header->headersize + (first + count) * header->slotsize;
+  if (end > recording->length)
+    end = recording->length;
+  start -= start % page;
+  madvise(recording->map + start, end - start, MADV_WILLNEED);
+}
+
+const unsigned char *idlpgr_RecordingFrame(const idlpgr_recording *recording,
+					   uint64_t n)
+{
+  const idlpgr_recordheader *header = &recording->header;
+
+  if (n >= recording->nframes)
+    return NULL;
+
+  return recording->map + header->headersize + n * header->slotsize;
+}
+
+void idlpgr_RecordingClose(idlpgr_recording *recording)
+{
+  if (recording->map)
+    munmap(recording->map, recording->length);
+  close(recording->fd);
+  free(recording);
+}
@@ -0,0 +1,182 @@
+//
+// idlpgr_record.h
+//
+// Streaming recorder and reader for idlpgr recordings.
+// The recorder and reader do not depend on IDL.
+//
+// A recording is a single file in host byte order:
+//
+//   offset 0       header (IDLPGR_RECORD_HEADERSIZE bytes)
+//   headersize     frame 0
+//   + slotsize     frame 1
+//   ...
+//   indexoffset    index: one idlpgr_recordindex per frame
+//
+// Each frame occupies a slot of slotsize bytes, which is framesize
+// rounded up to a multiple of IDLPGR_RECORD_ALIGN, so that every
+// frame begins on an aligned boundary in the file.  The pixel data
+// of a frame is rows*stride bytes laid out as in the fc2Image
+// delivered by the camera.
+//
+// The index and the final frame count are written when recording
+// stops.  A recording that was interrupted has indexoffset = 0;
+// its frames can still be located from their slot positions.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+// 10/16/2026 DGG Raw dumps and read-ahead.
+// 10/16/2026 DGG Index holds the camera's frame counter.
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_RECORD_H
+#define IDLPGR_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "C/FlyCapture2_C.h"
+
+#define IDLPGR_RECORD_MAGIC      "IDLPGR01"
+#define IDLPGR_RECORD_VERSION    1
+#define IDLPGR_RECORD_HEADERSIZE 4096
+#define IDLPGR_RECORD_ALIGN      4096
+
+//
+// Flags of a recording
+//
+#define IDLPGR_RECORD_FRAMECOUNTER 1 // index holds embedded frame counters
+
+typedef struct idlpgr_recordheader {
+  char magic[8];               // IDLPGR_RECORD_MAGIC
+  uint32_t version;            // IDLPGR_RECORD_VERSION
+  uint32_t headersize;         // offset of first frame
+  uint32_t rows;
+  uint32_t cols;
+  uint32_t stride;             // bytes per row
+  uint32_t format;             // fc2PixelFormat
+  uint32_t bayerformat;        // fc2BayerTileFormat
+  uint32_t flags;              // IDLPGR_RECORD_*
+  uint64_t framesize;          // bytes of pixel data per frame
+  uint64_t slotsize;           // bytes between successive frames
+  uint64_t nframes;            // frames in the recording
+  uint64_t indexoffset;        // offset of the index, or 0
+} idlpgr_recordheader;
+
+//
+// The counter of a frame is the frame counter that the camera
+// embedded in it, if the recording's flags include
+// IDLPGR_RECORD_FRAMECOUNTER, so that frames lost by the driver
+// or in transit leave gaps.  Otherwise it is the number of frames
+// that the recorder had retrieved, which reveals only frames that
+// the recorder dropped.
+//
+typedef struct idlpgr_recordindex {
+  double timestamp;            // [s]
+  uint64_t counter;            // frame counter or sequence number
+  uint64_t offset;             // offset of the frame in the file
+} idlpgr_recordindex;
+
+//
+// Recorder
+//
+// An acquisition thread retrieves frames from the camera and copies
+// them into a bounded ring of aligned slots.  A writer thread drains
+// the ring, writing runs of consecutive slots with a single call.
+// Frames that arrive while the ring is full are dropped and counted;
+// the gap appears in the counters of the index.
+//
+typedef struct idlpgr_recorder idlpgr_recorder;
+
+typedef struct idlpgr_recordstatus {
+  int running;                 // acquisition is in progress
+  fc2Error error;              // error that stopped acquisition
+  int syserror;                // errno of failed write, or 0
+  unsigned long long captured; // frames retrieved from the camera
+  unsigned long long written;  // frames written to the file
+  unsigned long long dropped;  // frames dropped because ring was full
+  unsigned long long bytes;    // bytes written to the file
+  unsigned int queued;         // frames waiting to be written
+  unsigned int nslots;         // capacity of the ring
+} idlpgr_recordstatus;
+
+//
+// Start recording frames from a context that is capturing into
+// filename, with a ring of nslots frames.  If direct is set, the
+// file is opened with O_DIRECT to bypass the page cache.
+// counteroffset is the offset of the embedded frame counter in
+// the pixel data, or -1 if the camera does not embed it.
+//
+fc2Error idlpgr_RecorderStart(idlpgr_recorder **precorder,
+			      fc2Context context,
+			      const char *filename,
+			      unsigned int nslots,
+			      int direct,
+			      int counteroffset);
+
+void idlpgr_RecorderStatus(idlpgr_recorder *recorder,
+			   idlpgr_recordstatus *status);
+
+//
+// Stop capture and acquisition, write the frames remaining in
+// the ring, write the index, close the file, and free the recorder.
+// Returns the first error encountered while recording, and sets
+// errno to the error of a failed write, or to 0.
+//
+fc2Error idlpgr_RecorderStop(idlpgr_recorder *recorder);
+
+//
+// Reader
+//
+// A recording is mapped into memory so that frames can be
+// read in any order without reading the whole file.  The mapping
+// is private and writable: changes made through it are never
+// written back to the file.
+//
+// Raw dumps, consisting of a fixed header followed by contiguous
+// frames of equal size, are opened with idlpgr_RecordingOpenRaw.
+// Their frames are located by position, so they have no index.
+//
+typedef struct idlpgr_recording {
+  int fd;
+  unsigned char *map;
+  size_t length;
+  idlpgr_recordheader header;
+  uint64_t nframes;
+  const idlpgr_recordindex *index; // NULL for interrupted recordings
+} idlpgr_recording;
+
+fc2Error idlpgr_RecordingOpen(const char *filename,
+			      idlpgr_recording **precording);
+
+//
+// Open a raw dump whose geometry is described by the headersize,
+// rows, cols, stride, format and framesize fields of layout.
+//
+fc2Error idlpgr_RecordingOpenRaw(const char *filename,
+				 const idlpgr_recordheader *layout,
+				 idlpgr_recording **precording);
+
+//
+// Advise the kernel that frames will be read in order (sequential)
+// or in no particular order.
+//
+void idlpgr_RecordingAdvise(const idlpgr_recording *recording,
+			    int sequential);
+
+//
+// Ask the kernel to start reading count frames beginning
+// with frame first.
+//
+void idlpgr_RecordingPrefetch(const idlpgr_recording *recording,
+			      uint64_t first, uint64_t count);
+
+//
+// Pixel data of frame n, or NULL if n is out of range.
+//
+const unsigned char *idlpgr_RecordingFrame(const idlpgr_recording *recording,
+					   uint64_t n);
+
+void idlpgr_RecordingClose(idlpgr_recording *recording);
+
+#endif
@@ -0,0 +1,126 @@
+//
+// idlpgr_simd.c
+//
+// Vectorized pixel kernels for idlpgr.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include "idlpgr_simd.h"
+
+#ifdef IDLPGR_X86
+#include <immintrin.h>
+#endif
+
+idlpgr_unpack12_fn idlpgr_Unpack12 = idlpgr_Unpack12Scalar;
+
+//
+// idlpgr_Unpack12Scalar
+//
+void idlpgr_Unpack12Scalar(const unsigned char *src, unsigned short *dest,
+			   size_t npixels)
+{
+  size_t n;
+
+  for (n = 0; n + 1 < npixels; n += 2, src += 3) {
+    dest[n]   = (unsigned short) ((src[0] << 4) | (src[1] & 0x0F));
+    dest[n+1] = (unsigned short) ((src[2] << 4) | (src[1] >> 4));
+  }
+  if (n < npixels)
+    dest[n] = (unsigned short) ((src[0] << 4) | (src[1] & 0x0F));
+}
+
+#ifdef IDLPGR_X86
+
+//
+// The vector kernels gather the three bytes of each pixel pair
+// into two 16-bit lanes, (b1 | b0 << 8) for the even pixel and
+// (b1 | b2 << 8) for the odd pixel.  Shifting both lanes right by
+// four yields the odd pixel directly; the even pixel takes the
+// high bits from the shifted lane and the low nibble from
+// the unshifted lane.
+//
+#define IDLPGR_SHUFFLE12 \
+  1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11
+#define IDLPGR_HIGH12 \
+  0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FF0, 0x0FFF
+#define IDLPGR_LOW12 \
+  0x000F, 0x0000, 0x000F, 0x0000, 0x000F, 0x0000, 0x000F, 0x0000
+
+//
+// idlpgr_Unpack12SSSE3
+//
+// 8 pixels from 12 bytes per iteration.  Each load reads 16 bytes,
+// so the last pixels are left to the scalar kernel.
+//
+__attribute__((target("ssse3")))
+void idlpgr_Unpack12SSSE3(const unsigned char *src, unsigned short *dest,
+			  size_t npixels)
+{
+  const __m128i shuffle = _mm_setr_epi8(IDLPGR_SHUFFLE12);
+  const __m128i high = _mm_setr_epi16(IDLPGR_HIGH12);
+  const __m128i low = _mm_setr_epi16(IDLPGR_LOW12);
+  __m128i v;
+  size_t n;
+
+  for (n = 0; n + 11 < npixels; n += 8, src += 12) {
+    v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), shuffle);
+    v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), high),
+		     _mm_and_si128(v, low));
+    _mm_storeu_si128((__m128i *) (dest + n), v);
+  }
+  idlpgr_Unpack12Scalar(src, dest + n, npixels - n);
+}
+
+//
+// idlpgr_Unpack12AVX2
+//
+// 16 pixels from 24 bytes per iteration, with each 128-bit lane
+// handling 12 bytes.
+//
+__attribute__((target("avx2")))
+void idlpgr_Unpack12AVX2(const unsigned char *src, unsigned short *dest,
+			 size_t npixels)
+{
+  const __m256i shuffle =
+    _mm256_setr_epi8(IDLPGR_SHUFFLE12, IDLPGR_SHUFFLE12);
+  const __m256i high = _mm256_setr_epi16(IDLPGR_HIGH12, IDLPGR_HIGH12);
+  const __m256i low = _mm256_setr_epi16(IDLPGR_LOW12, IDLPGR_LOW12);
+  __m256i v;
+  size_t n;
+
+  for (n = 0; n + 19 < npixels; n += 16, src += 24) {
+    v = _mm256_inserti128_si256
+      (_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) src)),
+       _mm_loadu_si128((const __m128i *) (src + 12)), 1);
+    v = _mm256_shuffle_epi8(v, shuffle);
+    v = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(v, 4), high),
+			_mm256_and_si256(v, low));
+    _mm256_storeu_si256((__m256i *) (dest + n), v);
+  }
+  idlpgr_Unpack12SSSE3(src, dest + n, npixels - n);
+}
+
+#endif
+
+//
+// idlpgr_SelectKernels
+//
+const char *idlpgr_SelectKernels(void)
+{
+#ifdef IDLPGR_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    idlpgr_Unpack12 = idlpgr_Unpack12AVX2;
+    return "avx2";
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    idlpgr_Unpack12 = idlpgr_Unpack12SSSE3;
+    return "ssse3";
+  }
+#endif
+  idlpgr_Unpack12 = idlpgr_Unpack12Scalar;
+  return "scalar";
+}
@@ -0,0 +1,46 @@
+//
+// idlpgr_simd.h
+//
+// Vectorized pixel kernels for idlpgr.  The kernels do not depend
+// on IDL, and the fastest implementation supported by the host CPU
+// is selected at run time by idlpgr_SelectKernels.
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+//
+// Copyright (c) 2026 David G. Grier
+//
+#ifndef IDLPGR_SIMD_H
+#define IDLPGR_SIMD_H
+
+#include <stddef.h>
+
+//
+// Unpack npixels 12-bit pixels from src into dest.  Each pair of
+// pixels occupies three bytes: the high bits of the first pixel,
+// the low bits of both pixels (second pixel in the upper nibble),
+// and the high bits of the second pixel.
+//
+typedef void (*idlpgr_unpack12_fn)(const unsigned char *src,
+				   unsigned short *dest,
+				   size_t npixels);
+
+extern idlpgr_unpack12_fn idlpgr_Unpack12;
+
+void idlpgr_Unpack12Scalar(const unsigned char *src, unsigned short *dest,
+			   size_t npixels);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IDLPGR_X86 1
+void idlpgr_Unpack12SSSE3(const unsigned char *src, unsigned short *dest,
+			  size_t npixels);
+void idlpgr_Unpack12AVX2(const unsigned char *src, unsigned short *dest,
+			 size_t npixels);
+#endif
+
+//
+// Choose the fastest kernels supported by the host CPU.
+// Returns the name of the selected instruction set.
+//
+const char *idlpgr_SelectKernels(void);
+
+#endif
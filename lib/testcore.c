@@ -0,0 +1,648 @@
+//
+// testcore.c
+//
+// Checks of the idlpgr acquisition engine without IDL, run
+// against the simulated cameras of fc2sim by `make check`.
+// Each check runs in its own process, because fc2sim reads its
+// configuration once, from the environment given in the table
+// at the end of this file.
+//
+//   sim         simulated cameras deliver frames of the configured
+//               geometry with consecutive counters and time stamps
+//   ring        grabber delivers frames in order, and counts
+//               overflows and gaps in the frame counter
+//   record      recordings read back in order, indexed by frame counter
+//   errors      retrieval status and statistics by class
+//   stats       percentiles of timing histograms
+//   background  background estimates against direct computation,
+//               and of every frame retrieved from a camera
+//   accumulate  accumulated sums, means and variances against
+//               direct computation, and of frames from a camera
+//   demosaic    interpolation is the same however the rows are
+//               divided among threads
+//
+// Usage: testcore [check ...]
+//
+// Modification History:
+// 10/16/2026 Written by David G. Grier, New York University
+//
+// Copyright (c) 2026 David G. Grier
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "C/FlyCapture2_C.h"
+#include "idlpgr_core.h"
+#include "idlpgr_demosaic.h"
+
+static int failures;
+
+#define CHECK(cond)							\
+  do {									\
+    if (!(cond)) {							\
+      fprintf(stderr, "%s:%d: check failed: %s\n",			\
+	      __FILE__, __LINE__, #cond);				\
+      failures++;							\
+    }									\
+  } while (0)
+
+static int close_to(double a, double b, double tolerance)
+{
+  return fabs(a - b) <= tolerance * (1. + fabs(b));
+}
+
+//
+// Connect the first camera with the frame counter embedded
+//
+static fc2Context connect_camera(idlpgr_camera **pcamera)
+{
+  fc2Context context;
+  fc2PGRGuid guid;
+  fc2EmbeddedImageInfo embedded;
+
+  if (fc2CreateContext(&context) ||
+      fc2GetCameraFromIndex(context, 0, &guid) ||
+      fc2Connect(context, &guid) ||
+      idlpgr_CameraConnect(context)) {
+    fprintf(stderr, "could not connect to simulated camera\n");
+    exit(1);
+  }
+  if (!fc2GetEmbeddedImageInfo(context, &embedded)) {
+    embedded.frameCounter.onOff = TRUE;
+    fc2SetEmbeddedImageInfo(context, &embedded);
+  }
+  *pcamera = idlpgr_CameraGet(context);
+  idlpgr_CacheEmbeddedImageInfo(*pcamera);
+
+  return context;
+}
+
+static void disconnect_camera(fc2Context context)
+{
+  idlpgr_CameraForget(context);
+  fc2Disconnect(context);
+  fc2DestroyContext(context);
+}
+
+static unsigned int frame_counter(const idlpgr_camera *camera,
+				  const unsigned char *data)
+{
+  return idlpgr_MetadataWord(data + camera->stats.counteroffset);
+}
+
+static void test_sim(void)
+{
+  idlpgr_camera *camera;
+  fc2Context context;
+  fc2Image image;
+  double timestamp, last = 0.;
+  unsigned int counter, previous = 0, n;
+  int geometry = 1, consecutive = 1, increasing = 1;
+
+  context = connect_camera(&camera);
+  CHECK(camera->stats.counteroffset >= 0);
+  fc2CreateImage(&image);
+
+  // frames are retrieved from the driver directly
+  CHECK(!fc2StartCapture(context));
+  for (n = 0; n < 20; n++) {
+    if (fc2RetrieveBuffer(context, &image)) {
+      CHECK(!"frame retrieved");
+      break;
+    }
+    geometry &= (image.rows == 240 && image.cols == 320 &&
+		 image.stride >= 320 &&
+		 image.format == FC2_PIXEL_FORMAT_MONO8);
+    counter = frame_counter(camera, image.pData);
+    timestamp = idlpgr_TimeStampSeconds(fc2GetImageTimeStamp(&image));
+    if (n > 0) {
+      consecutive &= (counter == previous + 1);
+      increasing &= (timestamp > last);
+    }
+    previous = counter;
+    last = timestamp;
+  }
+  fc2StopCapture(context);
+  CHECK(geometry);
+  CHECK(consecutive);
+  CHECK(increasing);
+
+  idlpgr_ImageRelease(&image);
+  disconnect_camera(context);
+}
+
+static void test_ring(void)
+{
+  idlpgr_camera *camera;
+  fc2Context context;
+  fc2Image image;
+  unsigned int counter, first = 0, last = 0, n;
+  unsigned long long popped = 0;
+  int inorder = 1;
+
+  context = connect_camera(&camera);
+  CHECK(camera->stats.counteroffset >= 0);
+  fc2CreateImage(&image);
+
+  CHECK(!fc2StartCapture(context));
+  CHECK(!idlpgr_GrabberStart(&camera->grabber, context, 4, 1000,
+			     &camera->stats, camera->framesize,
+			     NULL, NULL));
+
+  // keep up, fall behind long enough to fill the ring, catch up,
+  // and read what remains after capture stops
+  for (n = 0; n < 60; n++) {
+    if (n == 20)
+      usleep(50000);
+    if (n == 50)
+      fc2StopCapture(context);
+    if (idlpgr_Retrieve(context, &image, 0))
+      break;
+    counter = frame_counter(camera, image.pData);
+    if (popped++)
+      inorder &= (counter > last);
+    else
+      first = counter;
+    last = counter;
+  }
+  idlpgr_GrabberStop(camera->grabber);
+  camera->grabber = NULL;
+
+  CHECK(popped >= 50);
+  CHECK(inorder);
+  CHECK(camera->stats.overflows > 0);
+  CHECK(camera->stats.gaps > 0);
+  CHECK(camera->stats.delivered == popped);
+  CHECK(camera->stats.retrieved ==
+	camera->stats.delivered + camera->stats.overflows);
+  CHECK(last - first + 1 == camera->stats.retrieved + camera->stats.gaps);
+
+  idlpgr_ImageRelease(&image);
+  disconnect_camera(context);
+}
+
+static void test_record(void)
+{
+  char filename[] = "/tmp/testcoreXXXXXX";
+  idlpgr_camera *camera;
+  idlpgr_recorder *recorder;
+  idlpgr_recording *recording;
+  fc2Context context;
+  const unsigned char *data;
+  unsigned int counter, last = 0;
+  uint64_t n;
+  int fd, inorder = 1;
+
+  if ((fd = mkstemp(filename)) < 0) {
+    perror(filename);
+    failures++;
+    return;
+  }
+  close(fd);
+
+  context = connect_camera(&camera);
+  CHECK(!fc2StartCapture(context));
+  CHECK(!idlpgr_RecorderStart(&recorder, context, filename, 8, 0,
+			      camera->stats.counteroffset));
+  usleep(100000);
+  CHECK(!idlpgr_RecorderStop(recorder));
+
+  CHECK(!idlpgr_RecordingOpen(filename, &recording));
+  if (recording) {
+    CHECK(recording->nframes > 10);
+    CHECK(recording->nframes == recording->header.nframes);
+    CHECK(recording->header.rows == 240);
+    CHECK(recording->header.cols == 320);
+    CHECK(recording->header.format == FC2_PIXEL_FORMAT_MONO8);
+    CHECK(recording->index != NULL);
+    CHECK(recording->header.flags & IDLPGR_RECORD_FRAMECOUNTER);
+    for (n = 0; n < recording->nframes; n++) {
+      CHECK((data = idlpgr_RecordingFrame(recording, n)) != NULL);
+      if (!data)
+	break;
+      counter = frame_counter(camera, data);
+      if (recording->index)
+	inorder &= (recording->index[n].counter == counter);
+      if (n > 0) {
+	inorder &= (counter > last);
+	if (recording->index)
+	  inorder &= (recording->index[n].timestamp >
+		      recording->index[n-1].timestamp);
+      }
+      last = counter;
+    }
+    CHECK(inorder);
+    // frames lost in transit leave gaps in the index
+    if (recording->index)
+      CHECK(recording->index[recording->nframes-1].counter -
+	    recording->index[0].counter + 1 > recording->nframes);
+    CHECK(!idlpgr_RecordingFrame(recording, recording->nframes));
+    idlpgr_RecordingClose(recording);
+  }
+
+  unlink(filename);
+  disconnect_camera(context);
+}
+
+static void test_errors(void)
+{
+  idlpgr_camera *camera;
+  fc2Context context;
+  fc2Image image;
+  fc2Config config;
+  fc2TriggerMode trigger;
+  unsigned long long ok = 0, incomplete = 0, inconsistent = 0, other = 0;
+  int n, status;
+
+  context = connect_camera(&camera);
+  fc2CreateImage(&image);
+
+  // frames are retrieved directly, without the grabber
+  CHECK(!fc2StartCapture(context));
+  idlpgr_StatsReset(&camera->stats);
+  for (n = 0; n < 100; n++) {
+    status = idlpgr_FrameStatus(idlpgr_Retrieve(context, &image, 0), &image);
+    if (status == 0)
+      ok++;
+    else if (status == IDLPGR_ERROR_INCOMPLETE)
+      incomplete++;
+    else if (status == FC2_ERROR_IMAGE_CONSISTENCY_ERROR)
+      inconsistent++;
+    else
+      other++;
+  }
+  fc2StopCapture(context);
+  CHECK(ok > 0 && incomplete > 0 && inconsistent > 0);
+  CHECK(other == 0);
+  CHECK(camera->stats.incomplete == incomplete);
+  CHECK(camera->stats.inconsistent == inconsistent);
+  CHECK(camera->stats.errors == 0);
+  CHECK(camera->stats.timeouts == 0);
+
+  // a camera waiting for a trigger that never comes times out
+  CHECK(!fc2GetConfiguration(context, &config));
+  config.grabTimeout = 20;
+  CHECK(!fc2SetConfiguration(context, &config));
+  idlpgr_CacheConfiguration(camera);
+  memset(&trigger, 0, sizeof(fc2TriggerMode));
+  trigger.onOff = TRUE;
+  trigger.source = 7;
+  CHECK(!fc2SetTriggerMode(context, &trigger));
+  CHECK(!fc2StartCapture(context));
+  idlpgr_StatsReset(&camera->stats);
+  status = idlpgr_FrameStatus(idlpgr_Retrieve(context, &image, 0), &image);
+  CHECK(status == FC2_ERROR_TIMEOUT);
+  CHECK(camera->stats.timeouts == 1);
+  fc2StopCapture(context);
+
+  idlpgr_ImageRelease(&image);
+  disconnect_camera(context);
+}
+
+static void test_stats(void)
+{
+  idlpgr_stats stats;
+  idlpgr_histogram *h = &stats.stage[IDLPGR_STAGE_RETRIEVE];
+  double p50, p99;
+  unsigned int n;
+
+  // steady frame intervals of 33.3 ms
+  memset(&stats, 0, sizeof(idlpgr_stats));
+  idlpgr_StatsReset(&stats);
+  CHECK(idlpgr_HistogramPercentile(h, 0.5) == 0.);
+  for (n = 0; n < 1000; n++)
+    idlpgr_StatsInterval(&stats, IDLPGR_STAGE_RETRIEVE,
+			 33300000ULL + (n % 100) * 1000);
+  p50 = idlpgr_HistogramPercentile(h, 0.5);
+  p99 = idlpgr_HistogramPercentile(h, 0.99);
+  CHECK(h->min == 33300000ULL && h->max == 33399000ULL);
+  CHECK(p50 >= h->min && p50 <= h->max);
+  CHECK(close_to(p50, 33350000., 1. / IDLPGR_STATS_SUBBINS));
+  CHECK(p99 >= p50 && p99 <= h->max);
+
+  // intervals spread over several octaves, and short ones exactly
+  idlpgr_StatsReset(&stats);
+  for (n = 1; n <= 1000; n++)
+    idlpgr_StatsInterval(&stats, IDLPGR_STAGE_RETRIEVE, 1000ULL * n);
+  CHECK(close_to(idlpgr_HistogramPercentile(h, 0.5), 500000.,
+		 1. / IDLPGR_STATS_SUBBINS));
+  CHECK(close_to(idlpgr_HistogramPercentile(h, 0.9), 900000.,
+		 1. / IDLPGR_STATS_SUBBINS));
+  idlpgr_StatsReset(&stats);
+  for (n = 0; n < 10; n++)
+    idlpgr_StatsInterval(&stats, IDLPGR_STAGE_RETRIEVE, n);
+  CHECK(idlpgr_HistogramPercentile(h, 0.5) <= 5.);
+  CHECK(idlpgr_HistogramPercentile(h, 1.) == 9.);
+}
+
+//
+// Frames of random pixels, with rows padded to stride bytes
+//
+static unsigned char *make_frames(unsigned int nframes, unsigned int rows,
+				  size_t stride, unsigned int depth)
+{
+  unsigned char *data;
+  size_t n, size = nframes * rows * stride;
+
+  data = (unsigned char *) malloc(size);
+  for (n = 0; n < size; n++)
+    data[n] = (unsigned char) rand();
+  if (depth == 2)
+    for (n = 0; n < size / 2; n++)
+      ((unsigned short *) data)[n] &= 0x0fff;
+
+  return data;
+}
+
+static double pixel(const unsigned char *row, unsigned int x,
+		    unsigned int depth)
+{
+  return (depth == 1) ? row[x] : ((const unsigned short *) row)[x];
+}
+
+static void test_background(unsigned int depth)
+{
+  const unsigned int nframes = 6, rows = 300, cols = 70;
+  const size_t stride = cols * depth;
+  idlpgr_background *single, *pooled;
+  unsigned char *frames, *flat;
+  const unsigned char *row;
+  float *normalized;
+  double sum;
+  unsigned int f, x, y, means = 1, same = 1, ones = 1;
+
+  frames = make_frames(nframes, rows, stride, depth);
+  normalized = (float *) malloc(rows * cols * sizeof(float));
+
+  // equal weights: the running mean is the mean of the frames,
+  // and is the same however the rows are divided among threads
+  single = idlpgr_BackgroundCreate(0.f, 1);
+  pooled = idlpgr_BackgroundCreate(0.f, 4);
+  for (f = 0; f < nframes; f++) {
+    CHECK(!idlpgr_BackgroundUpdate(single, frames + f * rows * stride,
+				   stride, rows, cols, depth));
+    CHECK(!idlpgr_BackgroundUpdate(pooled, frames + f * rows * stride,
+				   stride, rows, cols, depth));
+  }
+  CHECK(pooled->nframes == nframes);
+  for (y = 0; y < rows; y++)
+    for (x = 0; x < cols; x++) {
+      sum = 0.;
+      for (f = 0; f < nframes; f++) {
+	row = frames + (f * rows + y) * stride;
+	sum += pixel(row, x, depth);
+      }
+      means &= close_to(pooled->mean[y * cols + x], sum / nframes, 1e-5);
+      same &= (pooled->mean[y * cols + x] == single->mean[y * cols + x]) &&
+	(pooled->median[y * cols + x] == single->median[y * cols + x]);
+    }
+  CHECK(means);
+  CHECK(same);
+
+  // a frame normalized by a constant background equal to it is 1
+  flat = (unsigned char *) calloc(rows, stride);
+  for (y = 0; y < rows; y++)
+    for (x = 0; x < cols; x++)
+      if (depth == 1)
+	flat[y * stride + x] = 100;
+      else
+	((unsigned short *) (flat + y * stride))[x] = 1000;
+  idlpgr_BackgroundReset(pooled);
+  for (f = 0; f < 3; f++)
+    CHECK(!idlpgr_BackgroundUpdate(pooled, flat, stride, rows, cols, depth));
+  CHECK(!idlpgr_BackgroundSetDark(pooled, NULL, 0, 0, 10.f));
+  CHECK(!idlpgr_BackgroundNormalize(pooled, flat, stride, rows, cols, depth,
+				    1, normalized));
+  for (y = 0; y < rows * cols; y++)
+    ones &= close_to(normalized[y], 1., 1e-6);
+  CHECK(ones);
+  CHECK(idlpgr_BackgroundNormalize(pooled, flat, stride, rows - 1, cols,
+				   depth, 1, normalized) == -1);
+
+  idlpgr_BackgroundFree(pooled);
+  idlpgr_BackgroundFree(single);
+  free(flat);
+  free(normalized);
+  free(frames);
+}
+
+static void test_backgrounds(void)
+{
+  idlpgr_camera *camera;
+  fc2Context context;
+  fc2Image image;
+  unsigned int n;
+
+  idlpgr_SelectAllKernels();
+  test_background(1);
+  test_background(2);
+
+  // every frame retrieved by the grabber reaches the background,
+  // including frames that overflow the ring
+  context = connect_camera(&camera);
+  fc2CreateImage(&image);
+  camera->background = idlpgr_BackgroundCreate(0.f, 2);
+  CHECK(!fc2StartCapture(context));
+  idlpgr_StatsReset(&camera->stats);
+  CHECK(!idlpgr_GrabberStart(&camera->grabber, context, 2, 1000,
+			     &camera->stats, camera->framesize,
+			     idlpgr_CameraFrame, camera));
+  for (n = 0; n < 5; n++) {
+    CHECK(!idlpgr_Retrieve(context, &image, 0));
+    usleep(10000);
+  }
+  fc2StopCapture(context);
+  idlpgr_GrabberStop(camera->grabber);
+  camera->grabber = NULL;
+  CHECK(camera->stats.overflows > 0);
+  CHECK(camera->background->nframes == camera->stats.retrieved);
+
+  idlpgr_ImageRelease(&image);
+  disconnect_camera(context);
+}
+
+static void test_accumulator(unsigned int depth)
+{
+  const unsigned int nframes = 5, rows = 250, cols = 37;
+  const size_t stride = cols * depth + 6;
+  idlpgr_accumulator *acc;
+  unsigned char *frames;
+  const unsigned char *row;
+  float *mean, *variance;
+  double sum, sum2, m, v;
+  unsigned int f, x, y, sums = 1, means = 1, variances = 1;
+
+  frames = make_frames(nframes, rows, stride, depth);
+  mean = (float *) malloc(rows * cols * sizeof(float));
+  variance = (float *) malloc(rows * cols * sizeof(float));
+
+  acc = idlpgr_AccumulatorCreate(4);
+  CHECK(!idlpgr_AccumulatorStart(acc, rows, cols, depth, 0, 1));
+  for (f = 0; f < nframes; f++)
+    CHECK(!idlpgr_AccumulatorAdd(acc, frames + f * rows * stride, stride));
+  CHECK(acc->nframes == nframes);
+  idlpgr_AccumulatorAverage(acc, mean);
+  idlpgr_AccumulatorVariance(acc, variance);
+
+  for (y = 0; y < rows; y++)
+    for (x = 0; x < cols; x++) {
+      sum = sum2 = 0.;
+      for (f = 0; f < nframes; f++) {
+	row = frames + (f * rows + y) * stride;
+	sum += pixel(row, x, depth);
+	sum2 += pixel(row, x, depth) * pixel(row, x, depth);
+      }
+      m = sum / nframes;
+      v = (sum2 - nframes * m * m) / (nframes - 1);
+      sums &= (((unsigned int *) acc->sum)[y * cols + x] == sum);
+      means &= close_to(mean[y * cols + x], m, 1e-5);
+      variances &= close_to(variance[y * cols + x], v, 1e-3);
+    }
+  CHECK(sums);
+  CHECK(means);
+  CHECK(variances);
+
+  idlpgr_AccumulatorFree(acc);
+  free(variance);
+  free(mean);
+  free(frames);
+}
+
+static void test_accumulate(void)
+{
+  idlpgr_camera *camera;
+  idlpgr_accumulator *acc = NULL;
+  idlpgr_layout layout;
+  fc2Context context;
+  fc2Image image;
+
+  idlpgr_SelectAllKernels();
+  test_accumulator(1);
+  test_accumulator(2);
+  CHECK(idlpgr_AccumulatorMaxFrames(1) == 16843009);
+  CHECK(idlpgr_AccumulatorMaxFrames(2) == 65537);
+
+  // packed 12-bit frames are unpacked before they are added
+  context = connect_camera(&camera);
+  fc2CreateImage(&image);
+  CHECK(!fc2StartCapture(context));
+  CHECK(!idlpgr_Accumulate(context, &image, 5, 0, 1, &layout, &acc));
+  CHECK(acc && acc->nframes == 5);
+  CHECK(layout.packed12 && layout.depth == 2);
+  CHECK(acc && acc->rows == 240 && acc->cols == 320);
+  CHECK(idlpgr_Accumulate(context, &image, 70000, 0, 0, &layout, &acc) ==
+	FC2_ERROR_INVALID_PARAMETER);
+  fc2StopCapture(context);
+
+  idlpgr_ImageRelease(&image);
+  disconnect_camera(context);
+}
+
+static void test_demosaic(void)
+{
+  const unsigned int rows = 300, cols = 70;
+  const size_t stride = cols + 10;
+  unsigned char *raw, *single, *pooled;
+  int method, same = 1;
+
+  idlpgr_SelectAllKernels();
+  raw = make_frames(1, rows, stride, 1);
+  single = (unsigned char *) malloc(3 * rows * cols);
+  pooled = (unsigned char *) malloc(3 * rows * cols);
+  for (method = IDLPGR_DEMOSAIC_NEAREST; method <= IDLPGR_DEMOSAIC_EDGE;
+       method++) {
+    CHECK(!idlpgr_DemosaicBayer8(raw, stride, rows, cols, IDLPGR_BAYER_GRBG,
+				 method, 1, single));
+    CHECK(!idlpgr_DemosaicBayer8(raw, stride, rows, cols, IDLPGR_BAYER_GRBG,
+				 method, 4, pooled));
+    same &= !memcmp(single, pooled, 3 * rows * cols);
+  }
+  CHECK(same);
+  CHECK(idlpgr_DemosaicBayer8(raw, stride, rows, cols, 0, 1, 1, single) == -1);
+
+  free(pooled);
+  free(single);
+  free(raw);
+}
+
+static const struct {
+  const char *name;
+  void (*run)(void);
+  const char *environment;     // fc2sim settings, name=value ...
+} tests[] = {
+  { "sim", test_sim,
+    "FC2SIM_WIDTH=320 FC2SIM_HEIGHT=240 FC2SIM_RATE=1000" },
+  { "ring", test_ring,
+    "FC2SIM_WIDTH=320 FC2SIM_HEIGHT=240 FC2SIM_RATE=1000 FC2SIM_DROP=0.05" },
+  { "record", test_record,
+    "FC2SIM_WIDTH=320 FC2SIM_HEIGHT=240 FC2SIM_RATE=1000 FC2SIM_DROP=0.05" },
+  { "errors", test_errors,
+    "FC2SIM_WIDTH=320 FC2SIM_HEIGHT=240 FC2SIM_RATE=1000 "
+    "FC2SIM_INCOMPLETE=0.2 FC2SIM_CORRUPT=0.2" },
+  { "stats", test_stats, "" },
+  { "background", test_backgrounds,
+    "FC2SIM_WIDTH=320 FC2SIM_HEIGHT=240 FC2SIM_RATE=1000 "
+    "FC2SIM_FORMAT=MONO12" },
+  { "accumulate", test_accumulate,
+    "FC2SIM_WIDTH=320 FC2SIM_HEIGHT=240 FC2SIM_RATE=1000 "
+    "FC2SIM_FORMAT=MONO12" },
+  { "demosaic", test_demosaic, "" },
+};
+
+#define NTESTS (sizeof(tests)/sizeof(tests[0]))
+
+//
+// Run a check in a child process with its fc2sim settings
+//
+static int run(unsigned int n)
+{
+  char *environment, *setting, *s, *value;
+  pid_t pid;
+  int status;
+
+  fflush(stdout);
+  if ((pid = fork()) == 0) {
+    environment = strdup(tests[n].environment);
+    for (setting = strtok_r(environment, " ", &s); setting;
+	 setting = strtok_r(NULL, " ", &s))
+      if ((value = strchr(setting, '='))) {
+	*value++ = '\0';
+	setenv(setting, value, 1);
+      }
+    srand(1);
+    tests[n].run();
+    _exit(failures ? 1 : 0);
+  }
+  if (pid < 0 || waitpid(pid, &status, 0) < 0)
+    return 1;
+
+  status = !WIFEXITED(status) || WEXITSTATUS(status);
+  printf("%-10s %s\n", tests[n].name, status ? "FAILED" : "ok");
+  return status;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int n;
+  int i, nfailed = 0;
+
+  if (argc < 2)
+    for (n = 0; n < NTESTS; n++)
+      nfailed += run(n);
+
+  for (i = 1; i < argc; i++) {
+    for (n = 0; n < NTESTS && strcmp(argv[i], tests[n].name); n++)
+      ;
+    if (n == NTESTS) {
+      fprintf(stderr, "%s: unknown check %s\n", argv[0], argv[i]);
+      return 2;
+    }
+    nfailed += run(n);
+  }
+
+  return nfailed ? 1 : 0;
+}